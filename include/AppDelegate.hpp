@@ -8,7 +8,9 @@
 
 class MyAppDelegate : public NS::ApplicationDelegate {
  public:
-  MyAppDelegate();
+  explicit MyAppDelegate(const InstanceGrid& grid = kDefaultInstanceGrid,
+      VertexFormat   vertexFormat                = VertexFormat::Float,
+      InstanceFormat instanceFormat              = InstanceFormat::Full);
   virtual ~MyAppDelegate();
 
   NS::Menu* createMenuBar();
@@ -25,6 +27,9 @@ class MyAppDelegate : public NS::ApplicationDelegate {
   MTK::View*         _pMtkView;
   MTL::Device*       _pDevice;
   MyMTKViewDelegate* _pViewDelegate;
+  InstanceGrid       _instanceGrid;
+  VertexFormat       _vertexFormat;
+  InstanceFormat     _instanceFormat;
 };
 
 #endif  // APPDELEGATE_HPP
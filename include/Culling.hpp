@@ -0,0 +1,82 @@
+#ifndef CULLING_HPP
+#define CULLING_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Math.hpp"
+#include "MeshOptimizer.hpp"
+
+// Six inward-facing planes (left, right, bottom, top, near, far) stored as
+// (normal, distance): a point p is inside when dot(normal, p) + w >= 0.
+struct Frustum {
+  Math::float4 planes[6];
+};
+
+// Gribb/Hartmann plane extraction for a Metal-style clip space (z in
+// [0, w]). Passing perspective * view * model yields planes in model space.
+Frustum extractFrustum(const Math::float4x4& clipFromModel);
+
+// Structure-of-arrays bounding spheres.
+struct SphereBounds {
+  const float* pX;
+  const float* pY;
+  const float* pZ;
+  const float* pRadius;
+};
+
+// Per-frame culling counters. `culled` counts frustum rejections and
+// `occluded` the instances the occlusion pass removed from what was left;
+// `visible` is what got submitted.
+struct CullStats {
+  uint32_t visible;
+  uint32_t culled;
+  uint32_t occluded;
+  float    occlusionMs;  // occluder rasterization, Hi-Z build and tests
+};
+
+// Triangles of submitted instances that went through meshlet culling and
+// how many of them it rejected.
+struct MeshletStats {
+  uint64_t triangles;
+  uint64_t backFacing;
+  uint64_t outsideFrustum;
+};
+
+// One instance's camera, moved into the instance's model space so meshlet
+// bounds can be tested without transforming them.
+struct MeshletCullContext {
+  Frustum      frustum;
+  Math::float3 cameraPosition;
+};
+
+enum class MeshletVisibility { Visible, BackFacing, OutsideFrustum };
+
+// `worldFromModel` is the instance transform and must be an invertible
+// affine matrix; back-facing is invariant under those, so the cone test
+// stays exact in model space.
+MeshletCullContext makeMeshletCullContext(const Math::float4x4& clipFromWorld,
+    const Math::float3& cameraPosition, const Math::float4x4& worldFromModel);
+
+// Conservative: every triangle of a BackFacing meshlet faces away from the
+// camera, and an OutsideFrustum meshlet's bounding sphere is entirely
+// outside one of the planes.
+MeshletVisibility cullMeshlet(
+    const MeshletBounds& bounds, const MeshletCullContext& context);
+
+// Number of spheres tested per iteration: 16 with AVX-512, 8 with AVX2, 4
+// with SSE4.1 and 1 for the scalar fallback.
+size_t cullLanes();
+
+// Tests spheres [0, count) against all six planes and writes the indices of
+// those that are at least partially inside, offset by `baseIndex`, to
+// pVisible in ascending order. Returns how many were written; pVisible
+// needs room for `count` entries.
+size_t cullSpheres(const Frustum& frustum, const SphereBounds& bounds,
+    size_t count, uint32_t baseIndex, uint32_t* pVisible);
+
+// Reference implementation, one sphere at a time.
+size_t cullSpheresScalar(const Frustum& frustum, const SphereBounds& bounds,
+    size_t count, uint32_t baseIndex, uint32_t* pVisible);
+
+#endif  // CULLING_HPP
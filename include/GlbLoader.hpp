@@ -0,0 +1,97 @@
+#ifndef GLBLOADER_HPP
+#define GLBLOADER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "JobSystem.hpp"
+#include "MappedFile.hpp"
+#include "Mesh.hpp"
+
+struct GlbStats {
+  size_t primitives;         // triangle primitives loaded
+  size_t skippedPrimitives;  // points, lines, strips and fans
+  size_t mappedMeshes;       // vertices used in place from the file
+  size_t convertedMeshes;    // vertices converted to VertexData
+};
+
+// One triangle primitive of a binary glTF 2.0 (GLB) file, in its mesh's
+// own space; node transforms are not applied.
+//
+// When POSITION and NORMAL are float VEC3 accessors interleaved in one
+// buffer view exactly like shader_types::VertexData (stride 32, normal 16
+// bytes after position, 16-byte aligned), the vertices are not copied:
+// vertexData() points into the mapped file, which the mesh keeps open.
+// Any other layout is converted in parallel. Primitives without normals
+// get flat ones, with every triangle's corners split apart.
+//
+// Indices are always converted: glTF fronts are counter-clockwise, so each
+// triangle's last two corners are swapped to face along cross(c - a, b - a)
+// like the built-in meshes. u8, u16 and u32 indices and non-indexed
+// primitives are accepted.
+class GlbMesh : public Mesh {
+ public:
+  // Maps `path` and appends each triangle primitive to *pMeshes, in mesh
+  // and primitive order. Returns false and sets *pError, naming the file,
+  // on malformed files and on features that are not supported: external
+  // or sparse buffers and non-float positions or normals.
+  static bool load(const char* path, JobSystem& jobSystem,
+      std::vector<std::unique_ptr<GlbMesh>>* pMeshes,
+      std::string* pError = nullptr, GlbStats* pStats = nullptr);
+
+  // Vertices viewed in place in `file`.
+  GlbMesh(std::string name, std::shared_ptr<const MappedFile> file,
+      const shader_types::VertexData* pVertices, size_t numVertices,
+      std::vector<uint32_t> indices)
+      : _name(std::move(name))
+      , _file(std::move(file))
+      , _pVertices(pVertices)
+      , _numVertices(numVertices)
+      , _indices(std::move(indices)) {}
+  // Converted vertices.
+  GlbMesh(std::string name, std::vector<shader_types::VertexData> vertices,
+      std::vector<uint32_t> indices)
+      : _name(std::move(name))
+      , _convertedVertices(std::move(vertices))
+      , _pVertices(_convertedVertices.data())
+      , _numVertices(_convertedVertices.size())
+      , _indices(std::move(indices)) {}
+  // _pVertices may point into _convertedVertices.
+  GlbMesh(const GlbMesh&)            = delete;
+  GlbMesh& operator=(const GlbMesh&) = delete;
+
+  // The glTF mesh name, or "mesh<index>", with "/<primitive>" appended
+  // for meshes of several primitives.
+  const std::string& name() const { return _name; }
+  // Whether vertexData() points into the mapped file.
+  bool isMapped() const { return _file != nullptr; }
+
+  size_t vertexCount() const override { return _numVertices; }
+  size_t indexCount() const override { return _indices.size(); }
+
+  const shader_types::VertexData* vertexData() const override {
+    return _pVertices;
+  }
+  void writeVertices(shader_types::VertexData* pVertices) const override {
+    std::copy(_pVertices, _pVertices + _numVertices, pVertices);
+  }
+  void writeIndices(uint16_t* pIndices) const override {
+    std::copy(_indices.begin(), _indices.end(), pIndices);
+  }
+  void writeIndices(uint32_t* pIndices) const override {
+    std::copy(_indices.begin(), _indices.end(), pIndices);
+  }
+
+ private:
+  std::string                           _name;
+  std::shared_ptr<const MappedFile>     _file;
+  std::vector<shader_types::VertexData> _convertedVertices;
+  const shader_types::VertexData*       _pVertices;
+  size_t                                _numVertices;
+  std::vector<uint32_t>                 _indices;
+};
+
+#endif  // GLBLOADER_HPP
@@ -0,0 +1,82 @@
+#ifndef INSTANCETRANSFORMS_HPP
+#define INSTANCETRANSFORMS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "Math.hpp"
+#include "Mesh.hpp"
+
+// Instance buffer layout uploaded every frame.
+enum class InstanceFormat { Full, Compact };
+
+inline size_t instanceSize(InstanceFormat format) {
+  return format == InstanceFormat::Full
+             ? sizeof(shader_types::InstanceData)
+             : sizeof(shader_types::CompactInstanceData);
+}
+
+// Structure-of-arrays inputs for a batch of instances. Instance i gets
+//
+//   parent * translate(x, y, z) * yRotate(yAngle) * zRotate(zAngle) *
+//       scale(s)
+//
+// which is the product Scene builds for every sphere in the grid.
+struct InstanceTransformParams {
+  const float* pX;
+  const float* pY;
+  const float* pZ;
+  const float* pYAngle;
+  const float* pZAngle;
+  const float* pScale;
+};
+
+// Number of instances the batched kernel produces per iteration: 16 with
+// AVX-512, 8 with AVX2, 1 for the scalar fallback.
+size_t instanceTransformLanes();
+
+// Writes instanceTransform and instanceNormalTransform of pOut[0, count),
+// or transformRows for compact instances. The SIMD paths expand the
+// product analytically and evaluate sin/cos with a vectorized polynomial;
+// colors are left untouched.
+void computeInstanceTransforms(const Math::float4x4& parent,
+    const InstanceTransformParams& params, size_t count,
+    shader_types::InstanceData* pOut);
+
+void computeInstanceTransforms(const Math::float4x4& parent,
+    const InstanceTransformParams& params, size_t count,
+    shader_types::CompactInstanceData* pOut);
+
+// Reference implementation: one AoS float4x4 product chain per instance.
+void computeInstanceTransformsScalar(const Math::float4x4& parent,
+    const InstanceTransformParams& params, size_t count,
+    shader_types::InstanceData* pOut);
+
+// Clamps each channel to [0, 1] and rounds it to 8 bits, like Metal's
+// pack_float_to_unorm4x8.
+inline uint32_t packUnorm4x8(const Math::float4& color) {
+  const float channels[4] = {color.x, color.y, color.z, color.w};
+  uint32_t    packed      = 0;
+  for (int c = 0; c < 4; ++c) {
+    const float v = std::min(std::max(channels[c], 0.f), 1.f);
+    packed |= uint32_t(lrintf(v * 255.f)) << (8 * c);
+  }
+  return packed;
+}
+
+inline Math::float4 unpackUnorm4x8(uint32_t packed) {
+  return {float(packed & 0xff) / 255.f, float(packed >> 8 & 0xff) / 255.f,
+      float(packed >> 16 & 0xff) / 255.f, float(packed >> 24) / 255.f};
+}
+
+// Rebuilds the full transform of a compact instance.
+inline Math::float4x4 instanceTransform(
+    const shader_types::CompactInstanceData& instance) {
+  return Math::matrixFromRows(instance.transformRows[0],
+      instance.transformRows[1], instance.transformRows[2],
+      (Math::float4){0.f, 0.f, 0.f, 1.f});
+}
+
+#endif  // INSTANCETRANSFORMS_HPP
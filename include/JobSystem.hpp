@@ -0,0 +1,87 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tracks a group of jobs; wait() returns once `pending` drops to zero.
+struct JobCounter {
+  std::atomic<size_t> pending{0};
+};
+
+// Work-stealing thread pool. Every worker owns a deque: it pops its own jobs
+// LIFO and, when it runs dry, steals FIFO from the others. Threads that are
+// not workers (e.g. the render thread) submit through a shared queue and
+// help execute jobs while they wait, so a JobSystem built with N threads
+// keeps N cores busy including the caller.
+class JobSystem {
+ public:
+  using Job = std::function<void()>;
+
+  explicit JobSystem(
+      unsigned int numThreads = std::thread::hardware_concurrency());
+  ~JobSystem();
+
+  JobSystem(const JobSystem&)            = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  unsigned int numThreads() const { return _numThreads; }
+
+  void run(Job job, JobCounter& counter);
+  void wait(JobCounter& counter);
+
+  // Calls fn(begin, end) over [0, count) in chunks of at most `grain`
+  // elements and returns when every chunk has finished.
+  template <typename Fn>
+  void parallelFor(size_t count, size_t grain, const Fn& fn) {
+    grain                = std::max<size_t>(grain, 1);
+    const size_t numJobs = (count + grain - 1) / grain;
+    if (numJobs <= 1 || _workers.empty()) {
+      if (count > 0) fn(size_t(0), count);
+      return;
+    }
+
+    JobCounter counter;
+    counter.pending.store(numJobs, std::memory_order_relaxed);
+    for (size_t job = 0; job < numJobs; ++job) {
+      const size_t begin = job * grain;
+      const size_t end   = std::min(begin + grain, count);
+      push(job % _queues.size(), [&fn, &counter, begin, end] {
+        fn(begin, end);
+        counter.pending.fetch_sub(1, std::memory_order_release);
+      });
+    }
+    wakeWorkers();
+    wait(counter);
+  }
+
+ private:
+  struct WorkQueue {
+    std::mutex      mutex;
+    std::deque<Job> jobs;
+  };
+
+  unsigned int                            _numThreads;
+  std::vector<std::unique_ptr<WorkQueue>> _queues;
+  std::vector<std::thread>                _workers;
+  std::atomic<size_t>                     _numQueued;
+  std::mutex                              _sleepMutex;
+  std::condition_variable                 _wake;
+  bool                                    _stop;
+
+  void   push(size_t queue, Job job);
+  void   wakeWorkers();
+  bool   tryRunJob(size_t queue);
+  size_t currentQueue() const;
+  void   workerMain(size_t queue);
+};
+
+#endif  // JOBSYSTEM_HPP
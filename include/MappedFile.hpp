@@ -0,0 +1,33 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are read in on first
+// touch, so several threads can parse disjoint parts of a large file
+// without copying it first. An empty file maps to nullptr with size 0.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Maps `path`, unmapping whatever was mapped before. On failure returns
+  // false and, when pError is set, stores a message naming the file.
+  bool open(const char* path, std::string* pError = nullptr);
+  void close();
+
+  const char* data() const { return _pData; }
+  size_t      size() const { return _size; }
+
+ private:
+  const char* _pData = nullptr;
+  size_t      _size  = 0;
+};
+
+#endif  // MAPPEDFILE_HPP
@@ -0,0 +1,377 @@
+#ifndef MATHTYPES_HPP
+#define MATHTYPES_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Portable stand-ins for the <simd/simd.h> types. Sizes and alignments match
+// Metal's float3/float4/float3x3/float4x4/half3 so the shader_types structs
+// can be memcpy'd into MTL::Buffers unchanged.
+//
+// The backend is picked at compile time from the target flags: -mavx2
+// (optionally with -mfma) selects AVX2, -msse4.1 selects SSE4, anything else
+// (including Apple silicon) falls back to scalar code. Define
+// MATH_FORCE_SCALAR to force the scalar path on x86.
+#if !defined(MATH_FORCE_SCALAR) && defined(__AVX2__)
+#define MATH_BACKEND_AVX2 1
+#define MATH_BACKEND_SSE4 1
+#include <immintrin.h>
+#elif !defined(MATH_FORCE_SCALAR) && defined(__SSE4_1__)
+#define MATH_BACKEND_SSE4 1
+#include <smmintrin.h>
+#else
+#define MATH_BACKEND_SCALAR 1
+#endif
+
+namespace Math {
+
+#if defined(MATH_BACKEND_AVX2)
+constexpr const char* kBackendName = "avx2";
+#elif defined(MATH_BACKEND_SSE4)
+constexpr const char* kBackendName = "sse4";
+#else
+constexpr const char* kBackendName = "scalar";
+#endif
+
+struct alignas(8) float2 {
+  float x;
+  float y;
+};
+
+struct alignas(16) float3 {
+  float x;
+  float y;
+  float z;
+  float _pad = 0.f;
+};
+
+struct alignas(16) float4 {
+  float x;
+  float y;
+  float z;
+  float w;
+
+  constexpr float3 xyz() const { return {x, y, z}; }
+};
+
+struct float3x3 {
+  float3 columns[3];
+};
+
+struct float4x4 {
+  float4 columns[4];
+};
+
+// IEEE binary16 storage type, converted with round-to-nearest-even.
+struct half {
+  uint16_t bits;
+
+  half() = default;
+  half(float f) : bits(fromFloat(f)) {}
+
+  operator float() const { return toFloat(bits); }
+
+  static uint16_t fromFloat(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    const uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+
+    uint16_t h;
+    if (u >= (143u << 23)) {
+      h = u > (255u << 23) ? 0x7e00 : 0x7c00;
+    } else if (u < (113u << 23)) {
+      // Subnormal or zero: let the FPU round the mantissa into place.
+      float v;
+      std::memcpy(&v, &u, sizeof(v));
+      v += 0.5f;
+      std::memcpy(&u, &v, sizeof(u));
+      h = static_cast<uint16_t>(u - (126u << 23));
+    } else {
+      const uint32_t mantissaOdd = (u >> 13) & 1;
+      u += (uint32_t(15 - 127) << 23) + 0xfff + mantissaOdd;
+      h = static_cast<uint16_t>(u >> 13);
+    }
+    return static_cast<uint16_t>(h | (sign >> 16));
+  }
+
+  static float toFloat(uint16_t h) {
+    const uint32_t shiftedExp = 0x7c00u << 13;
+    uint32_t       u          = (h & 0x7fffu) << 13;
+    const uint32_t exp        = u & shiftedExp;
+    u += uint32_t(127 - 15) << 23;
+    float f;
+    if (exp == shiftedExp) {
+      u += uint32_t(128 - 16) << 23;
+      std::memcpy(&f, &u, sizeof(f));
+    } else if (exp == 0) {
+      u += 1u << 23;
+      std::memcpy(&f, &u, sizeof(f));
+      f -= 6.103515625e-05f;  // 2^-14
+    } else {
+      std::memcpy(&f, &u, sizeof(f));
+    }
+    uint32_t out;
+    std::memcpy(&out, &f, sizeof(out));
+    out |= uint32_t(h & 0x8000u) << 16;
+    std::memcpy(&f, &out, sizeof(f));
+    return f;
+  }
+};
+
+struct alignas(8) half3 {
+  half x;
+  half y;
+  half z;
+};
+
+static_assert(sizeof(float2) == 8, "float2 must match Metal's layout");
+static_assert(sizeof(float3) == 16, "float3 must match Metal's layout");
+static_assert(sizeof(float4) == 16, "float4 must match Metal's layout");
+static_assert(sizeof(float3x3) == 48, "float3x3 must match Metal's layout");
+static_assert(sizeof(float4x4) == 64, "float4x4 must match Metal's layout");
+static_assert(sizeof(half3) == 8, "half3 must match Metal's layout");
+
+// float3
+
+constexpr float3 operator+(const float3& a, const float3& b) {
+  return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+constexpr float3 operator-(const float3& a, const float3& b) {
+  return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+constexpr float3 operator*(const float3& a, const float3& b) {
+  return {a.x * b.x, a.y * b.y, a.z * b.z};
+}
+constexpr float3 operator/(const float3& a, const float3& b) {
+  return {a.x / b.x, a.y / b.y, a.z / b.z};
+}
+constexpr float3 operator*(const float3& a, float s) {
+  return {a.x * s, a.y * s, a.z * s};
+}
+constexpr float3 operator*(float s, const float3& a) { return a * s; }
+constexpr float3 operator/(const float3& a, float s) {
+  return {a.x / s, a.y / s, a.z / s};
+}
+constexpr float3 operator-(const float3& a) { return {-a.x, -a.y, -a.z}; }
+inline float3&   operator+=(float3& a, const float3& b) { return a = a + b; }
+inline float3&   operator-=(float3& a, const float3& b) { return a = a - b; }
+inline float3&   operator*=(float3& a, float s) { return a = a * s; }
+
+constexpr float dot(const float3& a, const float3& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+constexpr float3 cross(const float3& a, const float3& b) {
+  return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+      a.x * b.y - a.y * b.x};
+}
+inline float  length(const float3& a) { return sqrtf(dot(a, a)); }
+inline float3 normalize(const float3& a) { return a * (1.f / length(a)); }
+
+// float4
+
+constexpr float4 operator+(const float4& a, const float4& b) {
+  return {a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+}
+constexpr float4 operator-(const float4& a, const float4& b) {
+  return {a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w};
+}
+constexpr float4 operator*(const float4& a, const float4& b) {
+  return {a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w};
+}
+constexpr float4 operator*(const float4& a, float s) {
+  return {a.x * s, a.y * s, a.z * s, a.w * s};
+}
+constexpr float4 operator*(float s, const float4& a) { return a * s; }
+constexpr float4 operator-(const float4& a) {
+  return {-a.x, -a.y, -a.z, -a.w};
+}
+
+constexpr float dot(const float4& a, const float4& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+// Matrix construction helpers mirroring simd_matrix / simd_matrix_from_rows.
+
+constexpr float3x3 matrixFromColumns(
+    const float3& c0, const float3& c1, const float3& c2) {
+  return {{c0, c1, c2}};
+}
+
+constexpr float4x4 matrixFromColumns(
+    const float4& c0, const float4& c1, const float4& c2, const float4& c3) {
+  return {{c0, c1, c2, c3}};
+}
+
+constexpr float4x4 matrixFromRows(
+    const float4& r0, const float4& r1, const float4& r2, const float4& r3) {
+  return {{{r0.x, r1.x, r2.x, r3.x}, {r0.y, r1.y, r2.y, r3.y},
+      {r0.z, r1.z, r2.z, r3.z}, {r0.w, r1.w, r2.w, r3.w}}};
+}
+
+// Backend kernels. Everything above is plain C++ the compiler vectorizes on
+// its own; the products below are where the explicit SIMD paths pay off.
+
+namespace detail {
+
+#if defined(MATH_BACKEND_SSE4)
+inline __m128 madd(__m128 a, __m128 b, __m128 c) {
+#if defined(__FMA__)
+  return _mm_fmadd_ps(a, b, c);
+#else
+  return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+// m * v for a column-major matrix held in four registers.
+inline __m128 combine(
+    __m128 v, __m128 c0, __m128 c1, __m128 c2, __m128 c3) {
+  __m128 r = _mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), c0);
+  r        = madd(_mm_shuffle_ps(v, v, 0x55), c1, r);
+  r        = madd(_mm_shuffle_ps(v, v, 0xaa), c2, r);
+  return madd(_mm_shuffle_ps(v, v, 0xff), c3, r);
+}
+
+// combine() with the products summed as a tree, so each column waits on
+// two dependent adds instead of three.
+inline __m128 combineTree(
+    __m128 v, __m128 c0, __m128 c1, __m128 c2, __m128 c3) {
+  const __m128 r01 = madd(_mm_shuffle_ps(v, v, 0x55), c1,
+      _mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), c0));
+  const __m128 r23 = madd(_mm_shuffle_ps(v, v, 0xff), c3,
+      _mm_mul_ps(_mm_shuffle_ps(v, v, 0xaa), c2));
+  return _mm_add_ps(r01, r23);
+}
+#endif
+
+#if defined(MATH_BACKEND_AVX2)
+inline __m256 madd(__m256 a, __m256 b, __m256 c) {
+#if defined(__FMA__)
+  return _mm256_fmadd_ps(a, b, c);
+#else
+  return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+// Two independent m * v products, one per 128-bit lane.
+inline __m256 combine(
+    __m256 v, __m256 c0, __m256 c1, __m256 c2, __m256 c3) {
+  __m256 r = _mm256_mul_ps(_mm256_shuffle_ps(v, v, 0x00), c0);
+  r        = madd(_mm256_shuffle_ps(v, v, 0x55), c1, r);
+  r        = madd(_mm256_shuffle_ps(v, v, 0xaa), c2, r);
+  return madd(_mm256_shuffle_ps(v, v, 0xff), c3, r);
+}
+#endif
+
+}  // namespace detail
+
+inline float4 operator*(const float4x4& m, const float4& v) {
+#if defined(MATH_BACKEND_SSE4)
+  float4 out;
+  _mm_store_ps(&out.x,
+      detail::combine(_mm_load_ps(&v.x), _mm_load_ps(&m.columns[0].x),
+          _mm_load_ps(&m.columns[1].x), _mm_load_ps(&m.columns[2].x),
+          _mm_load_ps(&m.columns[3].x)));
+  return out;
+#else
+  return m.columns[0] * v.x + m.columns[1] * v.y + m.columns[2] * v.z +
+         m.columns[3] * v.w;
+#endif
+}
+
+inline float4x4 operator*(const float4x4& a, const float4x4& b) {
+  float4x4 out;
+#if defined(MATH_BACKEND_AVX2)
+  const __m256 c0 = _mm256_broadcast_ps(
+      reinterpret_cast<const __m128*>(&a.columns[0]));
+  const __m256 c1 = _mm256_broadcast_ps(
+      reinterpret_cast<const __m128*>(&a.columns[1]));
+  const __m256 c2 = _mm256_broadcast_ps(
+      reinterpret_cast<const __m128*>(&a.columns[2]));
+  const __m256 c3 = _mm256_broadcast_ps(
+      reinterpret_cast<const __m128*>(&a.columns[3]));
+  _mm256_storeu_ps(&out.columns[0].x,
+      detail::combine(_mm256_loadu_ps(&b.columns[0].x), c0, c1, c2, c3));
+  _mm256_storeu_ps(&out.columns[2].x,
+      detail::combine(_mm256_loadu_ps(&b.columns[2].x), c0, c1, c2, c3));
+#elif defined(MATH_BACKEND_SSE4)
+  const __m128 c0 = _mm_load_ps(&a.columns[0].x);
+  const __m128 c1 = _mm_load_ps(&a.columns[1].x);
+  const __m128 c2 = _mm_load_ps(&a.columns[2].x);
+  const __m128 c3 = _mm_load_ps(&a.columns[3].x);
+  // Columns are written out rather than looped over so that all four stay
+  // in registers; a loop round-trips each one through the stack.
+  const __m128 r0 = detail::combineTree(
+      _mm_load_ps(&b.columns[0].x), c0, c1, c2, c3);
+  const __m128 r1 = detail::combineTree(
+      _mm_load_ps(&b.columns[1].x), c0, c1, c2, c3);
+  const __m128 r2 = detail::combineTree(
+      _mm_load_ps(&b.columns[2].x), c0, c1, c2, c3);
+  const __m128 r3 = detail::combineTree(
+      _mm_load_ps(&b.columns[3].x), c0, c1, c2, c3);
+  _mm_store_ps(&out.columns[0].x, r0);
+  _mm_store_ps(&out.columns[1].x, r1);
+  _mm_store_ps(&out.columns[2].x, r2);
+  _mm_store_ps(&out.columns[3].x, r3);
+#else
+  for (int j = 0; j < 4; ++j) {
+    out.columns[j] = a * b.columns[j];
+  }
+#endif
+  return out;
+}
+
+inline float3 operator*(const float3x3& m, const float3& v) {
+#if defined(MATH_BACKEND_SSE4)
+  const __m128 vv = _mm_load_ps(&v.x);
+  __m128 r = _mm_mul_ps(_mm_shuffle_ps(vv, vv, 0x00),
+      _mm_load_ps(&m.columns[0].x));
+  r = detail::madd(
+      _mm_shuffle_ps(vv, vv, 0x55), _mm_load_ps(&m.columns[1].x), r);
+  r = detail::madd(
+      _mm_shuffle_ps(vv, vv, 0xaa), _mm_load_ps(&m.columns[2].x), r);
+  float3 out;
+  _mm_store_ps(&out.x, r);
+  return out;
+#else
+  return m.columns[0] * v.x + m.columns[1] * v.y + m.columns[2] * v.z;
+#endif
+}
+
+// Transforms `count` vectors by `m`; pIn and pOut may alias.
+inline void transform(
+    const float4x4& m, const float4* pIn, float4* pOut, size_t count) {
+  size_t i = 0;
+#if defined(MATH_BACKEND_AVX2)
+  const __m256 c0 = _mm256_broadcast_ps(
+      reinterpret_cast<const __m128*>(&m.columns[0]));
+  const __m256 c1 = _mm256_broadcast_ps(
+      reinterpret_cast<const __m128*>(&m.columns[1]));
+  const __m256 c2 = _mm256_broadcast_ps(
+      reinterpret_cast<const __m128*>(&m.columns[2]));
+  const __m256 c3 = _mm256_broadcast_ps(
+      reinterpret_cast<const __m128*>(&m.columns[3]));
+  for (; i + 2 <= count; i += 2) {
+    _mm256_storeu_ps(&pOut[i].x,
+        detail::combine(_mm256_loadu_ps(&pIn[i].x), c0, c1, c2, c3));
+  }
+#elif defined(MATH_BACKEND_SSE4)
+  const __m128 c0 = _mm_load_ps(&m.columns[0].x);
+  const __m128 c1 = _mm_load_ps(&m.columns[1].x);
+  const __m128 c2 = _mm_load_ps(&m.columns[2].x);
+  const __m128 c3 = _mm_load_ps(&m.columns[3].x);
+  for (; i < count; ++i) {
+    _mm_store_ps(&pOut[i].x,
+        detail::combine(_mm_load_ps(&pIn[i].x), c0, c1, c2, c3));
+  }
+#endif
+  for (; i < count; ++i) {
+    pOut[i] = m * pIn[i];
+  }
+}
+
+}  // namespace Math
+
+#endif  // MATHTYPES_HPP
@@ -1,45 +1,91 @@
 #ifndef MESH_HPP
 #define MESH_HPP
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <vector>
 
+#include "JobSystem.hpp"
 #include "Math.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "ShaderTypes.hpp"
+#include "VertexQuantization.hpp"
 
-namespace shader_types {
-struct VertexData {
-  simd::float3 position;
-  simd::float3 normal;
-};
+// Width of a mesh's indices. 16-bit indices halve index fetch bandwidth and
+// are used whenever every vertex is addressable with them.
+enum class IndexType { UInt16, UInt32 };
 
-struct InstanceData {
-  simd::float4x4 instanceTransform;
-  simd::float3x3 instanceNormalTransform;
-  simd::float4   instanceColor;
-};
+inline IndexType indexTypeForVertexCount(size_t numVertices) {
+  return numVertices <= size_t(std::numeric_limits<uint16_t>::max()) + 1
+             ? IndexType::UInt16
+             : IndexType::UInt32;
+}
 
-struct CameraData {
-  simd::float4x4 perspectiveTransform;
-  simd::float4x4 worldTransform;
-  simd::float3x3 worldNormalTransform;
-};
-struct LightData {
-  simd::float3 position;
-  simd::half3  color;
-  float        intensity;
-  float        range;
-  float        pulseSpeed;
-  float        time;
-};
-}  // namespace shader_types
+inline size_t indexSize(IndexType type) {
+  return type == IndexType::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
 
+// Procedural or loaded geometry. Meshes report their exact sizes up front
+// and generate straight into caller-provided storage, such as the mapped
+// contents of a GPU buffer, so no intermediate copies are needed.
 class Mesh {
  public:
   virtual ~Mesh() = default;
 
-  virtual std::vector<shader_types::VertexData> getVertices() const = 0;
-  virtual std::vector<uint16_t>                 getIndices() const  = 0;
+  virtual size_t vertexCount() const = 0;
+  virtual size_t indexCount() const  = 0;
+
+  // The narrowest index width that can address every vertex.
+  IndexType indexType() const { return indexTypeForVertexCount(vertexCount()); }
+
+  // pVertices/pIndices must have room for vertexCount()/indexCount()
+  // elements. The 16-bit overload requires indexType() == UInt16.
+  virtual void writeVertices(shader_types::VertexData* pVertices) const = 0;
+  virtual void writeIndices(uint16_t* pIndices) const                   = 0;
+  virtual void writeIndices(uint32_t* pIndices) const                   = 0;
+
+  // Writes indexCount() indices of width `type` to pIndexData.
+  void writeIndices(void* pIndexData, IndexType type) const {
+    if (type == IndexType::UInt16) {
+      writeIndices(static_cast<uint16_t*>(pIndexData));
+    } else {
+      writeIndices(static_cast<uint32_t*>(pIndexData));
+    }
+  }
+
+  // vertexCount() vertices already stored as VertexData, e.g. in a mapped
+  // file, or nullptr if only writeVertices() can produce them. Callers
+  // that upload from a pointer can hand these over without a copy.
+  virtual const shader_types::VertexData* vertexData() const {
+    return nullptr;
+  }
+
+  // Convenience copies for code that wants owning containers.
+  std::vector<shader_types::VertexData> getVertices() const {
+    std::vector<shader_types::VertexData> vertices(vertexCount());
+    writeVertices(vertices.data());
+    return vertices;
+  }
+  std::vector<uint32_t> getIndices() const {
+    std::vector<uint32_t> indices(indexCount());
+    writeIndices(indices.data());
+    return indices;
+  }
+
+  // Meshlets over the triangles in writeIndices() order. By default the
+  // index buffer is cut up as it is, within the normal cone; meshes that
+  // cluster their triangles return their own, tighter meshlets.
+  virtual std::vector<Meshlet> getMeshlets() const {
+    const std::vector<shader_types::VertexData> vertices = getVertices();
+    const VertexStream                          position = {
+        &vertices.data()->position.x, sizeof(shader_types::VertexData), 3};
+    return buildMeshlets(
+        getIndices().data(), indexCount(), vertexCount(), &position);
+  }
 };
 
 class SphereMesh : public Mesh {
@@ -47,60 +93,118 @@ class SphereMesh : public Mesh {
   SphereMesh(float radius, unsigned int stacks, unsigned int slices)
       : radius_(radius), stacks_(stacks), slices_(slices) {}
 
-  std::vector<shader_types::VertexData> getVertices() const override {
-    std::vector<shader_types::VertexData> vertices;
-    for (unsigned int i = 0; i <= stacks_; ++i) {
-      float V   = static_cast<float>(i) / static_cast<float>(stacks_);
-      float phi = V * M_PI;
-      for (unsigned int j = 0; j <= slices_; ++j) {
-        float U     = static_cast<float>(j) / static_cast<float>(slices_);
-        float theta = U * (M_PI * 2);
+  size_t vertexCount() const override {
+    return size_t(stacks_ + 1) * (slices_ + 1);
+  }
+  size_t indexCount() const override { return size_t(stacks_) * slices_ * 6; }
 
-        float x = radius_ * sinf(phi) * cosf(theta);
-        float y = radius_ * cosf(phi);
-        float z = radius_ * sinf(phi) * sinf(theta);
+  void writeVertices(shader_types::VertexData* pVertices) const override {
+    const TrigTables tables = makeTrigTables();
+    writeRows(pVertices, tables, 0, stacks_ + 1);
+  }
+
+  // Same vertices as writeVertices(pVertices), with the rows split across
+  // `jobSystem`. Worth it for stress-test spheres with millions of vertices.
+  void writeVertices(
+      shader_types::VertexData* pVertices, JobSystem& jobSystem) const {
+    const TrigTables tables = makeTrigTables();
+    const size_t     grain  = std::max<size_t>(
+        1, kVerticesPerJob / (size_t(slices_) + 1));
+    jobSystem.parallelFor(
+        size_t(stacks_) + 1, grain, [&](size_t begin, size_t end) {
+          writeRows(pVertices, tables, unsigned(begin), unsigned(end));
+        });
+  }
 
-        float nx = x / radius_;
-        float ny = y / radius_;
-        float nz = z / radius_;
+  void writeIndices(uint16_t* pIndices) const override {
+    writeIndicesAs(pIndices);
+  }
+  void writeIndices(uint32_t* pIndices) const override {
+    writeIndicesAs(pIndices);
+  }
+
+ private:
+  // Vertices written per job by the parallel writeVertices().
+  static constexpr size_t kVerticesPerJob = 64 * 1024;
 
-        vertices.push_back({{x, y, z}, {nx, ny, nz}});
+  // sin and cos of every stack's polar angle and every slice's azimuth, so
+  // each vertex costs a few multiplies instead of five trig calls.
+  struct TrigTables {
+    std::vector<float> sinPhi, cosPhi;
+    std::vector<float> sinTheta, cosTheta;
+  };
+
+  float        radius_;
+  unsigned int stacks_;
+  unsigned int slices_;
+
+  TrigTables makeTrigTables() const {
+    TrigTables tables;
+    tables.sinPhi.resize(stacks_ + 1);
+    tables.cosPhi.resize(stacks_ + 1);
+    for (unsigned int i = 0; i <= stacks_; ++i) {
+      float V          = static_cast<float>(i) / static_cast<float>(stacks_);
+      float phi        = V * M_PI;
+      tables.sinPhi[i] = sinf(phi);
+      tables.cosPhi[i] = cosf(phi);
+    }
+    tables.sinTheta.resize(slices_ + 1);
+    tables.cosTheta.resize(slices_ + 1);
+    for (unsigned int j = 0; j <= slices_; ++j) {
+      float U            = static_cast<float>(j) / static_cast<float>(slices_);
+      float theta        = U * (M_PI * 2);
+      tables.sinTheta[j] = sinf(theta);
+      tables.cosTheta[j] = cosf(theta);
+    }
+    return tables;
+  }
+
+  // Writes the vertices of rows [firstRow, lastRow).
+  void writeRows(shader_types::VertexData* pVertices, const TrigTables& tables,
+      unsigned int firstRow, unsigned int lastRow) const {
+    const float* pSinTheta = tables.sinTheta.data();
+    const float* pCosTheta = tables.cosTheta.data();
+    pVertices += size_t(firstRow) * (slices_ + 1);
+    for (unsigned int i = firstRow; i < lastRow; ++i) {
+      const float sinPhi = tables.sinPhi[i];
+      const float cosPhi = tables.cosPhi[i];
+      const float ring   = radius_ * sinPhi;
+      const float y      = radius_ * cosPhi;
+      for (unsigned int j = 0; j <= slices_; ++j) {
+        *pVertices++ = {{ring * pCosTheta[j], y, ring * pSinTheta[j]},
+            {sinPhi * pCosTheta[j], cosPhi, sinPhi * pSinTheta[j]}};
       }
     }
-    return vertices;
   }
 
-  std::vector<uint16_t> getIndices() const override {
-    std::vector<uint16_t> indices;
+  template <typename Index>
+  void writeIndicesAs(Index* pIndices) const {
     for (unsigned int i = 0; i < stacks_; ++i) {
       for (unsigned int j = 0; j < slices_; ++j) {
-        uint16_t first  = (i * (slices_ + 1)) + j;
-        uint16_t second = first + slices_ + 1;
+        const uint32_t first  = (i * (slices_ + 1)) + j;
+        const uint32_t second = first + slices_ + 1;
 
-        indices.push_back(first);
-        indices.push_back(second);
-        indices.push_back(first + 1);
+        *pIndices++ = Index(first);
+        *pIndices++ = Index(second);
+        *pIndices++ = Index(first + 1);
 
-        indices.push_back(second);
-        indices.push_back(second + 1);
-        indices.push_back(first + 1);
+        *pIndices++ = Index(second);
+        *pIndices++ = Index(second + 1);
+        *pIndices++ = Index(first + 1);
       }
     }
-    return indices;
   }
-
- private:
-  float        radius_;
-  unsigned int stacks_;
-  unsigned int slices_;
 };
 
 class CubeMesh : public Mesh {
  public:
   CubeMesh(float sideLength) : s(sideLength) {}
 
-  std::vector<shader_types::VertexData> getVertices() const override {
-    std::vector<shader_types::VertexData> vertices = {
+  size_t vertexCount() const override { return 24; }
+  size_t indexCount() const override { return 36; }
+
+  void writeVertices(shader_types::VertexData* pVertices) const override {
+    const shader_types::VertexData vertices[] = {
         //   Positions          Normals
         {{-s, -s, +s}, {0.f, 0.f, 1.f}},
         {{+s, -s, +s}, {0.f, 0.f, 1.f}},
@@ -132,11 +236,22 @@ class CubeMesh : public Mesh {
         {{+s, -s, +s}, {0.f, -1.f, 0.f}},
         {{-s, -s, +s}, {0.f, -1.f, 0.f}},
     };
-    return vertices;
+    std::copy(std::begin(vertices), std::end(vertices), pVertices);
+  }
+
+  void writeIndices(uint16_t* pIndices) const override {
+    writeIndicesAs(pIndices);
+  }
+  void writeIndices(uint32_t* pIndices) const override {
+    writeIndicesAs(pIndices);
   }
 
-  std::vector<uint16_t> getIndices() const override {
-    std::vector<uint16_t> indices = {
+ private:
+  float s;
+
+  template <typename Index>
+  void writeIndicesAs(Index* pIndices) const {
+    const uint16_t indices[] = {
         0, 1, 2, 2, 3, 0,        // front
         4, 5, 6, 6, 7, 4,        // right
         8, 9, 10, 10, 11, 8,     // back
@@ -144,21 +259,844 @@ class CubeMesh : public Mesh {
         16, 17, 18, 18, 19, 16,  // top
         20, 21, 22, 22, 23, 20,  // bottom
     };
-    return indices;
+    std::copy(std::begin(indices), std::end(indices), pIndices);
+  }
+};
+
+// How finely a curved mesh is tessellated: the largest distance allowed
+// between any point of the mesh and the true surface, in position units.
+struct TessellationTarget {
+  float maxError;
+
+  // The same bound in pixels, for a surface of `radius` whose radius
+  // covers `radiusPixels` on screen.
+  static TessellationTarget screenSpace(
+      float radius, float radiusPixels, float maxErrorPixels) {
+    return {radius * maxErrorPixels / radiusPixels};
+  }
+};
+
+// Largest distance between a triangle inscribed in a sphere of `radius`
+// around the origin and the sphere: the radius minus the distance from the
+// origin to the triangle's nearest point. Evaluated in double, since the
+// two distances agree to within the error being measured.
+inline double inscribedTriangleError(const Math::float3& a,
+    const Math::float3& b, const Math::float3& c, double radius) {
+  const double p[3][3] = {
+      {a.x, a.y, a.z}, {b.x, b.y, b.z}, {c.x, c.y, c.z}};
+  auto dot = [](const double* u, const double* v) {
+    return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+  };
+  auto cross = [](const double* u, const double* v, double* w) {
+    w[0] = u[1] * v[2] - u[2] * v[1];
+    w[1] = u[2] * v[0] - u[0] * v[2];
+    w[2] = u[0] * v[1] - u[1] * v[0];
+  };
+
+  // Nearest point on each edge, which is where the nearest point lies
+  // unless the foot of the perpendicular from the origin is inside.
+  double nearest = radius;
+  for (int i = 0; i < 3; ++i) {
+    const double* u    = p[i];
+    const double* v    = p[(i + 1) % 3];
+    const double  d[3] = {v[0] - u[0], v[1] - u[1], v[2] - u[2]};
+    const double  dd   = dot(d, d);
+    const double  t = dd > 0.0 ? std::clamp(-dot(u, d) / dd, 0.0, 1.0) : 0.0;
+    const double  q[3] = {u[0] + d[0] * t, u[1] + d[1] * t, u[2] + d[2] * t};
+    nearest            = std::min(nearest, std::sqrt(dot(q, q)));
+  }
+
+  const double e1[3] = {
+      p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+  const double e2[3] = {
+      p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+  double n[3];
+  cross(e1, e2, n);
+  const double nn = dot(n, n);
+  if (nn > 0.0) {
+    const double t       = dot(n, p[0]) / nn;
+    const double foot[3] = {n[0] * t, n[1] * t, n[2] * t};
+    bool         inside  = true;
+    for (int i = 0; i < 3 && inside; ++i) {
+      const double* u    = p[i];
+      const double* v    = p[(i + 1) % 3];
+      const double  d[3] = {v[0] - u[0], v[1] - u[1], v[2] - u[2]};
+      const double  f[3] = {foot[0] - u[0], foot[1] - u[1], foot[2] - u[2]};
+      double        w[3];
+      cross(d, f, w);
+      inside = dot(w, n) >= 0.0;
+    }
+    if (inside) nearest = std::min(nearest, std::fabs(t) * std::sqrt(nn));
+  }
+  return radius - nearest;
+}
+
+// Smallest level in [1, maxLevel] whose error(level) is at most maxError,
+// for errors that fall off roughly as 1 / level^2. A few jumps along that
+// model get close before stepping one level at a time.
+template <typename ErrorFn>
+unsigned int tessellationLevelForError(
+    float maxError, unsigned int maxLevel, const ErrorFn& error) {
+  unsigned int level = 1;
+  double       e     = error(level);
+  for (int jump = 0; jump < 4 && e > maxError && level < maxLevel; ++jump) {
+    level = unsigned(std::clamp(std::ceil(level * std::sqrt(e / maxError)),
+        double(level + 1), double(maxLevel)));
+    e     = error(level);
+  }
+  while (level > 1 && error(level - 1) <= maxError) --level;
+  while (level < maxLevel && error(level) > maxError) ++level;
+  return level;
+}
+
+// Geodesic sphere: an icosahedron whose faces are each split into
+// frequency^2 triangles, with every vertex pushed out onto the sphere.
+// The triangles stay close to equilateral and to one size, so a given
+// error takes far fewer of them than the UV sphere, which crowds its
+// triangles at the poles. Vertices are shared across faces.
+class IcosphereMesh : public Mesh {
+ public:
+  // Keeps 10 * frequency^2 + 2 vertices within 32-bit indices.
+  static constexpr unsigned int kMaxFrequency = 16384;
+
+  IcosphereMesh(float radius, unsigned int frequency)
+      : radius_(radius)
+      , frequency_(std::clamp(frequency, 1u, kMaxFrequency)) {}
+
+  // The coarsest icosphere within target.maxError of the sphere.
+  IcosphereMesh(float radius, TessellationTarget target)
+      : IcosphereMesh(radius, frequencyForError(radius, target.maxError)) {}
+
+  static unsigned int frequencyForError(float radius, float maxError) {
+    return tessellationLevelForError(maxError, kMaxFrequency,
+        [&](unsigned int f) { return errorForFrequency(radius, f); });
+  }
+
+  // Every face is congruent, so the first one stands for all of them.
+  static double errorForFrequency(float radius, unsigned int frequency) {
+    const IcosphereMesh mesh(radius, frequency);
+    const uint8_t*      abc   = kFaces[0];
+    const unsigned int  n     = mesh.frequency_;
+    double              error = 0.0;
+    auto                at    = [&](unsigned int i, unsigned int j) {
+      return mesh.vertex(mesh.point(abc[0], abc[1], abc[2], n - i, i - j, j))
+          .position;
+    };
+    mesh.forEachTriangle([&](unsigned int i0, unsigned int j0,
+                             unsigned int i1, unsigned int j1,
+                             unsigned int i2, unsigned int j2) {
+      error = std::max(error,
+          inscribedTriangleError(at(i0, j0), at(i1, j1), at(i2, j2), radius));
+    });
+    return error;
+  }
+
+  unsigned int frequency() const { return frequency_; }
+  float        maxError() const {
+    return float(errorForFrequency(radius_, frequency_));
+  }
+
+  size_t vertexCount() const override {
+    return 10 * size_t(frequency_) * frequency_ + 2;
+  }
+  size_t indexCount() const override {
+    return 60 * size_t(frequency_) * frequency_;
+  }
+
+  void writeVertices(shader_types::VertexData* pVertices) const override {
+    const unsigned int n = frequency_;
+    for (int corner = 0; corner < 12; ++corner) {
+      pVertices[corner] = vertex(point(corner, corner, corner, n, 0, 0));
+    }
+    const EdgeTable& edges = edgeTable();
+    for (int e = 0; e < 30; ++e) {
+      for (unsigned int k = 1; k < n; ++k) {
+        pVertices[edgeVertex(e, k - 1)] = vertex(
+            point(edges.ends[e][0], edges.ends[e][1], 0, n - k, k, 0));
+      }
+    }
+    for (int face = 0; face < 20; ++face) {
+      const uint8_t* abc = kFaces[face];
+      for (unsigned int i = 2; i < n; ++i) {
+        for (unsigned int j = 1; j < i; ++j) {
+          pVertices[faceVertex(face, i, j)] = vertex(
+              point(abc[0], abc[1], abc[2], n - i, i - j, j));
+        }
+      }
+    }
+  }
+
+  void writeIndices(uint16_t* pIndices) const override {
+    writeIndicesAs(pIndices);
+  }
+  void writeIndices(uint32_t* pIndices) const override {
+    writeIndicesAs(pIndices);
   }
 
  private:
-  float s;
+  static constexpr float kGoldenRatio = 1.6180339887498949f;
+
+  static constexpr float kCorners[12][3] = {
+      {-1.f, kGoldenRatio, 0.f}, {1.f, kGoldenRatio, 0.f},
+      {-1.f, -kGoldenRatio, 0.f}, {1.f, -kGoldenRatio, 0.f},
+      {0.f, -1.f, kGoldenRatio}, {0.f, 1.f, kGoldenRatio},
+      {0.f, -1.f, -kGoldenRatio}, {0.f, 1.f, -kGoldenRatio},
+      {kGoldenRatio, 0.f, -1.f}, {kGoldenRatio, 0.f, 1.f},
+      {-kGoldenRatio, 0.f, -1.f}, {-kGoldenRatio, 0.f, 1.f}};
+
+  // Wound so that each face points along cross(c - a, b - a), like
+  // SphereMesh.
+  static constexpr uint8_t kFaces[20][3] = {{0, 5, 11}, {0, 1, 5},
+      {0, 7, 1}, {0, 10, 7}, {0, 11, 10}, {1, 9, 5}, {5, 4, 11},
+      {11, 2, 10}, {10, 6, 7}, {7, 8, 1}, {3, 4, 9}, {3, 2, 4}, {3, 6, 2},
+      {3, 8, 6}, {3, 9, 8}, {4, 5, 9}, {2, 11, 4}, {6, 10, 2}, {8, 7, 6},
+      {9, 1, 8}};
+
+  // The 30 edges, each from its lower corner to its higher one, and the
+  // edge between any two adjacent corners.
+  struct EdgeTable {
+    uint8_t ends[30][2];
+    int8_t  between[12][12];
+  };
+
+  static const EdgeTable& edgeTable() {
+    static const EdgeTable table = [] {
+      EdgeTable t;
+      std::fill(&t.between[0][0], &t.between[0][0] + 144, int8_t(-1));
+      int numEdges = 0;
+      for (const uint8_t* face : kFaces) {
+        for (int i = 0; i < 3; ++i) {
+          const uint8_t lo = std::min(face[i], face[(i + 1) % 3]);
+          const uint8_t hi = std::max(face[i], face[(i + 1) % 3]);
+          if (t.between[lo][hi] >= 0) continue;
+          t.ends[numEdges][0] = lo;
+          t.ends[numEdges][1] = hi;
+          t.between[lo][hi] = t.between[hi][lo] = int8_t(numEdges++);
+        }
+      }
+      return t;
+    }();
+    return table;
+  }
+
+  float        radius_;
+  unsigned int frequency_;
+
+  // Vertex layout: the 12 corners, then frequency - 1 points along each
+  // edge, then each face's interior points row by row.
+  uint32_t edgeVertex(int edge, unsigned int k) const {
+    return 12 + uint32_t(edge) * (frequency_ - 1) + k;
+  }
+  uint32_t faceVertex(int face, unsigned int i, unsigned int j) const {
+    const uint32_t perFace = (frequency_ - 1) * (frequency_ - 2) / 2;
+    return 12 + 30 * (frequency_ - 1) + uint32_t(face) * perFace +
+           (i - 1) * (i - 2) / 2 + (j - 1);
+  }
+
+  // Point `steps` of the way from corner `from` to corner `to`.
+  uint32_t alongEdge(int from, int to, unsigned int steps) const {
+    if (steps == 0) return uint32_t(from);
+    if (steps == frequency_) return uint32_t(to);
+    const int e = edgeTable().between[from][to];
+    return from < to ? edgeVertex(e, steps - 1)
+                     : edgeVertex(e, frequency_ - steps - 1);
+  }
+
+  // Grid point (i, j) of a face, 0 <= j <= i <= frequency, has barycentric
+  // weights (n - i, i - j, j) over its corners (a, b, c).
+  uint32_t gridVertex(int face, unsigned int i, unsigned int j) const {
+    const uint8_t* abc = kFaces[face];
+    if (j == 0) return alongEdge(abc[0], abc[1], i);
+    if (j == i) return alongEdge(abc[0], abc[2], i);
+    if (i == frequency_) return alongEdge(abc[1], abc[2], j);
+    return faceVertex(face, i, j);
+  }
+
+  Math::float3 point(int a, int b, int c, unsigned int wa, unsigned int wb,
+      unsigned int wc) const {
+    auto corner = [](int k) {
+      return Math::float3{kCorners[k][0], kCorners[k][1], kCorners[k][2]};
+    };
+    return Math::normalize(corner(a) * float(wa) + corner(b) * float(wb) +
+                           corner(c) * float(wc));
+  }
+
+  shader_types::VertexData vertex(const Math::float3& normal) const {
+    return {normal * radius_, normal};
+  }
+
+  // Calls fn(i0, j0, i1, j1, i2, j2) with the grid points of every
+  // triangle of a face.
+  template <typename Fn>
+  void forEachTriangle(const Fn& fn) const {
+    for (unsigned int i = 0; i < frequency_; ++i) {
+      for (unsigned int j = 0; j <= i; ++j) {
+        fn(i, j, i + 1, j, i + 1, j + 1);
+        if (j < i) fn(i, j, i + 1, j + 1, i, j + 1);
+      }
+    }
+  }
+
+  template <typename Index>
+  void writeIndicesAs(Index* pIndices) const {
+    for (int face = 0; face < 20; ++face) {
+      forEachTriangle([&](unsigned int i0, unsigned int j0, unsigned int i1,
+                          unsigned int j1, unsigned int i2, unsigned int j2) {
+        *pIndices++ = Index(gridVertex(face, i0, j0));
+        *pIndices++ = Index(gridVertex(face, i1, j1));
+        *pIndices++ = Index(gridVertex(face, i2, j2));
+      });
+    }
+  }
+};
+
+// Normalized cube: every face of a cube split into a divisions^2 grid and
+// pushed out onto the sphere. Grid lines sit at the tangents of evenly
+// spaced angles, which evens out triangle sizes between the face centers
+// and the cube corners. Each face has its own vertices; those on cube
+// edges are built from the same coordinates on both sides and match
+// exactly.
+class CubeSphereMesh : public Mesh {
+ public:
+  // Keeps 6 * (divisions + 1)^2 vertices within 32-bit indices.
+  static constexpr unsigned int kMaxDivisions = 16384;
+
+  CubeSphereMesh(float radius, unsigned int divisions)
+      : radius_(radius)
+      , divisions_(std::clamp(divisions, 1u, kMaxDivisions)) {}
+
+  // The coarsest cube-sphere within target.maxError of the sphere.
+  CubeSphereMesh(float radius, TessellationTarget target)
+      : CubeSphereMesh(radius, divisionsForError(radius, target.maxError)) {}
+
+  static unsigned int divisionsForError(float radius, float maxError) {
+    return tessellationLevelForError(maxError, kMaxDivisions,
+        [&](unsigned int d) { return errorForDivisions(radius, d); });
+  }
+
+  // Every face is congruent, so the first one stands for all of them.
+  static double errorForDivisions(float radius, unsigned int divisions) {
+    const CubeSphereMesh     mesh(radius, divisions);
+    const std::vector<float> grid  = mesh.gridTable();
+    double                   error = 0.0;
+    auto                     at    = [&](unsigned int i, unsigned int j) {
+      return mesh.vertex(0, grid, i, j).position;
+    };
+    mesh.forEachTriangle([&](unsigned int i0, unsigned int j0,
+                             unsigned int i1, unsigned int j1,
+                             unsigned int i2, unsigned int j2) {
+      error = std::max(error,
+          inscribedTriangleError(at(i0, j0), at(i1, j1), at(i2, j2), radius));
+    });
+    return error;
+  }
+
+  unsigned int divisions() const { return divisions_; }
+  float        maxError() const {
+    return float(errorForDivisions(radius_, divisions_));
+  }
+
+  size_t vertexCount() const override {
+    return 6 * size_t(divisions_ + 1) * (divisions_ + 1);
+  }
+  size_t indexCount() const override {
+    return 36 * size_t(divisions_) * divisions_;
+  }
+
+  void writeVertices(shader_types::VertexData* pVertices) const override {
+    const std::vector<float> grid = gridTable();
+    for (int face = 0; face < 6; ++face) {
+      for (unsigned int j = 0; j <= divisions_; ++j) {
+        for (unsigned int i = 0; i <= divisions_; ++i) {
+          *pVertices++ = vertex(face, grid, i, j);
+        }
+      }
+    }
+  }
+
+  void writeIndices(uint16_t* pIndices) const override {
+    writeIndicesAs(pIndices);
+  }
+  void writeIndices(uint32_t* pIndices) const override {
+    writeIndicesAs(pIndices);
+  }
+
+ private:
+  // Normal, u and v axes of every face, with cross(u, v) == normal.
+  static constexpr float kFaceAxes[6][3][3] = {
+      {{1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, 0.f, 1.f}},
+      {{-1.f, 0.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 1.f, 0.f}},
+      {{0.f, 1.f, 0.f}, {0.f, 0.f, 1.f}, {1.f, 0.f, 0.f}},
+      {{0.f, -1.f, 0.f}, {1.f, 0.f, 0.f}, {0.f, 0.f, 1.f}},
+      {{0.f, 0.f, 1.f}, {1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}},
+      {{0.f, 0.f, -1.f}, {0.f, 1.f, 0.f}, {1.f, 0.f, 0.f}}};
+
+  float        radius_;
+  unsigned int divisions_;
+
+  // Grid coordinates in [-1, 1], mirrored exactly so that faces walking
+  // an edge in opposite directions see the same values.
+  std::vector<float> gridTable() const {
+    const unsigned int n = divisions_;
+    std::vector<float> grid(n + 1);
+    for (unsigned int k = 0; k <= n / 2; ++k) {
+      grid[k]     = -float(std::tan(M_PI / 4 - k * M_PI / (2.0 * n)));
+      grid[n - k] = -grid[k];
+    }
+    if (n % 2 == 0) grid[n / 2] = 0.f;
+    return grid;
+  }
+
+  shader_types::VertexData vertex(int face, const std::vector<float>& grid,
+      unsigned int i, unsigned int j) const {
+    const float(&axes)[3][3] = kFaceAxes[face];
+    Math::float3 cube;
+    for (int c = 0; c < 3; ++c) {
+      (&cube.x)[c] = axes[0][c] + axes[1][c] * grid[i] + axes[2][c] * grid[j];
+    }
+    const Math::float3 normal = Math::normalize(cube);
+    return {normal * radius_, normal};
+  }
+
+  // Calls fn(i0, j0, i1, j1, i2, j2) with the grid points of every
+  // triangle of a face, wound so it points along cross(c - a, b - a) like
+  // SphereMesh.
+  template <typename Fn>
+  void forEachTriangle(const Fn& fn) const {
+    for (unsigned int j = 0; j < divisions_; ++j) {
+      for (unsigned int i = 0; i < divisions_; ++i) {
+        fn(i, j, i, j + 1, i + 1, j);
+        fn(i, j + 1, i + 1, j + 1, i + 1, j);
+      }
+    }
+  }
+
+  template <typename Index>
+  void writeIndicesAs(Index* pIndices) const {
+    const uint32_t row = divisions_ + 1;
+    for (int face = 0; face < 6; ++face) {
+      const uint32_t first = uint32_t(face) * row * row;
+      forEachTriangle([&](unsigned int i0, unsigned int j0, unsigned int i1,
+                          unsigned int j1, unsigned int i2, unsigned int j2) {
+        *pIndices++ = Index(first + j0 * row + i0);
+        *pIndices++ = Index(first + j1 * row + i1);
+        *pIndices++ = Index(first + j2 * row + i2);
+      });
+    }
+  }
+};
+
+// Generates `mesh` and welds vertices equal within kWeldEpsilon (seams,
+// poles), dropping the triangles that collapse. pRemap, if given, receives
+// the welded index of each of the mesh's own vertices.
+inline void weldMesh(const Mesh& mesh,
+    std::vector<shader_types::VertexData>* pVertices,
+    std::vector<uint32_t>*                 pIndices,
+    std::vector<uint32_t>*                 pRemap = nullptr) {
+  const std::vector<shader_types::VertexData> vertices = mesh.getVertices();
+  *pIndices                                          = mesh.getIndices();
+
+  const VertexStream streams[] = {
+      {&vertices.data()->position.x, sizeof(shader_types::VertexData), 3},
+      {&vertices.data()->normal.x, sizeof(shader_types::VertexData), 3},
+  };
+  std::vector<uint32_t> remap(vertices.size());
+  pVertices->resize(
+      generateWeldRemap(remap.data(), streams, 2, vertices.size()));
+  remapVertices(
+      pVertices->data(), vertices.data(), vertices.size(), remap.data());
+  remapIndices(
+      pIndices->data(), pIndices->data(), pIndices->size(), remap.data());
+  pIndices->resize(
+      removeDegenerateTriangles(pIndices->data(), pIndices->size()));
+  if (pRemap) *pRemap = std::move(remap);
+}
+
+// The optimization stage meshes go through before upload. The source mesh
+// is generated once, then:
+//  1. vertices equal within kWeldEpsilon (seams, poles) are welded and the
+//     triangles that collapse are dropped,
+//  2. triangles are grouped into compact meshlets with clusterMeshlets(),
+//     whose normals stay within kMeshletNormalCone so that back-facing
+//     meshlets can be culled, and each meshlet is ordered for the
+//     post-transform vertex cache,
+//  3. vertices are renumbered in first-use order for sequential fetches.
+// The result must run the vertex shader no more often and fetch no more
+// bytes than the source mesh. If the clustered order does not, the welded
+// mesh keeps its input order, and if welding alone does not, the source
+// mesh is kept as it is; either is cut into meshlets in order by
+// buildMeshlets(), with the same normal cone. Writes copy out the result.
+class OptimizedMesh : public Mesh {
+ public:
+  explicit OptimizedMesh(const Mesh& mesh) {
+    std::vector<shader_types::VertexData> vertices;
+    weldMesh(mesh, &vertices, &_indices);
+    const VertexStream position = {
+        &vertices.data()->position.x, sizeof(shader_types::VertexData), 3};
+
+    std::vector<uint32_t> clustered(_indices.size());
+    std::vector<Meshlet>  meshlets = clusterMeshlets(clustered.data(),
+        _indices.data(), _indices.size(), position, vertices.size());
+    optimizeMeshletVertexCache(clustered.data(), clustered.size(),
+        meshlets.data(), meshlets.size(), vertices.size());
+
+    // Welded orders are measured once vertices are in first-use order, as
+    // they will be uploaded; the source mesh as it is.
+    std::vector<uint32_t>  source      = mesh.getIndices();
+    const size_t           numSource   = mesh.vertexCount();
+    const VertexFetchStats sourceFetch = analyzeVertexFetch(source.data(),
+        source.size(), numSource, sizeof(shader_types::VertexData));
+    const uint32_t         sourceTransformed =
+        analyzeVertexCache(source.data(), source.size(), numSource)
+            .numTransformed;
+    std::vector<uint32_t>  remap(vertices.size()), renumbered;
+    auto noWorse = [&](const std::vector<uint32_t>& indices) {
+      const size_t numUsed = generateVertexFetchRemap(
+          remap.data(), indices.data(), indices.size(), vertices.size());
+      renumbered.resize(indices.size());
+      remapIndices(
+          renumbered.data(), indices.data(), indices.size(), remap.data());
+      const VertexFetchStats fetch = analyzeVertexFetch(renumbered.data(),
+          renumbered.size(), numUsed, sizeof(shader_types::VertexData));
+      return fetch.bytesFetched <= sourceFetch.bytesFetched &&
+             analyzeVertexCache(renumbered.data(), renumbered.size(), numUsed)
+                     .numTransformed <= sourceTransformed;
+    };
+    if (noWorse(clustered)) {
+      _indices.swap(clustered);
+      _meshlets = std::move(meshlets);
+    } else if (noWorse(_indices)) {
+      _meshlets = buildMeshlets(
+          _indices.data(), _indices.size(), vertices.size(), &position);
+    } else {
+      // The source mesh keeps its own vertex order too.
+      _vertices = mesh.getVertices();
+      _indices.swap(source);
+      const VertexStream sourcePosition = {&_vertices.data()->position.x,
+          sizeof(shader_types::VertexData), 3};
+      _meshlets = buildMeshlets(_indices.data(), _indices.size(),
+          _vertices.size(), &sourcePosition);
+      return;
+    }
+
+    _vertices.resize(generateVertexFetchRemap(
+        remap.data(), _indices.data(), _indices.size(), vertices.size()));
+    remapVertices(
+        _vertices.data(), vertices.data(), vertices.size(), remap.data());
+    remapIndices(
+        _indices.data(), _indices.data(), _indices.size(), remap.data());
+  }
+
+  size_t vertexCount() const override { return _vertices.size(); }
+  size_t indexCount() const override { return _indices.size(); }
+
+  void writeVertices(shader_types::VertexData* pVertices) const override {
+    std::copy(_vertices.begin(), _vertices.end(), pVertices);
+  }
+  void writeIndices(uint16_t* pIndices) const override {
+    std::copy(_indices.begin(), _indices.end(), pIndices);
+  }
+  void writeIndices(uint32_t* pIndices) const override {
+    std::copy(_indices.begin(), _indices.end(), pIndices);
+  }
+  std::vector<Meshlet> getMeshlets() const override { return _meshlets; }
+
+ private:
+  std::vector<shader_types::VertexData> _vertices;
+  std::vector<uint32_t>                 _indices;
+  std::vector<Meshlet>                  _meshlets;
+};
+
+// A welded copy of `mesh` run through simplifyMesh(), keeping only the
+// vertices the remaining triangles use. It has at most `targetTriangles`
+// triangles unless reaching that would take a collapse with more than
+// `maxError` error, in position units. Feed it to OptimizedMesh to reorder
+// for upload.
+class SimplifiedMesh : public Mesh {
+ public:
+  SimplifiedMesh(const Mesh& mesh, size_t targetTriangles, float maxError,
+      JobSystem& jobSystem) {
+    std::vector<shader_types::VertexData> welded;
+    weldMesh(mesh, &welded, &_indices);
+
+    const VertexStream   position = {
+        &welded.data()->position.x, sizeof(shader_types::VertexData), 3};
+    const VertexStream   normal   = {
+        &welded.data()->normal.x, sizeof(shader_types::VertexData), 3};
+    const SimplifyResult result   = simplifyMesh(_indices.data(),
+        _indices.data(), _indices.size(), position, welded.size(),
+        targetTriangles * 3, maxError, jobSystem, &normal);
+    _indices.resize(result.numIndices);
+    _error = result.error;
+
+    std::vector<uint32_t> remap(welded.size());
+    _vertices.resize(generateVertexFetchRemap(
+        remap.data(), _indices.data(), _indices.size(), welded.size()));
+    remapVertices(
+        _vertices.data(), welded.data(), welded.size(), remap.data());
+    remapIndices(
+        _indices.data(), _indices.data(), _indices.size(), remap.data());
+  }
+
+  // See SimplifyResult::error.
+  float error() const { return _error; }
+
+  size_t vertexCount() const override { return _vertices.size(); }
+  size_t indexCount() const override { return _indices.size(); }
+
+  void writeVertices(shader_types::VertexData* pVertices) const override {
+    std::copy(_vertices.begin(), _vertices.end(), pVertices);
+  }
+  void writeIndices(uint16_t* pIndices) const override {
+    std::copy(_indices.begin(), _indices.end(), pIndices);
+  }
+  void writeIndices(uint32_t* pIndices) const override {
+    std::copy(_indices.begin(), _indices.end(), pIndices);
+  }
+
+ private:
+  std::vector<shader_types::VertexData> _vertices;
+  std::vector<uint32_t>                 _indices;
+  float                                 _error;
 };
 
-enum class MeshType { Sphere, Cube };
+// Automatic LOD chain for any mesh, finest first: `mesh` itself, then up
+// to numLods - 1 levels that each simplify the previous one to `ratio` of
+// its triangles. The chain ends early at the first level that removes no
+// triangle (because of `maxError`, or locked borders), rather than repeat
+// it; callers see that in its size. Every level goes through OptimizedMesh.
+inline std::vector<std::unique_ptr<Mesh>> createSimplifiedLods(
+    const Mesh& mesh, size_t numLods, JobSystem& jobSystem,
+    float ratio = 0.25f, float maxError = HUGE_VALF) {
+  std::vector<std::unique_ptr<Mesh>> meshes;
+  meshes.push_back(std::make_unique<OptimizedMesh>(mesh));
+  while (meshes.size() < numLods) {
+    const Mesh&          previous        = *meshes.back();
+    const size_t         targetTriangles = size_t(
+        float(previous.indexCount() / 3) * ratio);
+    const SimplifiedMesh simplified(
+        previous, targetTriangles, maxError, jobSystem);
+    if (simplified.indexCount() >= previous.indexCount()) break;
+    meshes.push_back(std::make_unique<OptimizedMesh>(simplified));
+  }
+  return meshes;
+}
+
+enum class MeshType { Sphere, Cube, Icosphere, CubeSphere };
+
+// Radius of the sphere createMesh() builds; Scene derives instance bounds
+// from it.
+static constexpr float kSphereRadius = 0.5f;
 
-std::unique_ptr<Mesh> createMesh(MeshType type) {
+// Tessellation error of the icosphere and cube-sphere createMesh() builds,
+// about that of its 20x20 UV sphere.
+static constexpr float kSphereMaxError = 0.008f;
+
+inline std::unique_ptr<Mesh> createMesh(MeshType type) {
   switch (type) {
-    case MeshType::Sphere: return std::make_unique<SphereMesh>(0.5f, 20, 20);
+    case MeshType::Sphere:
+      return std::make_unique<SphereMesh>(kSphereRadius, 20, 20);
     case MeshType::Cube: return std::make_unique<CubeMesh>(0.5f);
+    case MeshType::Icosphere:
+      return std::make_unique<IcosphereMesh>(
+          kSphereRadius, TessellationTarget{kSphereMaxError});
+    case MeshType::CubeSphere:
+      return std::make_unique<CubeSphereMesh>(
+          kSphereRadius, TessellationTarget{kSphereMaxError});
     default: return nullptr;
   }
 }
 
+// Sphere LOD chain, finest first. Every level uses as many slices as
+// stacks.
+static constexpr size_t       kNumSphereLods                   = 4;
+static constexpr unsigned int kSphereLodStacks[kNumSphereLods] = {
+    32, 16, 8, 4};
+
+// One level of a LOD chain packed into shared vertex and index arrays.
+// Indices are relative to firstVertex. The meshlet range is only filled in
+// for a MeshLodChain; meshlet triangles are relative to firstIndex / 3.
+struct MeshLod {
+  uint32_t firstVertex;
+  uint32_t numVertices;
+  uint32_t firstIndex;
+  uint32_t numIndices;
+  uint32_t firstMeshlet;
+  uint32_t numMeshlets;
+};
+
+// Shared storage for a LOD chain. All levels use one index width, chosen
+// from the largest level since indices are relative to firstVertex.
+// Vertices live in `vertices` or, for VertexFormat::Quantized, in
+// `quantizedVertices` with one VertexQuantization per level. Meshlet
+// bounds are in model space.
+struct MeshLodChain {
+  VertexFormat                                   vertexFormat;
+  std::vector<shader_types::VertexData>          vertices;
+  std::vector<shader_types::QuantizedVertexData> quantizedVertices;
+  std::vector<shader_types::VertexQuantization>  quantizations;
+  IndexType                                      indexType;
+  std::vector<unsigned char>                     indexData;
+  std::vector<MeshLod>                           lods;
+  std::vector<Meshlet>                           meshlets;
+  std::vector<MeshletBounds>                     meshletBounds;
+
+  uint32_t index(size_t i) const {
+    return indexType == IndexType::UInt16
+               ? reinterpret_cast<const uint16_t*>(indexData.data())[i]
+               : reinterpret_cast<const uint32_t*>(indexData.data())[i];
+  }
+};
+
+inline std::vector<std::unique_ptr<Mesh>> createSphereLods() {
+  std::vector<std::unique_ptr<Mesh>> meshes;
+  for (unsigned int stacks : kSphereLodStacks) {
+    meshes.push_back(std::make_unique<OptimizedMesh>(
+        SphereMesh(kSphereRadius, stacks, stacks)));
+  }
+  return meshes;
+}
+
+// Where each mesh of a chain lands in the shared vertex and index storage,
+// and how large that storage must be.
+struct MeshLayout {
+  std::vector<MeshLod> lods;
+  size_t               numVertices;
+  size_t               numIndices;
+  VertexFormat         vertexFormat;
+  IndexType            indexType;
+
+  size_t vertexDataSize() const {
+    return numVertices * vertexSize(vertexFormat);
+  }
+  size_t indexDataSize() const { return numIndices * indexSize(indexType); }
+};
+
+// Places `meshes` back to back. Each level's first index is kept 4-byte
+// aligned so it can be used directly as an index buffer offset.
+inline MeshLayout layoutMeshLods(
+    const std::vector<std::unique_ptr<Mesh>>& meshes,
+    VertexFormat vertexFormat = VertexFormat::Float) {
+  MeshLayout layout   = {};
+  size_t     maxCount = 0;
+  layout.vertexFormat = vertexFormat;
+  for (const auto& mesh : meshes) {
+    maxCount = std::max(maxCount, mesh->vertexCount());
+  }
+  layout.indexType = indexTypeForVertexCount(maxCount);
+
+  const size_t indexAlignment = 4 / indexSize(layout.indexType);
+  for (const auto& mesh : meshes) {
+    layout.numIndices = (layout.numIndices + indexAlignment - 1) /
+                        indexAlignment * indexAlignment;
+    layout.lods.push_back({uint32_t(layout.numVertices),
+        uint32_t(mesh->vertexCount()), uint32_t(layout.numIndices),
+        uint32_t(mesh->indexCount())});
+    layout.numVertices += mesh->vertexCount();
+    layout.numIndices += mesh->indexCount();
+  }
+  return layout;
+}
+
+// Generates every level in place at the ranges layoutMeshLods() chose.
+// Alignment padding between levels is left untouched. Quantized levels
+// are generated into scratch memory first; their quantizations go to
+// pQuantizations, one per level.
+inline void writeMeshLods(const std::vector<std::unique_ptr<Mesh>>& meshes,
+    const MeshLayout& layout, void* pVertexData, void* pIndexData,
+    shader_types::VertexQuantization* pQuantizations = nullptr) {
+  const size_t                          stride = indexSize(layout.indexType);
+  std::vector<shader_types::VertexData> scratch;
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    const MeshLod& lod = layout.lods[i];
+    if (layout.vertexFormat == VertexFormat::Float) {
+      meshes[i]->writeVertices(
+          static_cast<shader_types::VertexData*>(pVertexData) +
+          lod.firstVertex);
+    } else {
+      scratch.resize(lod.numVertices);
+      meshes[i]->writeVertices(scratch.data());
+      pQuantizations[i] = computeVertexQuantization(
+          scratch.data(), scratch.size());
+      quantizeVertices(
+          static_cast<shader_types::QuantizedVertexData*>(pVertexData) +
+              lod.firstVertex,
+          scratch.data(), scratch.size(), pQuantizations[i]);
+    }
+    meshes[i]->writeIndices(
+        static_cast<unsigned char*>(pIndexData) + lod.firstIndex * stride,
+        layout.indexType);
+  }
+}
+
+// Packs `meshes`, finest first, into one chain with meshlets and bounds.
+inline MeshLodChain createMeshLodChain(
+    const std::vector<std::unique_ptr<Mesh>>& meshes,
+    VertexFormat                              vertexFormat) {
+  const MeshLayout layout = layoutMeshLods(meshes, vertexFormat);
+
+  MeshLodChain chain;
+  chain.vertexFormat = vertexFormat;
+  void* pVertexData;
+  if (vertexFormat == VertexFormat::Float) {
+    chain.vertices.resize(layout.numVertices);
+    pVertexData = chain.vertices.data();
+  } else {
+    chain.quantizedVertices.resize(layout.numVertices);
+    chain.quantizations.resize(meshes.size());
+    pVertexData = chain.quantizedVertices.data();
+  }
+  chain.indexType = layout.indexType;
+  chain.indexData.resize(layout.indexDataSize());
+  chain.lods = layout.lods;
+  writeMeshLods(meshes, layout, pVertexData, chain.indexData.data(),
+      chain.quantizations.data());
+
+  // Bounds come from the float vertices, whatever the storage format.
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    const std::vector<shader_types::VertexData> vertices =
+        meshes[i]->getVertices();
+    const std::vector<uint32_t> indices  = meshes[i]->getIndices();
+    const std::vector<Meshlet>  meshlets = meshes[i]->getMeshlets();
+    const VertexStream          position = {
+        &vertices.data()->position.x, sizeof(shader_types::VertexData), 3};
+    chain.lods[i].firstMeshlet = uint32_t(chain.meshlets.size());
+    chain.lods[i].numMeshlets  = uint32_t(meshlets.size());
+    for (const Meshlet& meshlet : meshlets) {
+      chain.meshlets.push_back(meshlet);
+      chain.meshletBounds.push_back(
+          computeMeshletBounds(indices.data(), meshlet, position));
+    }
+  }
+  return chain;
+}
+
+inline MeshLodChain createSphereLodChain(
+    VertexFormat vertexFormat = VertexFormat::Float) {
+  return createMeshLodChain(createSphereLods(), vertexFormat);
+}
+
+// Distance from the origin to the nearest face plane of a closed mesh
+// around the origin: the radius of the largest centered ball the mesh is
+// guaranteed to cover. Degenerate triangles are skipped. Needs a
+// VertexFormat::Float chain.
+inline float meshInnerRadius(const MeshLodChain& chain, size_t lod) {
+  const MeshLod&                  l      = chain.lods[lod];
+  const shader_types::VertexData* pVerts = &chain.vertices[l.firstVertex];
+
+  float radius = std::numeric_limits<float>::max();
+  for (uint32_t i = l.firstIndex; i < l.firstIndex + l.numIndices; i += 3) {
+    const Math::float3& a = pVerts[chain.index(i + 0)].position;
+    const Math::float3& b = pVerts[chain.index(i + 1)].position;
+    const Math::float3& c = pVerts[chain.index(i + 2)].position;
+
+    const Math::float3 n      = Math::cross(b - a, c - a);
+    const float        length = Math::length(n);
+    if (length > 1e-12f) {
+      radius = std::min(radius, fabsf(Math::dot(n, a)) / length);
+    }
+  }
+  return radius;
+}
+
 #endif  // MESH_HPP
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef MESHCODEC_HPP
+#define MESHCODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Mesh.hpp"
+
+// Lossless compression for vertex and index buffers, after meshoptimizer's
+// codecs: both predict each value from the one before it, zigzag-encode
+// the difference so that small ones of either sign become small unsigned
+// numbers, and pack those into byte groups that a SIMD decoder unpacks
+// with a table-driven shuffle. With SSE4.1, one 2 GHz core decodes about
+// 1 to 2.5 GB/s of vertices and 2.5 to 7 GB/s of indices; elsewhere
+// scalar code runs about five times slower. Both decoders reject truncated
+// or malformed input without reading or writing out of bounds.
+//
+// Compression depends on ordering: buffers that went through OptimizedMesh
+// (meshlet, vertex cache and fetch order) compress best.
+
+// Vertices are split into their byte columns, each delta-coded against the
+// same byte of the previous vertex. Groups of 16 deltas are stored with 0,
+// 2, 4 or 8 bits each; values that do not fit in 2 or 4 bits follow the
+// group as whole bytes. Padding and other constant bytes cost 2 bits per 16
+// vertices. `stride` must be a multiple of 4, at most kMaxVertexCodecStride.
+constexpr size_t kMaxVertexCodecStride = 256;
+
+size_t vertexBufferBound(size_t count, size_t stride);
+
+// Encodes `count` vertices into pDst, which must hold vertexBufferBound()
+// bytes. Returns the encoded size.
+size_t encodeVertexBuffer(unsigned char* pDst, const void* pVertices,
+    size_t count, size_t stride);
+
+// Decodes exactly `count` vertices of `stride` bytes. Returns false if the
+// data is not a vertex buffer of that size.
+bool decodeVertexBuffer(void* pVertices, size_t count, size_t stride,
+    const unsigned char* pSrc, size_t srcSize);
+
+// Indices are delta-coded against the previous index and stored in Stream
+// VByte format: a 2-bit length code per index, 1 to 4 bytes, with the
+// codes of four indices sharing a byte ahead of all the data. Optimized
+// meshes mostly need one byte per index.
+size_t indexBufferBound(size_t count);
+
+size_t encodeIndexBuffer(unsigned char* pDst, const void* pIndices,
+    size_t count, IndexType indexType);
+
+// Decodes exactly `count` indices of `indexType`. Returns false if the
+// data is malformed, or holds an index that does not fit `indexType`.
+bool decodeIndexBuffer(void* pIndices, size_t count, IndexType indexType,
+    const unsigned char* pSrc, size_t srcSize);
+
+#endif  // MESHCODEC_HPP
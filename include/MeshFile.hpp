@@ -0,0 +1,146 @@
+#ifndef MESHFILE_HPP
+#define MESHFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Mesh.hpp"
+
+// Binary container for a MeshLodChain, read by mapping it: every block is
+// stored in its in-memory layout, so loading only validates the header,
+// the ranges and the meshlets, and points into the mapping. All values
+// are little-endian.
+//
+//   MeshFileHeader
+//   MeshFileSection[numSections]
+//   section data, each block starting at a multiple of kMeshFileAlignment
+//
+// Blocks are aligned to 16 KiB, the largest page size of the targets, so
+// each one can back a GPU buffer without a copy (e.g. Metal's
+// newBufferWithBytesNoCopy). The version changes whenever a stored
+// struct's layout does; elementSize guards against mismatches too.
+constexpr char     kMeshFileMagic[8]  = {'R', 'M', 'E', 'S', 'H', 0, 0, 0};
+constexpr uint32_t kMeshFileVersion   = 1;
+constexpr size_t   kMeshFileAlignment = 16 * 1024;
+
+enum class MeshFileSectionType : uint32_t {
+  Vertices,       // VertexData or QuantizedVertexData
+  Quantizations,  // VertexQuantization per LOD, quantized files only
+  Indices,        // uint16_t or uint32_t
+  Lods,           // MeshLod
+  LodBounds,      // MeshLodBounds per LOD
+  Meshlets,       // Meshlet
+  MeshletBounds,  // MeshletBounds per meshlet
+  Count
+};
+
+struct MeshFileHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t vertexFormat;  // VertexFormat
+  uint32_t indexType;     // IndexType
+  uint32_t numSections;
+  uint64_t fileSize;
+};
+
+struct MeshFileSection {
+  uint32_t type;         // MeshFileSectionType
+  uint32_t elementSize;  // bytes per element
+  uint64_t offset;       // from the start of the file
+  uint64_t count;        // elements
+};
+
+// Model-space bounding box of one LOD.
+struct MeshLodBounds {
+  Math::float3 min;
+  Math::float3 max;
+};
+
+// Writes `chain` with bounds computed from its vertices. Returns false and
+// sets *pError, naming the file, if it cannot be written; a partly written
+// file is removed.
+bool writeMeshFile(
+    const char* path, const MeshLodChain& chain, std::string* pError = nullptr);
+
+// A mapped mesh file. Pointers stay valid until the file is closed or
+// reopened.
+class MeshFile {
+ public:
+  // Maps and validates `path`: header, section bounds and alignment,
+  // element sizes, every LOD's vertex, index and meshlet ranges, and every
+  // meshlet's triangle range within its LOD. On failure returns false and
+  // sets *pError, naming the file.
+  bool open(const char* path, std::string* pError = nullptr);
+
+  VertexFormat vertexFormat() const { return _vertexFormat; }
+  IndexType    indexType() const { return _indexType; }
+
+  // Vertices in vertexFormat()'s layout.
+  const void* vertexData() const {
+    return data(MeshFileSectionType::Vertices);
+  }
+  size_t vertexDataSize() const {
+    return bytes(MeshFileSectionType::Vertices);
+  }
+  size_t numVertices() const { return count(MeshFileSectionType::Vertices); }
+  const void* indexData() const { return data(MeshFileSectionType::Indices); }
+  size_t      indexDataSize() const {
+    return bytes(MeshFileSectionType::Indices);
+  }
+
+  size_t         numLods() const { return count(MeshFileSectionType::Lods); }
+  const MeshLod* lods() const {
+    return static_cast<const MeshLod*>(data(MeshFileSectionType::Lods));
+  }
+  const MeshLodBounds* lodBounds() const {
+    return static_cast<const MeshLodBounds*>(
+        data(MeshFileSectionType::LodBounds));
+  }
+  // One per LOD for VertexFormat::Quantized files, nullptr otherwise.
+  const shader_types::VertexQuantization* quantizations() const {
+    return static_cast<const shader_types::VertexQuantization*>(
+        data(MeshFileSectionType::Quantizations));
+  }
+  size_t numMeshlets() const { return count(MeshFileSectionType::Meshlets); }
+  const Meshlet* meshlets() const {
+    return static_cast<const Meshlet*>(data(MeshFileSectionType::Meshlets));
+  }
+  const MeshletBounds* meshletBounds() const {
+    return static_cast<const MeshletBounds*>(
+        data(MeshFileSectionType::MeshletBounds));
+  }
+
+  // An owning copy, for code that shares meshes through MeshRegistry.
+  // Each block is copied with one memcpy.
+  MeshLodChain toChain() const;
+
+ private:
+  MappedFile             _file;
+  VertexFormat           _vertexFormat = VertexFormat::Float;
+  IndexType              _indexType    = IndexType::UInt16;
+  const MeshFileSection* _sections[size_t(MeshFileSectionType::Count)] = {};
+
+  const void* data(MeshFileSectionType type) const {
+    const MeshFileSection* pSection = _sections[size_t(type)];
+    return pSection && pSection->count ? _file.data() + pSection->offset
+                                       : nullptr;
+  }
+  size_t count(MeshFileSectionType type) const {
+    const MeshFileSection* pSection = _sections[size_t(type)];
+    return pSection ? size_t(pSection->count) : 0;
+  }
+  size_t bytes(MeshFileSectionType type) const {
+    const MeshFileSection* pSection = _sections[size_t(type)];
+    return pSection ? size_t(pSection->count) * pSection->elementSize : 0;
+  }
+  template <typename T>
+  void copySection(MeshFileSectionType type, std::vector<T>* pOut) const {
+    const T* pBegin = static_cast<const T*>(data(type));
+    pOut->assign(pBegin, pBegin ? pBegin + bytes(type) / sizeof(T) : pBegin);
+  }
+};
+
+#endif  // MESHFILE_HPP
@@ -0,0 +1,157 @@
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Math.hpp"
+
+// Marks vertices no index refers to in a remap table.
+static constexpr uint32_t kUnusedVertex = ~0u;
+
+// Vertices within this of each other in every attribute component are
+// welded together.
+static constexpr float kWeldEpsilon = 1e-5f;
+
+// Vertex fetches are modelled as 64-byte cache lines.
+static constexpr size_t kFetchLineSize = 64;
+
+// Post-transform cache size the analysis models by default: a 16-entry
+// FIFO is a conservative stand-in for current GPUs.
+static constexpr uint32_t kVertexCacheSize = 16;
+
+// How well an index buffer reuses transformed vertices. ACMR is vertex
+// shader invocations per triangle (0.5 is ideal for large grids, 3 means
+// no reuse); ATVR is invocations per referenced vertex (1 is ideal).
+struct VertexCacheStats {
+  uint32_t numTransformed;
+  float    acmr;
+  float    atvr;
+};
+
+// Bytes read from the vertex buffer to run the vertex shader over a
+// triangle list, against the size of the vertices it references.
+// Overfetch is 1 when every referenced line is read exactly once.
+struct VertexFetchStats {
+  size_t bytesFetched;
+  float  overfetch;
+};
+
+// One float attribute of an interleaved vertex array, e.g. the position
+// of every vertex: `numFloats` floats at pData + i * stride bytes.
+struct VertexStream {
+  const float* pData;
+  size_t       stride;
+  size_t       numFloats;
+};
+
+// Meshlet limits, sized for mesh shader threadgroups: 64 vertices and 124
+// triangles keep a meshlet's primitive indices within 372 bytes.
+static constexpr size_t kMaxMeshletVertices  = 64;
+static constexpr size_t kMaxMeshletTriangles = 124;
+
+// Meshlet builders given positions keep every triangle normal of a meshlet
+// within acos(kMeshletNormalCone), about 37 degrees, of the meshlet's mean
+// normal, so that even the meshlets of a low-poly mesh can be cone culled.
+static constexpr float kMeshletNormalCone = 0.8f;
+
+// A run of triangles of an index buffer, [firstTriangle, firstTriangle +
+// numTriangles), that references numVertices distinct vertices.
+struct Meshlet {
+  uint32_t firstTriangle;
+  uint32_t numTriangles;
+  uint32_t numVertices;
+};
+
+// Bounding sphere and normal cone of a meshlet. Every triangle normal lies
+// within some angle a of coneAxis, and coneCutoff is sin(a); it is 1 when
+// the normals spread over a hemisphere or more, which disables the cone.
+struct MeshletBounds {
+  Math::float3 center;
+  Math::float3 coneAxis;
+  float        radius;
+  float        coneCutoff;
+};
+
+// Simulates a FIFO post-transform cache of `cacheSize` entries over the
+// triangle list.
+VertexCacheStats analyzeVertexCache(const uint32_t* pIndices,
+    size_t numIndices, size_t numVertices,
+    uint32_t cacheSize = kVertexCacheSize);
+
+// Reorders the triangles of an indexed triangle list for post-transform
+// cache reuse using Forsyth's linear-speed greedy algorithm: triangles are
+// emitted one at a time, picking the one whose vertices are most recently
+// used and have the fewest remaining triangles. Vertex numbering is
+// unchanged. pDst must not alias pIndices.
+void optimizeVertexCache(uint32_t* pDst, const uint32_t* pIndices,
+    size_t numIndices, size_t numVertices);
+
+// Vertex cache misses fetch their vertex's cache lines; a small FIFO of
+// recently read lines absorbs repeats.
+VertexFetchStats analyzeVertexFetch(const uint32_t* pIndices,
+    size_t numIndices, size_t numVertices, size_t vertexSize);
+
+// Welds vertices whose streams all agree within `epsilon`: each vertex
+// joins the first earlier unique vertex with every attribute within
+// `epsilon` of its own, and otherwise becomes a unique vertex itself.
+// Attributes are hashed on a grid, probing the neighbouring cells a
+// vertex's epsilon range reaches into. Writes each vertex's new index to
+// pRemap, numbering unique vertices in order of first occurrence, and
+// returns how many there are.
+size_t generateWeldRemap(uint32_t* pRemap, const VertexStream* pStreams,
+    size_t numStreams, size_t numVertices, float epsilon = kWeldEpsilon);
+
+// Numbers vertices in the order the index buffer first uses them so that
+// fetches walk the vertex buffer sequentially. Unreferenced vertices get
+// kUnusedVertex. Returns the number of referenced vertices.
+size_t generateVertexFetchRemap(uint32_t* pRemap, const uint32_t* pIndices,
+    size_t numIndices, size_t numVertices);
+
+// pDst[i] = pRemap[pIndices[i]]; pDst may alias pIndices.
+void remapIndices(uint32_t* pDst, const uint32_t* pIndices,
+    size_t numIndices, const uint32_t* pRemap);
+
+// Compacts away triangles with a repeated index in place and returns the
+// new index count.
+size_t removeDegenerateTriangles(uint32_t* pIndices, size_t numIndices);
+
+// Splits a triangle list into meshlets in order, closing one whenever the
+// next triangle would exceed either limit or, given positions, leave the
+// kMeshletNormalCone cone. Works on any index buffer, but the clusters are
+// only as compact as the triangle order.
+std::vector<Meshlet> buildMeshlets(const uint32_t* pIndices,
+    size_t numIndices, size_t numVertices,
+    const VertexStream* pPositions = nullptr);
+
+// Reorders triangles into compact meshlets and returns them. Each meshlet
+// grows from a seed by repeatedly taking the adjacent triangle within the
+// kMeshletNormalCone cone that adds the fewest new vertices, nearest the
+// meshlet's centroid on ties, so meshlets come out as round patches. The
+// triangle that no longer fits seeds the next one. pDst must not alias
+// pIndices.
+std::vector<Meshlet> clusterMeshlets(uint32_t* pDst, const uint32_t* pIndices,
+    size_t numIndices, const VertexStream& positions, size_t numVertices);
+
+// Runs optimizeVertexCache() within every meshlet; triangles never move
+// between meshlets.
+void optimizeMeshletVertexCache(uint32_t* pIndices, size_t numIndices,
+    const Meshlet* pMeshlets, size_t numMeshlets, size_t numVertices);
+
+MeshletBounds computeMeshletBounds(const uint32_t* pIndices,
+    const Meshlet& meshlet, const VertexStream& positions);
+
+// Moves every vertex to its remapped slot; vertices welded together are
+// expected to be interchangeable. pDst must not alias pVertices.
+template <typename Vertex>
+void remapVertices(Vertex* pDst, const Vertex* pVertices, size_t numVertices,
+    const uint32_t* pRemap) {
+  for (size_t v = 0; v < numVertices; ++v) {
+    if (pRemap[v] != kUnusedVertex) {
+      pDst[pRemap[v]] = pVertices[v];
+    }
+  }
+}
+
+#endif  // MESHOPTIMIZER_HPP
@@ -0,0 +1,109 @@
+#ifndef MESHREGISTRY_HPP
+#define MESHREGISTRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Mesh.hpp"
+
+// Identifies a mesh either by how it is generated, a generator name plus
+// its parameters, or by what it contains, a 64-bit hash of its packed
+// vertices, indices and LOD ranges. Content keys can collide; see
+// MeshRegistry::intern.
+struct MeshKey {
+  std::string         generator;  // empty for content keys
+  std::vector<double> params;
+  uint64_t            contentHash = 0;
+
+  static MeshKey generated(
+      std::string generator, std::initializer_list<double> params);
+  static MeshKey content(const MeshLodChain& chain);
+
+  bool operator==(const MeshKey& other) const {
+    return generator == other.generator && params == other.params &&
+           contentHash == other.contentHash;
+  }
+  size_t hash() const;
+};
+
+// Part of every cache file name, with the mesh file version and a hash of
+// the build parameters. Bump it whenever a generator or the optimization
+// stage changes its output.
+static constexpr uint32_t kMeshCacheVersion = 1;
+
+// Shared, immutable mesh data, ready to copy into GPU buffers as is.
+using MeshHandle = std::shared_ptr<const MeshLodChain>;
+
+struct MeshRegistryStats {
+  size_t hits;        // acquires answered from the registry
+  size_t builds;      // meshes built and added
+  size_t cacheLoads;  // builds read from the cache directory
+};
+
+// Hands out one shared MeshLodChain per key, so every reference to the same
+// mesh shares a single copy and it is only generated once. The registry
+// holds weak references: a mesh is freed once its last handle goes away,
+// and acquiring it again rebuilds it. Thread-safe.
+class MeshRegistry {
+ public:
+  // The registry Scene and the renderers draw their meshes from.
+  static MeshRegistry& shared();
+
+  // The mesh under `key`, calling `build` only if it is not registered.
+  // Builds run outside the lock; when two threads race to build one key,
+  // both get the copy that was registered first.
+  MeshHandle acquire(
+      const MeshKey& key, const std::function<MeshLodChain()>& build);
+
+  // Registers `chain` by content, or returns the registered chain with the
+  // same content hash if its vertices, indices and LOD ranges are also
+  // byte-for-byte equal. A chain whose hash merely collides is returned in
+  // a handle of its own, unshared. For meshes that do not come from a
+  // generator.
+  MeshHandle intern(MeshLodChain&& chain);
+
+  // createSphereLodChain(vertexFormat), shared.
+  MeshHandle acquireSphereLods(VertexFormat vertexFormat);
+
+  // Directory where generated meshes are cached as mesh files (see
+  // MeshFile.hpp): builds read the file if it is there and valid, and
+  // write it otherwise. Empty, the default, disables the cache. File names
+  // carry kMeshCacheVersion, kMeshFileVersion and a hash of the build
+  // parameters, so files from other builds are never read; they are left
+  // in place.
+  void setCacheDirectory(std::string directory);
+
+  // Meshes with at least one live handle.
+  size_t            numMeshes() const;
+  MeshRegistryStats stats() const;
+
+ private:
+  struct KeyHash {
+    size_t operator()(const MeshKey& key) const { return key.hash(); }
+  };
+
+  // Erases the entries of meshes nobody references anymore. Called with
+  // _mutex held.
+  void dropExpired();
+
+  // build(), or the cache file for `name` and `buildParams` if there is a
+  // valid one.
+  MeshLodChain buildCached(const std::string& name,
+      const std::vector<double>&           buildParams,
+      const std::function<MeshLodChain()>& build);
+
+  mutable std::mutex _mutex;
+  std::unordered_map<MeshKey, std::weak_ptr<const MeshLodChain>, KeyHash>
+                    _meshes;
+  MeshRegistryStats _stats = {0, 0, 0};
+  std::string       _cacheDirectory;
+};
+
+#endif  // MESHREGISTRY_HPP
@@ -0,0 +1,47 @@
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "JobSystem.hpp"
+#include "MeshOptimizer.hpp"
+
+// Normals of the triangles around a collapsing vertex may turn by at most
+// acos(kMaxCollapseNormalTurn); anything sharper would fold the surface.
+static constexpr float kMaxCollapseNormalTurn = 0.25f;
+
+struct SimplifyResult {
+  size_t numIndices;
+  // Largest error of any collapse made, as a distance in position units:
+  // the area-weighted RMS distance from the surviving vertex to the
+  // original triangle planes merged into it.
+  float error;
+};
+
+// Quadric error metric edge collapse (Garland and Heckbert). Every vertex
+// accumulates the area-weighted plane quadrics of its triangles, and a
+// heap hands out the cheapest edge collapse until the index count is at or
+// below `targetIndexCount` or the next collapse would exceed `targetError`.
+// Collapses move a vertex onto one of its neighbors, so no vertex is
+// created or moved and the output indexes the original vertex array.
+//
+// Vertices are matched by position. Vertices on open borders or
+// non-manifold edges are locked in place. A position shared by several
+// vertices (an attribute seam) only moves along a seam edge, onto another
+// such position, and each of its vertices takes the one it shares an edge
+// with there. Where more than two seams meet, as everywhere on a flat-shaded
+// mesh, the remaining vertices take the one with the closest attributes in
+// `pAttributes` (usually normals), or an arbitrary one without it.
+// Collapses that would make an edge non-manifold or flip a triangle are
+// skipped. Adjacency and quadrics are built on `jobSystem`.
+// Collapses start with a parallel pass over spatially sorted regions, each
+// with its own heap and limited to edges inside the region, and finish
+// with a single heap over the whole mesh. pDst needs room for numIndices
+// indices and may alias pIndices.
+SimplifyResult simplifyMesh(uint32_t* pDst, const uint32_t* pIndices,
+    size_t numIndices, const VertexStream& positions, size_t numVertices,
+    size_t targetIndexCount, float targetError, JobSystem& jobSystem,
+    const VertexStream* pAttributes = nullptr);
+
+#endif  // MESHSIMPLIFIER_HPP
@@ -7,7 +7,8 @@
 
 class MyMTKViewDelegate : public MTK::ViewDelegate {
  public:
-  MyMTKViewDelegate(MTL::Device* pDevice);
+  MyMTKViewDelegate(MTL::Device* pDevice, const InstanceGrid& grid,
+      VertexFormat vertexFormat, InstanceFormat instanceFormat);
   virtual ~MyMTKViewDelegate() override;
 
   virtual void drawInMTKView(MTK::View* pView) override;
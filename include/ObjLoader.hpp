@@ -0,0 +1,71 @@
+#ifndef OBJLOADER_HPP
+#define OBJLOADER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "JobSystem.hpp"
+#include "Mesh.hpp"
+
+struct ObjStats {
+  size_t positions;  // `v` records
+  size_t normals;    // `vn` records
+  size_t faces;      // `f` records, before triangulation
+  size_t chunks;     // pieces parsed in parallel
+  bool   generatedNormals;
+};
+
+// Parses Wavefront OBJ text into an indexed triangle mesh. Only positions
+// (`v`), normals (`vn`) and faces (`f`) are read; texture coordinates and
+// every other record are skipped. Polygons are fanned into triangles,
+// which are reversed from OBJ's counter-clockwise order to face along
+// cross(c - a, b - a) like the built-in meshes. Every distinct
+// (position, normal) pair becomes one vertex, in order of first use.
+// Corners without a normal use the area-weighted average of the face
+// normals around their position.
+//
+// The text is cut into chunks at line breaks and parsed on `jobSystem`:
+// one pass counts each chunk's records so that relative (negative)
+// indices resolve and attributes land directly in place, a second parses
+// them. Returns false with a message naming the offending line on
+// malformed numbers or out-of-range indices.
+bool parseObj(const char* pText, size_t size, JobSystem& jobSystem,
+    std::vector<shader_types::VertexData>* pVertices,
+    std::vector<uint32_t>* pIndices, std::string* pError = nullptr,
+    ObjStats* pStats = nullptr);
+
+// A mesh loaded from an OBJ file.
+class ObjMesh : public Mesh {
+ public:
+  // Memory-maps `path` and parses it with parseObj(). Returns nullptr and
+  // sets *pError on failure.
+  static std::unique_ptr<ObjMesh> load(const char* path,
+      JobSystem& jobSystem, std::string* pError = nullptr,
+      ObjStats* pStats = nullptr);
+
+  ObjMesh(std::vector<shader_types::VertexData> vertices,
+      std::vector<uint32_t>                     indices)
+      : _vertices(std::move(vertices)), _indices(std::move(indices)) {}
+
+  size_t vertexCount() const override { return _vertices.size(); }
+  size_t indexCount() const override { return _indices.size(); }
+
+  void writeVertices(shader_types::VertexData* pVertices) const override {
+    std::copy(_vertices.begin(), _vertices.end(), pVertices);
+  }
+  void writeIndices(uint16_t* pIndices) const override {
+    std::copy(_indices.begin(), _indices.end(), pIndices);
+  }
+  void writeIndices(uint32_t* pIndices) const override {
+    std::copy(_indices.begin(), _indices.end(), pIndices);
+  }
+
+ private:
+  std::vector<shader_types::VertexData> _vertices;
+  std::vector<uint32_t>                 _indices;
+};
+
+#endif  // OBJLOADER_HPP
@@ -0,0 +1,72 @@
+#ifndef OCCLUSIONCULLER_HPP
+#define OCCLUSIONCULLER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Culling.hpp"
+#include "Math.hpp"
+
+static constexpr uint32_t kOcclusionWidth  = 256;
+static constexpr uint32_t kOcclusionHeight = 256;
+
+// Low-resolution software occlusion culling against a hierarchical depth
+// buffer. Each frame, occluder spheres are rasterized as the screen-space
+// square inscribed in their projection, at the depth of their center,
+// which the real surface is guaranteed to cover and lie in front of.
+// buildHierarchy() then reduces the buffer into a max-depth mip chain and
+// cullSpheres() rejects spheres whose nearest point lies behind every
+// occluder over their screen bounds.
+//
+// Depth is linear view depth (clip w), so clipFromModel must be a
+// perspective projection times a rigid transform.
+class OcclusionCuller {
+ public:
+  explicit OcclusionCuller(
+      uint32_t width = kOcclusionWidth, uint32_t height = kOcclusionHeight);
+
+  // Clears the depth buffer to infinity.
+  void beginFrame(const Math::float4x4& clipFromModel);
+  // `occluders` radii should be conservative inner radii: the rendered
+  // geometry must cover the full sphere of that radius.
+  void addOccluders(const SphereBounds& occluders, size_t count);
+  void buildHierarchy();
+
+  // Writes pIndices[i] to pVisible for every sphere i that may be visible
+  // and returns how many were written. pVisible may alias pIndices.
+  size_t cullSpheres(const SphereBounds& bounds, size_t count,
+      const uint32_t* pIndices, uint32_t* pVisible) const;
+
+  uint32_t width() const { return _width; }
+  uint32_t height() const { return _height; }
+  size_t   numLevels() const { return _levels.size(); }
+  // Level 0 is the full-resolution buffer; `x`/`y` are in level texels.
+  float depthAt(size_t level, uint32_t x, uint32_t y) const;
+
+ private:
+  struct Level {
+    uint32_t           width;
+    uint32_t           height;
+    std::vector<float> depth;
+  };
+
+  // Screen-space bounds of a sphere, in level-0 pixels.
+  struct ScreenRect {
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+  };
+
+  uint32_t           _width;
+  uint32_t           _height;
+  Math::float4x4     _clipFromModel;
+  std::vector<Level> _levels;
+
+  bool project(float x, float y, float z, float radius, bool outer,
+      ScreenRect* pRect, float* pDepth) const;
+  void fillRect(int x0, int y0, int x1, int y1, float depth);
+};
+
+#endif  // OCCLUSIONCULLER_HPP
@@ -0,0 +1,47 @@
+#ifndef PLYREADER_HPP
+#define PLYREADER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "ShaderTypes.hpp"
+
+// Read buffer size of streamPly(). Records that straddle the end of the
+// buffer are moved to its front before it is refilled.
+constexpr size_t kPlyWindowBytes = 4 << 20;
+
+// Element counts from a PLY header.
+struct PlyInfo {
+  size_t numVertices;
+  size_t numFaces;
+  bool   hasNormals;
+};
+
+// Receives a streamed PLY mesh. Chunks arrive in file order, usually all
+// vertices and then all triangles, and point into the reader's buffers,
+// valid only during the call. Returning false stops the stream.
+struct PlyConsumer {
+  // Called once after the header; may be empty.
+  std::function<bool(const PlyInfo& info)> begin;
+  // `count` vertices starting at index `firstVertex`. Without normals in
+  // the file, normals are zero.
+  std::function<bool(size_t firstVertex,
+      const shader_types::VertexData* pVertices, size_t count)>
+      vertices;
+  // `count` indices, whole triangles. Polygons are fanned into triangles
+  // reversed to face along cross(c - a, b - a) like the built-in meshes.
+  std::function<bool(const uint32_t* pIndices, size_t count)> triangles;
+};
+
+// Streams a binary little-endian PLY file to `consumer` through a window
+// of `windowBytes`, so memory use does not grow with the file, which may
+// be larger than RAM. Vertex positions and normals may be stored as any
+// scalar type; other properties and elements are skipped. Returns false
+// and sets *pError, naming the file, on I/O errors, malformed or
+// unsupported files, out-of-range indices, or when the consumer stops.
+bool streamPly(const char* path, const PlyConsumer& consumer,
+    std::string* pError = nullptr, size_t windowBytes = kPlyWindowBytes);
+
+#endif  // PLYREADER_HPP
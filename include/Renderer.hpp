@@ -1,27 +1,38 @@
 #ifndef RENDERER_HPP
 #define RENDERER_HPP
 
-#include <simd/simd.h>
-
 #include <Metal/Metal.hpp>
 #include <MetalKit/MetalKit.hpp>
 
-static constexpr size_t kInstanceRows    = 10;
-static constexpr size_t kInstanceColumns = 10;
-static constexpr size_t kInstanceDepth   = 10;
-static constexpr size_t kNumInstances =
-    (kInstanceRows * kInstanceColumns * kInstanceDepth);
-static constexpr size_t kMaxFramesInFlight = 3;
+#include "JobSystem.hpp"
+#include "Scene.hpp"
+#include "UploadRing.hpp"
 
 class Renderer {
  public:
-  Renderer(MTL::Device* pDevice);
+  // `vertexFormat` selects float or quantized vertex buffers, drawn with
+  // vertexMain or vertexMainQuantized respectively; `instanceFormat`
+  // switches either to its *Compact variant.
+  explicit Renderer(MTL::Device* pDevice,
+      const InstanceGrid&        grid           = kDefaultInstanceGrid,
+      VertexFormat               vertexFormat   = VertexFormat::Float,
+      InstanceFormat             instanceFormat = InstanceFormat::Full);
   ~Renderer();
   void buildShaders();
   void buildDepthStencilStates();
   void buildBuffers();
   void draw(MTK::View* pView);
 
+  // Takes effect on the next draw; the upload ring is grown lazily.
+  void setInstanceGrid(const InstanceGrid& grid);
+
+  // Instance, camera and light bytes written for the last frame, including
+  // alignment padding.
+  size_t uploadedBytesLastFrame() const { return _uploadRing.lastFrameBytes(); }
+  // Culling counters and cost of the last frame.
+  const CullStats& cullStats() const { return _cullStats; }
+  const LodStats&  lodStats() const { return _lodStats; }
+
  private:
   MTL::Device*              _pDevice;
   MTL::CommandQueue*        _pCommandQueue;
@@ -29,18 +40,33 @@ class Renderer {
   MTL::RenderPipelineState* _pPSO;
   MTL::DepthStencilState*   _pDepthStencilState;
   MTL::Buffer*              _pVertexDataBuffer;
-  MTL::Buffer*              _pInstanceDataBuffer[kMaxFramesInFlight];
-  MTL::Buffer*              _pCameraDataBuffer[kMaxFramesInFlight];
   MTL::Buffer*              _pIndexBuffer;
-  MTL::Buffer*              _pLightDataBuffer[kMaxFramesInFlight];
-  float                     _angle;
-  int                       _frame;
-  float                     _currentTime;
+  MTL::Buffer*              _pUploadBuffer;
+  UploadRing                _uploadRing;
+  Scene                     _scene;
+  JobSystem                 _jobSystem;
+  CullStats                 _cullStats;
+  LodStats                  _lodStats;
   dispatch_semaphore_t      _semaphore;
   static const int          kMaxFramesInFlight;
-  size_t                    _numIndices;
+  // Metal wants 256-byte aligned offsets for constant-space buffer bindings.
+  static constexpr size_t   kUploadAlignment = 256;
+  MeshHandle                _mesh;
+  MeshLod                   _lods[kNumSphereLods];
+  IndexType                 _indexType;
+  VertexFormat              _vertexFormat;
+  InstanceFormat            _instanceFormat;
+  // Per-LOD position decode for quantized vertices.
+  shader_types::VertexQuantization _lodQuantizations[kNumSphereLods];
+
+  struct FrameUploads {
+    UploadRing::Allocation camera;
+    UploadRing::Allocation light;
+    UploadRing::Allocation instances;  // last, so culling can shrink it
+  };
 
-  void updateLightData(MTL::Buffer* pLightBuffer);
+  bool allocateFrameUploads(uint32_t numInstances, FrameUploads* pUploads);
+  void growUploadBuffer(size_t requiredBytes);
 };
 
 #endif  // RENDERER_HPP
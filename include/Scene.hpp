@@ -0,0 +1,154 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Culling.hpp"
+#include "InstanceTransforms.hpp"
+#include "JobSystem.hpp"
+#include "Mesh.hpp"
+#include "MeshRegistry.hpp"
+#include "OcclusionCuller.hpp"
+
+// Dimensions of the instance grid. The instance count is kept in 32 bits,
+// matching what a single instanced draw can address.
+struct InstanceGrid {
+  uint32_t rows;
+  uint32_t columns;
+  uint32_t depth;
+
+  uint32_t numInstances() const { return rows * columns * depth; }
+};
+
+static constexpr InstanceGrid kDefaultInstanceGrid = {10, 10, 10};
+static constexpr size_t       kInstancesPerJob     = 1024;
+static constexpr size_t       kTransformBlock      = 256;
+
+// Visible instances grouped by sphere LOD: bucket `lod` occupies
+// [first[lod], first[lod] + count[lod]) of the instance data, so each one
+// can be drawn with a single instanced call.
+struct InstanceBuckets {
+  uint32_t first[kNumSphereLods];
+  uint32_t count[kNumSphereLods];
+};
+
+// What the renderers submitted per LOD in the last frame.
+struct LodStats {
+  uint32_t instances[kNumSphereLods];
+  uint64_t triangles[kNumSphereLods];
+};
+
+// Backend-independent description of the animated sphere grid. Both the
+// Metal renderer and the software rasterizer pull their per-frame shader
+// inputs from here so they stay in lockstep.
+class Scene {
+ public:
+  explicit Scene(const InstanceGrid& grid = kDefaultInstanceGrid);
+
+  void advance();
+
+  // Re-lays out the grid; the instance count may grow or shrink freely.
+  void                setInstanceGrid(const InstanceGrid& grid);
+  const InstanceGrid& instanceGrid() const { return _grid; }
+
+  // Fills instances [first, last) of pInstanceData; pInstanceData points
+  // at instance 0 so disjoint ranges can be written concurrently.
+  void writeInstanceData(shader_types::InstanceData* pInstanceData,
+      size_t first, size_t last) const;
+  // Splits the full instance range into kInstancesPerJob chunks on `jobs`.
+  void writeInstanceData(
+      shader_types::InstanceData* pInstanceData, JobSystem& jobs) const;
+  // Frustum-culls the instance bounding spheres against the camera that
+  // writeCameraData(aspect) produces, then (unless disabled) rejects
+  // instances hidden behind nearer ones using a software Hi-Z buffer. The
+  // survivors get a sphere LOD from their projected radius on a viewport
+  // `viewportHeight` pixels tall and are packed into per-LOD buckets at
+  // the front of pInstanceData. Returns the number of instances written.
+  uint32_t writeVisibleInstanceData(shader_types::InstanceData* pInstanceData,
+      float aspect, float viewportHeight, JobSystem& jobs,
+      InstanceBuckets* pBuckets, CullStats* pStats = nullptr);
+  uint32_t writeVisibleInstanceData(
+      shader_types::CompactInstanceData* pInstanceData, float aspect,
+      float viewportHeight, JobSystem& jobs, InstanceBuckets* pBuckets,
+      CullStats* pStats = nullptr);
+  void writeCameraData(shader_types::CameraData* pCameraData,
+      float                                      aspect) const;
+  void writeLightData(shader_types::LightData* pLightData) const;
+
+  uint32_t numInstances() const { return _grid.numInstances(); }
+
+  void setFrustumCulling(bool enabled) { _frustumCulling = enabled; }
+  void setOcclusionCulling(bool enabled) { _occlusionCulling = enabled; }
+
+  // The float sphere LOD chain every instance references, from
+  // MeshRegistry::shared().
+  const MeshHandle& mesh() const { return _mesh; }
+
+ private:
+  InstanceGrid _grid;
+  MeshHandle   _mesh;
+  float        _angle;
+  float        _currentTime;
+
+  // Frame-invariant inputs: sin(ix)/cos(iy) feed the per-instance rotation
+  // angles and the colors never change once the grid is laid out.
+  std::vector<float>        _rowSin;
+  std::vector<float>        _columnCos;
+  std::vector<Math::float4> _instanceColors;
+  std::vector<uint32_t>     _packedInstanceColors;  // RGBA8
+
+  // Culling scratch: visible indices are compacted per kInstancesPerJob
+  // chunk, sorted by LOD within the chunk and then scattered to their
+  // buckets using prefix sums over (LOD, chunk).
+  std::vector<uint32_t> _visibleIndices;
+  std::vector<uint32_t> _sortedIndices;
+  std::vector<uint32_t> _chunkCounts;
+  std::vector<uint32_t> _lodCounts;
+  std::vector<uint32_t> _lodOffsets;
+  bool                  _frustumCulling;
+  bool                  _occlusionCulling;
+  OcclusionCuller       _occlusionCuller;
+
+  // LOD selection: projected radius in pixels is _lodPixelRadius / w, with
+  // w = dot(_lodDepthRow, (position, 1)).
+  Math::float4 _lodDepthRow;
+  float        _lodPixelRadius;
+  float        _lodMaxPixelRadius[kNumSphereLods];
+  float        _lodInnerRadius[kNumSphereLods];  // fraction of the radius
+
+  Math::float4x4 objectTransform() const;
+  Math::float3   gridPosition(uint32_t ix, uint32_t iy, uint32_t iz) const;
+  void gatherPositions(
+      size_t first, size_t count, float* pX, float* pY, float* pZ) const;
+  void gatherPositions(const uint32_t* pIndices, size_t count, float* pX,
+      float* pY, float* pZ) const;
+  size_t selectLod(float x, float y, float z) const;
+  // Runs the occlusion pass over the per-chunk visible lists, shrinking
+  // _chunkCounts.
+  void cullOccluded(const Math::float4x4& clipFromModel, size_t numChunks,
+      JobSystem& jobs);
+  // Culls and buckets the visible instances; the indices stay in
+  // _sortedIndices until writeBuckets() turns them into instance data.
+  uint32_t cullInstances(float aspect, float viewportHeight, JobSystem& jobs,
+      InstanceBuckets* pBuckets, CullStats* pStats);
+  template <typename Instance>
+  void writeBuckets(Instance* pInstanceData, JobSystem& jobs) const;
+  void writeInstanceData(shader_types::InstanceData* pInstanceData,
+      const uint32_t* pIndices, size_t count) const;
+  void writeInstanceData(shader_types::CompactInstanceData* pInstanceData,
+      const uint32_t* pIndices, size_t count) const;
+  template <typename Instance>
+  void writeIndexedInstances(
+      Instance* pInstanceData, const uint32_t* pIndices, size_t count) const;
+  void writeColor(shader_types::InstanceData* pInstance, uint32_t index) const;
+  void writeColor(
+      shader_types::CompactInstanceData* pInstance, uint32_t index) const;
+};
+
+// Parses "ROWSxCOLUMNSxDEPTH" (e.g. "100x100x100"). Rejects empty
+// dimensions and grids whose instance count does not fit in 32 bits.
+bool parseInstanceGrid(const char* pText, InstanceGrid* pGrid);
+
+#endif  // SCENE_HPP
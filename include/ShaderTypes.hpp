@@ -0,0 +1,62 @@
+#ifndef SHADERTYPES_HPP
+#define SHADERTYPES_HPP
+
+#include <cstdint>
+
+#include "Math.hpp"
+
+// Buffer layouts shared with shader.metal; keep the two in sync.
+namespace shader_types {
+struct VertexData {
+  Math::float3 position;
+  Math::float3 normal;
+};
+
+// Compact alternative to VertexData, 12 instead of 32 bytes: positions are
+// unorm16 within the mesh's bounding box and normals are octahedral-encoded
+// snorm16. VertexQuantization maps the positions back.
+struct QuantizedVertexData {
+  uint16_t position[3];
+  uint16_t padding;
+  int16_t  normal[2];
+};
+
+// position = offset + scale * float3(QuantizedVertexData::position)
+struct VertexQuantization {
+  Math::float3 offset;
+  Math::float3 scale;
+};
+
+struct InstanceData {
+  Math::float4x4 instanceTransform;
+  Math::float3x3 instanceNormalTransform;
+  Math::float4   instanceColor;
+};
+
+// Compact alternative to InstanceData, 64 instead of 128 bytes: the top
+// three rows of the affine instance transform and an RGBA8 color (red in
+// the low byte). The normal transform is the transform's upper 3x3, as in
+// InstanceData, so it is not stored.
+struct CompactInstanceData {
+  Math::float4 transformRows[3];
+  uint32_t     color;
+  uint32_t     padding[3];
+};
+
+struct CameraData {
+  Math::float4x4 perspectiveTransform;
+  Math::float4x4 worldTransform;
+  Math::float3x3 worldNormalTransform;
+  Math::float3   cameraPosition;
+};
+struct LightData {
+  Math::float3 position;
+  Math::half3  color;
+  float        intensity;
+  float        range;
+  float        pulseSpeed;
+  float        time;
+};
+}  // namespace shader_types
+
+#endif  // SHADERTYPES_HPP
@@ -0,0 +1,118 @@
+#ifndef SOFTWARERENDERER_HPP
+#define SOFTWARERENDERER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "Culling.hpp"
+#include "JobSystem.hpp"
+#include "Mesh.hpp"
+#include "Scene.hpp"
+
+static constexpr uint32_t kTileSize         = 64;
+static constexpr size_t   kInstancesPerChunk = 16;
+
+// Offscreen render target. Color is BGRA8 with sRGB encoding, matching the
+// MTKView's PixelFormatBGRA8Unorm_sRGB; depth holds NDC z in [0, 1].
+struct Framebuffer {
+  uint32_t              width;
+  uint32_t              height;
+  std::vector<uint32_t> color;
+  std::vector<float>    depth;
+};
+
+// Tile-based CPU rasterizer that reproduces vertexMain/fragmentMain from
+// shader.metal for the instanced sphere grid. Vertex shading and binning
+// are split across instance chunks, rasterization and shading across
+// screen tiles, and every stage runs on a `numThreads`-wide JobSystem.
+class SoftwareRenderer {
+ public:
+  // `vertexFormat` picks the layout the sphere LODs are stored in; the
+  // vertex stage decodes quantized vertices like vertexMainQuantized.
+  // `instanceFormat` does the same for the per-frame instance records.
+  SoftwareRenderer(uint32_t width, uint32_t height, unsigned int numThreads,
+      const InstanceGrid& grid           = kDefaultInstanceGrid,
+      VertexFormat        vertexFormat   = VertexFormat::Float,
+      InstanceFormat      instanceFormat = InstanceFormat::Full);
+
+  void buildBuffers();
+  void setInstanceGrid(const InstanceGrid& grid);
+  // Both culling passes are on by default; turning them off is useful for
+  // measuring what they save.
+  void setFrustumCulling(bool enabled) { _scene.setFrustumCulling(enabled); }
+  void setOcclusionCulling(bool enabled) {
+    _scene.setOcclusionCulling(enabled);
+  }
+  // Per-meshlet cone and frustum tests before binning; on by default.
+  void setMeshletCulling(bool enabled) { _meshletCulling = enabled; }
+  void draw();
+
+  const Framebuffer& framebuffer() const { return _framebuffer; }
+  unsigned int       numThreads() const { return _jobSystem.numThreads(); }
+  uint32_t           numInstances() const { return _scene.numInstances(); }
+  // Culling counters and cost of the last draw().
+  const CullStats& cullStats() const { return _cullStats; }
+  const LodStats&  lodStats() const { return _lodStats; }
+  const MeshletStats& meshletStats() const { return _meshletStats; }
+
+ private:
+  struct ScreenVertex {
+    float        x;
+    float        y;
+    float        z;
+    float        invW;
+    Math::float3 worldPos;
+    Math::float3 normal;
+  };
+
+  Framebuffer    _framebuffer;
+  JobSystem      _jobSystem;
+  uint32_t       _tilesX;
+  uint32_t       _tilesY;
+  Scene          _scene;
+  VertexFormat   _vertexFormat;
+  InstanceFormat _instanceFormat;
+  CullStats      _cullStats;
+  LodStats       _lodStats;
+  MeshletStats   _meshletStats;
+  bool           _meshletCulling;
+
+  // Per-LOD draw of the current frame: the instances of bucket `lod` and
+  // where their screen vertices and triangle ids start.
+  struct Bucket {
+    const MeshLod* pLod;
+    uint32_t       firstInstance;
+    uint32_t       numInstances;
+    size_t         firstScreenVertex;
+    size_t         firstTriangle;
+  };
+
+  MeshHandle _mesh;
+  Bucket     _buckets[kNumSphereLods];
+  // Only the first _cullStats.visible entries are live after culling, and
+  // only the array matching _instanceFormat is used.
+  std::vector<shader_types::InstanceData>        _instanceData;
+  std::vector<shader_types::CompactInstanceData> _compactInstanceData;
+  shader_types::CameraData                       _cameraData;
+  shader_types::LightData                        _lightData;
+
+  std::vector<ScreenVertex> _screenVertices;
+  // One triangle list per (instance chunk, tile) pair. Keeping chunks
+  // separate lets binning run without locks and keeps submission order
+  // deterministic when a tile walks its lists.
+  std::vector<std::vector<uint32_t>> _bins;
+  // Meshlet counters per instance chunk, summed after binning.
+  std::vector<MeshletStats> _chunkMeshletStats;
+
+  void          resizeInstanceBuffers();
+  size_t        numChunks() const;
+  const Bucket& bucketOfInstance(size_t instance) const;
+  const Bucket& bucketOfTriangle(size_t triangle) const;
+  Math::float4x4 instanceTransform(size_t instance) const;
+  Math::float3   instanceColor(size_t instance) const;
+  void shadeVertices(size_t instance);
+  void binTriangles(size_t chunk);
+  void rasterizeTile(size_t tile);
+};
+
+#endif  // SOFTWARERENDERER_HPP
@@ -0,0 +1,73 @@
+#ifndef UPLOADRING_HPP
+#define UPLOADRING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Sub-allocates per-frame upload regions out of one persistently mapped
+// buffer that is reused as a ring. Every frame's allocations are tagged
+// with a fence value; once that fence is signalled (typically from a GPU
+// completion handler) the frame's region becomes reusable. Frames retire in
+// submission order, so only the ring's tail needs tracking.
+//
+// The ring does not own memory: the caller maps a buffer and hands its
+// base pointer and size to reset(). Only signal() is thread-safe.
+class UploadRing {
+ public:
+  static constexpr size_t kMaxFramesInFlight = 8;
+
+  struct Allocation {
+    void*  pData;
+    size_t offset;
+  };
+
+  UploadRing();
+
+  // Points the ring at new storage and forgets all frames still in flight;
+  // their fences are ignored when they are signalled later.
+  void reset(void* pBase, size_t capacity);
+
+  // Retires every frame whose fence has been signalled.
+  void beginFrame();
+  // Returns false without allocating when the ring has no room left;
+  // `alignment` must be a power of two.
+  bool allocate(size_t size, size_t alignment, Allocation* pAllocation);
+  // Gives back the unused end of the most recent allocation, e.g. after
+  // culling wrote fewer instances than were reserved.
+  void shrinkLastAllocation(size_t size);
+  // Closes the current frame and returns the fence to signal once the GPU
+  // no longer reads from it. At most kMaxFramesInFlight frames may be
+  // pending at once.
+  uint64_t endFrame();
+  void     signal(uint64_t fence);
+
+  size_t capacity() const { return _capacity; }
+  size_t bytesInFlight() const { return size_t(_head - _tail); }
+  // Bytes handed out since beginFrame(), including alignment padding.
+  size_t frameBytes() const { return size_t(_head - _frameStart); }
+  size_t lastFrameBytes() const { return _lastFrameBytes; }
+
+ private:
+  struct Frame {
+    uint64_t fence;
+    uint64_t end;
+  };
+
+  // Offsets are monotonically increasing; offset % _capacity is the
+  // position inside the buffer.
+  unsigned char*        _pBase;
+  size_t                _capacity;
+  uint64_t              _head;
+  uint64_t              _lastOffset;
+  uint64_t              _tail;
+  uint64_t              _frameStart;
+  size_t                _lastFrameBytes;
+  Frame                 _frames[kMaxFramesInFlight];
+  size_t                _firstFrame;
+  size_t                _numFrames;
+  uint64_t              _nextFence;
+  std::atomic<uint64_t> _completedFence;
+};
+
+#endif  // UPLOADRING_HPP
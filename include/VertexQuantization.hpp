@@ -0,0 +1,62 @@
+#ifndef VERTEXQUANTIZATION_HPP
+#define VERTEXQUANTIZATION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "ShaderTypes.hpp"
+
+// Vertex buffer layout a mesh is uploaded in.
+enum class VertexFormat { Float, Quantized };
+
+inline size_t vertexSize(VertexFormat format) {
+  return format == VertexFormat::Float
+             ? sizeof(shader_types::VertexData)
+             : sizeof(shader_types::QuantizedVertexData);
+}
+
+// Worst-case angle in radians between a unit normal and its decoded
+// octahedral encoding. The nearest snorm16 lattice point lies within half
+// a cell diagonal, sqrt(2) / 2 / 32767, of the exact encoding, and the
+// octahedral map stretches distances by at most 3 onto the sphere; the
+// rest covers float rounding.
+static constexpr float kMaxNormalError = 3.f * 0.70710678f / 32767.f + 1e-6f;
+
+// The positions' bounding box spread over the unorm16 range. A flat axis
+// gets a zero scale and decodes exactly.
+shader_types::VertexQuantization computeVertexQuantization(
+    const shader_types::VertexData* pVertices, size_t count);
+
+// Rounds every position to the nearest unorm16 step of `quantization`, so
+// each axis is off by at most half of its scale, and picks the octahedral
+// encoding closest in angle to the normal.
+void quantizeVertices(shader_types::QuantizedVertexData* pDst,
+    const shader_types::VertexData* pVertices, size_t count,
+    const shader_types::VertexQuantization& quantization);
+
+// A zero normal, which has no direction, encodes as +Z.
+void encodeOctahedral(const Math::float3& normal, int16_t* pEncoded);
+
+// Decoding mirrors vertexMainQuantized in shader.metal.
+inline Math::float3 dequantizePosition(
+    const shader_types::QuantizedVertexData& vertex,
+    const shader_types::VertexQuantization&  quantization) {
+  return {quantization.offset.x + quantization.scale.x * vertex.position[0],
+      quantization.offset.y + quantization.scale.y * vertex.position[1],
+      quantization.offset.z + quantization.scale.z * vertex.position[2]};
+}
+
+inline Math::float3 decodeOctahedral(const int16_t* pEncoded) {
+  float       x = std::max(pEncoded[0] / 32767.f, -1.f);
+  float       y = std::max(pEncoded[1] / 32767.f, -1.f);
+  const float z = 1.f - fabsf(x) - fabsf(y);
+  // Unfold the lower hemisphere.
+  const float t = std::max(-z, 0.f);
+  x += x >= 0.f ? -t : t;
+  y += y >= 0.f ? -t : t;
+  return Math::normalize(Math::float3{x, y, z});
+}
+
+#endif  // VERTEXQUANTIZATION_HPP
@@ -4,11 +4,15 @@
 #include <Metal/Metal.hpp>
 #include <MetalKit/MetalKit.hpp>
 
-MyAppDelegate::MyAppDelegate()
+MyAppDelegate::MyAppDelegate(const InstanceGrid& grid,
+    VertexFormat vertexFormat, InstanceFormat instanceFormat)
     : _pWindow(nullptr)
     , _pMtkView(nullptr)
     , _pDevice(nullptr)
-    , _pViewDelegate(nullptr) {}
+    , _pViewDelegate(nullptr)
+    , _instanceGrid(grid)
+    , _vertexFormat(vertexFormat)
+    , _instanceFormat(instanceFormat) {}
 
 MyAppDelegate::~MyAppDelegate() {
   if (_pMtkView) _pMtkView->release();
@@ -91,7 +95,8 @@ void MyAppDelegate::applicationDidFinishLaunching(
       MTL::PixelFormat::PixelFormatDepth16Unorm);
   _pMtkView->setClearDepth(1.0f);
 
-  _pViewDelegate = new MyMTKViewDelegate(_pDevice);
+  _pViewDelegate = new MyMTKViewDelegate(
+      _pDevice, _instanceGrid, _vertexFormat, _instanceFormat);
   _pMtkView->setDelegate(_pViewDelegate);
 
   _pWindow->setContentView(_pMtkView);
@@ -0,0 +1,186 @@
+#include "Culling.hpp"
+
+#if !defined(MATH_FORCE_SCALAR) && \
+    (defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE4_1__))
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Per-ISA wrappers; vinside() returns one bit per lane, set where
+// `distance` is non-negative.
+#if !defined(MATH_FORCE_SCALAR) && defined(__AVX512F__)
+#define CULLING_SIMD 1
+constexpr size_t kLanes = 16;
+using vf                = __m512;
+
+inline vf       vset(float v) { return _mm512_set1_ps(v); }
+inline vf       vload(const float* p) { return _mm512_loadu_ps(p); }
+inline vf       vmadd(vf a, vf b, vf c) { return _mm512_fmadd_ps(a, b, c); }
+inline vf       vadd(vf a, vf b) { return _mm512_add_ps(a, b); }
+inline uint32_t vinside(vf distance) {
+  return _mm512_cmp_ps_mask(distance, _mm512_setzero_ps(), _CMP_GE_OQ);
+}
+#elif !defined(MATH_FORCE_SCALAR) && defined(__AVX2__)
+#define CULLING_SIMD 1
+constexpr size_t kLanes = 8;
+using vf                = __m256;
+
+inline vf vset(float v) { return _mm256_set1_ps(v); }
+inline vf vload(const float* p) { return _mm256_loadu_ps(p); }
+inline vf vmadd(vf a, vf b, vf c) {
+#if defined(__FMA__)
+  return _mm256_fmadd_ps(a, b, c);
+#else
+  return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+inline vf       vadd(vf a, vf b) { return _mm256_add_ps(a, b); }
+inline uint32_t vinside(vf distance) {
+  return _mm256_movemask_ps(
+      _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+}
+#elif !defined(MATH_FORCE_SCALAR) && defined(__SSE4_1__)
+#define CULLING_SIMD 1
+constexpr size_t kLanes = 4;
+using vf                = __m128;
+
+inline vf       vset(float v) { return _mm_set1_ps(v); }
+inline vf       vload(const float* p) { return _mm_loadu_ps(p); }
+inline vf       vmadd(vf a, vf b, vf c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline vf       vadd(vf a, vf b) { return _mm_add_ps(a, b); }
+inline uint32_t vinside(vf distance) {
+  return _mm_movemask_ps(_mm_cmpge_ps(distance, _mm_setzero_ps()));
+}
+#else
+constexpr size_t kLanes = 1;
+#endif
+
+Math::float4 normalizePlane(const Math::float4& plane) {
+  const float invLength = 1.f / Math::length(plane.xyz());
+  return plane * invLength;
+}
+
+}  // namespace
+
+Frustum extractFrustum(const Math::float4x4& m) {
+  // Rows of the column-major matrix.
+  Math::float4 rows[4];
+  for (int r = 0; r < 4; ++r) {
+    rows[r] = {(&m.columns[0].x)[r], (&m.columns[1].x)[r],
+        (&m.columns[2].x)[r], (&m.columns[3].x)[r]};
+  }
+
+  Frustum frustum;
+  frustum.planes[0] = normalizePlane(rows[3] + rows[0]);  // left
+  frustum.planes[1] = normalizePlane(rows[3] - rows[0]);  // right
+  frustum.planes[2] = normalizePlane(rows[3] + rows[1]);  // bottom
+  frustum.planes[3] = normalizePlane(rows[3] - rows[1]);  // top
+  frustum.planes[4] = normalizePlane(rows[2]);            // near, z >= 0
+  frustum.planes[5] = normalizePlane(rows[3] - rows[2]);  // far
+  return frustum;
+}
+
+size_t cullLanes() { return kLanes; }
+
+size_t cullSpheres(const Frustum& frustum, const SphereBounds& bounds,
+    size_t count, uint32_t baseIndex, uint32_t* pVisible) {
+#if defined(CULLING_SIMD)
+  vf nx[6], ny[6], nz[6], nw[6];
+  for (int p = 0; p < 6; ++p) {
+    nx[p] = vset(frustum.planes[p].x);
+    ny[p] = vset(frustum.planes[p].y);
+    nz[p] = vset(frustum.planes[p].z);
+    nw[p] = vset(frustum.planes[p].w);
+  }
+
+  size_t numVisible = 0;
+  size_t first      = 0;
+  for (; first + kLanes <= count; first += kLanes) {
+    const vf x      = vload(bounds.pX + first);
+    const vf y      = vload(bounds.pY + first);
+    const vf z      = vload(bounds.pZ + first);
+    const vf radius = vload(bounds.pRadius + first);
+
+    uint32_t mask = (uint32_t(1) << (kLanes - 1) << 1) - 1;
+    for (int p = 0; p < 6 && mask; ++p) {
+      vf distance = vmadd(nx[p], x, vadd(nw[p], radius));
+      distance    = vmadd(ny[p], y, distance);
+      distance    = vmadd(nz[p], z, distance);
+      mask &= vinside(distance);
+    }
+
+    // Compact the surviving lanes.
+    while (mask) {
+      pVisible[numVisible++] = baseIndex + uint32_t(first) +
+                               uint32_t(__builtin_ctz(mask));
+      mask &= mask - 1;
+    }
+  }
+
+  const SphereBounds tail = {bounds.pX + first, bounds.pY + first,
+      bounds.pZ + first, bounds.pRadius + first};
+  return numVisible + cullSpheresScalar(frustum, tail, count - first,
+                          baseIndex + uint32_t(first), pVisible + numVisible);
+#else
+  return cullSpheresScalar(frustum, bounds, count, baseIndex, pVisible);
+#endif
+}
+
+size_t cullSpheresScalar(const Frustum& frustum, const SphereBounds& bounds,
+    size_t count, uint32_t baseIndex, uint32_t* pVisible) {
+  size_t numVisible = 0;
+  for (size_t i = 0; i < count; ++i) {
+    bool inside = true;
+    for (int p = 0; p < 6 && inside; ++p) {
+      const Math::float4& plane = frustum.planes[p];
+      inside = plane.x * bounds.pX[i] + plane.y * bounds.pY[i] +
+                   plane.z * bounds.pZ[i] + plane.w + bounds.pRadius[i] >=
+               0.f;
+    }
+    if (inside) {
+      pVisible[numVisible++] = baseIndex + uint32_t(i);
+    }
+  }
+  return numVisible;
+}
+
+MeshletCullContext makeMeshletCullContext(const Math::float4x4& clipFromWorld,
+    const Math::float3& cameraPosition, const Math::float4x4& worldFromModel) {
+  MeshletCullContext context;
+  context.frustum = extractFrustum(clipFromWorld * worldFromModel);
+
+  // The inverse of the linear part has rows c1 x c2, c2 x c0 and c0 x c1
+  // over its determinant.
+  const Math::float3 c0  = worldFromModel.columns[0].xyz();
+  const Math::float3 c1  = worldFromModel.columns[1].xyz();
+  const Math::float3 c2  = worldFromModel.columns[2].xyz();
+  const Math::float3 r0  = Math::cross(c1, c2);
+  const Math::float3 r1  = Math::cross(c2, c0);
+  const Math::float3 r2  = Math::cross(c0, c1);
+  const float        det = Math::dot(c0, r0);
+  const Math::float3 d   = cameraPosition - worldFromModel.columns[3].xyz();
+  context.cameraPosition = Math::float3{Math::dot(r0, d), Math::dot(r1, d),
+                               Math::dot(r2, d)} *
+                           (1.f / det);
+  return context;
+}
+
+MeshletVisibility cullMeshlet(
+    const MeshletBounds& bounds, const MeshletCullContext& context) {
+  for (const Math::float4& plane : context.frustum.planes) {
+    if (Math::dot(plane.xyz(), bounds.center) + plane.w < -bounds.radius) {
+      return MeshletVisibility::OutsideFrustum;
+    }
+  }
+
+  // Every point of the sphere sees every normal of the cone from behind
+  // when the direction to the center is within 90 degrees minus the cone
+  // angle of the axis, with the radius as margin.
+  const Math::float3 view = bounds.center - context.cameraPosition;
+  if (Math::dot(view, bounds.coneAxis) >
+      bounds.coneCutoff * Math::length(view) + bounds.radius) {
+    return MeshletVisibility::BackFacing;
+  }
+  return MeshletVisibility::Visible;
+}
@@ -0,0 +1,618 @@
+#include "GlbLoader.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+using shader_types::VertexData;
+
+namespace {
+
+constexpr uint32_t kGlbMagic      = 0x46546C67;  // "glTF"
+constexpr uint32_t kGlbVersion    = 2;
+constexpr uint32_t kChunkJson     = 0x4E4F534A;  // "JSON"
+constexpr uint32_t kChunkBin      = 0x004E4942;  // "BIN\0"
+constexpr int      kUnsignedByte  = 5121;
+constexpr int      kUnsignedShort = 5123;
+constexpr int      kUnsignedInt   = 5125;
+constexpr int      kFloat         = 5126;
+constexpr int      kTriangles     = 4;
+
+// Work per job when converting vertices and indices.
+constexpr size_t kVerticesPerJob  = 64 * 1024;
+constexpr size_t kTrianglesPerJob = 64 * 1024;
+// Nesting deeper than this is rejected rather than recursed into.
+constexpr int kMaxJsonDepth = 64;
+
+// GLB is little-endian, as is every target this builds for.
+uint32_t readU32(const char* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// A parsed JSON value. Object members keep their order, with their names
+// in `keys` and values in `items`.
+struct Json {
+  enum class Type { Null, Bool, Number, String, Array, Object };
+
+  Type                     type   = Type::Null;
+  double                   number = 0.0;  // also 0 or 1 for booleans
+  std::string              string;
+  std::vector<std::string> keys;
+  std::vector<Json>        items;
+
+  // The member called `key`, or nullptr if there is none or this is not
+  // an object.
+  const Json* find(const char* key) const {
+    if (type != Type::Object) return nullptr;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (keys[i] == key) return &items[i];
+    }
+    return nullptr;
+  }
+};
+
+// Recursive-descent parser for the JSON chunk.
+class JsonParser {
+ public:
+  JsonParser(const char* pText, size_t size)
+      : _pBegin(pText), _p(pText), _pEnd(pText + size) {}
+
+  // Parses one value filling the whole text. On failure, sets *pError to
+  // the byte offset where parsing stopped.
+  bool parse(Json* pValue, std::string* pError) {
+    skipSpace();
+    if (parseValue(pValue, 0) && (skipSpace(), _p == _pEnd)) return true;
+    *pError = "invalid JSON at byte " + std::to_string(_p - _pBegin);
+    return false;
+  }
+
+ private:
+  const char* _pBegin;
+  const char* _p;
+  const char* _pEnd;
+
+  void skipSpace() {
+    while (_p < _pEnd &&
+           (*_p == ' ' || *_p == '\t' || *_p == '\n' || *_p == '\r')) {
+      ++_p;
+    }
+  }
+
+  bool consume(const char* word) {
+    const size_t length = std::strlen(word);
+    if (size_t(_pEnd - _p) < length || std::memcmp(_p, word, length) != 0) {
+      return false;
+    }
+    _p += length;
+    return true;
+  }
+
+  bool parseValue(Json* pValue, int depth) {
+    if (_p == _pEnd || depth > kMaxJsonDepth) return false;
+    switch (*_p) {
+      case '{': return parseObject(pValue, depth);
+      case '[': return parseArray(pValue, depth);
+      case '"':
+        pValue->type = Json::Type::String;
+        return parseString(&pValue->string);
+      case 't':
+        pValue->type   = Json::Type::Bool;
+        pValue->number = 1.0;
+        return consume("true");
+      case 'f':
+        pValue->type = Json::Type::Bool;
+        return consume("false");
+      case 'n': return consume("null");
+      default: pValue->type = Json::Type::Number; return parseNumber(pValue);
+    }
+  }
+
+  bool parseObject(Json* pValue, int depth) {
+    pValue->type = Json::Type::Object;
+    ++_p;
+    skipSpace();
+    if (_p < _pEnd && *_p == '}') return ++_p, true;
+    for (;;) {
+      pValue->keys.emplace_back();
+      pValue->items.emplace_back();
+      skipSpace();
+      if (_p == _pEnd || *_p != '"' || !parseString(&pValue->keys.back())) {
+        return false;
+      }
+      skipSpace();
+      if (_p == _pEnd || *_p++ != ':') return false;
+      skipSpace();
+      if (!parseValue(&pValue->items.back(), depth + 1)) return false;
+      skipSpace();
+      if (_p == _pEnd) return false;
+      if (*_p == '}') return ++_p, true;
+      if (*_p++ != ',') return false;
+    }
+  }
+
+  bool parseArray(Json* pValue, int depth) {
+    pValue->type = Json::Type::Array;
+    ++_p;
+    skipSpace();
+    if (_p < _pEnd && *_p == ']') return ++_p, true;
+    for (;;) {
+      pValue->items.emplace_back();
+      skipSpace();
+      if (!parseValue(&pValue->items.back(), depth + 1)) return false;
+      skipSpace();
+      if (_p == _pEnd) return false;
+      if (*_p == ']') return ++_p, true;
+      if (*_p++ != ',') return false;
+    }
+  }
+
+  static void appendUtf8(uint32_t codePoint, std::string* pOut) {
+    if (codePoint < 0x80) {
+      *pOut += char(codePoint);
+    } else if (codePoint < 0x800) {
+      *pOut += char(0xC0 | codePoint >> 6);
+      *pOut += char(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+      *pOut += char(0xE0 | codePoint >> 12);
+      *pOut += char(0x80 | (codePoint >> 6 & 0x3F));
+      *pOut += char(0x80 | (codePoint & 0x3F));
+    } else {
+      *pOut += char(0xF0 | codePoint >> 18);
+      *pOut += char(0x80 | (codePoint >> 12 & 0x3F));
+      *pOut += char(0x80 | (codePoint >> 6 & 0x3F));
+      *pOut += char(0x80 | (codePoint & 0x3F));
+    }
+  }
+
+  bool parseHex4(uint32_t* pValue) {
+    if (_pEnd - _p < 4) return false;
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i, ++_p) {
+      const char c = *_p;
+      value <<= 4;
+      if (c >= '0' && c <= '9') {
+        value |= uint32_t(c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        value |= uint32_t(c - 'a' + 10);
+      } else if (c >= 'A' && c <= 'F') {
+        value |= uint32_t(c - 'A' + 10);
+      } else {
+        return false;
+      }
+    }
+    *pValue = value;
+    return true;
+  }
+
+  bool parseString(std::string* pOut) {
+    ++_p;
+    while (_p < _pEnd && *_p != '"') {
+      if (*_p != '\\') {
+        *pOut += *_p++;
+        continue;
+      }
+      if (++_p == _pEnd) return false;
+      switch (*_p++) {
+        case '"': *pOut += '"'; break;
+        case '\\': *pOut += '\\'; break;
+        case '/': *pOut += '/'; break;
+        case 'b': *pOut += '\b'; break;
+        case 'f': *pOut += '\f'; break;
+        case 'n': *pOut += '\n'; break;
+        case 'r': *pOut += '\r'; break;
+        case 't': *pOut += '\t'; break;
+        case 'u': {
+          uint32_t codePoint;
+          if (!parseHex4(&codePoint)) return false;
+          // A high surrogate followed by a low one encodes one code point.
+          const char* pNext = _p;
+          uint32_t    low;
+          if (codePoint >= 0xD800 && codePoint < 0xDC00 && consume("\\u") &&
+              parseHex4(&low) && low >= 0xDC00 && low < 0xE000) {
+            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) +
+                        (low - 0xDC00);
+          } else {
+            _p = pNext;
+          }
+          appendUtf8(codePoint, pOut);
+          break;
+        }
+        default: return false;
+      }
+    }
+    if (_p == _pEnd) return false;
+    ++_p;
+    return true;
+  }
+
+  bool parseNumber(Json* pValue) {
+    // strtod on a terminated copy, since the chunk is not terminated.
+    char        buffer[64];
+    const char* pStart = _p;
+    while (_p < _pEnd && ((*_p >= '0' && *_p <= '9') || *_p == '-' ||
+                             *_p == '+' || *_p == '.' || *_p == 'e' ||
+                             *_p == 'E')) {
+      ++_p;
+    }
+    const size_t length = size_t(_p - pStart);
+    if (length == 0 || length >= sizeof(buffer)) return false;
+    std::memcpy(buffer, pStart, length);
+    buffer[length] = '\0';
+    char* pParsed;
+    pValue->number = std::strtod(buffer, &pParsed);
+    return pParsed == buffer + length;
+  }
+};
+
+// A non-negative integer member, such as an index or byte offset. Absent
+// members read as `fallback`; returns false if the member is required
+// (no fallback) and absent, or not a non-negative integer.
+bool getSize(const Json& object, const char* key, size_t* pValue,
+    const size_t* pFallback = nullptr) {
+  const Json* pMember = object.find(key);
+  if (!pMember) {
+    if (pFallback) *pValue = *pFallback;
+    return pFallback != nullptr;
+  }
+  const double number = pMember->number;
+  if (pMember->type != Json::Type::Number || number < 0 ||
+      number != std::floor(number) || number > 9e15) {
+    return false;
+  }
+  *pValue = size_t(number);
+  return true;
+}
+
+// The `index`th element of the array member `key`.
+const Json* getElement(const Json& object, const char* key, size_t index) {
+  const Json* pArray = object.find(key);
+  if (!pArray || pArray->type != Json::Type::Array ||
+      index >= pArray->items.size()) {
+    return nullptr;
+  }
+  return &pArray->items[index];
+}
+
+// An accessor resolved to bytes in the binary chunk.
+struct Accessor {
+  const char* pData;
+  size_t      count;
+  size_t      stride;
+  int         componentType;
+  size_t      components;
+};
+
+size_t componentSize(int componentType) {
+  switch (componentType) {
+    case 5120:
+    case kUnsignedByte: return 1;
+    case 5122:
+    case kUnsignedShort: return 2;
+    case kUnsignedInt:
+    case kFloat: return 4;
+    default: return 0;
+  }
+}
+
+// The GLB's JSON document and binary chunk.
+struct GlbDocument {
+  Json        root;
+  const char* pBin    = nullptr;
+  size_t      binSize = 0;
+
+  bool accessor(size_t index, Accessor* pAccessor, std::string* pError) const {
+    const std::string name = "accessor " + std::to_string(index);
+    const Json* pAccessorJson = getElement(root, "accessors", index);
+    if (!pAccessorJson) {
+      *pError = name + " does not exist";
+      return false;
+    }
+    const Json& json = *pAccessorJson;
+    if (json.find("sparse")) {
+      *pError = name + ": sparse accessors are not supported";
+      return false;
+    }
+
+    const size_t zero = 0;
+    size_t       viewIndex, byteOffset, componentType;
+    const Json*  pType = json.find("type");
+    if (!getSize(json, "bufferView", &viewIndex) ||
+        !getSize(json, "byteOffset", &byteOffset, &zero) ||
+        !getSize(json, "componentType", &componentType) ||
+        !getSize(json, "count", &pAccessor->count) || !pType ||
+        pType->type != Json::Type::String) {
+      *pError = name + " is malformed or has no buffer view";
+      return false;
+    }
+    static const char* const kTypes[] = {"SCALAR", "VEC2", "VEC3", "VEC4"};
+    pAccessor->components = 0;
+    for (size_t i = 0; i < 4; ++i) {
+      if (pType->string == kTypes[i]) pAccessor->components = i + 1;
+    }
+    pAccessor->componentType = int(componentType);
+    const size_t elementSize = componentSize(pAccessor->componentType) *
+                               pAccessor->components;
+    if (elementSize == 0) {
+      *pError = name + " has an unsupported type";
+      return false;
+    }
+
+    const Json* pView = getElement(root, "bufferViews", viewIndex);
+    size_t      buffer, viewOffset, viewLength, stride;
+    if (!pView || !getSize(*pView, "buffer", &buffer, &zero) ||
+        !getSize(*pView, "byteOffset", &viewOffset, &zero) ||
+        !getSize(*pView, "byteLength", &viewLength) ||
+        !getSize(*pView, "byteStride", &stride, &elementSize)) {
+      *pError = "buffer view " + std::to_string(viewIndex) + " is malformed";
+      return false;
+    }
+    // Only the first buffer can be the GLB's own binary chunk.
+    const Json* pBuffer = getElement(root, "buffers", buffer);
+    if (buffer != 0 || !pBuffer || pBuffer->find("uri")) {
+      *pError = "buffer view " + std::to_string(viewIndex) +
+                ": external buffers are not supported";
+      return false;
+    }
+    // glTF limits an explicit stride to 4..252 in steps of 4.
+    if (pView->find("byteStride") &&
+        (stride % 4 != 0 || stride > 252 || stride < elementSize)) {
+      *pError = "buffer view " + std::to_string(viewIndex) +
+                " has an invalid byte stride";
+      return false;
+    }
+    // Checked piecewise so that no product or sum can overflow.
+    if (viewOffset > binSize || viewLength > binSize - viewOffset ||
+        (pAccessor->count != 0 &&
+            (byteOffset > viewLength ||
+                elementSize > viewLength - byteOffset ||
+                pAccessor->count - 1 >
+                    (viewLength - byteOffset - elementSize) / stride))) {
+      *pError = name + " exceeds its buffer view";
+      return false;
+    }
+    pAccessor->pData  = pBin + viewOffset + byteOffset;
+    pAccessor->stride = stride;
+    return true;
+  }
+};
+
+bool parseGlb(const char* pData, size_t size, GlbDocument* pDocument,
+    std::string* pError) {
+  if (size < 12 || readU32(pData) != kGlbMagic) {
+    *pError = "not a GLB file";
+    return false;
+  }
+  if (readU32(pData + 4) != kGlbVersion) {
+    *pError = "unsupported glTF version " + std::to_string(readU32(pData + 4));
+    return false;
+  }
+  size = std::min<size_t>(size, readU32(pData + 8));
+
+  // Chunks follow the header: JSON first, then optionally BIN.
+  bool   haveJson = false;
+  size_t offset   = 12;
+  while (offset + 8 <= size) {
+    const size_t   length = readU32(pData + offset);
+    const uint32_t type   = readU32(pData + offset + 4);
+    offset += 8;
+    if (length > size - offset) {
+      *pError = "truncated chunk at byte " + std::to_string(offset - 8);
+      return false;
+    }
+    if (type == kChunkJson && !haveJson) {
+      JsonParser parser(pData + offset, length);
+      if (!parser.parse(&pDocument->root, pError)) return false;
+      haveJson = true;
+    } else if (type == kChunkBin && haveJson && !pDocument->pBin) {
+      pDocument->pBin    = pData + offset;
+      pDocument->binSize = length;
+    }
+    offset += (length + 3) & ~size_t(3);
+  }
+  if (!haveJson || pDocument->root.type != Json::Type::Object) {
+    *pError = "missing JSON chunk";
+    return false;
+  }
+  return true;
+}
+
+bool isFloatVec3(const Accessor& accessor) {
+  return accessor.componentType == kFloat && accessor.components == 3;
+}
+
+Math::float3 readFloat3(const Accessor& accessor, size_t i) {
+  float xyz[3];
+  std::memcpy(xyz, accessor.pData + i * accessor.stride, sizeof(xyz));
+  return {xyz[0], xyz[1], xyz[2]};
+}
+
+uint32_t readIndex(const Accessor& accessor, size_t i) {
+  const char* p = accessor.pData + i * accessor.stride;
+  switch (accessor.componentType) {
+    case kUnsignedByte: return uint8_t(*p);
+    case kUnsignedShort: {
+      uint16_t index;
+      std::memcpy(&index, p, sizeof(index));
+      return index;
+    }
+    default: return readU32(p);
+  }
+}
+
+// Whether the attributes are laid out exactly like VertexData, so the
+// mapped bytes can be used as they are.
+bool matchesVertexData(const Accessor& position, const Accessor& normal) {
+  return position.stride == sizeof(VertexData) &&
+         normal.stride == sizeof(VertexData) &&
+         normal.pData ==
+             position.pData + offsetof(VertexData, normal) -
+                 offsetof(VertexData, position) &&
+         reinterpret_cast<uintptr_t>(position.pData) % alignof(VertexData) ==
+             0;
+}
+
+// Converts one primitive into a GlbMesh.
+bool loadPrimitive(const GlbDocument& document, const Json& primitive,
+    std::string name, const std::shared_ptr<const MappedFile>& file,
+    JobSystem& jobSystem, std::unique_ptr<GlbMesh>* pMesh,
+    std::string* pError) {
+  const Json* pAttributes = primitive.find("attributes");
+  size_t      positionIndex, normalIndex, indicesIndex;
+  if (!pAttributes || !getSize(*pAttributes, "POSITION", &positionIndex)) {
+    *pError = name + " has no POSITION";
+    return false;
+  }
+  Accessor position, normal, indices;
+  if (!document.accessor(positionIndex, &position, pError)) return false;
+  const bool hasNormals = getSize(*pAttributes, "NORMAL", &normalIndex);
+  if (hasNormals && !document.accessor(normalIndex, &normal, pError)) {
+    return false;
+  }
+  const bool hasIndices = getSize(primitive, "indices", &indicesIndex);
+  if (hasIndices && !document.accessor(indicesIndex, &indices, pError)) {
+    return false;
+  }
+  const bool normalsMatch = !hasNormals || (isFloatVec3(normal) &&
+                                               normal.count == position.count);
+  if (!isFloatVec3(position) || !normalsMatch) {
+    *pError = name + ": positions and normals must be float VEC3";
+    return false;
+  }
+  if (hasIndices && (indices.components != 1 ||
+                        (indices.componentType != kUnsignedByte &&
+                            indices.componentType != kUnsignedShort &&
+                            indices.componentType != kUnsignedInt))) {
+    *pError = name + ": indices must be unsigned integer scalars";
+    return false;
+  }
+  const size_t numCorners = hasIndices ? indices.count : position.count;
+  if (numCorners % 3 != 0) {
+    *pError = name + ": corner count is not a multiple of 3";
+    return false;
+  }
+  const size_t numTriangles = numCorners / 3;
+
+  // Corners in our winding: each triangle's last two swapped.
+  std::vector<uint32_t> corners(numCorners);
+  std::atomic<bool>     outOfRange{false};
+  jobSystem.parallelFor(numTriangles, kTrianglesPerJob,
+      [&](size_t begin, size_t end) {
+        bool bad = false;
+        for (size_t t = begin; t < end; ++t) {
+          for (size_t k = 0; k < 3; ++k) {
+            const size_t   corner = 3 * t + k;
+            const uint32_t index  = hasIndices ? readIndex(indices, corner)
+                                               : uint32_t(corner);
+            bad |= index >= position.count;
+            corners[3 * t + (3 - k) % 3] = index;
+          }
+        }
+        if (bad) outOfRange = true;
+      });
+  if (outOfRange) {
+    *pError = name + ": vertex index out of range";
+    return false;
+  }
+
+  if (hasNormals && matchesVertexData(position, normal)) {
+    *pMesh = std::make_unique<GlbMesh>(std::move(name), file,
+        reinterpret_cast<const VertexData*>(position.pData), position.count,
+        std::move(corners));
+    return true;
+  }
+
+  std::vector<VertexData> vertices;
+  if (hasNormals) {
+    vertices.resize(position.count);
+    jobSystem.parallelFor(vertices.size(), kVerticesPerJob,
+        [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            vertices[i] = {readFloat3(position, i), readFloat3(normal, i)};
+          }
+        });
+  } else {
+    // Flat normals: every corner gets its own vertex.
+    vertices.resize(numCorners);
+    jobSystem.parallelFor(numTriangles, kTrianglesPerJob,
+        [&](size_t begin, size_t end) {
+          for (size_t t = begin; t < end; ++t) {
+            const Math::float3 a = readFloat3(position, corners[3 * t + 0]);
+            const Math::float3 b = readFloat3(position, corners[3 * t + 1]);
+            const Math::float3 c = readFloat3(position, corners[3 * t + 2]);
+            Math::float3       n = Math::cross(c - a, b - a);
+            const float        length = Math::length(n);
+            n = length > 0.f ? n / length : Math::float3{0.f, 0.f, 0.f};
+            vertices[3 * t + 0] = {a, n};
+            vertices[3 * t + 1] = {b, n};
+            vertices[3 * t + 2] = {c, n};
+          }
+        });
+    for (size_t i = 0; i < numCorners; ++i) corners[i] = uint32_t(i);
+  }
+  *pMesh = std::make_unique<GlbMesh>(
+      std::move(name), std::move(vertices), std::move(corners));
+  return true;
+}
+
+}  // namespace
+
+bool GlbMesh::load(const char* path, JobSystem& jobSystem,
+    std::vector<std::unique_ptr<GlbMesh>>* pMeshes, std::string* pError,
+    GlbStats* pStats) {
+  auto file = std::make_shared<MappedFile>();
+  if (!file->open(path, pError)) return false;
+
+  GlbStats    stats = {};
+  GlbDocument document;
+  std::string error;
+  auto        fail = [&]() {
+    if (pError) *pError = std::string(path) + ": " + error;
+    return false;
+  };
+  if (!parseGlb(file->data(), file->size(), &document, &error)) return fail();
+
+  const Json* pMeshesJson = document.root.find("meshes");
+  const size_t numMeshes  = pMeshesJson ? pMeshesJson->items.size() : 0;
+  for (size_t m = 0; m < numMeshes; ++m) {
+    const Json&       mesh        = pMeshesJson->items[m];
+    const Json*       pPrimitives = mesh.find("primitives");
+    const Json*       pName       = mesh.find("name");
+    const std::string meshName    = pName && pName->type == Json::Type::String
+                                        ? pName->string
+                                        : "mesh" + std::to_string(m);
+    if (!pPrimitives || pPrimitives->type != Json::Type::Array) {
+      error = meshName + " has no primitives";
+      return fail();
+    }
+    for (size_t p = 0; p < pPrimitives->items.size(); ++p) {
+      const Json&  primitive = pPrimitives->items[p];
+      const size_t triangles = kTriangles;
+      size_t       mode;
+      if (!getSize(primitive, "mode", &mode, &triangles)) {
+        error = meshName + " has a malformed primitive mode";
+        return fail();
+      }
+      if (mode != kTriangles) {
+        ++stats.skippedPrimitives;
+        continue;
+      }
+      std::string name = meshName;
+      if (pPrimitives->items.size() > 1) name += "/" + std::to_string(p);
+      std::unique_ptr<GlbMesh> primitiveMesh;
+      if (!loadPrimitive(document, primitive, std::move(name), file,
+              jobSystem, &primitiveMesh, &error)) {
+        return fail();
+      }
+      ++stats.primitives;
+      ++(primitiveMesh->isMapped() ? stats.mappedMeshes
+                                   : stats.convertedMeshes);
+      pMeshes->push_back(std::move(primitiveMesh));
+    }
+  }
+  if (pStats) *pStats = stats;
+  return true;
+}
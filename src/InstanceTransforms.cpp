@@ -0,0 +1,271 @@
+#include "InstanceTransforms.hpp"
+
+#include <algorithm>
+
+#if !defined(MATH_FORCE_SCALAR) && \
+    (defined(__AVX512F__) || defined(__AVX2__))
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Thin per-ISA wrappers so the kernel and the sin/cos approximation below
+// are written once for both vector widths.
+#if !defined(MATH_FORCE_SCALAR) && defined(__AVX512F__)
+#define INSTANCE_TRANSFORMS_SIMD 1
+constexpr size_t kLanes = 16;
+using vf                = __m512;
+using vi                = __m512i;
+
+// The unmasked forms of some integer and conversion intrinsics start from
+// _mm512_undefined_*, which GCC 12 reports as -Wuninitialized once they
+// are inlined (GCC bug 105593). Their zero-masked forms with every lane
+// enabled compile to the same instructions.
+constexpr __mmask16 kAllLanes = 0xFFFF;
+
+inline vf   vset(float v) { return _mm512_set1_ps(v); }
+inline vf   vload(const float* p) { return _mm512_loadu_ps(p); }
+inline void vstore(float* p, vf v) { _mm512_storeu_ps(p, v); }
+inline vf   vadd(vf a, vf b) { return _mm512_add_ps(a, b); }
+inline vf   vmul(vf a, vf b) { return _mm512_mul_ps(a, b); }
+inline vf   vmadd(vf a, vf b, vf c) { return _mm512_fmadd_ps(a, b, c); }
+inline vi   iset(int v) { return _mm512_set1_epi32(v); }
+inline vi   iand(vi a, vi b) { return _mm512_and_si512(a, b); }
+inline vi   iandnot(vi a, vi b) {
+  return _mm512_maskz_andnot_epi32(kAllLanes, a, b);
+}
+inline vi   ixor(vi a, vi b) { return _mm512_xor_si512(a, b); }
+inline vi   iadd(vi a, vi b) { return _mm512_add_epi32(a, b); }
+inline vi   isub(vi a, vi b) { return _mm512_sub_epi32(a, b); }
+inline vi   ishl29(vi a) { return _mm512_maskz_slli_epi32(kAllLanes, a, 29); }
+inline vi   vtrunc(vf a) { return _mm512_maskz_cvttps_epi32(kAllLanes, a); }
+inline vf   vconvert(vi a) { return _mm512_maskz_cvtepi32_ps(kAllLanes, a); }
+inline vi   vbits(vf a) { return _mm512_castps_si512(a); }
+inline vf   vfloat(vi a) { return _mm512_castsi512_ps(a); }
+// Picks `ifZero` in lanes where `cond` is zero and `otherwise` elsewhere.
+inline vf vselectZero(vi cond, vf ifZero, vf otherwise) {
+  return _mm512_mask_blend_ps(
+      _mm512_cmpeq_epi32_mask(cond, _mm512_setzero_si512()), otherwise,
+      ifZero);
+}
+#elif !defined(MATH_FORCE_SCALAR) && defined(__AVX2__)
+#define INSTANCE_TRANSFORMS_SIMD 1
+constexpr size_t kLanes = 8;
+using vf                = __m256;
+using vi                = __m256i;
+
+inline vf   vset(float v) { return _mm256_set1_ps(v); }
+inline vf   vload(const float* p) { return _mm256_loadu_ps(p); }
+inline void vstore(float* p, vf v) { _mm256_storeu_ps(p, v); }
+inline vf   vadd(vf a, vf b) { return _mm256_add_ps(a, b); }
+inline vf   vmul(vf a, vf b) { return _mm256_mul_ps(a, b); }
+inline vf   vmadd(vf a, vf b, vf c) {
+#if defined(__FMA__)
+  return _mm256_fmadd_ps(a, b, c);
+#else
+  return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+inline vi iset(int v) { return _mm256_set1_epi32(v); }
+inline vi iand(vi a, vi b) { return _mm256_and_si256(a, b); }
+inline vi iandnot(vi a, vi b) { return _mm256_andnot_si256(a, b); }
+inline vi ixor(vi a, vi b) { return _mm256_xor_si256(a, b); }
+inline vi iadd(vi a, vi b) { return _mm256_add_epi32(a, b); }
+inline vi isub(vi a, vi b) { return _mm256_sub_epi32(a, b); }
+inline vi ishl29(vi a) { return _mm256_slli_epi32(a, 29); }
+inline vi vtrunc(vf a) { return _mm256_cvttps_epi32(a); }
+inline vf vconvert(vi a) { return _mm256_cvtepi32_ps(a); }
+inline vi vbits(vf a) { return _mm256_castps_si256(a); }
+inline vf vfloat(vi a) { return _mm256_castsi256_ps(a); }
+inline vf vselectZero(vi cond, vf ifZero, vf otherwise) {
+  return _mm256_blendv_ps(otherwise, ifZero,
+      _mm256_castsi256_ps(_mm256_cmpeq_epi32(cond, _mm256_setzero_si256())));
+}
+#else
+constexpr size_t kLanes = 1;
+#endif
+
+#if defined(INSTANCE_TRANSFORMS_SIMD)
+inline vf vneg(vf a) { return vfloat(ixor(vbits(a), iset(int(0x80000000u)))); }
+
+// Cephes-style sinf/cosf: reduce by multiples of pi/4 using a three-part
+// constant, evaluate both minimax polynomials and swap/negate them per
+// octant. Within a few ulp of libm for |x| up to several thousand radians.
+inline void vsincos(vf x, vf& outSin, vf& outCos) {
+  const vi signMask = iset(int(0x80000000u));
+  const vi xBits    = vbits(x);
+  vi       sinSign  = iand(xBits, signMask);
+  x                 = vfloat(iandnot(signMask, xBits));
+
+  vi j = vtrunc(vmul(x, vset(1.27323954473516f)));  // 4 / pi
+  j    = iand(iadd(j, iset(1)), iset(~1));
+  vf y = vconvert(j);
+
+  sinSign          = ixor(sinSign, ishl29(iand(j, iset(4))));
+  const vi cosSign = ishl29(iandnot(isub(j, iset(2)), iset(4)));
+  const vi octant  = iand(j, iset(2));
+
+  x = vmadd(y, vset(-0.78515625f), x);
+  x = vmadd(y, vset(-2.4187564849853515625e-4f), x);
+  x = vmadd(y, vset(-3.77489497744594108e-8f), x);
+
+  const vf z = vmul(x, x);
+
+  vf cosPoly = vmadd(vset(2.443315711809948e-5f), z, vset(-1.388731625493765e-3f));
+  cosPoly    = vmadd(cosPoly, z, vset(4.166664568298827e-2f));
+  cosPoly    = vmul(vmul(cosPoly, z), z);
+  cosPoly    = vadd(vmadd(vset(-0.5f), z, cosPoly), vset(1.f));
+
+  vf sinPoly = vmadd(vset(-1.9515295891e-4f), z, vset(8.3321608736e-3f));
+  sinPoly    = vmadd(sinPoly, z, vset(-1.6666654611e-1f));
+  sinPoly    = vmadd(vmul(sinPoly, z), x, x);
+
+  outSin = vfloat(ixor(vbits(vselectZero(octant, sinPoly, cosPoly)), sinSign));
+  outCos = vfloat(ixor(vbits(vselectZero(octant, cosPoly, sinPoly)), cosSign));
+}
+
+// Computes kLanes instances starting at `first`; the 16 matrix entries land
+// in column-major order in out[entry][lane].
+void transformBlock(const Math::float4x4& parent,
+    const InstanceTransformParams& params, size_t first,
+    float (&out)[16][kLanes]) {
+  vf sinY, cosY, sinZ, cosZ;
+  vsincos(vload(params.pYAngle + first), sinY, cosY);
+  vsincos(vload(params.pZAngle + first), sinZ, cosZ);
+
+  // yRotate(b) * zRotate(a), row-major: [cb*ca  cb*sa  sb]
+  //                                     [-sa    ca     0 ]
+  //                                     [-sb*ca -sb*sa cb]
+  // folded with the uniform scale.
+  const vf scale = vload(params.pScale + first);
+  const vf cbs   = vmul(cosY, scale);
+  const vf sbs   = vmul(sinY, scale);
+  const vf zero  = vset(0.f);
+  const vf rot[3][3] = {
+      {vmul(cbs, cosZ), vneg(vmul(sinZ, scale)), vneg(vmul(sbs, cosZ))},
+      {vmul(cbs, sinZ), vmul(cosZ, scale), vneg(vmul(sbs, sinZ))},
+      {sbs, zero, cbs},
+  };  // rot[column][row]
+
+  for (int c = 0; c < 3; ++c) {
+    for (int r = 0; r < 4; ++r) {
+      vf v = vmul(vset((&parent.columns[0].x)[r]), rot[c][0]);
+      v    = vmadd(vset((&parent.columns[1].x)[r]), rot[c][1], v);
+      v    = vmadd(vset((&parent.columns[2].x)[r]), rot[c][2], v);
+      vstore(out[c * 4 + r], v);
+    }
+  }
+
+  const vf x = vload(params.pX + first);
+  const vf y = vload(params.pY + first);
+  const vf z = vload(params.pZ + first);
+  for (int r = 0; r < 4; ++r) {
+    vf v = vmadd(vset((&parent.columns[0].x)[r]), x,
+        vset((&parent.columns[3].x)[r]));
+    v = vmadd(vset((&parent.columns[1].x)[r]), y, v);
+    v = vmadd(vset((&parent.columns[2].x)[r]), z, v);
+    vstore(out[12 + r], v);
+  }
+}
+
+void storeInstance(const float (&out)[16][kLanes], size_t lane,
+    shader_types::InstanceData& inst) {
+  for (int c = 0; c < 4; ++c) {
+    inst.instanceTransform.columns[c] = {out[c * 4 + 0][lane],
+        out[c * 4 + 1][lane], out[c * 4 + 2][lane], out[c * 4 + 3][lane]};
+  }
+  inst.instanceNormalTransform = Math::discardTranslation(
+      inst.instanceTransform);
+}
+
+void storeInstance(const float (&out)[16][kLanes], size_t lane,
+    shader_types::CompactInstanceData& inst) {
+  for (int r = 0; r < 3; ++r) {
+    inst.transformRows[r] = {out[0 + r][lane], out[4 + r][lane],
+        out[8 + r][lane], out[12 + r][lane]};
+  }
+}
+
+template <typename Instance>
+void transformInstances(const Math::float4x4& parent,
+    const InstanceTransformParams& params, size_t count, Instance* pOut) {
+  alignas(64) float out[16][kLanes];
+  for (size_t first = 0; first < count; first += kLanes) {
+    const size_t n = std::min(kLanes, count - first);
+    if (n == kLanes) {
+      transformBlock(parent, params, first, out);
+    } else {
+      // Pad the tail so the vector loads stay in bounds.
+      alignas(64) float tail[6][kLanes] = {};
+      const float*      pSrc[6]         = {params.pX, params.pY, params.pZ,
+          params.pYAngle, params.pZAngle, params.pScale};
+      for (int a = 0; a < 6; ++a) {
+        std::copy_n(pSrc[a] + first, n, tail[a]);
+      }
+      const InstanceTransformParams padded = {
+          tail[0], tail[1], tail[2], tail[3], tail[4], tail[5]};
+      transformBlock(parent, padded, 0, out);
+    }
+
+    for (size_t lane = 0; lane < n; ++lane) {
+      storeInstance(out, lane, pOut[first + lane]);
+    }
+  }
+}
+#endif
+
+}  // namespace
+
+size_t instanceTransformLanes() { return kLanes; }
+
+void computeInstanceTransforms(const Math::float4x4& parent,
+    const InstanceTransformParams& params, size_t count,
+    shader_types::InstanceData* pOut) {
+#if defined(INSTANCE_TRANSFORMS_SIMD)
+  transformInstances(parent, params, count, pOut);
+#else
+  computeInstanceTransformsScalar(parent, params, count, pOut);
+#endif
+}
+
+void computeInstanceTransforms(const Math::float4x4& parent,
+    const InstanceTransformParams& params, size_t count,
+    shader_types::CompactInstanceData* pOut) {
+#if defined(INSTANCE_TRANSFORMS_SIMD)
+  transformInstances(parent, params, count, pOut);
+#else
+  // Run the reference product chain one instance at a time and keep the
+  // top three rows.
+  for (size_t i = 0; i < count; ++i) {
+    const InstanceTransformParams one = {params.pX + i, params.pY + i,
+        params.pZ + i, params.pYAngle + i, params.pZAngle + i,
+        params.pScale + i};
+    shader_types::InstanceData    full;
+    computeInstanceTransformsScalar(parent, one, 1, &full);
+    const Math::float4x4& m = full.instanceTransform;
+    for (int r = 0; r < 3; ++r) {
+      pOut[i].transformRows[r] = {(&m.columns[0].x)[r],
+          (&m.columns[1].x)[r], (&m.columns[2].x)[r], (&m.columns[3].x)[r]};
+    }
+  }
+#endif
+}
+
+void computeInstanceTransformsScalar(const Math::float4x4& parent,
+    const InstanceTransformParams& params, size_t count,
+    shader_types::InstanceData* pOut) {
+  using Math::float4x4;
+
+  for (size_t i = 0; i < count; ++i) {
+    const float s         = params.pScale[i];
+    float4x4    scale     = Math::makeScale({s, s, s});
+    float4x4    zrot      = Math::makeZRotate(params.pZAngle[i]);
+    float4x4    yrot      = Math::makeYRotate(params.pYAngle[i]);
+    float4x4    translate = Math::makeTranslate(
+        {params.pX[i], params.pY[i], params.pZ[i]});
+
+    pOut[i].instanceTransform = parent * translate * yrot * zrot * scale;
+    pOut[i].instanceNormalTransform = Math::discardTranslation(
+        pOut[i].instanceTransform);
+  }
+}
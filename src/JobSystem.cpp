@@ -0,0 +1,112 @@
+#include "JobSystem.hpp"
+
+namespace {
+
+// Lets a worker find its own deque; any other thread maps to queue 0.
+thread_local const JobSystem* tlsOwner = nullptr;
+thread_local size_t           tlsQueue = 0;
+
+}  // namespace
+
+JobSystem::JobSystem(unsigned int numThreads)
+    : _numThreads(std::max(numThreads, 1u)), _numQueued(0), _stop(false) {
+  for (unsigned int i = 0; i < _numThreads; ++i) {
+    _queues.push_back(std::make_unique<WorkQueue>());
+  }
+  for (unsigned int i = 1; i < _numThreads; ++i) {
+    _workers.emplace_back(&JobSystem::workerMain, this, size_t(i));
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(_sleepMutex);
+    _stop = true;
+  }
+  _wake.notify_all();
+  for (std::thread& worker : _workers) {
+    worker.join();
+  }
+}
+
+void JobSystem::run(Job job, JobCounter& counter) {
+  counter.pending.fetch_add(1, std::memory_order_relaxed);
+  push(currentQueue(), [job = std::move(job), &counter] {
+    job();
+    counter.pending.fetch_sub(1, std::memory_order_release);
+  });
+  wakeWorkers();
+}
+
+void JobSystem::wait(JobCounter& counter) {
+  const size_t queue = currentQueue();
+  while (counter.pending.load(std::memory_order_acquire) > 0) {
+    if (!tryRunJob(queue)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::push(size_t queue, Job job) {
+  WorkQueue& q = *_queues[queue];
+  {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.jobs.push_back(std::move(job));
+  }
+  _numQueued.fetch_add(1, std::memory_order_release);
+}
+
+void JobSystem::wakeWorkers() {
+  // Taking the lock orders the _numQueued update before any worker's
+  // predicate check, so a worker about to sleep cannot miss the wakeup.
+  { std::lock_guard<std::mutex> lock(_sleepMutex); }
+  _wake.notify_all();
+}
+
+bool JobSystem::tryRunJob(size_t queue) {
+  Job job;
+  {
+    WorkQueue&                  own = *_queues[queue];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.jobs.empty()) {
+      job = std::move(own.jobs.back());
+      own.jobs.pop_back();
+    }
+  }
+  for (size_t i = 1; !job && i < _queues.size(); ++i) {
+    WorkQueue&                  victim = *_queues[(queue + i) % _queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+    }
+  }
+  if (!job) {
+    return false;
+  }
+
+  _numQueued.fetch_sub(1, std::memory_order_relaxed);
+  job();
+  return true;
+}
+
+size_t JobSystem::currentQueue() const {
+  return tlsOwner == this ? tlsQueue : 0;
+}
+
+void JobSystem::workerMain(size_t queue) {
+  tlsOwner = this;
+  tlsQueue = queue;
+  for (;;) {
+    if (tryRunJob(queue)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(_sleepMutex);
+    _wake.wait(lock, [this] {
+      return _stop || _numQueued.load(std::memory_order_acquire) > 0;
+    });
+    if (_stop && _numQueued.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
@@ -1,4 +1,6 @@
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 
 #define NS_PRIVATE_IMPLEMENTATION
 #define MTL_PRIVATE_IMPLEMENTATION
@@ -8,11 +10,33 @@
 #include <AppKit/AppKit.hpp>
 
 #include "AppDelegate.hpp"
+#include "MeshRegistry.hpp"
 
 int main(int argc, char* argv[]) {
+  InstanceGrid   grid           = kDefaultInstanceGrid;
+  VertexFormat   vertexFormat   = VertexFormat::Float;
+  InstanceFormat instanceFormat = InstanceFormat::Full;
+  for (int i = 1; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--grid") && i + 1 < argc &&
+        parseInstanceGrid(argv[i + 1], &grid)) {
+      ++i;
+    } else if (!std::strcmp(argv[i], "--quantized-vertices")) {
+      vertexFormat = VertexFormat::Quantized;
+    } else if (!std::strcmp(argv[i], "--compact-instances")) {
+      instanceFormat = InstanceFormat::Compact;
+    } else if (!std::strcmp(argv[i], "--mesh-cache") && i + 1 < argc) {
+      MeshRegistry::shared().setCacheDirectory(argv[++i]);
+    } else {
+      std::printf("usage: %s [--grid RxCxD] [--quantized-vertices] "
+                  "[--compact-instances] [--mesh-cache DIR]\n",
+          argv[0]);
+      return 1;
+    }
+  }
+
   NS::AutoreleasePool* pAutoreleasePool = NS::AutoreleasePool::alloc()->init();
 
-  MyAppDelegate    appDelegate;
+  MyAppDelegate    appDelegate(grid, vertexFormat, instanceFormat);
   NS::Application* pApp = NS::Application::sharedApplication();
   pApp->setDelegate(&appDelegate);
   pApp->run();
@@ -0,0 +1,67 @@
+#include "MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : _pData(std::exchange(other._pData, nullptr))
+    , _size(std::exchange(other._size, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    close();
+    _pData = std::exchange(other._pData, nullptr);
+    _size  = std::exchange(other._size, 0);
+  }
+  return *this;
+}
+
+bool MappedFile::open(const char* path, std::string* pError) {
+  close();
+  auto fail = [&](const char* what) {
+    if (pError) {
+      *pError = std::string(path) + ": " + what + ": " + std::strerror(errno);
+    }
+    return false;
+  };
+
+  const int fd = ::open(path, O_RDONLY);
+  if (fd < 0) return fail("cannot open");
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    const bool ok = fail("cannot stat");
+    ::close(fd);
+    return ok;
+  }
+
+  if (info.st_size > 0) {
+    void* pData = mmap(
+        nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (pData == MAP_FAILED) {
+      const bool ok = fail("cannot map");
+      ::close(fd);
+      return ok;
+    }
+    // The whole file is about to be read, by several threads at once.
+    madvise(pData, size_t(info.st_size), MADV_WILLNEED);
+    _pData = static_cast<const char*>(pData);
+    _size  = size_t(info.st_size);
+  }
+  // The mapping keeps the file alive on its own.
+  ::close(fd);
+  return true;
+}
+
+void MappedFile::close() {
+  if (_pData) {
+    munmap(const_cast<char*>(_pData), _size);
+  }
+  _pData = nullptr;
+  _size  = 0;
+}
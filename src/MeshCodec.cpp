@@ -0,0 +1,516 @@
+#include "MeshCodec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if !defined(MATH_FORCE_SCALAR) && defined(__SSE4_1__)
+#include <immintrin.h>
+#define MESHCODEC_SIMD 1
+#endif
+
+namespace {
+
+// First byte of each stream, changed whenever the format does.
+constexpr unsigned char kVertexCodecVersion = 0xA1;
+constexpr unsigned char kIndexCodecVersion  = 0xB1;
+
+// Vertices are coded in blocks whose byte columns fit this scratch buffer.
+constexpr size_t kVertexBlockBytes    = 8192;
+constexpr size_t kMaxVertexBlockCount = 256;
+constexpr size_t kGroupSize           = 16;
+
+size_t vertexBlockCount(size_t stride) {
+  return std::min(kMaxVertexBlockCount, kVertexBlockBytes / stride) /
+         kGroupSize * kGroupSize;
+}
+
+size_t numGroups(size_t count) {
+  return (count + kGroupSize - 1) / kGroupSize;
+}
+
+// Bits per value of each 2-bit group header code.
+constexpr int kGroupBits[4] = {0, 2, 4, 8};
+
+// Shuffles that move a group's escaped bytes, stored in order after its
+// packed values, to the positions whose bits in an 8-bit mask are set.
+// Other positions get 0x80, which pshufb turns into zero.
+struct GroupTables {
+  unsigned char shuffle[256][8];
+  unsigned char count[256];
+};
+
+constexpr GroupTables makeGroupTables() {
+  GroupTables tables = {};
+  for (int mask = 0; mask < 256; ++mask) {
+    int count = 0;
+    for (int i = 0; i < 8; ++i) {
+      tables.shuffle[mask][i] = (mask >> i) & 1 ? count++ : 0x80;
+    }
+    tables.count[mask] = count;
+  }
+  return tables;
+}
+
+constexpr GroupTables kGroupTables = makeGroupTables();
+
+// Stream VByte: for each control byte, the shuffle that widens its four
+// 1 to 4 byte values to 32 bits, and the number of data bytes they take.
+struct StreamVByteTables {
+  unsigned char shuffle[256][16];
+  unsigned char length[256];
+};
+
+constexpr StreamVByteTables makeStreamVByteTables() {
+  StreamVByteTables tables = {};
+  for (int control = 0; control < 256; ++control) {
+    int offset = 0;
+    for (int value = 0; value < 4; ++value) {
+      const int length = ((control >> (2 * value)) & 3) + 1;
+      for (int byte = 0; byte < 4; ++byte) {
+        tables.shuffle[control][4 * value + byte] =
+            byte < length ? offset + byte : 0x80;
+      }
+      offset += length;
+    }
+    tables.length[control] = offset;
+  }
+  return tables;
+}
+
+constexpr StreamVByteTables kStreamVByteTables = makeStreamVByteTables();
+
+inline unsigned char zigzag8(unsigned char delta) {
+  return (delta << 1) ^ (int8_t(delta) >> 7);
+}
+
+inline unsigned char unzigzag8(unsigned char value) {
+  return (value >> 1) ^ -(value & 1);
+}
+
+inline uint32_t zigzag32(uint32_t delta) {
+  return (delta << 1) ^ uint32_t(int32_t(delta) >> 31);
+}
+
+inline uint32_t unzigzag32(uint32_t value) {
+  return (value >> 1) ^ -(value & 1);
+}
+
+// Writes one group of 16 zigzag deltas with the fewest bytes and returns
+// the end of what it wrote and its header code.
+unsigned char* encodeGroup(
+    unsigned char* pDst, const unsigned char* pValues, int* pCode) {
+  size_t sizes[4] = {0, 4, 8, 16};
+  for (size_t i = 0; i < kGroupSize; ++i) {
+    sizes[0] += pValues[i] != 0 ? 16 : 0;
+    sizes[1] += pValues[i] >= 3;
+    sizes[2] += pValues[i] >= 15;
+  }
+  const int code = int(std::min_element(sizes, sizes + 4) - sizes);
+  *pCode         = code;
+  if (code == 0) return pDst;
+  if (code == 3) {
+    std::memcpy(pDst, pValues, kGroupSize);
+    return pDst + kGroupSize;
+  }
+
+  const int     bits     = kGroupBits[code];
+  const int     perByte  = 8 / bits;
+  const size_t  numBytes = kGroupSize / perByte;
+  const uint8_t escape   = uint8_t((1 << bits) - 1);
+  std::memset(pDst, 0, numBytes);
+  // Value i goes to byte i % numBytes, so that the decoder can unpack
+  // each bit position across all bytes with one shift.
+  for (size_t i = 0; i < kGroupSize; ++i) {
+    const unsigned char packed = std::min(pValues[i], escape);
+    pDst[i % numBytes] |= packed << (bits * (i / numBytes));
+  }
+  pDst += numBytes;
+  for (size_t i = 0; i < kGroupSize; ++i) {
+    if (pValues[i] >= escape) *pDst++ = pValues[i];
+  }
+  return pDst;
+}
+
+// Reads one group written by encodeGroup(), or returns nullptr if it runs
+// past pEnd.
+const unsigned char* decodeGroupScalar(const unsigned char* pSrc,
+    const unsigned char* pEnd, int code, unsigned char* pValues) {
+  if (code == 0) {
+    std::memset(pValues, 0, kGroupSize);
+    return pSrc;
+  }
+  if (code == 3) {
+    if (pEnd - pSrc < ptrdiff_t(kGroupSize)) return nullptr;
+    std::memcpy(pValues, pSrc, kGroupSize);
+    return pSrc + kGroupSize;
+  }
+
+  const int     bits     = kGroupBits[code];
+  const size_t  numBytes = kGroupSize / (8 / bits);
+  const uint8_t escape   = uint8_t((1 << bits) - 1);
+  if (pEnd - pSrc < ptrdiff_t(numBytes)) return nullptr;
+  const unsigned char* pExtra = pSrc + numBytes;
+  for (size_t i = 0; i < kGroupSize; ++i) {
+    pValues[i] = (pSrc[i % numBytes] >> (bits * (i / numBytes))) & escape;
+    if (pValues[i] == escape) {
+      if (pExtra == pEnd) return nullptr;
+      pValues[i] = *pExtra++;
+    }
+  }
+  return pExtra;
+}
+
+#ifdef MESHCODEC_SIMD
+// decodeGroupScalar() with the bits of all 16 values unpacked at once, and
+// escaped bytes put in place with a shuffle.
+inline const unsigned char* decodeGroupSimd(const unsigned char* pSrc,
+    const unsigned char* pEnd, int code, __m128i* pValues) {
+  // Escaped bytes are read 16 at a time; near the end of the data the
+  // scalar decoder takes over.
+  if (pEnd - pSrc < ptrdiff_t(2 * kGroupSize)) {
+    alignas(16) unsigned char values[kGroupSize];
+    pSrc     = decodeGroupScalar(pSrc, pEnd, code, values);
+    *pValues = _mm_load_si128(reinterpret_cast<const __m128i*>(values));
+    return pSrc;
+  }
+
+  __m128i values, escape;
+  switch (code) {
+    case 0: *pValues = _mm_setzero_si128(); return pSrc;
+    case 3:
+      *pValues = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+      return pSrc + kGroupSize;
+    case 1: {
+      int32_t packed;
+      std::memcpy(&packed, pSrc, sizeof(packed));
+      const __m128i bytes = _mm_cvtsi32_si128(packed);
+      const __m128i mask  = _mm_set1_epi8(3);
+      const __m128i v0    = _mm_and_si128(bytes, mask);
+      const __m128i v1    = _mm_and_si128(_mm_srli_epi16(bytes, 2), mask);
+      const __m128i v2    = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+      const __m128i v3    = _mm_and_si128(_mm_srli_epi16(bytes, 6), mask);
+      values = _mm_unpacklo_epi64(
+          _mm_unpacklo_epi32(v0, v1), _mm_unpacklo_epi32(v2, v3));
+      escape = mask;
+      pSrc += 4;
+      break;
+    }
+    default: {
+      const __m128i bytes = _mm_loadl_epi64(
+          reinterpret_cast<const __m128i*>(pSrc));
+      const __m128i mask = _mm_set1_epi8(15);
+      values             = _mm_unpacklo_epi64(_mm_and_si128(bytes, mask),
+          _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+      escape             = mask;
+      pSrc += 8;
+      break;
+    }
+  }
+
+  const __m128i escaped = _mm_cmpeq_epi8(values, escape);
+  const int     mask    = _mm_movemask_epi8(escaped);
+  if (mask == 0) {
+    *pValues = values;
+    return pSrc;
+  }
+  const int     low     = mask & 0xFF;
+  const int     high    = mask >> 8;
+  const __m128i shuffle = _mm_unpacklo_epi64(
+      _mm_loadl_epi64(
+          reinterpret_cast<const __m128i*>(kGroupTables.shuffle[low])),
+      _mm_add_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(
+                       kGroupTables.shuffle[high])),
+          _mm_set1_epi8(char(kGroupTables.count[low]))));
+  const __m128i extra = _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc)), shuffle);
+  *pValues = _mm_or_si128(_mm_andnot_si128(escaped, values), extra);
+  return pSrc + kGroupTables.count[low] + kGroupTables.count[high];
+}
+#endif
+
+// Decodes one byte column of a block into `groups` * 16 bytes at pColumn,
+// turning deltas back into bytes starting from *pLast, which is left at
+// the column's last byte.
+const unsigned char* decodeColumn(const unsigned char* pSrc,
+    const unsigned char* pEnd, size_t groups, unsigned char* pColumn,
+    unsigned char* pLast) {
+  const unsigned char* pHeaders = pSrc;
+  pSrc += (groups + 3) / 4;
+  if (pSrc > pEnd) return nullptr;
+
+#ifdef MESHCODEC_SIMD
+  const __m128i one   = _mm_set1_epi8(1);
+  const __m128i low7  = _mm_set1_epi8(0x7F);
+  __m128i       carry = _mm_set1_epi8(char(*pLast));
+  for (size_t g = 0; g < groups; ++g) {
+    const int code = (pHeaders[g / 4] >> (2 * (g % 4))) & 3;
+    __m128i   v;
+    if (!(pSrc = decodeGroupSimd(pSrc, pEnd, code, &v))) return nullptr;
+    // Undo the zigzag, then a prefix sum over the 16 deltas.
+    v = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(v, 1), low7),
+        _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, one)));
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+    v = _mm_add_epi8(v, carry);
+    carry = _mm_shuffle_epi8(v, _mm_set1_epi8(15));
+    _mm_store_si128(
+        reinterpret_cast<__m128i*>(pColumn + g * kGroupSize), v);
+  }
+  *pLast = pColumn[groups * kGroupSize - 1];
+#else
+  unsigned char last = *pLast;
+  for (size_t g = 0; g < groups; ++g) {
+    const int      code    = (pHeaders[g / 4] >> (2 * (g % 4))) & 3;
+    unsigned char* pValues = pColumn + g * kGroupSize;
+    if (!(pSrc = decodeGroupScalar(pSrc, pEnd, code, pValues))) {
+      return nullptr;
+    }
+    for (size_t i = 0; i < kGroupSize; ++i) {
+      last += unzigzag8(pValues[i]);
+      pValues[i] = last;
+    }
+  }
+  *pLast = last;
+#endif
+  return pSrc;
+}
+
+// Interleaves the byte columns of `count` vertices back into vertices.
+void transposeColumns(unsigned char* pVertices, const unsigned char* pColumns,
+    size_t columnSize, size_t count, size_t stride) {
+#ifdef MESHCODEC_SIMD
+  // Each group of 16 vertices is built as 16-byte rows: four columns
+  // interleave into a 32-bit word per vertex, and a 4x4 transpose of four
+  // such words gives 16 bytes of one vertex. Vertices are then stored in
+  // order with whole 16-byte stores; what runs past the end of a vertex
+  // is overwritten by the ones after it. Vertices whose stores would run
+  // past the end of the buffer go through a copy.
+  const size_t numChunks = (stride + 15) / 16;
+  __m128i      rows[kMaxVertexCodecStride / 16][kGroupSize];
+  for (size_t i = 0; i < count; i += kGroupSize) {
+    for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+      const size_t k = chunk * 16;
+      __m128i      words[4][4];  // [column quad][vertices 4b to 4b + 3]
+      for (size_t q = 0; q < 4; ++q) {
+        if (k + q * 4 >= stride) {
+          std::fill_n(words[q], 4, _mm_setzero_si128());
+          continue;
+        }
+        auto load = [&](size_t column) {
+          return _mm_load_si128(reinterpret_cast<const __m128i*>(
+              pColumns + (k + q * 4 + column) * columnSize + i));
+        };
+        const __m128i c0 = load(0), c1 = load(1), c2 = load(2), c3 = load(3);
+        const __m128i lo01 = _mm_unpacklo_epi8(c0, c1);
+        const __m128i hi01 = _mm_unpackhi_epi8(c0, c1);
+        const __m128i lo23 = _mm_unpacklo_epi8(c2, c3);
+        const __m128i hi23 = _mm_unpackhi_epi8(c2, c3);
+        words[q][0] = _mm_unpacklo_epi16(lo01, lo23);
+        words[q][1] = _mm_unpackhi_epi16(lo01, lo23);
+        words[q][2] = _mm_unpacklo_epi16(hi01, hi23);
+        words[q][3] = _mm_unpackhi_epi16(hi01, hi23);
+      }
+      for (size_t b = 0; b < 4; ++b) {
+        const __m128i t0 = _mm_unpacklo_epi32(words[0][b], words[1][b]);
+        const __m128i t1 = _mm_unpacklo_epi32(words[2][b], words[3][b]);
+        const __m128i t2 = _mm_unpackhi_epi32(words[0][b], words[1][b]);
+        const __m128i t3 = _mm_unpackhi_epi32(words[2][b], words[3][b]);
+        rows[chunk][b * 4 + 0] = _mm_unpacklo_epi64(t0, t1);
+        rows[chunk][b * 4 + 1] = _mm_unpackhi_epi64(t0, t1);
+        rows[chunk][b * 4 + 2] = _mm_unpacklo_epi64(t2, t3);
+        rows[chunk][b * 4 + 3] = _mm_unpackhi_epi64(t2, t3);
+      }
+    }
+
+    const size_t n = std::min(kGroupSize, count - i);
+    for (size_t j = 0; j < n; ++j) {
+      unsigned char* pVertex = pVertices + (i + j) * stride;
+      if ((i + j) * stride + numChunks * 16 <= count * stride) {
+        for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(pVertex + chunk * 16),
+              rows[chunk][j]);
+        }
+      } else {
+        alignas(16) unsigned char last[kMaxVertexCodecStride];
+        for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+          _mm_store_si128(
+              reinterpret_cast<__m128i*>(last + chunk * 16), rows[chunk][j]);
+        }
+        std::memcpy(pVertex, last, stride);
+      }
+    }
+  }
+#else
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t k = 0; k < stride; ++k) {
+      pVertices[i * stride + k] = pColumns[k * columnSize + i];
+    }
+  }
+#endif
+}
+
+}  // namespace
+
+size_t vertexBufferBound(size_t count, size_t stride) {
+  const size_t blockCount = vertexBlockCount(stride);
+  const size_t blocks     = (count + blockCount - 1) / blockCount;
+  const size_t groups     = count / kGroupSize + blocks;
+  return 1 + stride * (groups * kGroupSize + groups / 4 + blocks);
+}
+
+size_t encodeVertexBuffer(unsigned char* pDst, const void* pVertices,
+    size_t count, size_t stride) {
+  const auto*   pSrc       = static_cast<const unsigned char*>(pVertices);
+  const size_t  blockCount = vertexBlockCount(stride);
+  unsigned char last[kMaxVertexCodecStride] = {};
+  unsigned char values[kMaxVertexBlockCount];
+
+  unsigned char* pOut = pDst;
+  *pOut++             = kVertexCodecVersion;
+  for (size_t first = 0; first < count; first += blockCount) {
+    const size_t n      = std::min(blockCount, count - first);
+    const size_t groups = numGroups(n);
+    for (size_t k = 0; k < stride; ++k) {
+      std::fill(values, values + groups * kGroupSize, 0);
+      for (size_t i = 0; i < n; ++i) {
+        const unsigned char byte = pSrc[(first + i) * stride + k];
+        values[i]                = zigzag8(byte - last[k]);
+        last[k]                  = byte;
+      }
+      unsigned char* pHeaders = pOut;
+      pOut += (groups + 3) / 4;
+      std::fill(pHeaders, pOut, 0);
+      for (size_t g = 0; g < groups; ++g) {
+        int code;
+        pOut = encodeGroup(pOut, values + g * kGroupSize, &code);
+        pHeaders[g / 4] |= code << (2 * (g % 4));
+      }
+    }
+  }
+  return pOut - pDst;
+}
+
+bool decodeVertexBuffer(void* pVertices, size_t count, size_t stride,
+    const unsigned char* pSrc, size_t srcSize) {
+  if (stride == 0 || stride % 4 != 0 || stride > kMaxVertexCodecStride ||
+      srcSize == 0 || pSrc[0] != kVertexCodecVersion) {
+    return false;
+  }
+  const unsigned char* pEnd       = pSrc + srcSize;
+  const size_t         blockCount = vertexBlockCount(stride);
+  auto*                pDst       = static_cast<unsigned char*>(pVertices);
+  alignas(16) unsigned char columns[kVertexBlockBytes];
+  unsigned char             last[kMaxVertexCodecStride] = {};
+
+  ++pSrc;
+  for (size_t first = 0; first < count; first += blockCount) {
+    const size_t n          = std::min(blockCount, count - first);
+    const size_t groups     = numGroups(n);
+    const size_t columnSize = groups * kGroupSize;
+    for (size_t k = 0; k < stride && pSrc; ++k) {
+      pSrc = decodeColumn(
+          pSrc, pEnd, groups, columns + k * columnSize, &last[k]);
+    }
+    if (!pSrc) return false;
+    transposeColumns(pDst + first * stride, columns, columnSize, n, stride);
+  }
+  return pSrc == pEnd;
+}
+
+size_t indexBufferBound(size_t count) {
+  return 1 + (count + 3) / 4 + count * sizeof(uint32_t);
+}
+
+size_t encodeIndexBuffer(unsigned char* pDst, const void* pIndices,
+    size_t count, IndexType indexType) {
+  unsigned char* pControl = pDst + 1;
+  unsigned char* pData    = pControl + (count + 3) / 4;
+  uint32_t       previous = 0;
+  pDst[0]                 = kIndexCodecVersion;
+  std::fill(pControl, pData, 0);
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t index =
+        indexType == IndexType::UInt16
+            ? static_cast<const uint16_t*>(pIndices)[i]
+            : static_cast<const uint32_t*>(pIndices)[i];
+    const uint32_t value  = zigzag32(index - previous);
+    const int      length = value < (1u << 8)    ? 1
+                            : value < (1u << 16) ? 2
+                            : value < (1u << 24) ? 3
+                                                 : 4;
+    previous = index;
+    pControl[i / 4] |= (length - 1) << (2 * (i % 4));
+    // Little-endian, like the rest of the mesh data.
+    for (int byte = 0; byte < length; ++byte) {
+      *pData++ = uint8_t(value >> (8 * byte));
+    }
+  }
+  return pData - pDst;
+}
+
+bool decodeIndexBuffer(void* pIndices, size_t count, IndexType indexType,
+    const unsigned char* pSrc, size_t srcSize) {
+  if (srcSize == 0 || pSrc[0] != kIndexCodecVersion ||
+      srcSize - 1 < (count + 3) / 4) {
+    return false;
+  }
+  const unsigned char* pEnd     = pSrc + srcSize;
+  const unsigned char* pControl = pSrc + 1;
+  const unsigned char* pData    = pControl + (count + 3) / 4;
+  auto*                pDst16   = static_cast<uint16_t*>(pIndices);
+  auto*                pDst32   = static_cast<uint32_t*>(pIndices);
+  const bool           wide     = indexType == IndexType::UInt32;
+  uint32_t             previous = 0;
+  size_t               i        = 0;
+
+#ifdef MESHCODEC_SIMD
+  // Four indices per control byte while 16 bytes of data can be loaded.
+  const __m128i one      = _mm_set1_epi32(1);
+  __m128i       last     = _mm_setzero_si128();
+  __m128i       overflow = _mm_setzero_si128();
+  for (; i + 4 <= count && pEnd - pData >= 16; i += 4) {
+    const unsigned char control = pControl[i / 4];
+    __m128i             v       = _mm_shuffle_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+            kStreamVByteTables.shuffle[control])));
+    pData += kStreamVByteTables.length[control];
+    v = _mm_xor_si128(_mm_srli_epi32(v, 1),
+        _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+    v    = _mm_add_epi32(v, last);
+    last = _mm_shuffle_epi32(v, 0xFF);
+    if (wide) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst32 + i), v);
+    } else {
+      overflow = _mm_or_si128(overflow, _mm_srli_epi32(v, 16));
+      _mm_storel_epi64(
+          reinterpret_cast<__m128i*>(pDst16 + i), _mm_packus_epi32(v, v));
+    }
+  }
+  if (!_mm_testz_si128(overflow, overflow)) return false;
+  previous = uint32_t(_mm_cvtsi128_si32(last));
+#endif
+
+  for (; i < count; ++i) {
+    const int length = ((pControl[i / 4] >> (2 * (i % 4))) & 3) + 1;
+    if (pEnd - pData < length) return false;
+    uint32_t value = 0;
+    for (int byte = 0; byte < length; ++byte) {
+      value |= uint32_t(pData[byte]) << (8 * byte);
+    }
+    pData += length;
+    previous += unzigzag32(value);
+    if (wide) {
+      pDst32[i] = previous;
+    } else if (previous > 0xFFFF) {
+      return false;
+    } else {
+      pDst16[i] = uint16_t(previous);
+    }
+  }
+  return pData == pEnd;
+}
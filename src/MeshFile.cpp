@@ -0,0 +1,242 @@
+#include "MeshFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+using shader_types::VertexQuantization;
+
+namespace {
+
+// Padding written between blocks.
+const char kZeros[kMeshFileAlignment] = {};
+
+size_t alignUp(size_t offset) {
+  return (offset + kMeshFileAlignment - 1) / kMeshFileAlignment *
+         kMeshFileAlignment;
+}
+
+// Bytes per element each section must have in a file of this format.
+size_t elementSize(
+    MeshFileSectionType type, VertexFormat vertexFormat, IndexType indexType) {
+  switch (type) {
+    case MeshFileSectionType::Vertices: return vertexSize(vertexFormat);
+    case MeshFileSectionType::Quantizations: return sizeof(VertexQuantization);
+    case MeshFileSectionType::Indices: return indexSize(indexType);
+    case MeshFileSectionType::Lods: return sizeof(MeshLod);
+    case MeshFileSectionType::LodBounds: return sizeof(MeshLodBounds);
+    case MeshFileSectionType::Meshlets: return sizeof(Meshlet);
+    case MeshFileSectionType::MeshletBounds: return sizeof(MeshletBounds);
+    case MeshFileSectionType::Count: break;
+  }
+  return 0;
+}
+
+std::vector<MeshLodBounds> computeLodBounds(const MeshLodChain& chain) {
+  std::vector<MeshLodBounds> bounds;
+  for (size_t l = 0; l < chain.lods.size(); ++l) {
+    const MeshLod& lod = chain.lods[l];
+    const float    big = std::numeric_limits<float>::max();
+    MeshLodBounds  box = {{big, big, big}, {-big, -big, -big}};
+    for (uint32_t v = lod.firstVertex; v < lod.firstVertex + lod.numVertices;
+         ++v) {
+      const Math::float3 p =
+          chain.vertexFormat == VertexFormat::Float
+              ? chain.vertices[v].position
+              : dequantizePosition(
+                    chain.quantizedVertices[v], chain.quantizations[l]);
+      box.min = {std::min(box.min.x, p.x), std::min(box.min.y, p.y),
+          std::min(box.min.z, p.z)};
+      box.max = {std::max(box.max.x, p.x), std::max(box.max.y, p.y),
+          std::max(box.max.z, p.z)};
+    }
+    bounds.push_back(box);
+  }
+  return bounds;
+}
+
+}  // namespace
+
+bool writeMeshFile(
+    const char* path, const MeshLodChain& chain, std::string* pError) {
+  const std::vector<MeshLodBounds> lodBounds = computeLodBounds(chain);
+  const bool                       quantized =
+      chain.vertexFormat == VertexFormat::Quantized;
+
+  struct Block {
+    MeshFileSectionType type;
+    const void*         pData;
+    size_t              count;
+  };
+  const Block blocks[] = {
+      {MeshFileSectionType::Vertices,
+          quantized ? static_cast<const void*>(chain.quantizedVertices.data())
+                    : chain.vertices.data(),
+          quantized ? chain.quantizedVertices.size() : chain.vertices.size()},
+      {MeshFileSectionType::Quantizations, chain.quantizations.data(),
+          quantized ? chain.quantizations.size() : 0},
+      {MeshFileSectionType::Indices, chain.indexData.data(),
+          chain.indexData.size() / indexSize(chain.indexType)},
+      {MeshFileSectionType::Lods, chain.lods.data(), chain.lods.size()},
+      {MeshFileSectionType::LodBounds, lodBounds.data(), lodBounds.size()},
+      {MeshFileSectionType::Meshlets, chain.meshlets.data(),
+          chain.meshlets.size()},
+      {MeshFileSectionType::MeshletBounds, chain.meshletBounds.data(),
+          chain.meshletBounds.size()},
+  };
+  constexpr size_t kNumBlocks = std::size(blocks);
+
+  MeshFileHeader header = {};
+  std::memcpy(header.magic, kMeshFileMagic, sizeof(header.magic));
+  header.version      = kMeshFileVersion;
+  header.vertexFormat = uint32_t(chain.vertexFormat);
+  header.indexType    = uint32_t(chain.indexType);
+  header.numSections  = uint32_t(kNumBlocks);
+
+  MeshFileSection sections[kNumBlocks];
+  size_t          offset = alignUp(sizeof(header) + sizeof(sections));
+  for (size_t i = 0; i < kNumBlocks; ++i) {
+    const size_t size = elementSize(
+        blocks[i].type, chain.vertexFormat, chain.indexType);
+    sections[i] = {uint32_t(blocks[i].type), uint32_t(size), offset,
+        blocks[i].count};
+    offset = alignUp(offset + size * blocks[i].count);
+  }
+  header.fileSize = offset;
+
+  // errno as of the first failure; a short fwrite need not set it.
+  FILE* pFile = std::fopen(path, "wb");
+  bool  ok    = pFile != nullptr;
+  int   error = ok ? 0 : errno;
+  auto  write = [&](const void* pData, size_t size) {
+    if (!ok) return;
+    errno = 0;
+    ok    = std::fwrite(pData, 1, size, pFile) == size;
+    error = errno;
+  };
+  auto pad = [&](size_t written) {
+    write(kZeros, alignUp(written) - written);
+  };
+  write(&header, sizeof(header));
+  write(sections, sizeof(sections));
+  pad(sizeof(header) + sizeof(sections));
+  for (size_t i = 0; i < kNumBlocks; ++i) {
+    const size_t size = sections[i].elementSize * blocks[i].count;
+    write(blocks[i].pData, size);
+    pad(size);
+  }
+  if (pFile) {
+    errno = 0;
+    if (std::fclose(pFile) != 0 && ok) {
+      ok    = false;
+      error = errno;
+    }
+  }
+  if (!ok) {
+    if (pFile) std::remove(path);
+    if (pError) {
+      *pError = std::string(path) + ": cannot write: " +
+                (error != 0 ? std::strerror(error) : "short write");
+    }
+  }
+  return ok;
+}
+
+bool MeshFile::open(const char* path, std::string* pError) {
+  std::fill(std::begin(_sections), std::end(_sections), nullptr);
+  if (!_file.open(path, pError)) return false;
+  auto fail = [&](const char* what) {
+    if (pError) *pError = std::string(path) + ": " + what;
+    _file.close();
+    return false;
+  };
+
+  const size_t size = _file.size();
+  if (size < sizeof(MeshFileHeader)) return fail("not a mesh file");
+  MeshFileHeader header;
+  std::memcpy(&header, _file.data(), sizeof(header));
+  if (std::memcmp(header.magic, kMeshFileMagic, sizeof(header.magic)) != 0) {
+    return fail("not a mesh file");
+  }
+  if (header.version != kMeshFileVersion) {
+    return fail("unsupported mesh file version");
+  }
+  if (header.fileSize != size) return fail("truncated mesh file");
+  if (header.vertexFormat > uint32_t(VertexFormat::Quantized) ||
+      header.indexType > uint32_t(IndexType::UInt32) ||
+      header.numSections >
+          (size - sizeof(header)) / sizeof(MeshFileSection)) {
+    return fail("malformed header");
+  }
+  _vertexFormat = VertexFormat(header.vertexFormat);
+  _indexType    = IndexType(header.indexType);
+
+  // The mapping is page-aligned, so the table is suitably aligned too.
+  const auto* pSections = reinterpret_cast<const MeshFileSection*>(
+      _file.data() + sizeof(header));
+  for (uint32_t i = 0; i < header.numSections; ++i) {
+    const MeshFileSection& section = pSections[i];
+    // Sections from newer writers that this one does not know are skipped.
+    if (section.type >= uint32_t(MeshFileSectionType::Count)) continue;
+    const auto type = MeshFileSectionType(section.type);
+    if (_sections[section.type] ||
+        section.elementSize != elementSize(type, _vertexFormat, _indexType) ||
+        section.offset % kMeshFileAlignment != 0 || section.offset > size ||
+        section.count > (size - section.offset) / section.elementSize) {
+      return fail("malformed section table");
+    }
+    _sections[section.type] = &section;
+  }
+
+  const size_t numLods   = this->numLods();
+  const bool   quantized = _vertexFormat == VertexFormat::Quantized;
+  if (!_sections[size_t(MeshFileSectionType::Vertices)] ||
+      !_sections[size_t(MeshFileSectionType::Indices)] || numLods == 0 ||
+      count(MeshFileSectionType::LodBounds) != numLods ||
+      count(MeshFileSectionType::Quantizations) != (quantized ? numLods : 0) ||
+      count(MeshFileSectionType::MeshletBounds) != numMeshlets()) {
+    return fail("missing or inconsistent sections");
+  }
+  // Ranges only; index values are not scanned, which would mean reading
+  // the whole file. Meshlets are a small fraction of it.
+  const size_t numIndices = count(MeshFileSectionType::Indices);
+  for (size_t l = 0; l < numLods; ++l) {
+    const MeshLod& lod = lods()[l];
+    if (size_t(lod.firstVertex) + lod.numVertices > numVertices() ||
+        size_t(lod.firstIndex) + lod.numIndices > numIndices ||
+        size_t(lod.firstMeshlet) + lod.numMeshlets > numMeshlets()) {
+      return fail("LOD out of range");
+    }
+    // Meshlet triangles index into the LOD's own index range.
+    const size_t numTriangles = lod.numIndices / 3;
+    for (uint32_t m = 0; m < lod.numMeshlets; ++m) {
+      const Meshlet& meshlet = meshlets()[lod.firstMeshlet + m];
+      if (meshlet.firstTriangle > numTriangles ||
+          meshlet.numTriangles > numTriangles - meshlet.firstTriangle) {
+        return fail("meshlet out of range");
+      }
+    }
+  }
+  return true;
+}
+
+MeshLodChain MeshFile::toChain() const {
+  MeshLodChain chain;
+  chain.vertexFormat = _vertexFormat;
+  chain.indexType    = _indexType;
+  if (_vertexFormat == VertexFormat::Float) {
+    copySection(MeshFileSectionType::Vertices, &chain.vertices);
+  } else {
+    copySection(MeshFileSectionType::Vertices, &chain.quantizedVertices);
+    copySection(MeshFileSectionType::Quantizations, &chain.quantizations);
+  }
+  copySection(MeshFileSectionType::Indices, &chain.indexData);
+  copySection(MeshFileSectionType::Lods, &chain.lods);
+  copySection(MeshFileSectionType::Meshlets, &chain.meshlets);
+  copySection(MeshFileSectionType::MeshletBounds, &chain.meshletBounds);
+  return chain;
+}
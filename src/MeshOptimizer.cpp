@@ -0,0 +1,654 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Forsyth's tuning constants. The scoring cache is larger than the one
+// analyzeVertexCache() models; it only ranks candidates.
+constexpr int   kScoringCacheSize  = 32;
+constexpr float kCacheDecayPower   = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.f;
+constexpr float kValenceBoostPower = 0.5f;
+
+// Scores are tabulated; powf() per update would dominate the run time.
+constexpr uint32_t kMaxTabulatedValence = 32;
+
+struct ScoreTables {
+  float cache[kScoringCacheSize];
+  float valence[kMaxTabulatedValence];
+
+  ScoreTables() {
+    for (int i = 0; i < kScoringCacheSize; ++i) {
+      // The last triangle's vertices score lower so the next triangle fans
+      // out instead of strip-hopping back over them.
+      const float scale = 1.f / (kScoringCacheSize - 3);
+      cache[i]          = i < 3 ? kLastTriangleScore
+                                : powf(1.f - (i - 3) * scale, kCacheDecayPower);
+    }
+    valence[0] = 0.f;
+    for (uint32_t i = 1; i < kMaxTabulatedValence; ++i) {
+      valence[i] = valenceScore(i);
+    }
+  }
+
+  // Favours vertices with few triangles left so they can leave the cache.
+  static float valenceScore(uint32_t remainingTriangles) {
+    return kValenceBoostScale *
+           powf(float(remainingTriangles), -kValenceBoostPower);
+  }
+
+  float score(int cachePosition, uint32_t remainingTriangles) const {
+    if (remainingTriangles == 0) {
+      return -1.f;
+    }
+    const float valenceBoost = remainingTriangles < kMaxTabulatedValence
+                                   ? valence[remainingTriangles]
+                                   : valenceScore(remainingTriangles);
+    return (cachePosition >= 0 ? cache[cachePosition] : 0.f) + valenceBoost;
+  }
+};
+
+// Recently fetched cache lines the fetch analysis assumes stay resident.
+constexpr uint64_t kFetchCacheLines = 64;
+
+// Welding hashes attributes on a grid this many epsilons wide. Wider cells
+// mean fewer neighbouring cells to probe but more vertices per cell.
+constexpr double kWeldCellSize = 8.0;
+
+uint64_t hashKey(const int64_t* pKey, size_t count) {
+  // FNV-1a over the grid cell's bytes.
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t word = uint64_t(pKey[i]);
+    for (int b = 0; b < 8; ++b) {
+      hash = (hash ^ (word & 0xff)) * 1099511628211ull;
+      word >>= 8;
+    }
+  }
+  return hash;
+}
+
+// Vertex -> triangle adjacency in CSR form: the triangles using vertex v
+// are triangles[offsets[v], offsets[v + 1]).
+struct TriangleAdjacency {
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+};
+
+TriangleAdjacency buildTriangleAdjacency(
+    const uint32_t* pIndices, size_t numTriangles, size_t numVertices) {
+  TriangleAdjacency adjacency;
+  adjacency.offsets.assign(numVertices + 1, 0);
+  for (size_t i = 0; i < numTriangles * 3; ++i) {
+    ++adjacency.offsets[pIndices[i] + 1];
+  }
+  for (size_t v = 0; v < numVertices; ++v) {
+    adjacency.offsets[v + 1] += adjacency.offsets[v];
+  }
+  adjacency.triangles.resize(numTriangles * 3);
+  std::vector<uint32_t> cursor(
+      adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+  for (size_t i = 0; i < numTriangles * 3; ++i) {
+    adjacency.triangles[cursor[pIndices[i]]++] = uint32_t(i / 3);
+  }
+  return adjacency;
+}
+
+Math::float3 streamPosition(const VertexStream& stream, uint32_t v) {
+  const float* p = reinterpret_cast<const float*>(
+      reinterpret_cast<const unsigned char*>(stream.pData) + v * stream.stride);
+  return {p[0], p[1], p[2]};
+}
+
+// Unit normal of the front face of `pTriangle`, or zero if it is
+// degenerate. Front faces have a positive signed area in the y-down
+// window, which in model space means they face along cross(c - a, b - a).
+Math::float3 triangleNormal(
+    const VertexStream& positions, const uint32_t* pTriangle) {
+  const Math::float3 a      = streamPosition(positions, pTriangle[0]);
+  const Math::float3 n      = Math::cross(
+      streamPosition(positions, pTriangle[2]) - a,
+      streamPosition(positions, pTriangle[1]) - a);
+  const float        length = Math::length(n);
+  return length > 1e-12f ? n * (1.f / length) : Math::float3{0.f, 0.f, 0.f};
+}
+
+// Whether a triangle with unit normal n stays within kMeshletNormalCone of
+// the mean of the normals in `normalSum`. Degenerate triangles fit
+// anywhere, and anything fits an empty meshlet.
+bool fitsNormalCone(const Math::float3& n, const Math::float3& normalSum) {
+  return (n.x == 0.f && n.y == 0.f && n.z == 0.f) ||
+         Math::dot(n, normalSum) >=
+             kMeshletNormalCone * Math::length(normalSum);
+}
+
+// Distinct vertices of `pTriangle` not yet stamped with `meshlet`.
+int countNewVertices(const uint32_t* pTriangle,
+    const std::vector<uint32_t>& stamps, uint32_t meshlet) {
+  int count = 0;
+  for (int k = 0; k < 3; ++k) {
+    const uint32_t v = pTriangle[k];
+    if (stamps[v] != meshlet && (k < 1 || v != pTriangle[0]) &&
+        (k < 2 || v != pTriangle[1])) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+}  // namespace
+
+VertexCacheStats analyzeVertexCache(const uint32_t* pIndices,
+    size_t numIndices, size_t numVertices, uint32_t cacheSize) {
+  // A vertex is cached while fewer than cacheSize misses happened since it
+  // was last loaded.
+  std::vector<uint64_t> loadedAt(numVertices, 0);
+  std::vector<bool>     used(numVertices, false);
+  uint64_t              misses  = 0;
+  size_t                numUsed = 0;
+  for (size_t i = 0; i < numIndices; ++i) {
+    const uint32_t v = pIndices[i];
+    if (loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize) {
+      loadedAt[v] = ++misses;
+    }
+    if (!used[v]) {
+      used[v] = true;
+      ++numUsed;
+    }
+  }
+
+  VertexCacheStats stats;
+  stats.numTransformed = uint32_t(misses);
+  stats.acmr           = numIndices ? float(misses) / (numIndices / 3) : 0.f;
+  stats.atvr           = numUsed ? float(misses) / numUsed : 0.f;
+  return stats;
+}
+
+void optimizeVertexCache(uint32_t* pDst, const uint32_t* pIndices,
+    size_t numIndices, size_t numVertices) {
+  const size_t numTriangles = numIndices / 3;
+  if (numTriangles == 0) {
+    return;
+  }
+
+  // Each vertex's live triangles are kept at the front of its adjacency
+  // range, `remaining` long.
+  TriangleAdjacency adjacency = buildTriangleAdjacency(
+      pIndices, numTriangles, numVertices);
+  const std::vector<uint32_t>& adjacencyOffsets = adjacency.offsets;
+  std::vector<uint32_t>        remaining(numVertices);
+  for (size_t v = 0; v < numVertices; ++v) {
+    remaining[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+  }
+
+  static const ScoreTables tables;
+  std::vector<float>       vertexScores(numVertices);
+  for (size_t v = 0; v < numVertices; ++v) {
+    vertexScores[v] = tables.score(-1, remaining[v]);
+  }
+  std::vector<bool>  emitted(numTriangles, false);
+
+  // The cache briefly holds three extra entries while a triangle is added.
+  uint32_t cache[kScoringCacheSize + 3];
+  uint32_t newCache[kScoringCacheSize + 3];
+  int      cacheCount = 0;
+
+  size_t  nextUnemitted = 0;
+  int64_t best          = 0;
+  for (size_t emittedCount = 0; emittedCount < numTriangles;
+       ++emittedCount) {
+    if (best < 0) {
+      // Nothing adjacent to the cache is left; restart from the first
+      // triangle not yet emitted.
+      while (emitted[nextUnemitted]) ++nextUnemitted;
+      best = int64_t(nextUnemitted);
+    }
+    const uint32_t* pTriangle = &pIndices[best * 3];
+    std::copy(pTriangle, pTriangle + 3, pDst + emittedCount * 3);
+    emitted[best] = true;
+
+    // Drop the triangle from its vertices' live lists.
+    for (int k = 0; k < 3; ++k) {
+      const uint32_t v      = pTriangle[k];
+      uint32_t*      pFirst = &adjacency.triangles[adjacencyOffsets[v]];
+      uint32_t*      pLast  = pFirst + remaining[v];
+      std::iter_swap(std::find(pFirst, pLast, uint32_t(best)), pLast - 1);
+      --remaining[v];
+    }
+
+    // New LRU order: the triangle's vertices, then the old cache minus
+    // them. Entries past the scoring size fall out.
+    int newCount = 0;
+    for (int k = 0; k < 3; ++k) {
+      newCache[newCount++] = pTriangle[k];
+    }
+    for (int i = 0; i < cacheCount; ++i) {
+      const uint32_t v = cache[i];
+      if (v != pTriangle[0] && v != pTriangle[1] && v != pTriangle[2]) {
+        newCache[newCount++] = v;
+      }
+    }
+    for (int i = kScoringCacheSize; i < newCount; ++i) {
+      vertexScores[newCache[i]] = tables.score(-1, remaining[newCache[i]]);
+    }
+    cacheCount = std::min(newCount, kScoringCacheSize);
+
+    // Rescore the cached vertices and their triangles, tracking the best
+    // candidate for the next step.
+    for (int i = 0; i < cacheCount; ++i) {
+      const uint32_t v = newCache[i];
+      cache[i]         = v;
+      vertexScores[v]  = tables.score(i, remaining[v]);
+    }
+    best            = -1;
+    float bestScore = -1.f;
+    for (int i = 0; i < cacheCount; ++i) {
+      const uint32_t  v      = cache[i];
+      const uint32_t* pFirst = &adjacency.triangles[adjacencyOffsets[v]];
+      for (uint32_t j = 0; j < remaining[v]; ++j) {
+        const uint32_t  t     = pFirst[j];
+        const uint32_t* p     = &pIndices[t * 3];
+        const float     score = vertexScores[p[0]] + vertexScores[p[1]] +
+                            vertexScores[p[2]];
+        if (score > bestScore) {
+          bestScore = score;
+          best      = t;
+        }
+      }
+    }
+  }
+}
+
+VertexFetchStats analyzeVertexFetch(const uint32_t* pIndices,
+    size_t numIndices, size_t numVertices, size_t vertexSize) {
+  const size_t numLines = (numVertices * vertexSize + kFetchLineSize - 1) /
+                          kFetchLineSize;
+
+  std::vector<uint64_t> vertexLoadedAt(numVertices, 0);
+  std::vector<uint64_t> lineLoadedAt(numLines, 0);
+  std::vector<bool>     used(numVertices, false);
+  uint64_t              vertexMisses = 0;
+  uint64_t              lineMisses   = 0;
+  size_t                numUsed      = 0;
+  for (size_t i = 0; i < numIndices; ++i) {
+    const uint32_t v = pIndices[i];
+    if (!used[v]) {
+      used[v] = true;
+      ++numUsed;
+    }
+    if (vertexLoadedAt[v] != 0 &&
+        vertexMisses - vertexLoadedAt[v] < kVertexCacheSize) {
+      continue;
+    }
+    vertexLoadedAt[v] = ++vertexMisses;
+
+    const size_t firstLine = v * vertexSize / kFetchLineSize;
+    const size_t lastLine  = ((v + 1) * vertexSize - 1) / kFetchLineSize;
+    for (size_t line = firstLine; line <= lastLine; ++line) {
+      if (lineLoadedAt[line] == 0 ||
+          lineMisses - lineLoadedAt[line] >= kFetchCacheLines) {
+        lineLoadedAt[line] = ++lineMisses;
+      }
+    }
+  }
+
+  VertexFetchStats stats;
+  stats.bytesFetched = size_t(lineMisses) * kFetchLineSize;
+  stats.overfetch    = numUsed ? float(stats.bytesFetched) /
+                                  (numUsed * vertexSize)
+                               : 0.f;
+  return stats;
+}
+
+size_t generateWeldRemap(uint32_t* pRemap, const VertexStream* pStreams,
+    size_t numStreams, size_t numVertices, float epsilon) {
+  size_t keySize = 0;
+  for (size_t s = 0; s < numStreams; ++s) {
+    keySize += pStreams[s].numFloats;
+  }
+
+  // Attributes of every vertex back to back, and the grid cell holding
+  // each. Cells are several epsilons wide, so an attribute's epsilon range
+  // reaches at most one neighbouring cell.
+  std::vector<float>   values(numVertices * keySize);
+  std::vector<int64_t> cells(numVertices * keySize);
+  std::vector<int8_t>  neighbours(numVertices * keySize);
+  const double         scale = 1.0 / (kWeldCellSize * double(epsilon));
+  for (size_t v = 0; v < numVertices; ++v) {
+    float*   pValue     = &values[v * keySize];
+    int64_t* pCell      = &cells[v * keySize];
+    int8_t*  pNeighbour = &neighbours[v * keySize];
+    for (size_t s = 0; s < numStreams; ++s) {
+      const VertexStream& stream = pStreams[s];
+      const float*        pData  = reinterpret_cast<const float*>(
+          reinterpret_cast<const unsigned char*>(stream.pData) +
+          v * stream.stride);
+      for (size_t f = 0; f < stream.numFloats; ++f) {
+        const double value = pData[f];
+        const double cell  = std::floor(value * scale);
+        *pValue++          = pData[f];
+        *pCell++           = int64_t(cell);
+        *pNeighbour++      = std::floor((value - epsilon) * scale) < cell ? -1
+                             : std::floor((value + epsilon) * scale) > cell
+                                 ? 1
+                                 : 0;
+      }
+    }
+  }
+
+  // Open addressing with linear probing on the cell; slots hold unique
+  // vertices, several of which may share a cell.
+  size_t tableSize = 16;
+  while (tableSize < numVertices * 2) tableSize *= 2;
+  std::vector<uint32_t> table(tableSize, kUnusedVertex);
+
+  std::vector<int64_t> probe(keySize);
+  std::vector<size_t>  nearAxes;
+  size_t               numUnique = 0;
+  for (size_t v = 0; v < numVertices; ++v) {
+    const float*   pValue     = &values[v * keySize];
+    const int64_t* pCell      = &cells[v * keySize];
+    const int8_t*  pNeighbour = &neighbours[v * keySize];
+    nearAxes.clear();
+    for (size_t k = 0; k < keySize; ++k) {
+      if (pNeighbour[k] != 0) nearAxes.push_back(k);
+    }
+
+    // Look through the vertex's cell and every combination of the
+    // neighbouring ones for the first unique vertex within epsilon.
+    uint32_t match = kUnusedVertex;
+    for (size_t mask = 0; mask < (size_t(1) << nearAxes.size()); ++mask) {
+      std::copy(pCell, pCell + keySize, probe.begin());
+      for (size_t i = 0; i < nearAxes.size(); ++i) {
+        if (mask >> i & 1) probe[nearAxes[i]] += pNeighbour[nearAxes[i]];
+      }
+      for (size_t slot = hashKey(probe.data(), keySize) & (tableSize - 1);
+           table[slot] != kUnusedVertex; slot = (slot + 1) & (tableSize - 1)) {
+        const uint32_t other = table[slot];
+        if (pRemap[other] >= match ||
+            !std::equal(probe.begin(), probe.end(), &cells[other * keySize])) {
+          continue;
+        }
+        const float* pOther = &values[other * keySize];
+        size_t       k      = 0;
+        while (k < keySize && std::fabs(pOther[k] - pValue[k]) <= epsilon) {
+          ++k;
+        }
+        if (k == keySize) match = pRemap[other];
+      }
+    }
+    if (match != kUnusedVertex) {
+      pRemap[v] = match;
+      continue;
+    }
+
+    size_t slot = hashKey(pCell, keySize) & (tableSize - 1);
+    while (table[slot] != kUnusedVertex) slot = (slot + 1) & (tableSize - 1);
+    table[slot] = uint32_t(v);
+    pRemap[v]   = uint32_t(numUnique++);
+  }
+  return numUnique;
+}
+
+size_t generateVertexFetchRemap(uint32_t* pRemap, const uint32_t* pIndices,
+    size_t numIndices, size_t numVertices) {
+  std::fill(pRemap, pRemap + numVertices, kUnusedVertex);
+  uint32_t next = 0;
+  for (size_t i = 0; i < numIndices; ++i) {
+    if (pRemap[pIndices[i]] == kUnusedVertex) {
+      pRemap[pIndices[i]] = next++;
+    }
+  }
+  return next;
+}
+
+void remapIndices(uint32_t* pDst, const uint32_t* pIndices,
+    size_t numIndices, const uint32_t* pRemap) {
+  for (size_t i = 0; i < numIndices; ++i) {
+    pDst[i] = pRemap[pIndices[i]];
+  }
+}
+
+size_t removeDegenerateTriangles(uint32_t* pIndices, size_t numIndices) {
+  size_t count = 0;
+  for (size_t i = 0; i + 3 <= numIndices; i += 3) {
+    const uint32_t a = pIndices[i + 0];
+    const uint32_t b = pIndices[i + 1];
+    const uint32_t c = pIndices[i + 2];
+    if (a != b && b != c && c != a) {
+      pIndices[count++] = a;
+      pIndices[count++] = b;
+      pIndices[count++] = c;
+    }
+  }
+  return count;
+}
+
+std::vector<Meshlet> buildMeshlets(const uint32_t* pIndices,
+    size_t numIndices, size_t numVertices, const VertexStream* pPositions) {
+  std::vector<Meshlet>  meshlets;
+  std::vector<uint32_t> stamps(numVertices, kUnusedVertex);
+  Meshlet               current   = {0, 0, 0};
+  Math::float3          normalSum = {0.f, 0.f, 0.f};
+  for (size_t t = 0; t < numIndices / 3; ++t) {
+    const uint32_t*    pTriangle = &pIndices[t * 3];
+    const Math::float3 normal    = pPositions
+                                       ? triangleNormal(*pPositions, pTriangle)
+                                       : Math::float3{0.f, 0.f, 0.f};
+    uint32_t           meshlet   = uint32_t(meshlets.size());
+    int newVertices = countNewVertices(pTriangle, stamps, meshlet);
+    if (current.numTriangles == kMaxMeshletTriangles ||
+        current.numVertices + newVertices > kMaxMeshletVertices ||
+        !fitsNormalCone(normal, normalSum)) {
+      meshlets.push_back(current);
+      current     = {uint32_t(t), 0, 0};
+      normalSum   = {0.f, 0.f, 0.f};
+      meshlet     = uint32_t(meshlets.size());
+      newVertices = countNewVertices(pTriangle, stamps, meshlet);
+    }
+    for (int k = 0; k < 3; ++k) {
+      stamps[pTriangle[k]] = meshlet;
+    }
+    current.numTriangles += 1;
+    current.numVertices += newVertices;
+    normalSum += normal;
+  }
+  if (current.numTriangles > 0) {
+    meshlets.push_back(current);
+  }
+  return meshlets;
+}
+
+std::vector<Meshlet> clusterMeshlets(uint32_t* pDst, const uint32_t* pIndices,
+    size_t numIndices, const VertexStream& positions, size_t numVertices) {
+  const size_t         numTriangles = numIndices / 3;
+  std::vector<Meshlet> meshlets;
+  if (numTriangles == 0) {
+    return meshlets;
+  }
+
+  const TriangleAdjacency   adjacency = buildTriangleAdjacency(
+      pIndices, numTriangles, numVertices);
+  std::vector<Math::float3> centroids(numTriangles), normals(numTriangles);
+  for (size_t t = 0; t < numTriangles; ++t) {
+    const uint32_t* p = &pIndices[t * 3];
+    centroids[t]      = (streamPosition(positions, p[0]) +
+                        streamPosition(positions, p[1]) +
+                        streamPosition(positions, p[2])) *
+                   (1.f / 3.f);
+    normals[t]        = triangleNormal(positions, p);
+  }
+
+  // Vertices and candidate triangles are stamped with the meshlet that
+  // last took them in.
+  std::vector<uint32_t> vertexStamps(numVertices, kUnusedVertex);
+  std::vector<uint32_t> candidateStamps(numTriangles, kUnusedVertex);
+  std::vector<bool>     emitted(numTriangles, false);
+  std::vector<uint32_t> candidates;
+  Meshlet               current     = {0, 0, 0};
+  Math::float3          centroidSum = {0.f, 0.f, 0.f};
+  Math::float3          normalSum   = {0.f, 0.f, 0.f};
+
+  size_t  nextUnemitted = 0;
+  int64_t next          = -1;
+  for (size_t emittedCount = 0; emittedCount < numTriangles;
+       ++emittedCount) {
+    if (next < 0) {
+      // The meshlet's neighbourhood is used up; continue with the first
+      // triangle not yet emitted.
+      while (emitted[nextUnemitted]) ++nextUnemitted;
+      next = int64_t(nextUnemitted);
+    }
+    const uint32_t  t         = uint32_t(next);
+    const uint32_t* pTriangle = &pIndices[t * 3];
+    int newVertices = countNewVertices(
+        pTriangle, vertexStamps, uint32_t(meshlets.size()));
+    if (current.numTriangles == kMaxMeshletTriangles ||
+        current.numVertices + newVertices > kMaxMeshletVertices ||
+        !fitsNormalCone(normals[t], normalSum)) {
+      meshlets.push_back(current);
+      current     = {uint32_t(emittedCount), 0, 0};
+      centroidSum = {0.f, 0.f, 0.f};
+      normalSum   = {0.f, 0.f, 0.f};
+      candidates.clear();
+      newVertices = countNewVertices(
+        pTriangle, vertexStamps, uint32_t(meshlets.size()));
+    }
+    const uint32_t meshlet = uint32_t(meshlets.size());
+
+    std::copy(pTriangle, pTriangle + 3, pDst + emittedCount * 3);
+    emitted[t] = true;
+    current.numTriangles += 1;
+    current.numVertices += newVertices;
+    centroidSum += centroids[t];
+    normalSum += normals[t];
+    for (int k = 0; k < 3; ++k) {
+      const uint32_t v = pTriangle[k];
+      vertexStamps[v]  = meshlet;
+      for (uint32_t a = adjacency.offsets[v]; a < adjacency.offsets[v + 1];
+           ++a) {
+        const uint32_t neighbour = adjacency.triangles[a];
+        if (!emitted[neighbour] && candidateStamps[neighbour] != meshlet) {
+          candidateStamps[neighbour] = meshlet;
+          candidates.push_back(neighbour);
+        }
+      }
+    }
+
+    // Drop emitted candidates and pick the best of the rest that fits the
+    // cone.
+    const Math::float3 center = centroidSum * (1.f / current.numTriangles);
+    next                      = -1;
+    int    bestNewVertices    = 4;
+    float  bestDistance       = 0.f;
+    size_t numCandidates      = 0;
+    for (uint32_t candidate : candidates) {
+      if (emitted[candidate]) continue;
+      candidates[numCandidates++] = candidate;
+      if (!fitsNormalCone(normals[candidate], normalSum)) continue;
+
+      const int candidateNewVertices = countNewVertices(
+          &pIndices[candidate * 3], vertexStamps, meshlet);
+      const Math::float3 d        = centroids[candidate] - center;
+      const float        distance = Math::dot(d, d);
+      if (candidateNewVertices < bestNewVertices ||
+          (candidateNewVertices == bestNewVertices &&
+              distance < bestDistance)) {
+        next            = candidate;
+        bestNewVertices = candidateNewVertices;
+        bestDistance    = distance;
+      }
+    }
+    candidates.resize(numCandidates);
+  }
+  meshlets.push_back(current);
+  return meshlets;
+}
+
+void optimizeMeshletVertexCache(uint32_t* pIndices, size_t numIndices,
+    const Meshlet* pMeshlets, size_t numMeshlets, size_t numVertices) {
+  // Each meshlet is optimized over its own small vertex numbering.
+  std::vector<uint32_t> localIds(numVertices, kUnusedVertex);
+  uint32_t              globalIds[kMaxMeshletVertices];
+  uint32_t              local[kMaxMeshletTriangles * 3];
+  uint32_t              optimized[kMaxMeshletTriangles * 3];
+  for (size_t m = 0; m < numMeshlets; ++m) {
+    const Meshlet& meshlet = pMeshlets[m];
+    uint32_t*      p       = &pIndices[meshlet.firstTriangle * 3];
+    const size_t   count   = meshlet.numTriangles * 3;
+    if (meshlet.numTriangles > kMaxMeshletTriangles ||
+        meshlet.numVertices > kMaxMeshletVertices ||
+        (meshlet.firstTriangle + meshlet.numTriangles) * 3 > numIndices) {
+      continue;
+    }
+
+    uint32_t numLocal = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if (localIds[p[i]] == kUnusedVertex) {
+        globalIds[numLocal] = p[i];
+        localIds[p[i]]      = numLocal++;
+      }
+      local[i] = localIds[p[i]];
+    }
+    optimizeVertexCache(optimized, local, count, numLocal);
+    for (size_t i = 0; i < count; ++i) {
+      p[i] = globalIds[optimized[i]];
+    }
+    for (uint32_t v = 0; v < numLocal; ++v) {
+      localIds[globalIds[v]] = kUnusedVertex;
+    }
+  }
+}
+
+MeshletBounds computeMeshletBounds(const uint32_t* pIndices,
+    const Meshlet& meshlet, const VertexStream& positions) {
+  const uint32_t* pFirst = &pIndices[meshlet.firstTriangle * 3];
+  const size_t    count  = meshlet.numTriangles * 3;
+
+  // Sphere around the bounding box center.
+  Math::float3 lo = streamPosition(positions, pFirst[0]);
+  Math::float3 hi = lo;
+  for (size_t i = 1; i < count; ++i) {
+    const Math::float3 p = streamPosition(positions, pFirst[i]);
+    lo = {std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z)};
+    hi = {std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z)};
+  }
+  MeshletBounds bounds;
+  bounds.center = (lo + hi) * 0.5f;
+  bounds.radius = 0.f;
+  for (size_t i = 0; i < count; ++i) {
+    bounds.radius = std::max(bounds.radius,
+        Math::length(streamPosition(positions, pFirst[i]) - bounds.center));
+  }
+
+  // Cone around the mean of the unit face normals.
+  Math::float3 normals[kMaxMeshletTriangles];
+  size_t       numNormals = 0;
+  Math::float3 sum        = {0.f, 0.f, 0.f};
+  for (size_t i = 0; i < count && numNormals < kMaxMeshletTriangles; i += 3) {
+    const Math::float3 n = triangleNormal(positions, &pFirst[i]);
+    if (n.x != 0.f || n.y != 0.f || n.z != 0.f) {
+      normals[numNormals] = n;
+      sum += normals[numNormals++];
+    }
+  }
+  bounds.coneAxis   = {0.f, 0.f, 1.f};
+  bounds.coneCutoff = 1.f;
+  const float sumLength = Math::length(sum);
+  if (numNormals > 0 && sumLength > 1e-6f) {
+    bounds.coneAxis = sum * (1.f / sumLength);
+    float minDot    = 1.f;
+    for (size_t i = 0; i < numNormals; ++i) {
+      minDot = std::min(minDot, Math::dot(normals[i], bounds.coneAxis));
+    }
+    if (minDot > 0.f) {
+      bounds.coneCutoff = sqrtf(1.f - minDot * minDot);
+    }
+  }
+  return bounds;
+}
@@ -0,0 +1,310 @@
+#include "MeshRegistry.hpp"
+
+#include "MeshFile.hpp"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace {
+
+// 64-bit multiply-rotate hash fed one word at a time, with a splitmix64
+// finalizer. Fields are fed one by one rather than as raw struct bytes,
+// since float3 and friends carry padding lanes with arbitrary contents.
+class ContentHasher {
+ public:
+  void add(uint64_t word) {
+    _h ^= word * 0x9E3779B97F4A7C15ull;
+    _h = ((_h << 31) | (_h >> 33)) * 0xBF58476D1CE4E5B9ull;
+  }
+  void add(float a, float b) {
+    uint32_t bits[2];
+    std::memcpy(&bits[0], &a, sizeof(float));
+    std::memcpy(&bits[1], &b, sizeof(float));
+    add(uint64_t(bits[0]) | uint64_t(bits[1]) << 32);
+  }
+  void add(const Math::float3& v) {
+    add(v.x, v.y);
+    add(v.z, 0.f);
+  }
+  void addBytes(const unsigned char* pData, size_t size) {
+    add(uint64_t(size));
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+      uint64_t word;
+      std::memcpy(&word, pData + i, 8);
+      add(word);
+    }
+    uint64_t tail = 0;
+    if (i < size) std::memcpy(&tail, pData + i, size - i);
+    add(tail);
+  }
+
+  uint64_t finish() const {
+    uint64_t h = _h;
+    h          = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h          = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+  }
+
+ private:
+  uint64_t _h = 0x243F6A8885A308D3ull;
+};
+
+bool sameBits(const Math::float3& a, const Math::float3& b) {
+  return std::memcmp(&a.x, &b.x, sizeof(float)) == 0 &&
+         std::memcmp(&a.y, &b.y, sizeof(float)) == 0 &&
+         std::memcmp(&a.z, &b.z, sizeof(float)) == 0;
+}
+
+// Whether two chains hold the same bytes in everything MeshKey::content
+// hashes. Padding is skipped, as in the hash.
+bool sameContent(const MeshLodChain& a, const MeshLodChain& b) {
+  if (a.vertexFormat != b.vertexFormat || a.indexType != b.indexType ||
+      a.vertices.size() != b.vertices.size() ||
+      a.quantizedVertices.size() != b.quantizedVertices.size() ||
+      a.quantizations.size() != b.quantizations.size() ||
+      a.indexData != b.indexData || a.lods.size() != b.lods.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.vertices.size(); ++i) {
+    if (!sameBits(a.vertices[i].position, b.vertices[i].position) ||
+        !sameBits(a.vertices[i].normal, b.vertices[i].normal)) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < a.quantizedVertices.size(); ++i) {
+    const shader_types::QuantizedVertexData& va = a.quantizedVertices[i];
+    const shader_types::QuantizedVertexData& vb = b.quantizedVertices[i];
+    if (std::memcmp(va.position, vb.position, sizeof(va.position)) != 0 ||
+        std::memcmp(va.normal, vb.normal, sizeof(va.normal)) != 0) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < a.quantizations.size(); ++i) {
+    if (!sameBits(a.quantizations[i].offset, b.quantizations[i].offset) ||
+        !sameBits(a.quantizations[i].scale, b.quantizations[i].scale)) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < a.lods.size(); ++i) {
+    const MeshLod& la = a.lods[i];
+    const MeshLod& lb = b.lods[i];
+    if (la.firstVertex != lb.firstVertex || la.numVertices != lb.numVertices ||
+        la.firstIndex != lb.firstIndex || la.numIndices != lb.numIndices) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+MeshKey MeshKey::generated(
+    std::string generator, std::initializer_list<double> params) {
+  MeshKey key;
+  key.generator = std::move(generator);
+  key.params    = params;
+  return key;
+}
+
+MeshKey MeshKey::content(const MeshLodChain& chain) {
+  ContentHasher hasher;
+  hasher.add(uint64_t(chain.vertexFormat) << 8 | uint64_t(chain.indexType));
+
+  hasher.add(uint64_t(chain.vertices.size()));
+  for (const shader_types::VertexData& v : chain.vertices) {
+    hasher.add(v.position);
+    hasher.add(v.normal);
+  }
+  hasher.add(uint64_t(chain.quantizedVertices.size()));
+  for (const shader_types::QuantizedVertexData& v : chain.quantizedVertices) {
+    hasher.add(uint64_t(v.position[0]) | uint64_t(v.position[1]) << 16 |
+               uint64_t(v.position[2]) << 32 |
+               uint64_t(uint16_t(v.normal[0])) << 48);
+    hasher.add(uint64_t(uint16_t(v.normal[1])));
+  }
+  for (const shader_types::VertexQuantization& q : chain.quantizations) {
+    hasher.add(q.offset);
+    hasher.add(q.scale);
+  }
+  hasher.addBytes(chain.indexData.data(), chain.indexData.size());
+
+  // Meshlets and their bounds follow from the levels' triangles.
+  for (const MeshLod& lod : chain.lods) {
+    hasher.add(uint64_t(lod.firstVertex) | uint64_t(lod.numVertices) << 32);
+    hasher.add(uint64_t(lod.firstIndex) | uint64_t(lod.numIndices) << 32);
+  }
+
+  MeshKey key;
+  key.contentHash = hasher.finish();
+  return key;
+}
+
+size_t MeshKey::hash() const {
+  ContentHasher hasher;
+  hasher.addBytes(
+      reinterpret_cast<const unsigned char*>(generator.data()),
+      generator.size());
+  for (double param : params) {
+    uint64_t bits;
+    std::memcpy(&bits, &param, sizeof(bits));
+    hasher.add(bits);
+  }
+  hasher.add(contentHash);
+  return size_t(hasher.finish());
+}
+
+MeshRegistry& MeshRegistry::shared() {
+  static MeshRegistry registry;
+  return registry;
+}
+
+MeshHandle MeshRegistry::acquire(
+    const MeshKey& key, const std::function<MeshLodChain()>& build) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto                  it = _meshes.find(key);
+    if (it != _meshes.end()) {
+      if (MeshHandle mesh = it->second.lock()) {
+        ++_stats.hits;
+        return mesh;
+      }
+    }
+  }
+
+  MeshHandle built = std::make_shared<const MeshLodChain>(build());
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::weak_ptr<const MeshLodChain>& entry = _meshes[key];
+  if (MeshHandle mesh = entry.lock()) {
+    ++_stats.hits;
+    return mesh;
+  }
+  entry = built;
+  ++_stats.builds;
+  dropExpired();
+  return built;
+}
+
+MeshHandle MeshRegistry::intern(MeshLodChain&& chain) {
+  const MeshKey key      = MeshKey::content(chain);
+  MeshHandle    interned = std::make_shared<const MeshLodChain>(
+      std::move(chain));
+  MeshHandle    registered;
+  {
+    std::lock_guard<std::mutex>        lock(_mutex);
+    std::weak_ptr<const MeshLodChain>& entry = _meshes[key];
+    registered                               = entry.lock();
+    if (!registered) {
+      entry = interned;
+      ++_stats.builds;
+      dropExpired();
+      return interned;
+    }
+  }
+
+  // Equal hashes; the contents are compared outside the lock. A chain that
+  // only collides with the registered one stays unshared.
+  const bool                  same = sameContent(*registered, *interned);
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (same) {
+    ++_stats.hits;
+    return registered;
+  }
+  ++_stats.builds;
+  return interned;
+}
+
+MeshHandle MeshRegistry::acquireSphereLods(VertexFormat vertexFormat) {
+  const std::string   name =
+      vertexFormat == VertexFormat::Float ? "sphere-lods-float"
+                                          : "sphere-lods-quantized";
+  // Everything the chain is built from, for the cache file name.
+  std::vector<double> buildParams = {double(vertexFormat), kSphereRadius,
+      kWeldEpsilon, kMeshletNormalCone, double(kMaxMeshletVertices),
+      double(kMaxMeshletTriangles)};
+  buildParams.insert(buildParams.end(), std::begin(kSphereLodStacks),
+      std::end(kSphereLodStacks));
+  return acquire(MeshKey::generated("sphere-lods", {double(vertexFormat)}),
+      [&] {
+        return buildCached(name, buildParams,
+            [&] { return createSphereLodChain(vertexFormat); });
+      });
+}
+
+void MeshRegistry::setCacheDirectory(std::string directory) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _cacheDirectory = std::move(directory);
+}
+
+MeshLodChain MeshRegistry::buildCached(const std::string& name,
+    const std::vector<double>&           buildParams,
+    const std::function<MeshLodChain()>& build) {
+  ContentHasher hasher;
+  hasher.add(uint64_t(kMeshCacheVersion) << 32 | kMeshFileVersion);
+  for (double param : buildParams) {
+    uint64_t bits;
+    std::memcpy(&bits, &param, sizeof(bits));
+    hasher.add(bits);
+  }
+  char fingerprint[17];
+  std::snprintf(
+      fingerprint, sizeof(fingerprint), "%016" PRIx64, hasher.finish());
+
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_cacheDirectory.empty()) return build();
+    path = _cacheDirectory + "/" + name + "-" + fingerprint + ".rmesh";
+  }
+
+  MeshFile file;
+  if (file.open(path.c_str())) {
+    MeshLodChain                chain = file.toChain();
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.cacheLoads;
+    return chain;
+  }
+  // A missing or corrupt file, or one from another version or build
+  // parameters (which has another name), is rebuilt. The new file is
+  // written under a temporary name and renamed into place, so readers
+  // never see it half written. If it cannot be written, only the build
+  // is lost.
+  MeshLodChain chain = build();
+  std::string  temp  = path + ".XXXXXX";
+  const int    fd    = mkstemp(&temp[0]);
+  if (fd >= 0) {
+    close(fd);
+    if (!writeMeshFile(temp.c_str(), chain) ||
+        std::rename(temp.c_str(), path.c_str()) != 0) {
+      std::remove(temp.c_str());
+    }
+  }
+  return chain;
+}
+
+void MeshRegistry::dropExpired() {
+  for (auto it = _meshes.begin(); it != _meshes.end();) {
+    it = it->second.expired() ? _meshes.erase(it) : std::next(it);
+  }
+}
+
+size_t MeshRegistry::numMeshes() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  size_t                      count = 0;
+  for (const auto& entry : _meshes) {
+    count += entry.second.expired() ? 0 : 1;
+  }
+  return count;
+}
+
+MeshRegistryStats MeshRegistry::stats() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _stats;
+}
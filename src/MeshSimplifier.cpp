@@ -0,0 +1,708 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Points (positions shared by one or more vertices) handed to each job.
+constexpr size_t kPointsPerJob = 4096;
+
+// Points per region. A region's points, triangles and heap stay within the
+// L2 cache while it is simplified.
+constexpr size_t kPointsPerRegion = 8192;
+
+// Most of its interior triangles a region may remove on its own. Region
+// borders keep their full density through the regional pass, so pushing
+// interiors much further would leave them coarser than the borders.
+constexpr double kMaxRegionalShare = 0.75;
+
+// Quadrics are accumulated in double: a collapse's error is a small
+// difference of large sums, and float cancellation would swamp the error
+// of fine meshes.
+struct Point {
+  double x, y, z;
+};
+
+Point operator-(const Point& a, const Point& b) {
+  return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+Point cross(const Point& a, const Point& b) {
+  return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+double dot(const Point& a, const Point& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// w * (dot(n, p) + d)^2 summed over planes, as the symmetric matrix
+// [A b; b^T c], and the summed weight w.
+struct Quadric {
+  double a00, a11, a22, a01, a02, a12;
+  double b0, b1, b2;
+  double c;
+  double w;
+};
+
+void addPlane(Quadric& q, const Point& n, double d, double w) {
+  q.a00 += w * n.x * n.x;
+  q.a11 += w * n.y * n.y;
+  q.a22 += w * n.z * n.z;
+  q.a01 += w * n.x * n.y;
+  q.a02 += w * n.x * n.z;
+  q.a12 += w * n.y * n.z;
+  q.b0 += w * n.x * d;
+  q.b1 += w * n.y * d;
+  q.b2 += w * n.z * d;
+  q.c += w * d * d;
+  q.w += w;
+}
+
+// Weighted mean squared distance from p to the planes of q.
+double quadricError(const Quadric& q, const Point& p) {
+  if (q.w <= 0.0) {
+    return 0.0;
+  }
+  const double rx = q.a00 * p.x + q.a01 * p.y + q.a02 * p.z;
+  const double ry = q.a01 * p.x + q.a11 * p.y + q.a12 * p.z;
+  const double rz = q.a02 * p.x + q.a12 * p.y + q.a22 * p.z;
+  const double r  = p.x * rx + p.y * ry + p.z * rz +
+                   2.0 * (p.x * q.b0 + p.y * q.b1 + p.z * q.b2) + q.c;
+  return std::fabs(r) / q.w;
+}
+
+void accumulate(Quadric& dst, const Quadric& src) {
+  dst.a00 += src.a00;
+  dst.a11 += src.a11;
+  dst.a22 += src.a22;
+  dst.a01 += src.a01;
+  dst.a02 += src.a02;
+  dst.a12 += src.a12;
+  dst.b0 += src.b0;
+  dst.b1 += src.b1;
+  dst.b2 += src.b2;
+  dst.c += src.c;
+  dst.w += src.w;
+}
+
+// Moving `from` onto `to`. Point versions only ever grow, so the sum of
+// both versions at costing time identifies the state it was costed in; a
+// later change to either point makes the entry stale.
+struct Collapse {
+  float    cost;
+  uint32_t from;
+  uint32_t to;
+  uint32_t version;
+};
+
+// Min-heap of collapses with four children per node: half the depth of a
+// binary heap, and siblings are compared within one or two cache lines.
+// The heap outgrows the caches on large meshes, so depth is what counts.
+class CollapseHeap {
+ public:
+  void assign(std::vector<Collapse>&& collapses) {
+    _nodes = std::move(collapses);
+    if (_nodes.size() < 2) return;
+    for (size_t i = (_nodes.size() - 2) / kArity + 1; i-- > 0;) {
+      siftDown(i);
+    }
+  }
+
+  bool            empty() const { return _nodes.empty(); }
+  const Collapse& top() const { return _nodes.front(); }
+
+  void push(const Collapse& collapse) {
+    size_t i = _nodes.size();
+    _nodes.push_back(collapse);
+    while (i > 0) {
+      const size_t parent = (i - 1) / kArity;
+      if (_nodes[parent].cost <= collapse.cost) break;
+      _nodes[i] = _nodes[parent];
+      i         = parent;
+    }
+    _nodes[i] = collapse;
+  }
+
+  void pop() {
+    _nodes.front() = _nodes.back();
+    _nodes.pop_back();
+    if (!_nodes.empty()) siftDown(0);
+  }
+
+ private:
+  static constexpr size_t kArity = 4;
+
+  std::vector<Collapse> _nodes;
+
+  void siftDown(size_t i) {
+    const Collapse collapse = _nodes[i];
+    for (;;) {
+      const size_t first = i * kArity + 1;
+      if (first >= _nodes.size()) break;
+      const size_t last     = std::min(first + kArity, _nodes.size());
+      size_t       smallest = first;
+      for (size_t child = first + 1; child < last; ++child) {
+        if (_nodes[child].cost < _nodes[smallest].cost) smallest = child;
+      }
+      if (_nodes[smallest].cost >= collapse.cost) break;
+      _nodes[i] = _nodes[smallest];
+      i         = smallest;
+    }
+    _nodes[i] = collapse;
+  }
+};
+
+// Spreads the low 10 bits of v to every third bit.
+uint32_t spreadBits(uint32_t v) {
+  v = (v | (v << 16)) & 0x030000ffu;
+  v = (v | (v << 8)) & 0x0300f00fu;
+  v = (v | (v << 4)) & 0x030c30c3u;
+  v = (v | (v << 2)) & 0x09249249u;
+  return v;
+}
+
+class Simplifier {
+ public:
+  Simplifier(const uint32_t* pIndices, size_t numIndices,
+      const VertexStream& positions, size_t numVertices,
+      const VertexStream* pAttributes);
+
+  void   build(JobSystem& jobSystem);
+  double simplify(
+      size_t targetIndexCount, double maxError, JobSystem& jobSystem);
+  size_t write(uint32_t* pDst) const;
+
+ private:
+  // Per-thread neighbor lists.
+  struct Scratch {
+    std::vector<uint32_t> from;
+    std::vector<uint32_t> to;
+  };
+
+  // The vertices of point p are _pointVertices[_pointVertexOffsets[p]]
+  // up to that of p + 1.
+  std::vector<uint32_t> _pointVertexOffsets;
+  std::vector<uint32_t> _pointVertices;
+  std::vector<Point>    _points;
+  std::vector<uint32_t> _corners;         // triangle corners as points
+  std::vector<uint32_t> _cornerVertices;  // triangle corners as vertices
+  std::vector<char>     _alive;
+  size_t                _numAlive;
+  VertexStream          _attributes;
+
+  std::vector<std::vector<uint32_t>> _triangles;  // point -> triangles
+  std::vector<Quadric>               _quadrics;
+  std::vector<uint32_t>              _versions;
+  std::vector<char>                  _locked;
+
+  // Points sorted along a Morton curve and cut into regions of
+  // kPointsPerRegion. A point is interior when its whole one-ring lies in
+  // its own region.
+  std::vector<uint32_t> _regionPoints;
+  std::vector<uint32_t> _regionOf;
+  std::vector<char>     _interior;
+
+  bool     isLocked(uint32_t p) const { return _locked[p] != 0; }
+  size_t   numVertices(uint32_t p) const {
+    return _pointVertexOffsets[p + 1] - _pointVertexOffsets[p];
+  }
+  void     neighbors(uint32_t p, std::vector<uint32_t>* pNeighbors) const;
+  bool     isSeamEdge(uint32_t p, uint32_t q) const;
+  bool     canMove(uint32_t from, uint32_t to) const;
+  bool     cheapestCollapse(
+      uint32_t p, uint32_t q, Collapse* pCollapse) const;
+  bool     canCollapse(uint32_t from, uint32_t to, Scratch& scratch) const;
+  uint32_t matchVertex(
+      uint32_t v, uint32_t to, const uint32_t (*pPairs)[2]) const;
+  size_t   collapse(uint32_t from, uint32_t to, bool regional,
+      CollapseHeap& heap, Scratch& scratch);
+  size_t   collapseHeap(CollapseHeap& heap, size_t budget, double maxError,
+      bool regional, Scratch& scratch, double* pError);
+  Point    triangleNormal(uint32_t t, uint32_t moved, const Point& p) const;
+};
+
+Simplifier::Simplifier(const uint32_t* pIndices, size_t numIndices,
+    const VertexStream& positions, size_t numVertices,
+    const VertexStream* pAttributes)
+    : _pointVertices(numVertices)
+    , _corners(numIndices)
+    , _cornerVertices(pIndices, pIndices + numIndices)
+    , _alive(numIndices / 3)
+    , _numAlive(0)
+    , _attributes(pAttributes ? *pAttributes : VertexStream{}) {
+  std::vector<uint32_t> pointOf(numVertices);
+  const VertexStream    position  = {positions.pData, positions.stride, 3};
+  const size_t          numPoints = generateWeldRemap(
+      pointOf.data(), &position, 1, numVertices);
+  _pointVertexOffsets.assign(numPoints + 1, 0);
+  _points.resize(numPoints);
+  for (size_t v = 0; v < numVertices; ++v) {
+    const uint32_t p = pointOf[v];
+    const float*   f = reinterpret_cast<const float*>(
+        reinterpret_cast<const unsigned char*>(positions.pData) +
+        v * positions.stride);
+    _points[p] = {f[0], f[1], f[2]};
+    ++_pointVertexOffsets[p + 1];
+  }
+  for (size_t p = 0; p < numPoints; ++p) {
+    _pointVertexOffsets[p + 1] += _pointVertexOffsets[p];
+  }
+  std::vector<uint32_t> next(
+      _pointVertexOffsets.begin(), _pointVertexOffsets.end() - 1);
+  for (size_t v = 0; v < numVertices; ++v) {
+    _pointVertices[next[pointOf[v]]++] = uint32_t(v);
+  }
+
+  remapIndices(_corners.data(), pIndices, numIndices, pointOf.data());
+  for (size_t t = 0; t < _alive.size(); ++t) {
+    const uint32_t* c = &_corners[t * 3];
+    _alive[t]         = c[0] != c[1] && c[1] != c[2] && c[0] != c[2];
+    _numAlive += _alive[t];
+  }
+}
+
+void Simplifier::build(JobSystem& jobSystem) {
+  const size_t numPoints = _points.size();
+
+  // Point -> triangle lists. Sizes are counted up front so every list is
+  // allocated once.
+  std::vector<uint32_t> counts(numPoints, 0);
+  for (size_t t = 0; t < _alive.size(); ++t) {
+    if (!_alive[t]) continue;
+    for (int k = 0; k < 3; ++k) ++counts[_corners[t * 3 + k]];
+  }
+  _triangles.resize(numPoints);
+  jobSystem.parallelFor(
+      numPoints, kPointsPerJob, [&](size_t first, size_t last) {
+        for (size_t p = first; p < last; ++p) {
+          _triangles[p].reserve(counts[p]);
+        }
+      });
+  for (size_t t = 0; t < _alive.size(); ++t) {
+    if (!_alive[t]) continue;
+    for (int k = 0; k < 3; ++k) {
+      _triangles[_corners[t * 3 + k]].push_back(uint32_t(t));
+    }
+  }
+
+  // Quadrics and locks. Each point sums its own triangles' planes, so
+  // points are independent and every job writes only its own range.
+  _quadrics.assign(numPoints, Quadric{});
+  _versions.assign(numPoints, 0);
+  _locked.assign(numPoints, 0);
+  jobSystem.parallelFor(
+      numPoints, kPointsPerJob, [&](size_t first, size_t last) {
+        std::vector<std::pair<uint32_t, int>> edges;
+        for (size_t p = first; p < last; ++p) {
+          edges.clear();
+          for (uint32_t t : _triangles[p]) {
+            const uint32_t* c = &_corners[t * 3];
+            const Point     n = cross(_points[c[1]] - _points[c[0]],
+                _points[c[2]] - _points[c[0]]);
+            const double    length = std::sqrt(dot(n, n));
+            if (length > 0.0) {
+              const Point unit = {n.x / length, n.y / length, n.z / length};
+              addPlane(_quadrics[p], unit, -dot(unit, _points[c[0]]),
+                  0.5 * length);
+            }
+
+            // Every edge around an interior point is shared by exactly two
+            // of its triangles.
+            for (int k = 0; k < 3; ++k) {
+              if (c[k] == p) continue;
+              auto it = std::find_if(edges.begin(), edges.end(),
+                  [&](const auto& e) { return e.first == c[k]; });
+              if (it == edges.end()) {
+                edges.push_back({c[k], 1});
+              } else {
+                ++it->second;
+              }
+            }
+          }
+          bool manifold = true;
+          for (const auto& edge : edges) {
+            manifold = manifold && edge.second == 2;
+          }
+          _locked[p] = !manifold;
+        }
+      });
+
+  // Regions: Morton order over the bounding box, then fixed-size runs.
+  Point lo = _points.empty() ? Point{} : _points[0];
+  Point hi = lo;
+  for (const Point& p : _points) {
+    lo = {std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z)};
+    hi = {std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z)};
+  }
+  const double extent = std::max({hi.x - lo.x, hi.y - lo.y, hi.z - lo.z});
+  const double scale  = extent > 0.0 ? 1023.0 / extent : 0.0;
+  std::vector<uint32_t> codes(numPoints);
+  jobSystem.parallelFor(
+      numPoints, kPointsPerJob, [&](size_t first, size_t last) {
+        for (size_t p = first; p < last; ++p) {
+          const Point& point = _points[p];
+          codes[p] = spreadBits(uint32_t((point.x - lo.x) * scale)) |
+                     spreadBits(uint32_t((point.y - lo.y) * scale)) << 1 |
+                     spreadBits(uint32_t((point.z - lo.z) * scale)) << 2;
+        }
+      });
+  _regionPoints.resize(numPoints);
+  for (size_t p = 0; p < numPoints; ++p) {
+    _regionPoints[p] = uint32_t(p);
+  }
+  std::sort(_regionPoints.begin(), _regionPoints.end(),
+      [&](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
+  _regionOf.resize(numPoints);
+  for (size_t i = 0; i < numPoints; ++i) {
+    _regionOf[_regionPoints[i]] = uint32_t(i / kPointsPerRegion);
+  }
+  _interior.assign(numPoints, 0);
+  jobSystem.parallelFor(
+      numPoints, kPointsPerJob, [&](size_t first, size_t last) {
+        for (size_t p = first; p < last; ++p) {
+          bool interior = true;
+          for (uint32_t t : _triangles[p]) {
+            for (int k = 0; k < 3; ++k) {
+              interior = interior &&
+                         _regionOf[_corners[t * 3 + k]] == _regionOf[p];
+            }
+          }
+          _interior[p] = interior;
+        }
+      });
+}
+
+void Simplifier::neighbors(
+    uint32_t p, std::vector<uint32_t>* pNeighbors) const {
+  pNeighbors->clear();
+  for (uint32_t t : _triangles[p]) {
+    if (!_alive[t]) continue;
+    for (int k = 0; k < 3; ++k) {
+      const uint32_t q = _corners[t * 3 + k];
+      if (q != p && std::find(pNeighbors->begin(), pNeighbors->end(), q) ==
+                        pNeighbors->end()) {
+        pNeighbors->push_back(q);
+      }
+    }
+  }
+}
+
+// Whether the two triangles on the edge p-q use different vertices at
+// either end, i.e. the edge runs along an attribute seam.
+bool Simplifier::isSeamEdge(uint32_t p, uint32_t q) const {
+  uint32_t vertices[2][2];
+  size_t   edgeTriangles = 0;
+  for (uint32_t t : _triangles[p]) {
+    if (!_alive[t]) continue;
+    const uint32_t* c = &_corners[t * 3];
+    const int       k = c[0] == q ? 0 : c[1] == q ? 1 : c[2] == q ? 2 : -1;
+    if (k < 0) continue;
+    if (edgeTriangles == 2) return false;
+    const int j = c[0] == p ? 0 : c[1] == p ? 1 : 2;
+    vertices[edgeTriangles][0] = _cornerVertices[t * 3 + j];
+    vertices[edgeTriangles][1] = _cornerVertices[t * 3 + k];
+    ++edgeTriangles;
+  }
+  return edgeTriangles == 2 && (vertices[0][0] != vertices[1][0] ||
+                                   vertices[0][1] != vertices[1][1]);
+}
+
+// Locked points never move. A point with several vertices moves only along
+// a seam edge onto another such point, as in meshoptimizer, so the seam
+// keeps its shape and every one of its vertices has a counterpart there.
+bool Simplifier::canMove(uint32_t from, uint32_t to) const {
+  if (isLocked(from)) return false;
+  if (numVertices(from) == 1) return true;
+  return numVertices(to) > 1 && !isLocked(to) && isSeamEdge(from, to);
+}
+
+// The cheaper direction of the edge p-q.
+bool Simplifier::cheapestCollapse(
+    uint32_t p, uint32_t q, Collapse* pCollapse) const {
+  const bool pq = canMove(p, q);
+  const bool qp = canMove(q, p);
+  if (!pq && !qp) {
+    return false;
+  }
+  // The merged point carries both quadrics wherever it ends up.
+  Quadric merged = _quadrics[p];
+  accumulate(merged, _quadrics[q]);
+  const double toQ = pq ? quadricError(merged, _points[q]) : HUGE_VAL;
+  const double toP = qp ? quadricError(merged, _points[p]) : HUGE_VAL;
+  if (toQ <= toP) {
+    *pCollapse = {float(toQ), p, q, _versions[p] + _versions[q]};
+  } else {
+    *pCollapse = {float(toP), q, p, _versions[q] + _versions[p]};
+  }
+  return true;
+}
+
+Point Simplifier::triangleNormal(
+    uint32_t t, uint32_t moved, const Point& p) const {
+  const uint32_t* c = &_corners[t * 3];
+  const Point&    a = c[0] == moved ? p : _points[c[0]];
+  const Point&    b = c[1] == moved ? p : _points[c[1]];
+  const Point&    d = c[2] == moved ? p : _points[c[2]];
+  return cross(b - a, d - a);
+}
+
+bool Simplifier::canCollapse(
+    uint32_t from, uint32_t to, Scratch& scratch) const {
+  // An interior edge borders exactly two triangles, and its endpoints must
+  // share exactly those two triangles' third vertices (the link
+  // condition); otherwise the collapse pinches the surface.
+  neighbors(from, &scratch.from);
+  neighbors(to, &scratch.to);
+  size_t shared = 0;
+  for (uint32_t q : scratch.from) {
+    shared += std::find(scratch.to.begin(), scratch.to.end(), q) !=
+              scratch.to.end();
+  }
+  if (shared != 2) {
+    return false;
+  }
+
+  size_t edgeTriangles = 0;
+  for (uint32_t t : _triangles[from]) {
+    if (!_alive[t]) continue;
+    const uint32_t* c = &_corners[t * 3];
+    if (c[0] == to || c[1] == to || c[2] == to) {
+      ++edgeTriangles;
+      continue;
+    }
+    const Point  before = triangleNormal(t, from, _points[from]);
+    const Point  after  = triangleNormal(t, from, _points[to]);
+    const double cosine = dot(before, after);
+    if (cosine <= 0.0 || cosine * cosine <= kMaxCollapseNormalTurn *
+                                                kMaxCollapseNormalTurn *
+                                                dot(before, before) *
+                                                dot(after, after)) {
+      return false;
+    }
+  }
+  return edgeTriangles == 2;
+}
+
+// The vertex at `to` that a corner using vertex v takes when its point
+// moves there. pPairs holds the vertices at either end of the collapsed
+// edge in its two triangles. A vertex on the edge takes its partner across
+// it; any other (around a point where more than two seams meet) takes the
+// vertex of `to` with the closest attributes.
+uint32_t Simplifier::matchVertex(
+    uint32_t v, uint32_t to, const uint32_t (*pPairs)[2]) const {
+  const uint32_t* pFirst = _pointVertices.data() + _pointVertexOffsets[to];
+  const uint32_t* pLast  = _pointVertices.data() +
+                          _pointVertexOffsets[to + 1];
+  if (pLast - pFirst == 1) return *pFirst;
+  const bool first  = pPairs[0][0] == v;
+  const bool second = pPairs[1][0] == v;
+  if (first != second || (first && pPairs[0][1] == pPairs[1][1])) {
+    return first ? pPairs[0][1] : pPairs[1][1];
+  }
+  if (!_attributes.pData) return pPairs[0][1];
+
+  auto attribute = [&](uint32_t vertex) {
+    return reinterpret_cast<const float*>(
+        reinterpret_cast<const unsigned char*>(_attributes.pData) +
+        vertex * _attributes.stride);
+  };
+  const float* a        = attribute(v);
+  uint32_t     best     = *pFirst;
+  float        bestDist = HUGE_VALF;
+  for (const uint32_t* pVertex = pFirst; pVertex != pLast; ++pVertex) {
+    const float* b    = attribute(*pVertex);
+    float        dist = 0.f;
+    for (size_t i = 0; i < _attributes.numFloats; ++i) {
+      dist += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    if (dist < bestDist) {
+      best     = *pVertex;
+      bestDist = dist;
+    }
+  }
+  return best;
+}
+
+// Returns the number of triangles removed. During the regional pass only
+// edges between interior points are queued again, which keeps every
+// region's writes inside its own points and triangles.
+size_t Simplifier::collapse(uint32_t from, uint32_t to, bool regional,
+    CollapseHeap& heap, Scratch& scratch) {
+  std::vector<uint32_t>& toTriangles = _triangles[to];
+  toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(),
+                        [&](uint32_t t) { return !_alive[t]; }),
+      toTriangles.end());
+
+  // Vertices at `from` and `to` in the two triangles the collapse removes;
+  // canCollapse() made sure there are exactly two.
+  uint32_t pairs[2][2];
+  size_t   removed = 0;
+  for (uint32_t t : _triangles[from]) {
+    if (!_alive[t]) continue;
+    const uint32_t* c = &_corners[t * 3];
+    const int       k = c[0] == to ? 0 : c[1] == to ? 1 : c[2] == to ? 2 : -1;
+    if (k < 0) continue;
+    const int j = c[0] == from ? 0 : c[1] == from ? 1 : 2;
+    pairs[removed][0] = _cornerVertices[t * 3 + j];
+    pairs[removed][1] = _cornerVertices[t * 3 + k];
+    _alive[t]         = false;
+    ++removed;
+  }
+  for (uint32_t t : _triangles[from]) {
+    if (!_alive[t]) continue;
+    uint32_t* c = &_corners[t * 3];
+    for (int k = 0; k < 3; ++k) {
+      if (c[k] != from) continue;
+      c[k]                      = to;
+      _cornerVertices[t * 3 + k] = matchVertex(
+          _cornerVertices[t * 3 + k], to, pairs);
+    }
+    toTriangles.push_back(t);
+  }
+  std::vector<uint32_t>().swap(_triangles[from]);
+
+  accumulate(_quadrics[to], _quadrics[from]);
+  ++_versions[from];
+  ++_versions[to];
+
+  // Only edges at `to` changed cost; the stale ones are dropped on pop.
+  neighbors(to, &scratch.to);
+  for (uint32_t q : scratch.to) {
+    Collapse next;
+    if ((!regional || _interior[q]) && cheapestCollapse(to, q, &next)) {
+      heap.push(next);
+    }
+  }
+  return removed;
+}
+
+size_t Simplifier::collapseHeap(CollapseHeap& heap, size_t budget,
+    double maxError, bool regional, Scratch& scratch, double* pError) {
+  size_t removed = 0;
+  while (removed < budget && !heap.empty()) {
+    const Collapse next = heap.top();
+    if (next.cost > maxError) {
+      break;
+    }
+    heap.pop();
+    if (next.version != _versions[next.from] + _versions[next.to] ||
+        !canCollapse(next.from, next.to, scratch)) {
+      continue;
+    }
+    removed += collapse(next.from, next.to, regional, heap, scratch);
+    *pError = std::max(*pError, double(next.cost));
+  }
+  return removed;
+}
+
+double Simplifier::simplify(
+    size_t targetIndexCount, double maxError, JobSystem& jobSystem) {
+  const size_t targetTriangles = targetIndexCount / 3;
+  if (_numAlive <= targetTriangles) {
+    return 0.0;
+  }
+
+  // Regional pass: every region removes its share of the triangles around
+  // its interior points, collapsing only edges between them. Regions never
+  // touch each other's points or triangles, so they run without locks.
+  const double share = std::min(
+      double(_numAlive - targetTriangles) / double(_numAlive),
+      kMaxRegionalShare);
+  const size_t numRegions = (_points.size() + kPointsPerRegion - 1) /
+                            kPointsPerRegion;
+  std::vector<size_t> removed(numRegions, 0);
+  std::vector<double> errors(numRegions, 0.0);
+  jobSystem.parallelFor(numRegions, 1, [&](size_t first, size_t last) {
+    Scratch scratch;
+    for (size_t region = first; region < last; ++region) {
+      const size_t begin = region * kPointsPerRegion;
+      const size_t end   = std::min(
+          begin + kPointsPerRegion, _regionPoints.size());
+
+      std::vector<Collapse> collapses;
+      size_t                corners = 0;
+      for (size_t i = begin; i < end; ++i) {
+        const uint32_t p = _regionPoints[i];
+        if (!_interior[p]) continue;
+        corners += _triangles[p].size();
+        neighbors(p, &scratch.to);
+        for (uint32_t q : scratch.to) {
+          Collapse collapse;
+          if (q > p && _interior[q] && cheapestCollapse(p, q, &collapse)) {
+            collapses.push_back(collapse);
+          }
+        }
+      }
+      CollapseHeap heap;
+      heap.assign(std::move(collapses));
+      removed[region] = collapseHeap(heap, size_t(share * corners / 3),
+          maxError, true, scratch, &errors[region]);
+    }
+  });
+  double error = 0.0;
+  for (size_t region = 0; region < numRegions; ++region) {
+    _numAlive -= removed[region];
+    error = std::max(error, errors[region]);
+  }
+
+  // Global pass over every edge left: region borders, and whatever the
+  // regions' shares missed, until the exact target.
+  if (_numAlive > targetTriangles) {
+    const size_t numPoints = _points.size();
+    const size_t numJobs   = (numPoints + kPointsPerJob - 1) / kPointsPerJob;
+    std::vector<std::vector<Collapse>> jobCollapses(numJobs);
+    jobSystem.parallelFor(
+        numPoints, kPointsPerJob, [&](size_t first, size_t last) {
+          std::vector<Collapse>& collapses =
+              jobCollapses[first / kPointsPerJob];
+          std::vector<uint32_t> adjacent;
+          for (size_t p = first; p < last; ++p) {
+            neighbors(uint32_t(p), &adjacent);
+            for (uint32_t q : adjacent) {
+              Collapse collapse;
+              if (q > p && cheapestCollapse(uint32_t(p), q, &collapse)) {
+                collapses.push_back(collapse);
+              }
+            }
+          }
+        });
+    std::vector<Collapse> collapses;
+    for (std::vector<Collapse>& job : jobCollapses) {
+      collapses.insert(collapses.end(), job.begin(), job.end());
+      std::vector<Collapse>().swap(job);
+    }
+    CollapseHeap heap;
+    heap.assign(std::move(collapses));
+    Scratch scratch;
+    _numAlive -= collapseHeap(heap, _numAlive - targetTriangles, maxError,
+        false, scratch, &error);
+  }
+  return error;
+}
+
+size_t Simplifier::write(uint32_t* pDst) const {
+  size_t numIndices = 0;
+  for (size_t t = 0; t < _alive.size(); ++t) {
+    if (!_alive[t]) continue;
+    for (size_t i = t * 3; i < t * 3 + 3; ++i) {
+      pDst[numIndices++] = _cornerVertices[i];
+    }
+  }
+  return numIndices;
+}
+
+}  // namespace
+
+SimplifyResult simplifyMesh(uint32_t* pDst, const uint32_t* pIndices,
+    size_t numIndices, const VertexStream& positions, size_t numVertices,
+    size_t targetIndexCount, float targetError, JobSystem& jobSystem,
+    const VertexStream* pAttributes) {
+  Simplifier simplifier(
+      pIndices, numIndices, positions, numVertices, pAttributes);
+  simplifier.build(jobSystem);
+  const double error = simplifier.simplify(
+      targetIndexCount, double(targetError) * targetError, jobSystem);
+  return {simplifier.write(pDst), float(std::sqrt(error))};
+}
@@ -1,7 +1,10 @@
 #include "MyMTKViewDelegate.hpp"
 
-MyMTKViewDelegate::MyMTKViewDelegate(MTL::Device* pDevice)
-    : MTK::ViewDelegate(), _pRenderer(new Renderer(pDevice)) {}
+MyMTKViewDelegate::MyMTKViewDelegate(MTL::Device* pDevice,
+    const InstanceGrid& grid, VertexFormat vertexFormat,
+    InstanceFormat instanceFormat)
+    : MTK::ViewDelegate()
+    , _pRenderer(new Renderer(pDevice, grid, vertexFormat, instanceFormat)) {}
 
 MyMTKViewDelegate::~MyMTKViewDelegate() { delete _pRenderer; }
 
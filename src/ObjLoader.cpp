@@ -0,0 +1,487 @@
+#include "ObjLoader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "MappedFile.hpp"
+
+using shader_types::VertexData;
+
+namespace {
+
+// Chunks are cut at line breaks roughly this far apart, with several per
+// thread so that uneven chunks even out.
+constexpr size_t kMinChunkBytes   = 1 << 20;
+constexpr size_t kChunksPerThread = 8;
+// Vertices built per job once the mesh is merged.
+constexpr size_t kVerticesPerJob = 64 * 1024;
+
+constexpr uint32_t kNoNormal = ~0u;
+constexpr uint64_t kEmptyKey = ~0ull;
+
+// Powers of ten up to the largest exact in double.
+constexpr double kPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+    1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+    1e21, 1e22};
+
+// '\r' counts as a blank so CRLF files parse like LF ones.
+inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool isDigit(char c) { return unsigned(c - '0') < 10; }
+
+inline const char* skipBlanks(const char* p, const char* end) {
+  while (p < end && isBlank(*p)) ++p;
+  return p;
+}
+
+// Decimal number with optional sign, fraction and exponent, without
+// allocating or consulting the locale. Up to 19 significant digits are
+// kept and scaled by an exact power of ten in double, so the float result
+// matches strtof() for anything an exporter writes. Returns nullptr if no
+// number starts at p.
+const char* parseFloat(const char* p, const char* end, float* pValue) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+  uint64_t mantissa    = 0;
+  int      significant = 0;
+  int      exponent    = 0;
+  bool     anyDigit    = false;
+  for (; p < end && isDigit(*p); ++p) {
+    anyDigit = true;
+    if (significant < 19) {
+      mantissa = mantissa * 10 + unsigned(*p - '0');
+      significant += mantissa != 0;
+    } else {
+      ++exponent;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && isDigit(*p); ++p) {
+      anyDigit = true;
+      if (significant < 19) {
+        mantissa = mantissa * 10 + unsigned(*p - '0');
+        significant += mantissa != 0;
+        --exponent;
+      }
+    }
+  }
+  if (!anyDigit) return nullptr;
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negativeExponent = false;
+    if (p < end && (*p == '-' || *p == '+')) negativeExponent = *p++ == '-';
+    if (p == end || !isDigit(*p)) return nullptr;
+    int value = 0;
+    for (; p < end && isDigit(*p); ++p) {
+      value = std::min(value * 10 + (*p - '0'), 100000);
+    }
+    exponent += negativeExponent ? -value : value;
+  }
+
+  double value = double(mantissa);
+  if (exponent < 0) {
+    value = exponent >= -22 ? value / kPow10[-exponent]
+                            : value * std::pow(10.0, exponent);
+  } else if (exponent > 0) {
+    value = exponent <= 22 ? value * kPow10[exponent]
+                           : value * std::pow(10.0, exponent);
+  }
+  *pValue = float(negative ? -value : value);
+  return p;
+}
+
+// Optionally negative integer, clamped far outside any valid index.
+const char* parseIndex(const char* p, const char* end, int64_t* pValue) {
+  bool negative = false;
+  if (p < end && *p == '-') negative = *p++ == '-';
+  if (p == end || !isDigit(*p)) return nullptr;
+  int64_t value = 0;
+  for (; p < end && isDigit(*p); ++p) {
+    value = std::min<int64_t>(value * 10 + (*p - '0'), int64_t(1) << 40);
+  }
+  *pValue = negative ? -value : value;
+  return p;
+}
+
+enum class Record { Position, Normal, Face, Other };
+
+// Classifies the line starting at p and moves p past its keyword.
+Record recordType(const char*& p, const char* eol) {
+  p = skipBlanks(p, eol);
+  if (eol - p >= 2 && p[0] == 'v' && isBlank(p[1])) {
+    p += 2;
+    return Record::Position;
+  }
+  if (eol - p >= 3 && p[0] == 'v' && p[1] == 'n' && isBlank(p[2])) {
+    p += 3;
+    return Record::Normal;
+  }
+  if (eol - p >= 2 && p[0] == 'f' && isBlank(p[1])) {
+    p += 2;
+    return Record::Face;
+  }
+  return Record::Other;
+}
+
+// Calls fn(line, eol) for every line of [begin, end).
+template <typename Fn>
+void forEachLine(const char* begin, const char* end, const Fn& fn) {
+  for (const char* line = begin; line < end;) {
+    const char* eol = static_cast<const char*>(
+        std::memchr(line, '\n', size_t(end - line)));
+    if (!eol) eol = end;
+    if (!fn(line, eol)) return;
+    line = eol + 1;
+  }
+}
+
+struct Chunk {
+  const char* begin;
+  const char* end;
+
+  // Counted in the first pass; the first* offsets are their prefix sums.
+  size_t positions = 0;
+  size_t normals   = 0;
+  size_t faces     = 0;
+  size_t firstPosition;
+  size_t firstNormal;
+
+  // Triangle corners, three per triangle. After local deduplication
+  // `corners` holds indices into `keys` instead of positions.
+  std::vector<uint32_t> corners;
+  std::vector<uint32_t> cornerNormals;  // kNoNormal where none was given
+  std::vector<uint64_t> keys;           // position << 32 | normal
+  std::vector<uint32_t> keyVertices;    // global vertex of every key
+  bool                  anyNormal  = false;
+  bool                  anyMissing = false;
+  bool                  sameIndex  = true;  // normal index == position index
+
+  const char* pErrorLine = nullptr;
+  const char* error      = nullptr;
+};
+
+// Open-addressing table from 64-bit keys to dense ids, in order of first
+// insertion.
+class KeyTable {
+ public:
+  explicit KeyTable(size_t maxKeys) {
+    size_t capacity = 16;
+    while (capacity < maxKeys * 2) capacity *= 2;
+    _slots.assign(capacity, kEmptyKey);
+    _ids.resize(capacity);
+  }
+
+  // Returns the key's id, adding it to *pKeys if it is new.
+  uint32_t insert(uint64_t key, std::vector<uint64_t>* pKeys) {
+    const size_t mask = _slots.size() - 1;
+    size_t       slot = size_t((key * 0x9E3779B97F4A7C15ull) >> 20) & mask;
+    while (_slots[slot] != kEmptyKey) {
+      if (_slots[slot] == key) return _ids[slot];
+      slot = (slot + 1) & mask;
+    }
+    _slots[slot] = key;
+    _ids[slot]   = uint32_t(pKeys->size());
+    pKeys->push_back(key);
+    return _ids[slot];
+  }
+
+ private:
+  std::vector<uint64_t> _slots;
+  std::vector<uint32_t> _ids;
+};
+
+void countChunk(Chunk* pChunk) {
+  forEachLine(pChunk->begin, pChunk->end, [&](const char* p, const char* eol) {
+    switch (recordType(p, eol)) {
+      case Record::Position: ++pChunk->positions; break;
+      case Record::Normal: ++pChunk->normals; break;
+      case Record::Face: ++pChunk->faces; break;
+      default: break;
+    }
+    return true;
+  });
+}
+
+// Parses a chunk's records. Positions and normals go straight to their
+// global slots; faces are fanned into the chunk's corner lists.
+void parseChunk(Chunk* pChunk, size_t numPositions, size_t numNormals,
+    Math::float3* pPositions, Math::float3* pNormals) {
+  Chunk& chunk        = *pChunk;
+  size_t nextPosition = chunk.firstPosition;
+  size_t nextNormal   = chunk.firstNormal;
+  chunk.corners.reserve(chunk.faces * 3);
+  chunk.cornerNormals.reserve(chunk.faces * 3);
+
+  auto fail = [&](const char* line, const char* error) {
+    chunk.pErrorLine = line;
+    chunk.error      = error;
+    return false;
+  };
+  auto parseVector = [&](const char* p, const char* eol, Math::float3* pOut) {
+    for (int c = 0; c < 3; ++c) {
+      p = parseFloat(skipBlanks(p, eol), eol, &(&pOut->x)[c]);
+      if (!p) return false;
+    }
+    return true;
+  };
+  // OBJ indices count from 1; negative ones count back from the last
+  // record read so far.
+  auto resolve = [](int64_t index, size_t next, size_t count, uint32_t* pOut) {
+    const int64_t resolved = index > 0 ? index - 1 : int64_t(next) + index;
+    if (index == 0 || resolved < 0 || resolved >= int64_t(count)) return false;
+    *pOut = uint32_t(resolved);
+    return true;
+  };
+
+  forEachLine(chunk.begin, chunk.end, [&](const char* line, const char* eol) {
+    const char* p = line;
+    switch (recordType(p, eol)) {
+      case Record::Position:
+        if (!parseVector(p, eol, &pPositions[nextPosition++])) {
+          return fail(line, "malformed vertex position");
+        }
+        return true;
+      case Record::Normal:
+        if (!parseVector(p, eol, &pNormals[nextNormal++])) {
+          return fail(line, "malformed vertex normal");
+        }
+        return true;
+      case Record::Face: break;
+      default: return true;
+    }
+
+    // v, v/vt, v//vn or v/vt/vn per corner. The corners are fanned from
+    // the first one, each triangle reversed.
+    uint32_t firstPosition = 0, firstNormal = 0;
+    uint32_t lastPosition = 0, lastNormal = 0;
+    int      numCorners = 0;
+    for (p = skipBlanks(p, eol); p < eol; p = skipBlanks(p, eol)) {
+      int64_t  index;
+      uint32_t position, normal = kNoNormal;
+      if (!(p = parseIndex(p, eol, &index)) ||
+          !resolve(index, nextPosition, numPositions, &position)) {
+        return fail(line, "bad face position index");
+      }
+      if (p < eol && *p == '/') {
+        ++p;
+        if (p < eol && *p != '/') {
+          if (!(p = parseIndex(p, eol, &index))) {
+            return fail(line, "bad face texture coordinate index");
+          }
+        }
+        if (p < eol && *p == '/') {
+          if (!(p = parseIndex(p + 1, eol, &index)) ||
+              !resolve(index, nextNormal, numNormals, &normal)) {
+            return fail(line, "bad face normal index");
+          }
+        }
+      }
+      if (p < eol && !isBlank(*p)) return fail(line, "malformed face");
+
+      chunk.anyNormal  = chunk.anyNormal || normal != kNoNormal;
+      chunk.anyMissing = chunk.anyMissing || normal == kNoNormal;
+      chunk.sameIndex  = chunk.sameIndex && normal == position;
+      if (numCorners == 0) {
+        firstPosition = position;
+        firstNormal   = normal;
+      } else if (numCorners >= 2) {
+        chunk.corners.insert(
+            chunk.corners.end(), {firstPosition, position, lastPosition});
+        chunk.cornerNormals.insert(
+            chunk.cornerNormals.end(), {firstNormal, normal, lastNormal});
+      }
+      lastPosition = position;
+      lastNormal   = normal;
+      ++numCorners;
+    }
+    if (numCorners < 3) return fail(line, "face with fewer than 3 vertices");
+    return true;
+  });
+}
+
+// Deduplicates a chunk's (position, normal) pairs, turning its corners
+// into indices into chunk.keys.
+void dedupChunk(Chunk* pChunk) {
+  Chunk&   chunk = *pChunk;
+  KeyTable table(chunk.corners.size());
+  for (size_t i = 0; i < chunk.corners.size(); ++i) {
+    chunk.corners[i] = table.insert(
+        uint64_t(chunk.corners[i]) << 32 | chunk.cornerNormals[i],
+        &chunk.keys);
+  }
+  chunk.cornerNormals = {};
+}
+
+}  // namespace
+
+bool parseObj(const char* pText, size_t size, JobSystem& jobSystem,
+    std::vector<VertexData>* pVertices, std::vector<uint32_t>* pIndices,
+    std::string* pError, ObjStats* pStats) {
+  // Cut at line breaks.
+  const size_t chunkBytes = std::max(kMinChunkBytes,
+      size / (size_t(jobSystem.numThreads()) * kChunksPerThread) + 1);
+  std::vector<Chunk> chunks;
+  const char* const pEnd = pText + size;
+  for (const char* begin = pText; begin < pEnd;) {
+    const char* end = begin + std::min(chunkBytes, size_t(pEnd - begin));
+    if (end < pEnd) {
+      const char* eol = static_cast<const char*>(
+          std::memchr(end, '\n', size_t(pEnd - end)));
+      end = eol ? eol + 1 : pEnd;
+    }
+    chunks.emplace_back();
+    chunks.back().begin = begin;
+    chunks.back().end   = end;
+    begin               = end;
+  }
+
+  jobSystem.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; ++c) countChunk(&chunks[c]);
+  });
+  size_t numPositions = 0, numNormals = 0, numFaces = 0;
+  for (Chunk& chunk : chunks) {
+    chunk.firstPosition = numPositions;
+    chunk.firstNormal   = numNormals;
+    numPositions += chunk.positions;
+    numNormals += chunk.normals;
+    numFaces += chunk.faces;
+  }
+
+  std::vector<Math::float3> positions(numPositions);
+  std::vector<Math::float3> normals(numNormals);
+  jobSystem.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; ++c) {
+      parseChunk(&chunks[c], numPositions, numNormals, positions.data(),
+          normals.data());
+    }
+  });
+
+  bool   anyNormal = false, anyMissing = false, sameIndex = true;
+  size_t numCorners = 0;
+  for (const Chunk& chunk : chunks) {
+    if (chunk.error) {
+      if (pError) {
+        const size_t line = 1 + size_t(std::count(
+                                    pText, chunk.pErrorLine, '\n'));
+        *pError = "line " + std::to_string(line) + ": " + chunk.error;
+      }
+      return false;
+    }
+    anyNormal  = anyNormal || chunk.anyNormal;
+    anyMissing = anyMissing || chunk.anyMissing;
+    sameIndex  = sameIndex && chunk.sameIndex;
+    numCorners += chunk.corners.size();
+  }
+
+  // Corners without a normal take the area-weighted average of the OBJ
+  // face normals around their position; triangles are stored reversed,
+  // so those are cross(c - a, b - a). Positions no face uses, as in a
+  // file without faces, keep a zero normal.
+  std::vector<Math::float3> smoothNormals;
+  if (anyMissing || !anyNormal) {
+    smoothNormals.assign(numPositions, Math::float3{0.f, 0.f, 0.f});
+    for (const Chunk& chunk : chunks) {
+      for (size_t i = 0; i < chunk.corners.size(); i += 3) {
+        const uint32_t*    t = &chunk.corners[i];
+        const Math::float3 n = Math::cross(positions[t[2]] - positions[t[0]],
+            positions[t[1]] - positions[t[0]]);
+        for (int k = 0; k < 3; ++k) smoothNormals[t[k]] += n;
+      }
+    }
+    jobSystem.parallelFor(numPositions, kVerticesPerJob,
+        [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            const float length = Math::length(smoothNormals[i]);
+            if (length > 0.f) smoothNormals[i] = smoothNormals[i] / length;
+          }
+        });
+  }
+
+  std::vector<size_t> firstCorner(chunks.size());
+  for (size_t c = 0, offset = 0; c < chunks.size(); ++c) {
+    firstCorner[c] = offset;
+    offset += chunks[c].corners.size();
+  }
+  pIndices->resize(numCorners);
+
+  if (!anyNormal || (sameIndex && !anyMissing && numNormals >= numPositions)) {
+    // Every position carries one normal, so vertices are the positions.
+    jobSystem.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; ++c) {
+        std::copy(chunks[c].corners.begin(), chunks[c].corners.end(),
+            pIndices->begin() + firstCorner[c]);
+      }
+    });
+    pVertices->resize(numPositions);
+    const std::vector<Math::float3>& vertexNormals = anyNormal ? normals
+                                                               : smoothNormals;
+    jobSystem.parallelFor(numPositions, kVerticesPerJob,
+        [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            (*pVertices)[i] = {positions[i], vertexNormals[i]};
+          }
+        });
+  } else {
+    // Deduplicate within chunks in parallel, then merge the chunks' far
+    // fewer distinct keys in order.
+    jobSystem.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; ++c) dedupChunk(&chunks[c]);
+    });
+    size_t numChunkKeys = 0;
+    for (const Chunk& chunk : chunks) numChunkKeys += chunk.keys.size();
+    KeyTable              table(numChunkKeys);
+    std::vector<uint64_t> keys;
+    keys.reserve(numChunkKeys);
+    for (Chunk& chunk : chunks) {
+      chunk.keyVertices.resize(chunk.keys.size());
+      for (size_t k = 0; k < chunk.keys.size(); ++k) {
+        chunk.keyVertices[k] = table.insert(chunk.keys[k], &keys);
+      }
+    }
+
+    jobSystem.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; ++c) {
+        const Chunk& chunk    = chunks[c];
+        uint32_t*    pCorners = pIndices->data() + firstCorner[c];
+        for (size_t i = 0; i < chunk.corners.size(); ++i) {
+          pCorners[i] = chunk.keyVertices[chunk.corners[i]];
+        }
+      }
+    });
+    pVertices->resize(keys.size());
+    jobSystem.parallelFor(keys.size(), kVerticesPerJob,
+        [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            const uint32_t position = uint32_t(keys[i] >> 32);
+            const uint32_t normal   = uint32_t(keys[i]);
+            const Math::float3& n = normal == kNoNormal
+                                        ? smoothNormals[position]
+                                        : normals[normal];
+            (*pVertices)[i]       = {positions[position], n};
+          }
+        });
+  }
+
+  if (pStats) {
+    *pStats = {numPositions, numNormals, numFaces, chunks.size(), anyMissing};
+  }
+  return true;
+}
+
+std::unique_ptr<ObjMesh> ObjMesh::load(const char* path, JobSystem& jobSystem,
+    std::string* pError, ObjStats* pStats) {
+  MappedFile file;
+  if (!file.open(path, pError)) return nullptr;
+
+  std::vector<VertexData> vertices;
+  std::vector<uint32_t>   indices;
+  std::string             error;
+  if (!parseObj(file.data(), file.size(), jobSystem, &vertices, &indices,
+          &error, pStats)) {
+    if (pError) *pError = std::string(path) + ": " + error;
+    return nullptr;
+  }
+  return std::make_unique<ObjMesh>(std::move(vertices), std::move(indices));
+}
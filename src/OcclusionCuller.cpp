@@ -0,0 +1,198 @@
+#include "OcclusionCuller.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if !defined(MATH_FORCE_SCALAR) && (defined(__AVX2__) || defined(__SSE4_1__))
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr float kFarDepth = std::numeric_limits<float>::infinity();
+
+// Spheres this close to the eye plane are neither used as occluders nor
+// culled; their projection is unbounded.
+constexpr float kMinDepth = 1e-3f;
+
+// depth[i] = min(depth[i], value) for i in [0, count).
+void minDepthRow(float* pDepth, size_t count, float value) {
+  size_t i = 0;
+#if !defined(MATH_FORCE_SCALAR) && defined(__AVX2__)
+  const __m256 v8 = _mm256_set1_ps(value);
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_ps(pDepth + i, _mm256_min_ps(_mm256_loadu_ps(pDepth + i), v8));
+  }
+#endif
+#if !defined(MATH_FORCE_SCALAR) && (defined(__AVX2__) || defined(__SSE4_1__))
+  const __m128 v4 = _mm_set1_ps(value);
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(pDepth + i, _mm_min_ps(_mm_loadu_ps(pDepth + i), v4));
+  }
+#endif
+  for (; i < count; ++i) {
+    pDepth[i] = std::min(pDepth[i], value);
+  }
+}
+
+// dst[i] = max(a[2i], a[2i+1], b[2i], b[2i+1]), repeating the last column
+// when the source width is odd.
+void reduceRow(const float* pA, const float* pB, uint32_t srcWidth,
+    float* pDst, uint32_t dstWidth) {
+  for (uint32_t x = 0; x < dstWidth; ++x) {
+    const uint32_t x0 = 2 * x;
+    const uint32_t x1 = std::min(x0 + 1, srcWidth - 1);
+    pDst[x] = std::max(std::max(pA[x0], pA[x1]), std::max(pB[x0], pB[x1]));
+  }
+}
+
+}  // namespace
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+    : _width(width), _height(height), _clipFromModel(Math::makeIdentity()) {
+  uint32_t w = width;
+  uint32_t h = height;
+  for (;;) {
+    _levels.push_back({w, h, std::vector<float>(size_t(w) * h, kFarDepth)});
+    if (w == 1 && h == 1) break;
+    w = std::max(1u, (w + 1) / 2);
+    h = std::max(1u, (h + 1) / 2);
+  }
+}
+
+void OcclusionCuller::beginFrame(const Math::float4x4& clipFromModel) {
+  _clipFromModel = clipFromModel;
+  std::fill(_levels[0].depth.begin(), _levels[0].depth.end(), kFarDepth);
+}
+
+// Projects a sphere to a level-0 pixel rectangle. With `outer` the
+// rectangle bounds the whole sphere and *pDepth is its nearest depth;
+// otherwise it is the square inscribed in the projection of the sphere's
+// cross-section at its center, and *pDepth is the center depth.
+bool OcclusionCuller::project(float x, float y, float z, float radius,
+    bool outer, ScreenRect* pRect, float* pDepth) const {
+  const Math::float4x4& m    = _clipFromModel;
+  const Math::float4    clip = m * Math::float4{x, y, z, 1.f};
+
+  // Scale of each clip row: the perspective's focal lengths, and 1 for w
+  // under a rigid model-view transform.
+  auto rowScale = [&m](int r) {
+    return Math::length(Math::float3{(&m.columns[0].x)[r],
+        (&m.columns[1].x)[r], (&m.columns[2].x)[r]});
+  };
+  const float xs = rowScale(0);
+  const float ys = rowScale(1);
+  const float wr = radius * rowScale(3);
+
+  float extentX;
+  float extentY;
+  if (outer) {
+    *pDepth = clip.w - wr;
+    if (*pDepth < kMinDepth) return false;
+    // |d(x/w)| <= (xs * r + |x| * r / w) / (w - r) over the sphere.
+    extentX = (xs * radius + fabsf(clip.x) * wr / clip.w) / *pDepth;
+    extentY = (ys * radius + fabsf(clip.y) * wr / clip.w) / *pDepth;
+  } else {
+    *pDepth = clip.w;
+    if (clip.w < kMinDepth) return false;
+    const float invSqrt2 = 0.70710678f;
+    extentX              = xs * radius * invSqrt2 / clip.w;
+    extentY              = ys * radius * invSqrt2 / clip.w;
+  }
+
+  const float centerX = clip.x / clip.w;
+  const float centerY = clip.y / clip.w;
+  const float scaleX  = 0.5f * _width;
+  const float scaleY  = 0.5f * _height;
+  pRect->minX         = (centerX - extentX + 1.f) * scaleX;
+  pRect->maxX         = (centerX + extentX + 1.f) * scaleX;
+  pRect->minY         = (1.f - centerY - extentY) * scaleY;
+  pRect->maxY         = (1.f - centerY + extentY) * scaleY;
+  return true;
+}
+
+void OcclusionCuller::fillRect(int x0, int y0, int x1, int y1, float depth) {
+  float* pDepth = _levels[0].depth.data();
+  for (int y = y0; y < y1; ++y) {
+    minDepthRow(pDepth + size_t(y) * _width + x0, size_t(x1 - x0), depth);
+  }
+}
+
+void OcclusionCuller::addOccluders(
+    const SphereBounds& occluders, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    ScreenRect rect;
+    float      depth;
+    if (!project(occluders.pX[i], occluders.pY[i], occluders.pZ[i],
+            occluders.pRadius[i], false, &rect, &depth)) {
+      continue;
+    }
+    // Only pixels the square covers completely.
+    const int x0 = std::max(int(std::ceil(rect.minX)), 0);
+    const int y0 = std::max(int(std::ceil(rect.minY)), 0);
+    const int x1 = std::min(int(std::floor(rect.maxX)), int(_width));
+    const int y1 = std::min(int(std::floor(rect.maxY)), int(_height));
+    if (x0 < x1 && y0 < y1) {
+      fillRect(x0, y0, x1, y1, depth);
+    }
+  }
+}
+
+void OcclusionCuller::buildHierarchy() {
+  for (size_t l = 1; l < _levels.size(); ++l) {
+    const Level& src = _levels[l - 1];
+    Level&       dst = _levels[l];
+    for (uint32_t y = 0; y < dst.height; ++y) {
+      const uint32_t y0 = 2 * y;
+      const uint32_t y1 = std::min(y0 + 1, src.height - 1);
+      reduceRow(&src.depth[size_t(y0) * src.width],
+          &src.depth[size_t(y1) * src.width], src.width,
+          &dst.depth[size_t(y) * dst.width], dst.width);
+    }
+  }
+}
+
+size_t OcclusionCuller::cullSpheres(const SphereBounds& bounds, size_t count,
+    const uint32_t* pIndices, uint32_t* pVisible) const {
+  size_t numVisible = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t index = pIndices[i];
+
+    ScreenRect rect;
+    float      nearest;
+    bool       occluded = false;
+    if (project(bounds.pX[i], bounds.pY[i], bounds.pZ[i], bounds.pRadius[i],
+            true, &rect, &nearest)) {
+      const int x0 = std::max(int(std::floor(rect.minX)), 0);
+      const int y0 = std::max(int(std::floor(rect.minY)), 0);
+      const int x1 = std::min(int(std::ceil(rect.maxX)), int(_width)) - 1;
+      const int y1 = std::min(int(std::ceil(rect.maxY)), int(_height)) - 1;
+      if (x0 <= x1 && y0 <= y1) {
+        // Coarsest level at which the rectangle spans at most 2x2 texels.
+        size_t level = 0;
+        while (level + 1 < _levels.size() &&
+               ((x1 >> level) - (x0 >> level) > 1 ||
+                   (y1 >> level) - (y0 >> level) > 1)) {
+          ++level;
+        }
+        float farthest = 0.f;
+        for (int y = y0 >> level; y <= y1 >> level; ++y) {
+          for (int x = x0 >> level; x <= x1 >> level; ++x) {
+            farthest = std::max(farthest, depthAt(level, x, y));
+          }
+        }
+        occluded = nearest > farthest;
+      }
+    }
+    if (!occluded) {
+      pVisible[numVisible++] = index;
+    }
+  }
+  return numVisible;
+}
+
+float OcclusionCuller::depthAt(size_t level, uint32_t x, uint32_t y) const {
+  const Level& l = _levels[level];
+  return l.depth[size_t(y) * l.width + x];
+}
@@ -0,0 +1,445 @@
+#include "PlyReader.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+using shader_types::VertexData;
+
+namespace {
+
+// Vertices and triangles handed to the consumer per call.
+constexpr size_t kVerticesPerChunk  = 64 * 1024;
+constexpr size_t kTrianglesPerChunk = 64 * 1024;
+// Headers are a few hundred bytes; anything longer is not a PLY file.
+constexpr size_t kMaxHeaderBytes = 64 * 1024;
+
+enum class ScalarType {
+  Int8,
+  UInt8,
+  Int16,
+  UInt16,
+  Int32,
+  UInt32,
+  Float,
+  Double
+};
+
+bool parseScalarType(const std::string& name, ScalarType* pType) {
+  static const struct {
+    const char* name;
+    ScalarType  type;
+  } kNames[] = {{"char", ScalarType::Int8}, {"int8", ScalarType::Int8},
+      {"uchar", ScalarType::UInt8}, {"uint8", ScalarType::UInt8},
+      {"short", ScalarType::Int16}, {"int16", ScalarType::Int16},
+      {"ushort", ScalarType::UInt16}, {"uint16", ScalarType::UInt16},
+      {"int", ScalarType::Int32}, {"int32", ScalarType::Int32},
+      {"uint", ScalarType::UInt32}, {"uint32", ScalarType::UInt32},
+      {"float", ScalarType::Float}, {"float32", ScalarType::Float},
+      {"double", ScalarType::Double}, {"float64", ScalarType::Double}};
+  for (const auto& entry : kNames) {
+    if (name == entry.name) {
+      *pType = entry.type;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t scalarSize(ScalarType type) {
+  switch (type) {
+    case ScalarType::Int8:
+    case ScalarType::UInt8: return 1;
+    case ScalarType::Int16:
+    case ScalarType::UInt16: return 2;
+    case ScalarType::Int32:
+    case ScalarType::UInt32:
+    case ScalarType::Float: return 4;
+    case ScalarType::Double: return 8;
+  }
+  return 0;
+}
+
+template <typename T>
+T load(const char* p) {
+  T value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// Binary little-endian, as is every target this builds for.
+double readScalar(const char* p, ScalarType type) {
+  switch (type) {
+    case ScalarType::Int8: return load<int8_t>(p);
+    case ScalarType::UInt8: return load<uint8_t>(p);
+    case ScalarType::Int16: return load<int16_t>(p);
+    case ScalarType::UInt16: return load<uint16_t>(p);
+    case ScalarType::Int32: return load<int32_t>(p);
+    case ScalarType::UInt32: return load<uint32_t>(p);
+    case ScalarType::Float: return load<float>(p);
+    case ScalarType::Double: return load<double>(p);
+  }
+  return 0.0;
+}
+
+struct Property {
+  std::string name;
+  bool        isList;
+  ScalarType  countType;  // lists only
+  ScalarType  type;
+};
+
+struct Element {
+  std::string           name;
+  size_t                count;
+  std::vector<Property> properties;
+};
+
+// Sequential reads through a fixed buffer.
+class Window {
+ public:
+  Window(int fd, size_t capacity) : _fd(fd), _buffer(capacity) {}
+
+  // Makes at least `n` bytes available at data(). Returns false if the
+  // file ends first, n exceeds the capacity, or reading fails.
+  bool ensure(size_t n) {
+    if (_end - _begin >= n) return true;
+    if (n > _buffer.size()) return false;
+    std::memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+    _end -= _begin;
+    _begin = 0;
+    while (_end < n) {
+      const ssize_t bytes = ::read(
+          _fd, _buffer.data() + _end, _buffer.size() - _end);
+      if (bytes < 0 && errno == EINTR) continue;
+      if (bytes <= 0) {
+        _failed = bytes < 0;
+        return false;
+      }
+      _end += size_t(bytes);
+    }
+    return true;
+  }
+
+  const char* data() const { return _buffer.data() + _begin; }
+  size_t      available() const { return _end - _begin; }
+  size_t      capacity() const { return _buffer.size(); }
+  void        consume(size_t n) { _begin += n; }
+  bool        failed() const { return _failed; }
+
+ private:
+  int               _fd;
+  std::vector<char> _buffer;
+  size_t            _begin  = 0;
+  size_t            _end    = 0;
+  bool              _failed = false;
+};
+
+// Reads the header up to and including "end_header\n".
+bool parseHeader(Window* pWindow, std::vector<Element>* pElements,
+    std::string* pError) {
+  size_t headerBytes = 0;
+  for (;;) {
+    if (!pWindow->ensure(headerBytes + 1) || headerBytes >= kMaxHeaderBytes) {
+      *pError = "truncated or oversized header";
+      return false;
+    }
+    const char* pEnd = static_cast<const char*>(std::memchr(
+        pWindow->data() + headerBytes, '\n',
+        pWindow->available() - headerBytes));
+    headerBytes = pEnd ? size_t(pEnd - pWindow->data()) + 1
+                       : pWindow->available();
+    // The line may end in "\r\n".
+    const char* pLine = pEnd;
+    if (pLine && pLine > pWindow->data() && pLine[-1] == '\r') --pLine;
+    if (pLine && size_t(pLine - pWindow->data()) >= 10 &&
+        std::memcmp(pLine - 10, "end_header", 10) == 0) {
+      break;
+    }
+  }
+  std::istringstream header(std::string(pWindow->data(), headerBytes));
+  pWindow->consume(headerBytes);
+
+  std::string line, keyword;
+  bool        haveFormat = false;
+  std::getline(header, line);
+  if (line != "ply" && line != "ply\r") {
+    *pError = "not a PLY file";
+    return false;
+  }
+  while (std::getline(header, line)) {
+    std::istringstream words(line);
+    if (!(words >> keyword) || keyword == "comment" || keyword == "obj_info") {
+      continue;
+    }
+    if (keyword == "format") {
+      std::string format;
+      words >> format;
+      if (format != "binary_little_endian") {
+        *pError = "unsupported format " + format +
+                  ", only binary_little_endian is read";
+        return false;
+      }
+      haveFormat = true;
+    } else if (keyword == "element") {
+      pElements->emplace_back();
+      if (!(words >> pElements->back().name >> pElements->back().count)) {
+        *pError = "malformed element: " + line;
+        return false;
+      }
+    } else if (keyword == "property") {
+      Property    property = {};
+      std::string type, countType;
+      words >> type;
+      property.isList = type == "list";
+      if (property.isList) {
+        words >> countType >> type;
+        if (!parseScalarType(countType, &property.countType)) type.clear();
+      }
+      if (pElements->empty() || !(words >> property.name) ||
+          !parseScalarType(type, &property.type)) {
+        *pError = "malformed property: " + line;
+        return false;
+      }
+      pElements->back().properties.push_back(property);
+    }
+  }
+  if (!haveFormat) {
+    *pError = "missing format";
+    return false;
+  }
+  return true;
+}
+
+// Where each VertexData component is in a vertex record.
+struct VertexLayout {
+  size_t     recordSize = 0;
+  size_t     offsets[6];
+  ScalarType types[6];
+  bool       hasNormals = false;
+  bool       allFloat   = true;
+
+  bool init(const Element& element, std::string* pError) {
+    static const char* const kNames[6] = {"x", "y", "z", "nx", "ny", "nz"};
+    bool                     found[6]  = {};
+    for (const Property& property : element.properties) {
+      if (property.isList) {
+        *pError = "list property " + property.name + " in vertex element";
+        return false;
+      }
+      for (int i = 0; i < 6; ++i) {
+        if (property.name == kNames[i]) {
+          found[i]   = true;
+          offsets[i] = recordSize;
+          types[i]   = property.type;
+          allFloat &= property.type == ScalarType::Float;
+        }
+      }
+      recordSize += scalarSize(property.type);
+    }
+    if (!found[0] || !found[1] || !found[2]) {
+      *pError = "vertex element without x, y and z";
+      return false;
+    }
+    hasNormals = found[3] && found[4] && found[5];
+    return true;
+  }
+
+  void read(const char* pRecord, VertexData* pVertex) const {
+    float     values[6] = {};
+    const int count     = hasNormals ? 6 : 3;
+    for (int i = 0; i < count; ++i) {
+      values[i] = allFloat ? load<float>(pRecord + offsets[i])
+                           : float(readScalar(pRecord + offsets[i], types[i]));
+    }
+    *pVertex = {{values[0], values[1], values[2]},
+        {values[3], values[4], values[5]}};
+  }
+};
+
+class PlyStream {
+ public:
+  PlyStream(Window* pWindow, const PlyConsumer& consumer, size_t numVertices)
+      : _pWindow(pWindow), _consumer(consumer), _numVertices(numVertices) {}
+
+  const std::string& error() const { return _error; }
+
+  bool readVertices(const Element& element) {
+    VertexLayout layout;
+    if (!layout.init(element, &_error)) return false;
+    if (layout.recordSize == 0) return fail("empty vertex records");
+
+    std::vector<VertexData> chunk(std::min(element.count, kVerticesPerChunk));
+    size_t                  first = 0;
+    while (first < element.count) {
+      const size_t count = std::min(chunk.size(), element.count - first);
+      for (size_t i = 0; i < count;) {
+        if (!_pWindow->ensure(layout.recordSize)) {
+          return fail("truncated vertex " + std::to_string(first + i));
+        }
+        // Every whole record in the window at once.
+        const size_t available = std::min(
+            count - i, _pWindow->available() / layout.recordSize);
+        const char* p = _pWindow->data();
+        for (size_t j = 0; j < available; ++j, p += layout.recordSize) {
+          layout.read(p, &chunk[i + j]);
+        }
+        _pWindow->consume(available * layout.recordSize);
+        i += available;
+      }
+      if (!_consumer.vertices(first, chunk.data(), count)) {
+        return fail("stopped by consumer");
+      }
+      first += count;
+    }
+    return true;
+  }
+
+  // Faces, or any other element when `isFace` is false, whose records are
+  // then only skipped.
+  bool readElement(const Element& element, bool isFace) {
+    std::vector<uint32_t> triangles;
+    std::vector<uint32_t> polygon;
+    if (isFace) triangles.reserve(3 * kTrianglesPerChunk);
+
+    for (size_t r = 0; r < element.count; ++r) {
+      size_t size = 0;
+      for (const Property& property : element.properties) {
+        const size_t itemSize = scalarSize(property.type);
+        if (!property.isList) {
+          size += itemSize;
+          continue;
+        }
+        const size_t countSize = scalarSize(property.countType);
+        if (!_pWindow->ensure(size + countSize)) return truncated(element, r);
+        const double count = readScalar(
+            _pWindow->data() + size, property.countType);
+        if (count < 0) return fail(recordName(element, r) + ": bad list size");
+        size += countSize;
+        if (size + size_t(count) * itemSize > _pWindow->capacity()) {
+          return fail(recordName(element, r) + " exceeds the read window");
+        }
+        if (!_pWindow->ensure(size + size_t(count) * itemSize)) {
+          return truncated(element, r);
+        }
+        if (isFace && (property.name == "vertex_indices" ||
+                          property.name == "vertex_index")) {
+          polygon.resize(size_t(count));
+          for (size_t k = 0; k < polygon.size(); ++k) {
+            const double index = readScalar(
+                _pWindow->data() + size + k * itemSize, property.type);
+            if (index < 0 || index >= double(_numVertices)) {
+              return fail(recordName(element, r) +
+                          ": vertex index out of range");
+            }
+            polygon[k] = uint32_t(index);
+          }
+          // Reversed fan, as in the OBJ loader.
+          for (size_t k = 1; k + 1 < polygon.size(); ++k) {
+            triangles.insert(triangles.end(),
+                {polygon[0], polygon[k + 1], polygon[k]});
+          }
+        }
+        size += size_t(count) * itemSize;
+      }
+      if (!_pWindow->ensure(size)) return truncated(element, r);
+      _pWindow->consume(size);
+
+      if (triangles.size() >= 3 * kTrianglesPerChunk && !flush(&triangles)) {
+        return false;
+      }
+    }
+    return flush(&triangles);
+  }
+
+ private:
+  Window*            _pWindow;
+  const PlyConsumer& _consumer;
+  size_t             _numVertices;
+  std::string        _error;
+
+  bool fail(std::string error) {
+    _error = std::move(error);
+    return false;
+  }
+  static std::string recordName(const Element& element, size_t r) {
+    return element.name + " " + std::to_string(r);
+  }
+  bool truncated(const Element& element, size_t r) {
+    return fail(_pWindow->failed() ? "read error in " + recordName(element, r)
+                                   : "truncated " + recordName(element, r));
+  }
+
+  bool flush(std::vector<uint32_t>* pTriangles) {
+    if (pTriangles->empty()) return true;
+    if (!_consumer.triangles(pTriangles->data(), pTriangles->size())) {
+      return fail("stopped by consumer");
+    }
+    pTriangles->clear();
+    return true;
+  }
+};
+
+bool streamFile(int fd, const PlyConsumer& consumer, size_t windowBytes,
+    std::string* pError) {
+  Window               window(fd, std::max(windowBytes, kMaxHeaderBytes));
+  std::vector<Element> elements;
+  if (!parseHeader(&window, &elements, pError)) return false;
+
+  PlyInfo info = {};
+  for (const Element& element : elements) {
+    if (element.name == "vertex") {
+      VertexLayout layout;
+      if (!layout.init(element, pError)) return false;
+      info.numVertices = element.count;
+      info.hasNormals  = layout.hasNormals;
+    } else if (element.name == "face") {
+      info.numFaces = element.count;
+    }
+  }
+  if (info.numVertices > size_t(UINT32_MAX) + 1) {
+    *pError = "too many vertices for 32-bit indices";
+    return false;
+  }
+  if (consumer.begin && !consumer.begin(info)) {
+    *pError = "stopped by consumer";
+    return false;
+  }
+
+  PlyStream stream(&window, consumer, info.numVertices);
+  for (const Element& element : elements) {
+    const bool ok = element.name == "vertex"
+                        ? stream.readVertices(element)
+                        : stream.readElement(element, element.name == "face");
+    if (!ok) {
+      *pError = stream.error();
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool streamPly(const char* path, const PlyConsumer& consumer,
+    std::string* pError, size_t windowBytes) {
+  std::string error;
+  const int   fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    error = std::string("cannot open: ") + std::strerror(errno);
+  } else {
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    const bool ok = streamFile(fd, consumer, windowBytes, &error);
+    ::close(fd);
+    if (ok) return true;
+  }
+  if (pError) *pError = std::string(path) + ": " + error;
+  return false;
+}
@@ -1,17 +1,38 @@
 #include "Renderer.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <string>
 
-#include "Math.hpp"
 #include "Mesh.hpp"
+#include "MeshRegistry.hpp"
 
 const int Renderer::kMaxFramesInFlight = 3;
 
-Renderer::Renderer(MTL::Device* pDevice)
-    : _pDevice(pDevice->retain()), _angle(0.f), _frame(0) {
+namespace {
+
+// Upper bound on one frame's ring usage, alignment padding included.
+size_t frameUploadBytes(
+    uint32_t numInstances, size_t bytesPerInstance, size_t alignment) {
+  return size_t(numInstances) * bytesPerInstance +
+         sizeof(shader_types::CameraData) + sizeof(shader_types::LightData) +
+         3 * alignment;
+}
+
+}  // namespace
+
+Renderer::Renderer(MTL::Device* pDevice, const InstanceGrid& grid,
+    VertexFormat vertexFormat, InstanceFormat instanceFormat)
+    : _pDevice(pDevice->retain())
+    , _pUploadBuffer(nullptr)
+    , _scene(grid)
+    , _cullStats{}
+    , _lodStats{}
+    , _vertexFormat(vertexFormat)
+    , _instanceFormat(instanceFormat) {
   _pCommandQueue = _pDevice->newCommandQueue();
   buildShaders();
   buildDepthStencilStates();
@@ -24,13 +45,8 @@ Renderer::~Renderer() {
   _pShaderLibrary->release();
   _pDepthStencilState->release();
   _pVertexDataBuffer->release();
-  for (int i = 0; i < kMaxFramesInFlight; ++i) {
-    _pInstanceDataBuffer[i]->release();
-  }
-  for (int i = 0; i < kMaxFramesInFlight; ++i) {
-    _pCameraDataBuffer[i]->release();
-  }
   _pIndexBuffer->release();
+  _pUploadBuffer->release();
   _pPSO->release();
   _pCommandQueue->release();
   _pDevice->release();
@@ -79,8 +95,15 @@ void Renderer::buildShaders() {
     assert(false);
   }
 
+  std::string vertexFnName = "vertexMain";
+  if (_vertexFormat == VertexFormat::Quantized) {
+    vertexFnName += "Quantized";
+  }
+  if (_instanceFormat == InstanceFormat::Compact) {
+    vertexFnName += "Compact";
+  }
   MTL::Function* pVertexFn = pLibrary->newFunction(
-      NS::String::string("vertexMain", UTF8StringEncoding));
+      NS::String::string(vertexFnName.c_str(), UTF8StringEncoding));
   MTL::Function* pFragFn = pLibrary->newFunction(
       NS::String::string("fragmentMain", UTF8StringEncoding));
 
@@ -106,153 +129,121 @@ void Renderer::buildShaders() {
 }
 
 void Renderer::buildBuffers() {
-  auto mesh = createMesh(MeshType::Sphere);
-
-  auto vertices = mesh->getVertices();
-  auto indices  = mesh->getIndices();
-
-  _numIndices                 = indices.size();
-  const size_t vertexDataSize = vertices.size() *
-                                sizeof(shader_types::VertexData);
-  const size_t indexDataSize = indices.size() * sizeof(uint16_t);
-
-  _pVertexDataBuffer = _pDevice->newBuffer(
-      vertexDataSize, MTL::ResourceStorageModeManaged);
-  _pIndexBuffer = _pDevice->newBuffer(
-      indexDataSize, MTL::ResourceStorageModeManaged);
-
-  memcpy(_pVertexDataBuffer->contents(), vertices.data(), vertexDataSize);
-  memcpy(_pIndexBuffer->contents(), indices.data(), indexDataSize);
-
-  _pVertexDataBuffer->didModifyRange(NS::Range::Make(0, vertexDataSize));
-  _pIndexBuffer->didModifyRange(NS::Range::Make(0, indexDataSize));
-
-  const size_t instanceDataSize = kMaxFramesInFlight * kNumInstances *
-                                  sizeof(shader_types::InstanceData);
-  for (size_t i = 0; i < kMaxFramesInFlight; ++i) {
-    _pInstanceDataBuffer[i] = _pDevice->newBuffer(
-        instanceDataSize, MTL::ResourceStorageModeManaged);
-  }
-
-  const size_t cameraDataSize = kMaxFramesInFlight *
-                                sizeof(shader_types::CameraData);
-  for (size_t i = 0; i < kMaxFramesInFlight; ++i) {
-    _pCameraDataBuffer[i] = _pDevice->newBuffer(
-        cameraDataSize, MTL::ResourceStorageModeManaged);
+  // The LOD chain comes from the shared registry, so the float chain the
+  // scene already holds is uploaded as is instead of being generated again.
+  _mesh = MeshRegistry::shared().acquireSphereLods(_vertexFormat);
+  std::copy(_mesh->lods.begin(), _mesh->lods.end(), _lods);
+  std::copy(_mesh->quantizations.begin(), _mesh->quantizations.end(),
+      _lodQuantizations);
+  _indexType = _mesh->indexType;
+
+  const void* pVertexData;
+  size_t      vertexDataSize;
+  if (_vertexFormat == VertexFormat::Float) {
+    pVertexData    = _mesh->vertices.data();
+    vertexDataSize = _mesh->vertices.size() *
+                     sizeof(shader_types::VertexData);
+  } else {
+    pVertexData    = _mesh->quantizedVertices.data();
+    vertexDataSize = _mesh->quantizedVertices.size() *
+                     sizeof(shader_types::QuantizedVertexData);
   }
+  _pVertexDataBuffer = _pDevice->newBuffer(
+      pVertexData, vertexDataSize, MTL::ResourceStorageModeManaged);
+  _pIndexBuffer = _pDevice->newBuffer(_mesh->indexData.data(),
+      _mesh->indexData.size(), MTL::ResourceStorageModeManaged);
 
-  const size_t lightDataSize = kMaxFramesInFlight *
-                               sizeof(shader_types::LightData);
-  for (size_t i = 0; i < kMaxFramesInFlight; ++i) {
-    _pLightDataBuffer[i] = _pDevice->newBuffer(
-        lightDataSize, MTL::ResourceStorageModeManaged);
-  }
+  growUploadBuffer(Renderer::kMaxFramesInFlight *
+                   frameUploadBytes(_scene.numInstances(),
+                       instanceSize(_instanceFormat), kUploadAlignment));
 }
 
-void Renderer::updateLightData(MTL::Buffer* pLightBuffer) {
-  shader_types::LightData* pLightData =
-      reinterpret_cast<shader_types::LightData*>(pLightBuffer->contents());
+void Renderer::setInstanceGrid(const InstanceGrid& grid) {
+  _scene.setInstanceGrid(grid);
+}
 
-  pLightData->position = {
-      5.0f * sinf(_currentTime), 5.0f, 5.0f * cosf(_currentTime)};
-  pLightData->color      = {1.0f, 0.9f, 0.8f};
-  pLightData->intensity  = 2.0f;
-  pLightData->range      = 30.0f;
-  pLightData->pulseSpeed = 2.0f;
-  pLightData->time       = _currentTime;
+bool Renderer::allocateFrameUploads(
+    uint32_t numInstances, FrameUploads* pUploads) {
+  return _uploadRing.allocate(sizeof(shader_types::CameraData),
+             kUploadAlignment, &pUploads->camera) &&
+         _uploadRing.allocate(sizeof(shader_types::LightData), kUploadAlignment,
+             &pUploads->light) &&
+         _uploadRing.allocate(
+             size_t(numInstances) * instanceSize(_instanceFormat),
+             kUploadAlignment, &pUploads->instances);
+}
 
-  pLightBuffer->didModifyRange(
-      NS::Range::Make(0, sizeof(shader_types::LightData)));
+// Replaces the ring's storage with one at least twice as large. Command
+// buffers still in flight retain the old buffer, so releasing it is safe;
+// the ring forgets their regions along with it.
+void Renderer::growUploadBuffer(size_t requiredBytes) {
+  size_t capacity = requiredBytes;
+  if (_pUploadBuffer) {
+    capacity = std::max(capacity, 2 * _pUploadBuffer->length());
+    _pUploadBuffer->release();
+  }
+  _pUploadBuffer = _pDevice->newBuffer(
+      capacity, MTL::ResourceStorageModeManaged);
+  _uploadRing.reset(_pUploadBuffer->contents(), capacity);
 }
 
 void Renderer::draw(MTK::View* pView) {
-  using simd::float3;
-  using simd::float4;
-  using simd::float4x4;
-
   NS::AutoreleasePool* pPool = NS::AutoreleasePool::alloc()->init();
 
-  _frame = (_frame + 1) % Renderer::kMaxFramesInFlight;
-  MTL::Buffer* pInstanceDataBuffer = _pInstanceDataBuffer[_frame];
-  MTL::Buffer* pLightDataBuffer    = _pLightDataBuffer[_frame];
-
   MTL::CommandBuffer* pCmd = _pCommandQueue->commandBuffer();
   dispatch_semaphore_wait(_semaphore, DISPATCH_TIME_FOREVER);
-  Renderer* pRenderer = this;
+  _uploadRing.beginFrame();
+
+  _scene.advance();
+
+  const uint32_t numInstances = _scene.numInstances();
+  FrameUploads   uploads;
+  if (!allocateFrameUploads(numInstances, &uploads)) {
+    // The grid grew past what the ring can hold for kMaxFramesInFlight
+    // frames; the fresh ring is empty, so this cannot fail again.
+    growUploadBuffer(Renderer::kMaxFramesInFlight *
+                     frameUploadBytes(numInstances,
+                         instanceSize(_instanceFormat), kUploadAlignment));
+    allocateFrameUploads(numInstances, &uploads);
+  }
+
+  InstanceBuckets buckets;
+  const float     viewportHeight = float(pView->drawableSize().height);
+  uint32_t        numVisible;
+  if (_instanceFormat == InstanceFormat::Compact) {
+    numVisible = _scene.writeVisibleInstanceData(
+        static_cast<shader_types::CompactInstanceData*>(
+            uploads.instances.pData),
+        1.f, viewportHeight, _jobSystem, &buckets, &_cullStats);
+  } else {
+    numVisible = _scene.writeVisibleInstanceData(
+        static_cast<shader_types::InstanceData*>(uploads.instances.pData),
+        1.f, viewportHeight, _jobSystem, &buckets, &_cullStats);
+  }
+  const size_t instanceDataSize = size_t(numVisible) *
+                                  instanceSize(_instanceFormat);
+  _uploadRing.shrinkLastAllocation(instanceDataSize);
+  _scene.writeCameraData(
+      static_cast<shader_types::CameraData*>(uploads.camera.pData), 1.f);
+  _scene.writeLightData(
+      static_cast<shader_types::LightData*>(uploads.light.pData));
+
+  if (instanceDataSize > 0) {
+    _pUploadBuffer->didModifyRange(
+        NS::Range::Make(uploads.instances.offset, instanceDataSize));
+  }
+  _pUploadBuffer->didModifyRange(NS::Range::Make(
+      uploads.camera.offset, sizeof(shader_types::CameraData)));
+  _pUploadBuffer->didModifyRange(NS::Range::Make(
+      uploads.light.offset, sizeof(shader_types::LightData)));
+
+  const uint64_t fence     = _uploadRing.endFrame();
+  Renderer*      pRenderer = this;
   pCmd->addCompletedHandler(^void(MTL::CommandBuffer* pCmd) {
+    pRenderer->_uploadRing.signal(fence);
     dispatch_semaphore_signal(pRenderer->_semaphore);
   });
 
-  _currentTime += 0.016f;
-  _angle += 0.002f;
-
-  const float                 scl = 0.2f;
-  shader_types::InstanceData* pInstanceData =
-      reinterpret_cast<shader_types::InstanceData*>(
-          pInstanceDataBuffer->contents());
-
-  float3 objectPosition = {0.f, 0.f, -10.f};
-
-  float4x4 rt    = Math::makeTranslate(objectPosition);
-  float4x4 rr1   = Math::makeYRotate(-_angle);
-  float4x4 rr0   = Math::makeXRotate(_angle * 0.5);
-  float4x4 rtInv = Math::makeTranslate(
-      {-objectPosition.x, -objectPosition.y, -objectPosition.z});
-  float4x4 fullObjectRot = rt * rr1 * rr0 * rtInv;
-
-  size_t ix = 0;
-  size_t iy = 0;
-  size_t iz = 0;
-  for (size_t i = 0; i < kNumInstances; ++i) {
-    if (ix == kInstanceRows) {
-      ix = 0;
-      iy += 1;
-    }
-    if (iy == kInstanceRows) {
-      iy = 0;
-      iz += 1;
-    }
-
-    float4x4 scale = Math::makeScale((float3){scl, scl, scl});
-    float4x4 zrot  = Math::makeZRotate(_angle * sinf((float)ix));
-    float4x4 yrot  = Math::makeYRotate(_angle * cosf((float)iy));
-
-    float x = ((float)ix - (float)kInstanceRows / 2.f) * (2.f * scl) + scl;
-    float y = ((float)iy - (float)kInstanceColumns / 2.f) * (2.f * scl) + scl;
-    float z = ((float)iz - (float)kInstanceDepth / 2.f) * (2.f * scl);
-    float4x4 translate = Math::makeTranslate(
-        Math::add(objectPosition, {x, y, z}));
-
-    pInstanceData[i].instanceTransform = fullObjectRot * translate * yrot *
-                                         zrot * scale;
-    pInstanceData[i].instanceNormalTransform = Math::discardTranslation(
-        pInstanceData[i].instanceTransform);
-
-    float iDivNumInstances         = i / (float)kNumInstances;
-    float r                        = iDivNumInstances;
-    float g                        = 1.0f - r;
-    float b                        = sinf(M_PI * 2.0f * iDivNumInstances);
-    pInstanceData[i].instanceColor = (float4){r, g, b, 1.0f};
-
-    ix += 1;
-  }
-  pInstanceDataBuffer->didModifyRange(
-      NS::Range::Make(0, pInstanceDataBuffer->length()));
-
-  updateLightData(pLightDataBuffer);
-
-  MTL::Buffer*              pCameraDataBuffer = _pCameraDataBuffer[_frame];
-  shader_types::CameraData* pCameraData =
-      reinterpret_cast<shader_types::CameraData*>(
-          pCameraDataBuffer->contents());
-  pCameraData->perspectiveTransform = Math::makePerspective(
-      45.f * M_PI / 180.f, 1.f, 0.03f, 500.0f);
-  pCameraData->worldTransform       = Math::makeIdentity();
-  pCameraData->worldNormalTransform = Math::discardTranslation(
-      pCameraData->worldTransform);
-  pCameraDataBuffer->didModifyRange(
-      NS::Range::Make(0, sizeof(shader_types::CameraData)));
-
   MTL::RenderPassDescriptor* pRpd = pView->currentRenderPassDescriptor();
   MTL::RenderCommandEncoder* pEnc = pCmd->renderCommandEncoder(pRpd);
 
@@ -260,18 +251,39 @@ void Renderer::draw(MTK::View* pView) {
   pEnc->setDepthStencilState(_pDepthStencilState);
 
   pEnc->setVertexBuffer(_pVertexDataBuffer, 0, 0);
-  pEnc->setVertexBuffer(pInstanceDataBuffer, 0, 1);
-  pEnc->setVertexBuffer(pCameraDataBuffer, 0, 2);
+  pEnc->setVertexBuffer(_pUploadBuffer, uploads.instances.offset, 1);
+  pEnc->setVertexBuffer(_pUploadBuffer, uploads.camera.offset, 2);
 
-  pEnc->setFragmentBuffer(pCameraDataBuffer, 0, 0);
-  pEnc->setFragmentBuffer(pLightDataBuffer, 0, 1);
+  pEnc->setFragmentBuffer(_pUploadBuffer, uploads.camera.offset, 0);
+  pEnc->setFragmentBuffer(_pUploadBuffer, uploads.light.offset, 1);
 
   pEnc->setCullMode(MTL::CullModeBack);
   pEnc->setFrontFacingWinding(MTL::Winding::WindingCounterClockwise);
 
-  pEnc->drawIndexedPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle,
-      _numIndices, MTL::IndexType::IndexTypeUInt16, _pIndexBuffer, 0,
-      kNumInstances);
+  // One instanced draw per LOD bucket; the buffer offsets select the
+  // LOD's vertices and the bucket's instances.
+  const MTL::IndexType indexType = _indexType == IndexType::UInt16
+                                       ? MTL::IndexType::IndexTypeUInt16
+                                       : MTL::IndexType::IndexTypeUInt32;
+  for (size_t lod = 0; lod < kNumSphereLods; ++lod) {
+    const MeshLod& l         = _lods[lod];
+    _lodStats.instances[lod] = buckets.count[lod];
+    _lodStats.triangles[lod] = uint64_t(buckets.count[lod]) * l.numIndices / 3;
+    if (buckets.count[lod] == 0) continue;
+
+    pEnc->setVertexBufferOffset(l.firstVertex * vertexSize(_vertexFormat), 0);
+    if (_vertexFormat == VertexFormat::Quantized) {
+      pEnc->setVertexBytes(&_lodQuantizations[lod],
+          sizeof(shader_types::VertexQuantization), 3);
+    }
+    pEnc->setVertexBufferOffset(uploads.instances.offset +
+                                    buckets.first[lod] *
+                                        instanceSize(_instanceFormat),
+        1);
+    pEnc->drawIndexedPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle,
+        l.numIndices, indexType, _pIndexBuffer,
+        l.firstIndex * indexSize(_indexType), buckets.count[lod]);
+  }
 
   pEnc->endEncoding();
   pCmd->presentDrawable(pView->currentDrawable());
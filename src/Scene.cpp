@@ -0,0 +1,512 @@
+#include "Scene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#include "InstanceTransforms.hpp"
+#include "Math.hpp"
+
+namespace {
+
+constexpr float        kInstanceScale  = 0.2f;
+constexpr Math::float3 kObjectPosition = {0.f, 0.f, -10.f};
+
+// Largest silhouette deviation from the true sphere, in pixels, that LOD
+// selection accepts.
+constexpr float kLodPixelError = 0.5f;
+
+}  // namespace
+
+Scene::Scene(const InstanceGrid& grid)
+    : _mesh(MeshRegistry::shared().acquireSphereLods(VertexFormat::Float))
+    , _angle(0.f)
+    , _currentTime(0.f)
+    , _frustumCulling(true)
+    , _occlusionCulling(true)
+    , _lodDepthRow{0.f, 0.f, 0.f, 1.f}
+    , _lodPixelRadius(0.f) {
+  // A level with n stacks deviates from the sphere by up to
+  // r * (1 - cos(pi / n)); pick the coarsest level that stays within
+  // kLodPixelError. Occluders use each level's inscribed radius, with a
+  // little slack for rounding.
+  for (size_t lod = 0; lod < kNumSphereLods; ++lod) {
+    const float deviation   = 1.f - cosf(M_PI / kSphereLodStacks[lod]);
+    _lodMaxPixelRadius[lod] = kLodPixelError / deviation;
+    _lodInnerRadius[lod]    = 0.99f * meshInnerRadius(*_mesh, lod) /
+                           kSphereRadius;
+  }
+  setInstanceGrid(grid);
+}
+
+void Scene::setInstanceGrid(const InstanceGrid& grid) {
+  _grid = grid;
+
+  // resize() keeps the existing allocations when the grid shrinks and only
+  // reallocates when it outgrows them.
+  _rowSin.resize(grid.rows);
+  for (uint32_t ix = 0; ix < grid.rows; ++ix) {
+    _rowSin[ix] = sinf((float)ix);
+  }
+  _columnCos.resize(grid.columns);
+  for (uint32_t iy = 0; iy < grid.columns; ++iy) {
+    _columnCos[iy] = cosf((float)iy);
+  }
+
+  const uint32_t numInstances = grid.numInstances();
+  _instanceColors.resize(numInstances);
+  _packedInstanceColors.resize(numInstances);
+  for (uint32_t i = 0; i < numInstances; ++i) {
+    float iDivNumInstances   = i / (float)numInstances;
+    float r                  = iDivNumInstances;
+    float g                  = 1.0f - r;
+    float b                  = sinf(M_PI * 2.0f * iDivNumInstances);
+    _instanceColors[i]       = (Math::float4){r, g, b, 1.0f};
+    _packedInstanceColors[i] = packUnorm4x8(_instanceColors[i]);
+  }
+}
+
+void Scene::advance() {
+  _currentTime += 0.016f;
+  _angle += 0.002f;
+}
+
+void Scene::writeInstanceData(
+    shader_types::InstanceData* pInstanceData, JobSystem& jobs) const {
+  jobs.parallelFor(numInstances(), kInstancesPerJob,
+      [this, pInstanceData](size_t first, size_t last) {
+        writeInstanceData(pInstanceData, first, last);
+      });
+}
+
+uint32_t Scene::writeVisibleInstanceData(
+    shader_types::InstanceData* pInstanceData, float aspect,
+    float viewportHeight, JobSystem& jobs, InstanceBuckets* pBuckets,
+    CullStats* pStats) {
+  const uint32_t total = cullInstances(
+      aspect, viewportHeight, jobs, pBuckets, pStats);
+  writeBuckets(pInstanceData, jobs);
+  return total;
+}
+
+uint32_t Scene::writeVisibleInstanceData(
+    shader_types::CompactInstanceData* pInstanceData, float aspect,
+    float viewportHeight, JobSystem& jobs, InstanceBuckets* pBuckets,
+    CullStats* pStats) {
+  const uint32_t total = cullInstances(
+      aspect, viewportHeight, jobs, pBuckets, pStats);
+  writeBuckets(pInstanceData, jobs);
+  return total;
+}
+
+uint32_t Scene::cullInstances(float aspect, float viewportHeight,
+    JobSystem& jobs, InstanceBuckets* pBuckets, CullStats* pStats) {
+  const uint32_t numInstances = this->numInstances();
+  const size_t   numChunks    = (numInstances + kInstancesPerJob - 1) /
+                           kInstancesPerJob;
+  _visibleIndices.resize(numInstances);
+  _sortedIndices.resize(numInstances);
+  _chunkCounts.resize(numChunks);
+  _lodCounts.resize(numChunks * kNumSphereLods);
+  _lodOffsets.resize(numChunks * kNumSphereLods);
+
+  // Cull in the grid's own space: the planes absorb the object rotation,
+  // which is rigid and so leaves the bounding radius unchanged.
+  shader_types::CameraData camera;
+  writeCameraData(&camera, aspect);
+  const Math::float4x4 clipFromModel = camera.perspectiveTransform *
+                                       camera.worldTransform *
+                                       objectTransform();
+  const Frustum        frustum       = extractFrustum(clipFromModel);
+
+  // Projected radius in pixels is _lodPixelRadius / w.
+  _lodDepthRow    = {clipFromModel.columns[0].w, clipFromModel.columns[1].w,
+         clipFromModel.columns[2].w, clipFromModel.columns[3].w};
+  _lodPixelRadius = kSphereRadius * kInstanceScale *
+                    camera.perspectiveTransform.columns[1].y * 0.5f *
+                    viewportHeight;
+
+  // Pass 1: each chunk compacts its visible indices in place.
+  jobs.parallelFor(numChunks, 1, [&](size_t firstChunk, size_t lastChunk) {
+    float x[kTransformBlock];
+    float y[kTransformBlock];
+    float z[kTransformBlock];
+    float radius[kTransformBlock];
+    std::fill_n(radius, kTransformBlock, kSphereRadius * kInstanceScale);
+    const SphereBounds bounds = {x, y, z, radius};
+
+    for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk) {
+      const size_t first = chunk * kInstancesPerJob;
+      const size_t last  = std::min<size_t>(
+          first + kInstancesPerJob, numInstances);
+      uint32_t* pVisible   = &_visibleIndices[first];
+      size_t    numVisible = 0;
+      if (!_frustumCulling) {
+        for (size_t i = first; i < last; ++i) {
+          pVisible[numVisible++] = uint32_t(i);
+        }
+      }
+      for (size_t block = first; _frustumCulling && block < last;
+           block += kTransformBlock) {
+        const size_t count = std::min(kTransformBlock, last - block);
+        gatherPositions(block, count, x, y, z);
+        numVisible += cullSpheres(
+            frustum, bounds, count, uint32_t(block), pVisible + numVisible);
+      }
+      _chunkCounts[chunk] = uint32_t(numVisible);
+    }
+  });
+
+  uint32_t numInFrustum = 0;
+  for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+    numInFrustum += _chunkCounts[chunk];
+  }
+
+  float occlusionMs = 0.f;
+  if (_occlusionCulling && numInFrustum > 0) {
+    auto start = std::chrono::steady_clock::now();
+    cullOccluded(clipFromModel, numChunks, jobs);
+    std::chrono::duration<float, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    occlusionMs = elapsed.count();
+  }
+
+  // Pass 2: each chunk sorts its survivors by LOD (counting sort).
+  jobs.parallelFor(numChunks, 1, [&](size_t firstChunk, size_t lastChunk) {
+    float   x[kTransformBlock];
+    float   y[kTransformBlock];
+    float   z[kTransformBlock];
+    uint8_t lods[kInstancesPerJob];
+
+    for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk) {
+      const uint32_t* pIndices = &_visibleIndices[chunk * kInstancesPerJob];
+      const size_t    count    = _chunkCounts[chunk];
+      uint32_t        lodCounts[kNumSphereLods] = {};
+      for (size_t block = 0; block < count; block += kTransformBlock) {
+        const size_t blockCount = std::min(kTransformBlock, count - block);
+        gatherPositions(pIndices + block, blockCount, x, y, z);
+        for (size_t i = 0; i < blockCount; ++i) {
+          const size_t lod = selectLod(x[i], y[i], z[i]);
+          lods[block + i]  = uint8_t(lod);
+          lodCounts[lod] += 1;
+        }
+      }
+
+      uint32_t* pSorted = &_sortedIndices[chunk * kInstancesPerJob];
+      uint32_t  cursor[kNumSphereLods];
+      uint32_t  start = 0;
+      for (size_t lod = 0; lod < kNumSphereLods; ++lod) {
+        cursor[lod] = start;
+        start += lodCounts[lod];
+        _lodCounts[lod * numChunks + chunk] = lodCounts[lod];
+      }
+      for (size_t i = 0; i < count; ++i) {
+        pSorted[cursor[lods[i]]++] = pIndices[i];
+      }
+    }
+  });
+
+  // Exclusive prefix sum in (LOD, chunk) order so every bucket is
+  // contiguous in pInstanceData.
+  InstanceBuckets buckets;
+  uint32_t        total = 0;
+  for (size_t lod = 0; lod < kNumSphereLods; ++lod) {
+    buckets.first[lod] = total;
+    for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+      _lodOffsets[lod * numChunks + chunk] = total;
+      total += _lodCounts[lod * numChunks + chunk];
+    }
+    buckets.count[lod] = total - buckets.first[lod];
+  }
+
+  if (pBuckets) {
+    *pBuckets = buckets;
+  }
+  if (pStats) {
+    pStats->visible     = total;
+    pStats->culled      = numInstances - numInFrustum;
+    pStats->occluded    = numInFrustum - total;
+    pStats->occlusionMs = occlusionMs;
+  }
+  return total;
+}
+
+// Pass 3 of writeVisibleInstanceData: write each chunk's LOD runs into
+// their buckets.
+template <typename Instance>
+void Scene::writeBuckets(Instance* pInstanceData, JobSystem& jobs) const {
+  const size_t numChunks = _chunkCounts.size();
+  jobs.parallelFor(numChunks, 1, [&](size_t firstChunk, size_t lastChunk) {
+    for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk) {
+      const uint32_t* pSorted = &_sortedIndices[chunk * kInstancesPerJob];
+      for (size_t lod = 0; lod < kNumSphereLods; ++lod) {
+        const uint32_t count = _lodCounts[lod * numChunks + chunk];
+        writeInstanceData(pInstanceData + _lodOffsets[lod * numChunks + chunk],
+            pSorted, count);
+        pSorted += count;
+      }
+    }
+  });
+}
+
+size_t Scene::selectLod(float x, float y, float z) const {
+  const float w = _lodDepthRow.x * x + _lodDepthRow.y * y +
+                  _lodDepthRow.z * z + _lodDepthRow.w;
+  if (w <= 0.f) {
+    return 0;
+  }
+  const float pixelRadius = _lodPixelRadius / w;
+  size_t      lod         = 0;
+  while (lod + 1 < kNumSphereLods &&
+         pixelRadius <= _lodMaxPixelRadius[lod + 1]) {
+    ++lod;
+  }
+  return lod;
+}
+
+void Scene::cullOccluded(const Math::float4x4& clipFromModel,
+    size_t numChunks, JobSystem& jobs) {
+  const float radius = kSphereRadius * kInstanceScale;
+
+  // Every instance that survived the frustum test is an occluder. The
+  // rasterization is serial, but each instance only touches a handful of
+  // low-resolution pixels.
+  _occlusionCuller.beginFrame(clipFromModel);
+  {
+    float x[kTransformBlock];
+    float y[kTransformBlock];
+    float z[kTransformBlock];
+    float innerRadius[kTransformBlock];
+    const SphereBounds occluders = {x, y, z, innerRadius};
+
+    for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+      const uint32_t* pIndices = &_visibleIndices[chunk * kInstancesPerJob];
+      const size_t    count    = _chunkCounts[chunk];
+      for (size_t block = 0; block < count; block += kTransformBlock) {
+        const size_t blockCount = std::min(kTransformBlock, count - block);
+        gatherPositions(pIndices + block, blockCount, x, y, z);
+        // Coarser LODs cover a smaller ball.
+        for (size_t i = 0; i < blockCount; ++i) {
+          const size_t lod = selectLod(x[i], y[i], z[i]);
+          innerRadius[i]   = radius * _lodInnerRadius[lod];
+        }
+        _occlusionCuller.addOccluders(occluders, blockCount);
+      }
+    }
+  }
+  _occlusionCuller.buildHierarchy();
+
+  jobs.parallelFor(numChunks, 1, [&](size_t firstChunk, size_t lastChunk) {
+    float x[kTransformBlock];
+    float y[kTransformBlock];
+    float z[kTransformBlock];
+    float outerRadius[kTransformBlock];
+    std::fill_n(outerRadius, kTransformBlock, radius);
+    const SphereBounds bounds = {x, y, z, outerRadius};
+
+    for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk) {
+      uint32_t*    pIndices   = &_visibleIndices[chunk * kInstancesPerJob];
+      const size_t count      = _chunkCounts[chunk];
+      size_t       numVisible = 0;
+      for (size_t block = 0; block < count; block += kTransformBlock) {
+        const size_t blockCount = std::min(kTransformBlock, count - block);
+        gatherPositions(pIndices + block, blockCount, x, y, z);
+        // Compacting in place is safe: writes never overtake reads.
+        numVisible += _occlusionCuller.cullSpheres(
+            bounds, blockCount, pIndices + block, pIndices + numVisible);
+      }
+      _chunkCounts[chunk] = uint32_t(numVisible);
+    }
+  });
+}
+
+Math::float4x4 Scene::objectTransform() const {
+  Math::float4x4 rt    = Math::makeTranslate(kObjectPosition);
+  Math::float4x4 rr1   = Math::makeYRotate(-_angle);
+  Math::float4x4 rr0   = Math::makeXRotate(_angle * 0.5);
+  Math::float4x4 rtInv = Math::makeTranslate(
+      {-kObjectPosition.x, -kObjectPosition.y, -kObjectPosition.z});
+  return rt * rr1 * rr0 * rtInv;
+}
+
+Math::float3 Scene::gridPosition(uint32_t ix, uint32_t iy, uint32_t iz) const {
+  const float scl = kInstanceScale;
+  return {kObjectPosition.x +
+              ((float)ix - (float)_grid.rows / 2.f) * (2.f * scl) + scl,
+      kObjectPosition.y +
+          ((float)iy - (float)_grid.columns / 2.f) * (2.f * scl) + scl,
+      kObjectPosition.z + ((float)iz - (float)_grid.depth / 2.f) * (2.f * scl)};
+}
+
+void Scene::gatherPositions(
+    size_t first, size_t count, float* pX, float* pY, float* pZ) const {
+  uint32_t ix = uint32_t(first % _grid.rows);
+  uint32_t iy = uint32_t(first / _grid.rows % _grid.columns);
+  uint32_t iz = uint32_t(first / (size_t(_grid.rows) * _grid.columns));
+  for (size_t i = 0; i < count; ++i) {
+    if (ix == _grid.rows) {
+      ix = 0;
+      iy += 1;
+    }
+    if (iy == _grid.columns) {
+      iy = 0;
+      iz += 1;
+    }
+    const Math::float3 p = gridPosition(ix, iy, iz);
+    pX[i]                = p.x;
+    pY[i]                = p.y;
+    pZ[i]                = p.z;
+    ix += 1;
+  }
+}
+
+void Scene::gatherPositions(const uint32_t* pIndices, size_t count,
+    float* pX, float* pY, float* pZ) const {
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t index = pIndices[i];
+    const uint32_t ix    = index % _grid.rows;
+    const uint32_t iy    = index / _grid.rows % _grid.columns;
+    const uint32_t iz    = index / (_grid.rows * _grid.columns);
+
+    const Math::float3 p = gridPosition(ix, iy, iz);
+    pX[i]                = p.x;
+    pY[i]                = p.y;
+    pZ[i]                = p.z;
+  }
+}
+
+void Scene::writeInstanceData(shader_types::InstanceData* pInstanceData,
+    size_t first, size_t last) const {
+  const Math::float4x4 fullObjectRot = objectTransform();
+
+  // Gather the per-instance parameters into SoA blocks for the batched
+  // transform kernel.
+  float x[kTransformBlock];
+  float y[kTransformBlock];
+  float z[kTransformBlock];
+  float yAngle[kTransformBlock];
+  float zAngle[kTransformBlock];
+  float scale[kTransformBlock];
+  std::fill_n(scale, kTransformBlock, kInstanceScale);
+
+  const InstanceTransformParams params = {x, y, z, yAngle, zAngle, scale};
+  for (size_t block = first; block < last; block += kTransformBlock) {
+    const size_t count = std::min(kTransformBlock, last - block);
+    gatherPositions(block, count, x, y, z);
+
+    uint32_t ix = uint32_t(block % _grid.rows);
+    uint32_t iy = uint32_t(block / _grid.rows % _grid.columns);
+    for (size_t i = 0; i < count; ++i) {
+      if (ix == _grid.rows) {
+        ix = 0;
+        iy = iy + 1 == _grid.columns ? 0 : iy + 1;
+      }
+      yAngle[i] = _angle * _columnCos[iy];
+      zAngle[i] = _angle * _rowSin[ix];
+
+      pInstanceData[block + i].instanceColor = _instanceColors[block + i];
+
+      ix += 1;
+    }
+
+    computeInstanceTransforms(
+        fullObjectRot, params, count, pInstanceData + block);
+  }
+}
+
+void Scene::writeInstanceData(shader_types::InstanceData* pInstanceData,
+    const uint32_t* pIndices, size_t count) const {
+  writeIndexedInstances(pInstanceData, pIndices, count);
+}
+
+void Scene::writeInstanceData(
+    shader_types::CompactInstanceData* pInstanceData,
+    const uint32_t* pIndices, size_t count) const {
+  writeIndexedInstances(pInstanceData, pIndices, count);
+}
+
+void Scene::writeColor(
+    shader_types::InstanceData* pInstance, uint32_t index) const {
+  pInstance->instanceColor = _instanceColors[index];
+}
+
+void Scene::writeColor(
+    shader_types::CompactInstanceData* pInstance, uint32_t index) const {
+  pInstance->color = _packedInstanceColors[index];
+}
+
+template <typename Instance>
+void Scene::writeIndexedInstances(
+    Instance* pInstanceData, const uint32_t* pIndices, size_t count) const {
+  const Math::float4x4 fullObjectRot = objectTransform();
+
+  float x[kTransformBlock];
+  float y[kTransformBlock];
+  float z[kTransformBlock];
+  float yAngle[kTransformBlock];
+  float zAngle[kTransformBlock];
+  float scale[kTransformBlock];
+  std::fill_n(scale, kTransformBlock, kInstanceScale);
+
+  const InstanceTransformParams params = {x, y, z, yAngle, zAngle, scale};
+  for (size_t block = 0; block < count; block += kTransformBlock) {
+    const size_t blockCount = std::min(kTransformBlock, count - block);
+    for (size_t i = 0; i < blockCount; ++i) {
+      const uint32_t index = pIndices[block + i];
+      const uint32_t ix    = index % _grid.rows;
+      const uint32_t iy    = index / _grid.rows % _grid.columns;
+      const uint32_t iz    = index / (_grid.rows * _grid.columns);
+
+      const Math::float3 p = gridPosition(ix, iy, iz);
+      x[i]                 = p.x;
+      y[i]                 = p.y;
+      z[i]                 = p.z;
+      yAngle[i]            = _angle * _columnCos[iy];
+      zAngle[i]            = _angle * _rowSin[ix];
+
+      writeColor(pInstanceData + block + i, index);
+    }
+
+    computeInstanceTransforms(
+        fullObjectRot, params, blockCount, pInstanceData + block);
+  }
+}
+
+void Scene::writeCameraData(
+    shader_types::CameraData* pCameraData, float aspect) const {
+  pCameraData->perspectiveTransform = Math::makePerspective(
+      45.f * M_PI / 180.f, aspect, 0.03f, 500.0f);
+  pCameraData->worldTransform       = Math::makeIdentity();
+  pCameraData->worldNormalTransform = Math::discardTranslation(
+      pCameraData->worldTransform);
+  pCameraData->cameraPosition = {0.f, 0.f, 0.f};
+}
+
+void Scene::writeLightData(shader_types::LightData* pLightData) const {
+  pLightData->position = {
+      5.0f * sinf(_currentTime), 5.0f, 5.0f * cosf(_currentTime)};
+  pLightData->color      = {1.0f, 0.9f, 0.8f};
+  pLightData->intensity  = 2.0f;
+  pLightData->range      = 30.0f;
+  pLightData->pulseSpeed = 2.0f;
+  pLightData->time       = _currentTime;
+}
+
+bool parseInstanceGrid(const char* pText, InstanceGrid* pGrid) {
+  unsigned long dims[3];
+  const char*   p = pText;
+  for (int d = 0; d < 3; ++d) {
+    char* pEnd;
+    dims[d] = strtoul(p, &pEnd, 10);
+    if (pEnd == p || dims[d] == 0 || dims[d] > UINT32_MAX ||
+        *pEnd != (d < 2 ? 'x' : '\0')) {
+      return false;
+    }
+    p = pEnd + 1;
+  }
+  if (uint64_t(dims[0]) * dims[1] * dims[2] > UINT32_MAX) {
+    return false;
+  }
+  *pGrid = {uint32_t(dims[0]), uint32_t(dims[1]), uint32_t(dims[2])};
+  return true;
+}
@@ -0,0 +1,489 @@
+#include "SoftwareRenderer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "Math.hpp"
+
+namespace {
+
+constexpr uint32_t kInvalidTriangle = std::numeric_limits<uint32_t>::max();
+
+// Linear [0, 1] -> sRGB byte, the conversion the GPU applies when storing
+// to a BGRA8Unorm_sRGB target.
+const std::array<uint8_t, 4096>& srgbTable() {
+  static const std::array<uint8_t, 4096> table = [] {
+    std::array<uint8_t, 4096> t{};
+    for (size_t i = 0; i < t.size(); ++i) {
+      float c = static_cast<float>(i) / static_cast<float>(t.size() - 1);
+      float s = c <= 0.0031308f ? c * 12.92f
+                                : 1.055f * powf(c, 1.f / 2.4f) - 0.055f;
+      t[i]    = static_cast<uint8_t>(s * 255.f + 0.5f);
+    }
+    return t;
+  }();
+  return table;
+}
+
+uint32_t packColor(float r, float g, float b) {
+  const std::array<uint8_t, 4096>& table = srgbTable();
+  auto toIndex = [](float c) {
+    return static_cast<size_t>(std::clamp(c, 0.f, 1.f) * 4095.f + 0.5f);
+  };
+  return (0xffu << 24) | (uint32_t(table[toIndex(r)]) << 16) |
+         (uint32_t(table[toIndex(g)]) << 8) | uint32_t(table[toIndex(b)]);
+}
+
+float saturate(float v) { return std::clamp(v, 0.f, 1.f); }
+
+// CPU mirror of fragmentMain in shader.metal, evaluated in float.
+Math::float3 shadeFragment(const Math::float3& worldPos,
+    const Math::float3& interpolatedNormal, const Math::float3& color,
+    const shader_types::CameraData& camera,
+    const shader_types::LightData&  light) {
+  using Math::float3;
+
+  float3 normal = Math::normalize(interpolatedNormal);
+
+  float3 lightVec = light.position - worldPos;
+  float  distance = Math::length(lightVec);
+  float3 lightDir = Math::normalize(lightVec);
+
+  float attenuation = saturate(1.f - distance / light.range);
+  attenuation *= attenuation;
+
+  float ndotl = saturate(Math::dot(normal, lightDir));
+
+  float3 viewDir    = Math::normalize(camera.cameraPosition - worldPos);
+  float3 halfVector = Math::normalize(lightDir + viewDir);
+  float  specular = powf(saturate(Math::dot(normal, halfVector)), 16.f) * 0.3f;
+
+  float pulse = light.pulseSpeed > 0.f
+                    ? sinf(light.time * light.pulseSpeed) * 0.5f + 0.5f
+                    : 1.f;
+
+  float3 lightColor = {static_cast<float>(light.color.x),
+      static_cast<float>(light.color.y), static_cast<float>(light.color.z)};
+  float  lightIntensity = light.intensity * attenuation * pulse;
+
+  float3 ambient         = color * 0.2f;
+  float3 diffuse         = color * lightColor * (ndotl * lightIntensity);
+  float3 specularContrib = lightColor * (specular * lightIntensity);
+
+  return ambient + diffuse + specularContrib;
+}
+
+}  // namespace
+
+SoftwareRenderer::SoftwareRenderer(uint32_t width, uint32_t height,
+    unsigned int numThreads, const InstanceGrid& grid,
+    VertexFormat vertexFormat, InstanceFormat instanceFormat)
+    : _jobSystem(numThreads)
+    , _tilesX((width + kTileSize - 1) / kTileSize)
+    , _tilesY((height + kTileSize - 1) / kTileSize)
+    , _scene(grid)
+    , _vertexFormat(vertexFormat)
+    , _instanceFormat(instanceFormat)
+    , _cullStats{}
+    , _lodStats{}
+    , _meshletStats{}
+    , _meshletCulling(true)
+    , _buckets{} {
+  _framebuffer.width  = width;
+  _framebuffer.height = height;
+  _framebuffer.color.resize(size_t(width) * height);
+  _framebuffer.depth.resize(size_t(width) * height);
+  buildBuffers();
+}
+
+void SoftwareRenderer::buildBuffers() {
+  // A float chain is the one the scene already holds.
+  _mesh = MeshRegistry::shared().acquireSphereLods(_vertexFormat);
+  for (size_t lod = 0; lod < kNumSphereLods; ++lod) {
+    _buckets[lod].pLod = &_mesh->lods[lod];
+  }
+
+  resizeInstanceBuffers();
+}
+
+void SoftwareRenderer::setInstanceGrid(const InstanceGrid& grid) {
+  _scene.setInstanceGrid(grid);
+  resizeInstanceBuffers();
+}
+
+void SoftwareRenderer::resizeInstanceBuffers() {
+  const size_t numInstances = _scene.numInstances();
+  const size_t numChunks    = (numInstances + kInstancesPerChunk - 1) /
+                           kInstancesPerChunk;
+
+  if (_instanceFormat == InstanceFormat::Compact) {
+    _compactInstanceData.resize(numInstances);
+  } else {
+    _instanceData.resize(numInstances);
+  }
+  _bins.resize(numChunks * _tilesX * _tilesY);
+  _chunkMeshletStats.resize(numChunks);
+}
+
+size_t SoftwareRenderer::numChunks() const {
+  return (_cullStats.visible + kInstancesPerChunk - 1) / kInstancesPerChunk;
+}
+
+// Buckets are laid out in LOD order, so the owner is the last non-empty
+// bucket starting at or before the instance/triangle.
+const SoftwareRenderer::Bucket& SoftwareRenderer::bucketOfInstance(
+    size_t instance) const {
+  size_t lod = kNumSphereLods - 1;
+  while (lod > 0 && (_buckets[lod].numInstances == 0 ||
+                        instance < _buckets[lod].firstInstance)) {
+    --lod;
+  }
+  return _buckets[lod];
+}
+
+const SoftwareRenderer::Bucket& SoftwareRenderer::bucketOfTriangle(
+    size_t triangle) const {
+  size_t lod = kNumSphereLods - 1;
+  while (lod > 0 && (_buckets[lod].numInstances == 0 ||
+                        triangle < _buckets[lod].firstTriangle)) {
+    --lod;
+  }
+  return _buckets[lod];
+}
+
+// What shadeInstance in shader.metal reads from either instance format.
+Math::float4x4 SoftwareRenderer::instanceTransform(size_t instance) const {
+  return _instanceFormat == InstanceFormat::Compact
+             ? ::instanceTransform(_compactInstanceData[instance])
+             : _instanceData[instance].instanceTransform;
+}
+
+Math::float3 SoftwareRenderer::instanceColor(size_t instance) const {
+  const Math::float4 color =
+      _instanceFormat == InstanceFormat::Compact
+          ? unpackUnorm4x8(_compactInstanceData[instance].color)
+          : _instanceData[instance].instanceColor;
+  return {color.x, color.y, color.z};
+}
+
+void SoftwareRenderer::draw() {
+  const float aspect = float(_framebuffer.width) / float(_framebuffer.height);
+
+  _scene.advance();
+  InstanceBuckets buckets;
+  if (_instanceFormat == InstanceFormat::Compact) {
+    _scene.writeVisibleInstanceData(_compactInstanceData.data(), aspect,
+        float(_framebuffer.height), _jobSystem, &buckets, &_cullStats);
+  } else {
+    _scene.writeVisibleInstanceData(_instanceData.data(), aspect,
+        float(_framebuffer.height), _jobSystem, &buckets, &_cullStats);
+  }
+  _scene.writeCameraData(&_cameraData, aspect);
+  _scene.writeLightData(&_lightData);
+
+  size_t numScreenVertices = 0;
+  size_t numTriangles      = 0;
+  for (size_t lod = 0; lod < kNumSphereLods; ++lod) {
+    Bucket& bucket           = _buckets[lod];
+    bucket.firstInstance     = buckets.first[lod];
+    bucket.numInstances      = buckets.count[lod];
+    bucket.firstScreenVertex = numScreenVertices;
+    bucket.firstTriangle     = numTriangles;
+
+    const size_t lodTriangles = bucket.pLod->numIndices / 3;
+    numScreenVertices += size_t(bucket.numInstances) * bucket.pLod->numVertices;
+    numTriangles += size_t(bucket.numInstances) * lodTriangles;
+    _lodStats.instances[lod] = bucket.numInstances;
+    _lodStats.triangles[lod] = uint64_t(bucket.numInstances) * lodTriangles;
+  }
+  _screenVertices.resize(numScreenVertices);
+
+  _jobSystem.parallelFor(_cullStats.visible, kInstancesPerChunk,
+      [this](size_t first, size_t last) {
+        for (size_t instance = first; instance < last; ++instance) {
+          shadeVertices(instance);
+        }
+      });
+  _jobSystem.parallelFor(numChunks(), 1, [this](size_t first, size_t last) {
+    for (size_t chunk = first; chunk < last; ++chunk) {
+      binTriangles(chunk);
+    }
+  });
+  _meshletStats = {};
+  for (size_t chunk = 0; chunk < numChunks(); ++chunk) {
+    _meshletStats.triangles += _chunkMeshletStats[chunk].triangles;
+    _meshletStats.backFacing += _chunkMeshletStats[chunk].backFacing;
+    _meshletStats.outsideFrustum += _chunkMeshletStats[chunk].outsideFrustum;
+  }
+  _jobSystem.parallelFor(size_t(_tilesX) * _tilesY, 1,
+      [this](size_t first, size_t last) {
+        for (size_t tile = first; tile < last; ++tile) {
+          rasterizeTile(tile);
+        }
+      });
+}
+
+void SoftwareRenderer::shadeVertices(size_t instance) {
+  using Math::float4;
+
+  const Bucket&        bucket          = bucketOfInstance(instance);
+  const MeshLod&       lod             = *bucket.pLod;
+  const Math::float4x4 transform       = instanceTransform(instance);
+  const Math::float3x3 normalTransform = Math::discardTranslation(transform);
+  const Math::float4x4 viewProj        = _cameraData.perspectiveTransform *
+                                  _cameraData.worldTransform;
+  const float          halfWidth       = 0.5f * _framebuffer.width;
+  const float          halfHeight      = 0.5f * _framebuffer.height;
+
+  const bool    quantized = _vertexFormat == VertexFormat::Quantized;
+  const size_t  lodIndex  = &bucket - _buckets;
+  ScreenVertex* pOut      = &_screenVertices[bucket.firstScreenVertex +
+                                        (instance - bucket.firstInstance) *
+                                            lod.numVertices];
+  for (uint32_t v = 0; v < lod.numVertices; ++v) {
+    Math::float3 position;
+    Math::float3 normal;
+    if (quantized) {
+      const shader_types::QuantizedVertexData& vd =
+          _mesh->quantizedVertices[lod.firstVertex + v];
+      position = dequantizePosition(vd, _mesh->quantizations[lodIndex]);
+      normal   = decodeOctahedral(vd.normal);
+    } else {
+      const shader_types::VertexData& vd = _mesh->vertices[lod.firstVertex + v];
+      position                           = vd.position;
+      normal                             = vd.normal;
+    }
+    float4 pos      = {position.x, position.y, position.z, 1.f};
+    float4 worldPos = transform * pos;
+    float4 clipPos  = viewProj * worldPos;
+
+    ScreenVertex& sv = *pOut++;
+    sv.invW          = clipPos.w > 0.f ? 1.f / clipPos.w : 0.f;
+    sv.x             = (clipPos.x * sv.invW + 1.f) * halfWidth;
+    sv.y             = (1.f - clipPos.y * sv.invW) * halfHeight;
+    sv.z             = clipPos.z * sv.invW;
+    sv.worldPos      = {worldPos.x, worldPos.y, worldPos.z};
+    sv.normal        = Math::normalize(normalTransform * normal);
+  }
+}
+
+void SoftwareRenderer::binTriangles(size_t chunk) {
+  const size_t numTiles     = size_t(_tilesX) * _tilesY;
+  const size_t first        = chunk * kInstancesPerChunk;
+  const size_t last         = std::min<size_t>(
+      first + kInstancesPerChunk, _cullStats.visible);
+  const float width  = float(_framebuffer.width);
+  const float height = float(_framebuffer.height);
+  const Math::float4x4 viewProj = _cameraData.perspectiveTransform *
+                                  _cameraData.worldTransform;
+
+  std::vector<uint32_t>* pBins = &_bins[chunk * numTiles];
+  for (size_t tile = 0; tile < numTiles; ++tile) {
+    pBins[tile].clear();
+  }
+  MeshletStats& stats = _chunkMeshletStats[chunk];
+  stats               = {};
+
+  for (size_t instance = first; instance < last; ++instance) {
+    const Bucket&       bucket       = bucketOfInstance(instance);
+    const MeshLod&      lod          = *bucket.pLod;
+    const size_t        numTriangles = lod.numIndices / 3;
+    const size_t        local        = instance - bucket.firstInstance;
+    const ScreenVertex* pVerts       = &_screenVertices[
+        bucket.firstScreenVertex + local * lod.numVertices];
+    stats.triangles += numTriangles;
+
+    // A single meshlet's bounds are the instance's, which scene culling
+    // already tested, so only LODs split into several are worth the setup.
+    const bool         cull = _meshletCulling && lod.numMeshlets > 1;
+    MeshletCullContext context;
+    if (cull) {
+      context = makeMeshletCullContext(
+          viewProj, _cameraData.cameraPosition, instanceTransform(instance));
+    }
+
+    // Meshlets cover the LOD's triangles in order, so a culled meshlet is a
+    // skipped range of t.
+    for (uint32_t m = 0; m < lod.numMeshlets; ++m) {
+      const Meshlet&    meshlet = _mesh->meshlets[lod.firstMeshlet + m];
+      MeshletVisibility visibility = MeshletVisibility::Visible;
+      if (cull) {
+        visibility = cullMeshlet(
+            _mesh->meshletBounds[lod.firstMeshlet + m], context);
+      }
+      if (visibility == MeshletVisibility::BackFacing) {
+        stats.backFacing += meshlet.numTriangles;
+      } else if (visibility == MeshletVisibility::OutsideFrustum) {
+        stats.outsideFrustum += meshlet.numTriangles;
+      }
+      if (visibility != MeshletVisibility::Visible) continue;
+
+      const size_t end = meshlet.firstTriangle + meshlet.numTriangles;
+      for (size_t t = meshlet.firstTriangle; t < end; ++t) {
+        const size_t        i = lod.firstIndex + t * 3;
+        const ScreenVertex& a = pVerts[_mesh->index(i + 0)];
+        const ScreenVertex& b = pVerts[_mesh->index(i + 1)];
+        const ScreenVertex& c = pVerts[_mesh->index(i + 2)];
+
+        // Triangles reaching past the near plane are dropped rather than
+        // clipped; the grid always sits well inside the frustum.
+        if (a.invW <= 0.f || b.invW <= 0.f || c.invW <= 0.f) continue;
+        if (a.z < 0.f || b.z < 0.f || c.z < 0.f) continue;
+        if (a.z > 1.f && b.z > 1.f && c.z > 1.f) continue;
+
+        // Screen space is y-down, so Metal's counter-clockwise front faces
+        // (CullModeBack) end up with a positive signed area here.
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (area <= 0.f) continue;
+
+        float minX = std::max(std::min({a.x, b.x, c.x}), 0.f);
+        float minY = std::max(std::min({a.y, b.y, c.y}), 0.f);
+        float maxX = std::min(std::max({a.x, b.x, c.x}), width - 1.f);
+        float maxY = std::min(std::max({a.y, b.y, c.y}), height - 1.f);
+        if (minX > maxX || minY > maxY) continue;
+
+        const uint32_t triangle = uint32_t(
+            bucket.firstTriangle + local * numTriangles + t);
+        const uint32_t tx0      = uint32_t(minX) / kTileSize;
+        const uint32_t ty0      = uint32_t(minY) / kTileSize;
+        const uint32_t tx1      = uint32_t(maxX) / kTileSize;
+        const uint32_t ty1      = uint32_t(maxY) / kTileSize;
+        for (uint32_t ty = ty0; ty <= ty1; ++ty) {
+          for (uint32_t tx = tx0; tx <= tx1; ++tx) {
+            pBins[ty * _tilesX + tx].push_back(triangle);
+          }
+        }
+      }
+    }
+  }
+}
+
+void SoftwareRenderer::rasterizeTile(size_t tile) {
+  using Math::float3;
+
+  const size_t   numTiles     = size_t(_tilesX) * _tilesY;
+  const size_t   numChunks    = this->numChunks();
+  const uint32_t x0           = uint32_t(tile % _tilesX) * kTileSize;
+  const uint32_t y0           = uint32_t(tile / _tilesX) * kTileSize;
+  const uint32_t x1 = std::min(x0 + kTileSize, _framebuffer.width);
+  const uint32_t y1 = std::min(y0 + kTileSize, _framebuffer.height);
+
+  // Visibility buffer: the nearest triangle and its screen-space
+  // barycentrics per pixel, so each pixel is shaded exactly once.
+  float    depth[kTileSize * kTileSize];
+  uint32_t triangles[kTileSize * kTileSize];
+  float    bary1[kTileSize * kTileSize];
+  float    bary2[kTileSize * kTileSize];
+  std::fill_n(depth, kTileSize * kTileSize, 1.f);
+  std::fill_n(triangles, kTileSize * kTileSize, kInvalidTriangle);
+
+  // Maps a triangle id back to its instance and the screen vertex behind
+  // one of its corners.
+  auto instanceOf = [&](uint32_t triangle) -> size_t {
+    const Bucket& bucket       = bucketOfTriangle(triangle);
+    const size_t  numTriangles = bucket.pLod->numIndices / 3;
+    return bucket.firstInstance +
+           (triangle - bucket.firstTriangle) / numTriangles;
+  };
+  auto vertexOf = [&](uint32_t triangle, int corner) -> const ScreenVertex& {
+    const Bucket&  bucket       = bucketOfTriangle(triangle);
+    const MeshLod& lod          = *bucket.pLod;
+    const size_t   numTriangles = lod.numIndices / 3;
+    const size_t   local        = triangle - bucket.firstTriangle;
+    const size_t   t            = local % numTriangles;
+    return _screenVertices[bucket.firstScreenVertex +
+                           local / numTriangles * lod.numVertices +
+                           _mesh->index(lod.firstIndex + t * 3 + corner)];
+  };
+
+  for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+    for (uint32_t triangle : _bins[chunk * numTiles + tile]) {
+      const ScreenVertex& a = vertexOf(triangle, 0);
+      const ScreenVertex& b = vertexOf(triangle, 1);
+      const ScreenVertex& c = vertexOf(triangle, 2);
+
+      const float area    = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+      const float invArea = 1.f / area;
+
+      const int minX = std::max(
+          int(std::floor(std::min({a.x, b.x, c.x}) - 0.5f)), int(x0));
+      const int minY = std::max(
+          int(std::floor(std::min({a.y, b.y, c.y}) - 0.5f)), int(y0));
+      const int maxX = std::min(
+          int(std::ceil(std::max({a.x, b.x, c.x}) - 0.5f)), int(x1) - 1);
+      const int maxY = std::min(
+          int(std::ceil(std::max({a.y, b.y, c.y}) - 0.5f)), int(y1) - 1);
+
+      // Edge functions at the first pixel center and their per-pixel steps.
+      const float px  = minX + 0.5f;
+      const float py  = minY + 0.5f;
+      float       w0y = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+      float       w1y = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+      float       w2y = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+
+      for (int y = minY; y <= maxY; ++y) {
+        float w0 = w0y;
+        float w1 = w1y;
+        float w2 = w2y;
+        for (int x = minX; x <= maxX; ++x) {
+          if (w0 >= 0.f && w1 >= 0.f && w2 >= 0.f) {
+            const float l1 = w1 * invArea;
+            const float l2 = w2 * invArea;
+            const float z  = a.z + l1 * (b.z - a.z) + l2 * (c.z - a.z);
+
+            const size_t p = size_t(y - y0) * kTileSize + size_t(x - x0);
+            if (z >= 0.f && z < depth[p]) {
+              depth[p]     = z;
+              triangles[p] = triangle;
+              bary1[p]     = l1;
+              bary2[p]     = l2;
+            }
+          }
+          w0 -= c.y - b.y;
+          w1 -= a.y - c.y;
+          w2 -= b.y - a.y;
+        }
+        w0y += c.x - b.x;
+        w1y += a.x - c.x;
+        w2y += b.x - a.x;
+      }
+    }
+  }
+
+  const uint32_t clearColor = packColor(0.1f, 0.1f, 0.1f);
+  for (uint32_t y = y0; y < y1; ++y) {
+    uint32_t* pColor = &_framebuffer.color[size_t(y) * _framebuffer.width];
+    float*    pDepth = &_framebuffer.depth[size_t(y) * _framebuffer.width];
+    for (uint32_t x = x0; x < x1; ++x) {
+      const size_t   p        = size_t(y - y0) * kTileSize + size_t(x - x0);
+      const uint32_t triangle = triangles[p];
+      pDepth[x]               = depth[p];
+      if (triangle == kInvalidTriangle) {
+        pColor[x] = clearColor;
+        continue;
+      }
+
+      const ScreenVertex& a = vertexOf(triangle, 0);
+      const ScreenVertex& b = vertexOf(triangle, 1);
+      const ScreenVertex& c = vertexOf(triangle, 2);
+
+      // Perspective-correct interpolation of the v2f varyings.
+      float l0   = (1.f - bary1[p] - bary2[p]) * a.invW;
+      float l1   = bary1[p] * b.invW;
+      float l2   = bary2[p] * c.invW;
+      float norm = 1.f / (l0 + l1 + l2);
+      l0 *= norm;
+      l1 *= norm;
+      l2 *= norm;
+
+      float3 worldPos = a.worldPos * l0 + b.worldPos * l1 + c.worldPos * l2;
+      float3 normal   = a.normal * l0 + b.normal * l1 + c.normal * l2;
+
+      float3 color = shadeFragment(worldPos, normal,
+          instanceColor(instanceOf(triangle)), _cameraData, _lightData);
+      pColor[x] = packColor(color.x, color.y, color.z);
+    }
+  }
+}
@@ -0,0 +1,90 @@
+#include "UploadRing.hpp"
+
+#include <cassert>
+
+UploadRing::UploadRing()
+    : _pBase(nullptr)
+    , _capacity(0)
+    , _head(0)
+    , _lastOffset(0)
+    , _tail(0)
+    , _frameStart(0)
+    , _lastFrameBytes(0)
+    , _firstFrame(0)
+    , _numFrames(0)
+    , _nextFence(0)
+    , _completedFence(0) {}
+
+void UploadRing::reset(void* pBase, size_t capacity) {
+  _pBase      = static_cast<unsigned char*>(pBase);
+  _capacity   = capacity;
+  _head       = 0;
+  _lastOffset = 0;
+  _tail       = 0;
+  _frameStart = 0;
+  _firstFrame = 0;
+  _numFrames  = 0;
+}
+
+void UploadRing::beginFrame() {
+  const uint64_t completed = _completedFence.load(std::memory_order_acquire);
+  while (_numFrames > 0 && _frames[_firstFrame].fence <= completed) {
+    _tail       = _frames[_firstFrame].end;
+    _firstFrame = (_firstFrame + 1) % kMaxFramesInFlight;
+    --_numFrames;
+  }
+  if (_numFrames == 0) {
+    _tail = _head;
+  }
+  _frameStart = _head;
+}
+
+bool UploadRing::allocate(
+    size_t size, size_t alignment, Allocation* pAllocation) {
+  assert(alignment && !(alignment & (alignment - 1)));
+  if (_capacity == 0) {
+    return false;
+  }
+
+  // Allocations never straddle the end of the buffer: skip to the start of
+  // the next lap instead.
+  const uint64_t position = _head % _capacity;
+  uint64_t       aligned  = (position + alignment - 1) &
+                     ~uint64_t(alignment - 1);
+  if (aligned + size > _capacity) {
+    aligned = _capacity;
+  }
+  const uint64_t offset = _head - position + aligned;
+  if (offset % _capacity + size > _capacity ||
+      offset + size - _tail > _capacity) {
+    return false;
+  }
+
+  _lastOffset         = offset;
+  _head               = offset + size;
+  pAllocation->offset = size_t(offset % _capacity);
+  pAllocation->pData  = _pBase + pAllocation->offset;
+  return true;
+}
+
+void UploadRing::shrinkLastAllocation(size_t size) {
+  assert(_lastOffset >= _frameStart && _lastOffset + size <= _head);
+  _head = _lastOffset + size;
+}
+
+uint64_t UploadRing::endFrame() {
+  assert(_numFrames < kMaxFramesInFlight);
+  const uint64_t fence = ++_nextFence;
+  _frames[(_firstFrame + _numFrames) % kMaxFramesInFlight] = {fence, _head};
+  ++_numFrames;
+  _lastFrameBytes = size_t(_head - _frameStart);
+  return fence;
+}
+
+void UploadRing::signal(uint64_t fence) {
+  uint64_t completed = _completedFence.load(std::memory_order_relaxed);
+  while (completed < fence &&
+         !_completedFence.compare_exchange_weak(
+             completed, fence, std::memory_order_release)) {
+  }
+}
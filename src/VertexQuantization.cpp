@@ -0,0 +1,98 @@
+#include "VertexQuantization.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr float kUnorm16Max = 65535.f;
+constexpr float kSnorm16Max = 32767.f;
+
+uint16_t quantizeUnorm16(float value, float offset, float invScale) {
+  const float q = (value - offset) * invScale;
+  return uint16_t(std::min(std::max(q + 0.5f, 0.f), kUnorm16Max));
+}
+
+}  // namespace
+
+shader_types::VertexQuantization computeVertexQuantization(
+    const shader_types::VertexData* pVertices, size_t count) {
+  Math::float3 lo = {0.f, 0.f, 0.f};
+  Math::float3 hi = {0.f, 0.f, 0.f};
+  if (count > 0) {
+    lo = hi = pVertices[0].position;
+  }
+  for (size_t i = 1; i < count; ++i) {
+    const Math::float3& p = pVertices[i].position;
+    lo = {std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z)};
+    hi = {std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z)};
+  }
+
+  shader_types::VertexQuantization quantization;
+  quantization.offset = lo;
+  quantization.scale  = {(hi.x - lo.x) / kUnorm16Max,
+      (hi.y - lo.y) / kUnorm16Max, (hi.z - lo.z) / kUnorm16Max};
+  return quantization;
+}
+
+void quantizeVertices(shader_types::QuantizedVertexData* pDst,
+    const shader_types::VertexData* pVertices, size_t count,
+    const shader_types::VertexQuantization& quantization) {
+  const Math::float3& offset   = quantization.offset;
+  const Math::float3& scale    = quantization.scale;
+  const Math::float3  invScale = {scale.x > 0.f ? 1.f / scale.x : 0.f,
+      scale.y > 0.f ? 1.f / scale.y : 0.f,
+      scale.z > 0.f ? 1.f / scale.z : 0.f};
+  for (size_t i = 0; i < count; ++i) {
+    const Math::float3&                p = pVertices[i].position;
+    shader_types::QuantizedVertexData& q = pDst[i];
+    q.position[0] = quantizeUnorm16(p.x, offset.x, invScale.x);
+    q.position[1] = quantizeUnorm16(p.y, offset.y, invScale.y);
+    q.position[2] = quantizeUnorm16(p.z, offset.z, invScale.z);
+    q.padding     = 0;
+    encodeOctahedral(pVertices[i].normal, q.normal);
+  }
+}
+
+void encodeOctahedral(const Math::float3& normal, int16_t* pEncoded) {
+  // A zero normal has no direction; store +Z rather than dividing by zero.
+  const float l1 = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+  if (!(l1 > 0.f)) {
+    pEncoded[0] = 0;
+    pEncoded[1] = 0;
+    return;
+  }
+
+  // Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower
+  // hemisphere over the diagonals.
+  const float invL1 = 1.f / l1;
+  float x = normal.x * invL1;
+  float y = normal.y * invL1;
+  if (normal.z < 0.f) {
+    const float foldedX = (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f);
+    const float foldedY = (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f);
+    x                   = foldedX;
+    y                   = foldedY;
+  }
+
+  // Of the four lattice points around the exact encoding, keep the one
+  // that decodes closest to the normal. Distances are compared rather than
+  // dot products, which round to 1 at this precision.
+  const float fx   = std::floor(x * kSnorm16Max);
+  const float fy   = std::floor(y * kSnorm16Max);
+  float       best = std::numeric_limits<float>::max();
+  for (int corner = 0; corner < 4; ++corner) {
+    const int16_t candidate[2] = {
+        int16_t(std::min(std::max(fx + (corner & 1), -kSnorm16Max),
+            kSnorm16Max)),
+        int16_t(std::min(std::max(fy + (corner >> 1), -kSnorm16Max),
+            kSnorm16Max))};
+    const Math::float3 error    = decodeOctahedral(candidate) - normal;
+    const float        distance = Math::dot(error, error);
+    if (distance < best) {
+      best        = distance;
+      pEncoded[0] = candidate[0];
+      pEncoded[1] = candidate[1];
+    }
+  }
+}
@@ -13,12 +13,29 @@ struct VertexData {
     float3 normal;
 };
 
+struct QuantizedVertexData {
+    packed_ushort3 position;
+    ushort padding;
+    packed_short2 normal;
+};
+
+struct VertexQuantization {
+    float3 offset;
+    float3 scale;
+};
+
 struct InstanceData {
     float4x4 instanceTransform;
     float3x3 instanceNormalTransform;
     float4 instanceColor;
 };
 
+struct CompactInstanceData {
+    float4 transformRows[3];
+    uint color;
+    uint padding[3];
+};
+
 struct CameraData {
     float4x4 perspectiveTransform;
     float4x4 worldTransform;
@@ -35,27 +52,101 @@ struct LightData {
     float time;
 };
 
-v2f vertex vertexMain(device const VertexData* vertexData [[buffer(0)]],
-                      device const InstanceData* instanceData [[buffer(1)]],
-                      device const CameraData& cameraData [[buffer(2)]],
-                      uint vertexId [[vertex_id]],
-                      uint instanceId [[instance_id]]) {
+v2f shadeVertex(float3 position, float3 normal,
+                float4x4 instanceTransform,
+                float3x3 instanceNormalTransform,
+                half3 color,
+                const device CameraData& cameraData) {
     v2f o;
     
-    const device VertexData& vd = vertexData[vertexId];
-    float4 pos = float4(vd.position, 1.0);
+    float4 pos = float4(position, 1.0);
     
-    float4 worldPos = instanceData[instanceId].instanceTransform * pos;
+    float4 worldPos = instanceTransform * pos;
     o.worldPos = worldPos.xyz;
     o.position = cameraData.perspectiveTransform * cameraData.worldTransform * worldPos;
     
-    float3 worldNormal = instanceData[instanceId].instanceNormalTransform * vd.normal;
+    float3 worldNormal = instanceNormalTransform * normal;
     o.normal = normalize(worldNormal);
     
-    o.color = half3(instanceData[instanceId].instanceColor.rgb);
+    o.color = color;
     return o;
 }
 
+v2f shadeInstance(float3 position, float3 normal,
+                  const device InstanceData& instance,
+                  const device CameraData& cameraData) {
+    return shadeVertex(position, normal, instance.instanceTransform,
+                       instance.instanceNormalTransform,
+                       half3(instance.instanceColor.rgb), cameraData);
+}
+
+// The bottom row of an affine transform is always (0, 0, 0, 1).
+v2f shadeInstance(float3 position, float3 normal,
+                  const device CompactInstanceData& instance,
+                  const device CameraData& cameraData) {
+    float4x4 transform = transpose(float4x4(instance.transformRows[0],
+                                            instance.transformRows[1],
+                                            instance.transformRows[2],
+                                            float4(0.0, 0.0, 0.0, 1.0)));
+    float3x3 normalTransform = float3x3(transform[0].xyz, transform[1].xyz, transform[2].xyz);
+    half3 color = half3(unpack_unorm4x8_to_float(instance.color).rgb);
+    return shadeVertex(position, normal, transform, normalTransform, color, cameraData);
+}
+
+// Inverse of the octahedral mapping in VertexQuantization.cpp.
+float3 decodeOctahedral(short2 encoded) {
+    float2 e = max(float2(encoded) / 32767.0, -1.0);
+    float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += select(float2(t), float2(-t), n.xy >= 0.0);
+    return normalize(n);
+}
+
+float3 dequantizePosition(const device QuantizedVertexData& vd,
+                          constant VertexQuantization& quantization) {
+    return quantization.offset + quantization.scale * float3(ushort3(vd.position));
+}
+
+v2f vertex vertexMain(device const VertexData* vertexData [[buffer(0)]],
+                      device const InstanceData* instanceData [[buffer(1)]],
+                      device const CameraData& cameraData [[buffer(2)]],
+                      uint vertexId [[vertex_id]],
+                      uint instanceId [[instance_id]]) {
+    const device VertexData& vd = vertexData[vertexId];
+    return shadeInstance(vd.position, vd.normal, instanceData[instanceId], cameraData);
+}
+
+v2f vertex vertexMainQuantized(device const QuantizedVertexData* vertexData [[buffer(0)]],
+                               device const InstanceData* instanceData [[buffer(1)]],
+                               device const CameraData& cameraData [[buffer(2)]],
+                               constant VertexQuantization& quantization [[buffer(3)]],
+                               uint vertexId [[vertex_id]],
+                               uint instanceId [[instance_id]]) {
+    const device QuantizedVertexData& vd = vertexData[vertexId];
+    return shadeInstance(dequantizePosition(vd, quantization), decodeOctahedral(short2(vd.normal)),
+                         instanceData[instanceId], cameraData);
+}
+
+v2f vertex vertexMainCompact(device const VertexData* vertexData [[buffer(0)]],
+                             device const CompactInstanceData* instanceData [[buffer(1)]],
+                             device const CameraData& cameraData [[buffer(2)]],
+                             uint vertexId [[vertex_id]],
+                             uint instanceId [[instance_id]]) {
+    const device VertexData& vd = vertexData[vertexId];
+    return shadeInstance(vd.position, vd.normal, instanceData[instanceId], cameraData);
+}
+
+v2f vertex vertexMainQuantizedCompact(device const QuantizedVertexData* vertexData [[buffer(0)]],
+                                      device const CompactInstanceData* instanceData [[buffer(1)]],
+                                      device const CameraData& cameraData [[buffer(2)]],
+                                      constant VertexQuantization& quantization [[buffer(3)]],
+                                      uint vertexId [[vertex_id]],
+                                      uint instanceId [[instance_id]]) {
+    const device QuantizedVertexData& vd = vertexData[vertexId];
+    return shadeInstance(dequantizePosition(vd, quantization), decodeOctahedral(short2(vd.normal)),
+                         instanceData[instanceId], cameraData);
+}
+
 half4 fragment fragmentMain(v2f in [[stage_in]], 
                           constant CameraData& cameraData [[buffer(0)]],
                           constant LightData& lightData [[buffer(1)]]) {
@@ -0,0 +1,37 @@
+#ifndef BENCHUTIL_HPP
+#define BENCHUTIL_HPP
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Helpers shared by the self-checking benchmarks.
+
+// Prints one result line and passes `pass` through, so checks chain as
+// `ok = check(..., "what") && ok`.
+inline bool check(bool pass, const char* what) {
+  std::printf("%-48s %s\n", what, pass ? "ok" : "FAIL");
+  return pass;
+}
+
+// Creates an empty, uniquely named file in $TMPDIR (or /tmp) and returns
+// its path; the caller removes it. `suffix` keeps the extension loaders go
+// by. Exits if no file can be created, as nothing could be checked.
+inline std::string createTempFile(const char* name, const char* suffix) {
+  const char* pDir = std::getenv("TMPDIR");
+  std::string path = std::string(pDir && *pDir ? pDir : "/tmp") + "/" +
+                     name + "_XXXXXX" + suffix;
+  const int   fd   = mkstemps(&path[0], int(std::strlen(suffix)));
+  if (fd < 0) {
+    std::printf("%s: cannot create a temporary file\n", path.c_str());
+    std::exit(1);
+  }
+  close(fd);
+  return path;
+}
+
+#endif  // BENCHUTIL_HPP
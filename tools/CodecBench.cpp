@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.hpp"
+#include "Mesh.hpp"
+#include "MeshCodec.hpp"
+#include "MeshFile.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+bool vertexRoundTrip(const std::vector<unsigned char>& vertices,
+    size_t stride, std::vector<unsigned char>* pEncoded = nullptr) {
+  const size_t               count = vertices.size() / stride;
+  std::vector<unsigned char> encoded(vertexBufferBound(count, stride));
+  encoded.resize(
+      encodeVertexBuffer(encoded.data(), vertices.data(), count, stride));
+  std::vector<unsigned char> decoded(vertices.size() + 1, 0xCD);
+  const bool                 ok =
+      decodeVertexBuffer(
+          decoded.data(), count, stride, encoded.data(), encoded.size()) &&
+      std::equal(vertices.begin(), vertices.end(), decoded.begin()) &&
+      decoded.back() == 0xCD;
+  if (pEncoded) *pEncoded = std::move(encoded);
+  return ok;
+}
+
+bool indexRoundTrip(const std::vector<uint32_t>& indices,
+    IndexType indexType, std::vector<unsigned char>* pEncoded = nullptr) {
+  std::vector<uint16_t> narrow(indices.begin(), indices.end());
+  const void*           pIndices = indexType == IndexType::UInt16
+                                       ? static_cast<const void*>(narrow.data())
+                                       : indices.data();
+  std::vector<unsigned char> encoded(indexBufferBound(indices.size()));
+  encoded.resize(encodeIndexBuffer(
+      encoded.data(), pIndices, indices.size(), indexType));
+  std::vector<uint32_t> decoded(indices.size() + 1, 0xCDCDCDCD);
+  bool                  ok = decodeIndexBuffer(decoded.data(), indices.size(),
+      indexType, encoded.data(), encoded.size());
+  ok = ok && decoded.back() == 0xCDCDCDCD &&
+       (indices.empty() || std::memcmp(decoded.data(), pIndices,
+                               indices.size() * indexSize(indexType)) == 0);
+  if (pEncoded) *pEncoded = std::move(encoded);
+  return ok;
+}
+
+bool checkCodecs() {
+  std::mt19937 random(7);
+  bool         ok = true;
+
+  // Smooth columns, noise and constant padding, at sizes around the group
+  // and block boundaries.
+  bool vertices = true;
+  for (size_t stride : {4, 12, 32, 256}) {
+    for (size_t count : {0, 1, 15, 16, 17, 255, 256, 257, 1000}) {
+      std::vector<unsigned char> data(count * stride);
+      for (size_t i = 0; i < data.size(); ++i) {
+        const size_t k = i % stride;
+        data[i]        = k % 4 == 3   ? 0
+                         : k % 4 == 2 ? uint8_t(i / stride / 7)
+                                      : uint8_t(random());
+      }
+      vertices = vertexRoundTrip(data, stride) && vertices;
+    }
+  }
+  ok = check(vertices, "vertex buffers round-trip") && ok;
+
+  bool                  indices = true;
+  std::vector<uint32_t> sequence;
+  for (size_t count : {0, 1, 3, 4, 5, 63, 64, 65, 3001}) {
+    sequence.resize(count);
+    for (uint32_t& index : sequence) index = random() % 65536;
+    indices = indexRoundTrip(sequence, IndexType::UInt16) && indices;
+    for (uint32_t& index : sequence) index = uint32_t(random());
+    indices = indexRoundTrip(sequence, IndexType::UInt32) && indices;
+  }
+  ok = check(indices, "index buffers round-trip") && ok;
+
+  // Every truncation and a trailing byte are rejected; corrupted bytes
+  // must not make the decoders read or write out of bounds.
+  const SphereMesh            sphere(kSphereRadius, 24, 24);
+  const std::vector<uint32_t> sphereIndices = sphere.getIndices();
+  std::vector<unsigned char>  vertexData(
+      sphere.vertexCount() * sizeof(shader_types::VertexData));
+  std::vector<unsigned char> encodedVertices, encodedIndices;
+  sphere.writeVertices(
+      reinterpret_cast<shader_types::VertexData*>(vertexData.data()));
+  vertexRoundTrip(vertexData, sizeof(shader_types::VertexData),
+      &encodedVertices);
+  indexRoundTrip(sphereIndices, IndexType::UInt16, &encodedIndices);
+
+  std::vector<unsigned char> vertexOut(vertexData.size());
+  std::vector<uint16_t>      indexOut(sphereIndices.size());
+  auto decodeVertices = [&](const std::vector<unsigned char>& encoded,
+                            size_t size) {
+    return decodeVertexBuffer(vertexOut.data(), sphere.vertexCount(),
+        sizeof(shader_types::VertexData), encoded.data(), size);
+  };
+  auto decodeIndices = [&](const std::vector<unsigned char>& encoded,
+                           size_t size) {
+    return decodeIndexBuffer(indexOut.data(), sphereIndices.size(),
+        IndexType::UInt16, encoded.data(), size);
+  };
+  bool rejected = true;
+  for (size_t size = 0; size < encodedVertices.size(); ++size) {
+    rejected = !decodeVertices(encodedVertices, size) && rejected;
+  }
+  ok = check(rejected, "truncated vertex data is rejected") && ok;
+  rejected = true;
+  for (size_t size = 0; size < encodedIndices.size(); ++size) {
+    rejected = !decodeIndices(encodedIndices, size) && rejected;
+  }
+  encodedIndices.push_back(0);
+  rejected = !decodeIndices(encodedIndices, encodedIndices.size()) &&
+             rejected;
+  encodedIndices.pop_back();
+  ok = check(rejected, "truncated or padded index data is rejected") && ok;
+  for (int trial = 0; trial < 1000; ++trial) {
+    std::vector<unsigned char> corrupt = encodedVertices;
+    corrupt[1 + random() % (corrupt.size() - 1)] ^= 1 + random() % 255;
+    decodeVertices(corrupt, corrupt.size());
+    corrupt = encodedIndices;
+    corrupt[1 + random() % (corrupt.size() - 1)] ^= 1 + random() % 255;
+    decodeIndices(corrupt, corrupt.size());
+  }
+
+  // 32-bit indices do not decode into 16 bits.
+  sequence = {0, 1, 70000, 2};
+  std::vector<unsigned char> wide;
+  indexRoundTrip(sequence, IndexType::UInt32, &wide);
+  ok = check(!decodeIndexBuffer(indexOut.data(), sequence.size(),
+                 IndexType::UInt16, wide.data(), wide.size()),
+           "indices too wide for 16 bits are rejected") &&
+       ok;
+  return ok;
+}
+
+// Best decode time of several runs, in seconds.
+template <typename Decode>
+double bestDecodeSeconds(const Decode& decode) {
+  double     best  = 1e30;
+  const auto start = Clock::now();
+  for (int run = 0;
+       run < 5 || (Clock::now() - start < std::chrono::milliseconds(100) &&
+                   run < 100000);
+       ++run) {
+    const auto runStart = Clock::now();
+    decode();
+    best = std::min(best,
+        std::chrono::duration<double>(Clock::now() - runStart).count());
+  }
+  return best;
+}
+
+// Compresses a chain's vertex and index buffers and times decoding them.
+bool report(const char* name, const void* pVertices, size_t numVertices,
+    size_t stride, const void* pIndices, size_t numIndices,
+    IndexType indexType) {
+  const size_t               vertexBytes = numVertices * stride;
+  const size_t               indexBytes  = numIndices * indexSize(indexType);
+  std::vector<unsigned char> vertices(vertexBufferBound(numVertices, stride));
+  std::vector<unsigned char> indices(indexBufferBound(numIndices));
+  vertices.resize(
+      encodeVertexBuffer(vertices.data(), pVertices, numVertices, stride));
+  indices.resize(encodeIndexBuffer(
+      indices.data(), pIndices, numIndices, indexType));
+
+  std::vector<unsigned char> vertexOut(vertexBytes), indexOut(indexBytes);
+  bool                       ok = true;
+  const double vertexSeconds = bestDecodeSeconds([&] {
+    ok = decodeVertexBuffer(vertexOut.data(), numVertices, stride,
+             vertices.data(), vertices.size()) &&
+         ok;
+  });
+  const double indexSeconds = bestDecodeSeconds([&] {
+    ok = decodeIndexBuffer(indexOut.data(), numIndices, indexType,
+             indices.data(), indices.size()) &&
+         ok;
+  });
+  ok = ok && std::memcmp(vertexOut.data(), pVertices, vertexBytes) == 0 &&
+       std::memcmp(indexOut.data(), pIndices, indexBytes) == 0;
+
+  std::printf("%-24s %10.2f %8.2f %9.2f %10.2f %8.2f %9.2f\n", name,
+      vertexBytes / 1e6, double(vertexBytes) / vertices.size(),
+      vertexBytes / vertexSeconds / 1e9, indexBytes / 1e6,
+      double(indexBytes) / indices.size(), indexBytes / indexSeconds / 1e9);
+  return ok;
+}
+
+bool reportChain(const std::string& name, const MeshLodChain& chain) {
+  const bool  quantized = chain.vertexFormat == VertexFormat::Quantized;
+  const void* pVertices = quantized
+                              ? static_cast<const void*>(
+                                    chain.quantizedVertices.data())
+                              : chain.vertices.data();
+  return report(name.c_str(), pVertices,
+      quantized ? chain.quantizedVertices.size() : chain.vertices.size(),
+      vertexSize(chain.vertexFormat), chain.indexData.data(),
+      chain.indexData.size() / indexSize(chain.indexType), chain.indexType);
+}
+
+// A single optimized mesh in both vertex formats.
+MeshLodChain createChain(const Mesh& mesh, VertexFormat vertexFormat) {
+  std::vector<std::unique_ptr<Mesh>> meshes;
+  meshes.push_back(std::make_unique<OptimizedMesh>(mesh));
+  return createMeshLodChain(meshes, vertexFormat);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  bool ok = checkCodecs();
+
+  std::printf("\n%-24s %10s %8s %9s %10s %8s %9s\n", "mesh", "vert MB",
+      "ratio", "GB/s", "index MB", "ratio", "GB/s");
+  bool reported = true;
+  for (VertexFormat format : {VertexFormat::Float, VertexFormat::Quantized}) {
+    const std::string suffix =
+        format == VertexFormat::Float ? "" : " (quantized)";
+    const SphereMesh    sphere(kSphereRadius, 1024, 1024);
+    const IcosphereMesh icosphere(kSphereRadius, TessellationTarget{1e-5f});
+    reported = reportChain("sphere lods" + suffix,
+                   createSphereLodChain(format)) &&
+               reported;
+    reported = reportChain("sphere 1024" + suffix,
+                   createChain(sphere, format)) &&
+               reported;
+    reported = reportChain("icosphere" + suffix,
+                   createChain(icosphere, format)) &&
+               reported;
+  }
+
+  // Loaded meshes, converted with meshconvert.
+  for (int i = 1; i < argc; ++i) {
+    MeshFile    file;
+    std::string error;
+    if (!file.open(argv[i], &error)) {
+      std::printf("%s\n", error.c_str());
+      return 1;
+    }
+    reported = report(argv[i], file.vertexData(), file.numVertices(),
+                   vertexSize(file.vertexFormat()), file.indexData(),
+                   file.indexDataSize() / indexSize(file.indexType()),
+                   file.indexType()) &&
+               reported;
+  }
+  std::printf("(ratio is raw / encoded size; GB/s is decoded bytes per "
+              "second)\n");
+  ok = check(reported, "benchmarked buffers decode exactly") && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "BenchUtil.hpp"
+#include "Culling.hpp"
+#include "OcclusionCuller.hpp"
+
+// Checks the frustum planes, the SIMD sphere culler against the scalar
+// reference and the occlusion culler on a known scene, then times both
+// sphere cullers. Built per backend by `make bench`.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr float kFov    = 1.0471976f;  // 60 degrees
+constexpr float kAspect = 1.5f;
+constexpr float kNear   = 0.1f;
+constexpr float kFar    = 100.f;
+
+float planeDistance(const Math::float4& plane, const Math::float3& p) {
+  return plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w;
+}
+
+// Signed distance to the slab of `plane` the clip-space test puts it in:
+// x >= -w, x <= w, y >= -w, y <= w, z >= 0, z <= w, unnormalized.
+float clipDistance(const Math::float4& clip, int plane) {
+  switch (plane) {
+    case 0: return clip.w + clip.x;
+    case 1: return clip.w - clip.x;
+    case 2: return clip.w + clip.y;
+    case 3: return clip.w - clip.y;
+    case 4: return clip.z;
+    default: return clip.w - clip.z;
+  }
+}
+
+bool checkFrustum(std::mt19937& random) {
+  // A camera at (3, -2, 8), turned, looking down its -z axis.
+  const Math::float4x4 viewFromWorld =
+      Math::makeXRotate(0.3f) * Math::makeYRotate(-0.8f) *
+      Math::makeTranslate({-3.f, 2.f, -8.f});
+  const Math::float4x4 clipFromView = Math::makePerspective(
+      kFov, kAspect, kNear, kFar);
+  const Frustum frustum = extractFrustum(clipFromView * viewFromWorld);
+
+  bool unit = true;
+  for (const Math::float4& plane : frustum.planes) {
+    unit = unit && fabsf(Math::length(plane.xyz()) - 1.f) < 1e-5f;
+  }
+
+  // Every plane agrees in sign with its clip-space inequality, and the
+  // near and far planes measure world distance along the view axis.
+  std::uniform_real_distribution<float> coordinate(-120.f, 120.f);
+
+  const Math::float4x4 worldFromView = Math::makeTranslate({3.f, -2.f, 8.f}) *
+                                       Math::makeYRotate(0.8f) *
+                                       Math::makeXRotate(-0.3f);
+  bool signs = true, distances = true;
+  for (int i = 0; i < 100000; ++i) {
+    const Math::float3 view  = {
+        coordinate(random), coordinate(random), coordinate(random)};
+    const Math::float4 world = worldFromView *
+                               Math::float4{view.x, view.y, view.z, 1.f};
+    const Math::float3 p     = world.xyz();
+    const Math::float4 clip  = clipFromView *
+                              Math::float4{view.x, view.y, view.z, 1.f};
+    for (int plane = 0; plane < 6; ++plane) {
+      const float distance = planeDistance(frustum.planes[plane], p);
+      const float expected = clipDistance(clip, plane);
+      if (fabsf(expected) > 1e-3f * (fabsf(clip.w) + 1.f)) {
+        signs = signs && (distance >= 0.f) == (expected >= 0.f);
+      }
+    }
+    // The far plane is a difference of nearly equal rows, good to a few
+    // float ulps of the point's coordinates.
+    const float tolerance = 1e-4f * (1.f + Math::length(view));
+    const float nearError = planeDistance(frustum.planes[4], p) -
+                            (-view.z - kNear);
+    const float farError  = planeDistance(frustum.planes[5], p) -
+                           (kFar + view.z);
+    distances = distances && fabsf(nearError) <= tolerance &&
+                fabsf(farError) <= tolerance;
+  }
+
+  bool ok = check(unit, "frustum planes are normalized");
+  ok = check(signs, "frustum planes match the clip-space test") && ok;
+  ok = check(distances, "near and far planes measure view depth") && ok;
+  return ok;
+}
+
+// Spheres in a box around the view frustum, a third of them inside it.
+struct Spheres {
+  std::vector<float> x, y, z, radius;
+
+  SphereBounds bounds() const {
+    return {x.data(), y.data(), z.data(), radius.data()};
+  }
+};
+
+Spheres randomSpheres(size_t count, std::mt19937& random) {
+  std::uniform_real_distribution<float> coordinate(-60.f, 60.f);
+  std::uniform_real_distribution<float> depth(-110.f, 10.f);
+  std::uniform_real_distribution<float> radius(0.f, 4.f);
+  Spheres                               spheres;
+  for (size_t i = 0; i < count; ++i) {
+    spheres.x.push_back(coordinate(random));
+    spheres.y.push_back(coordinate(random));
+    spheres.z.push_back(depth(random));
+    spheres.radius.push_back(radius(random));
+  }
+  return spheres;
+}
+
+// Whether sphere i touches one of the planes to within rounding, where the
+// SIMD path's fused multiply-adds may round the other way.
+bool onPlane(const Frustum& frustum, const Spheres& spheres, size_t i) {
+  for (const Math::float4& plane : frustum.planes) {
+    const float distance =
+        planeDistance(plane, {spheres.x[i], spheres.y[i], spheres.z[i]}) +
+        spheres.radius[i];
+    if (fabsf(distance) < 1e-4f) return true;
+  }
+  return false;
+}
+
+bool checkSimd(const Frustum& frustum, const Spheres& spheres,
+    uint32_t baseIndex) {
+  const size_t          count = spheres.x.size();
+  std::vector<uint32_t> simd(count), scalar(count);
+  simd.resize(cullSpheres(
+      frustum, spheres.bounds(), count, baseIndex, simd.data()));
+  scalar.resize(cullSpheresScalar(
+      frustum, spheres.bounds(), count, baseIndex, scalar.data()));
+
+  std::vector<uint32_t> differ;
+  std::set_symmetric_difference(simd.begin(), simd.end(), scalar.begin(),
+      scalar.end(), std::back_inserter(differ));
+  bool ok = std::is_sorted(simd.begin(), simd.end());
+  for (uint32_t index : differ) {
+    ok = ok && index >= baseIndex && index - baseIndex < count &&
+         onPlane(frustum, spheres, index - baseIndex);
+  }
+  return ok;
+}
+
+bool checkOcclusion() {
+  // Camera at the origin looking down -z. A ball of radius 2 at depth 5
+  // hides a small one straight behind it, but not one off to the side or
+  // one in front of it.
+  const Math::float4x4 clipFromModel = Math::makePerspective(
+      kFov, kAspect, kNear, kFar);
+  const float          occluderX[]   = {0.f};
+  const float          occluderY[]   = {0.f};
+  const float          occluderZ[]   = {-5.f};
+  const float          occluderR[]   = {2.f};
+  const float          x[]           = {0.f, 8.f, 0.f};
+  const float          y[]           = {0.f, 0.f, 0.f};
+  const float          z[]           = {-20.f, -20.f, -2.f};
+  const float          r[]           = {0.5f, 0.5f, 0.5f};
+  const uint32_t       indices[]     = {10, 11, 12};
+
+  OcclusionCuller culler;
+  culler.beginFrame(clipFromModel);
+  culler.addOccluders({occluderX, occluderY, occluderZ, occluderR}, 1);
+  culler.buildHierarchy();
+  uint32_t     visible[3];
+  const size_t numVisible = culler.cullSpheres(
+      {x, y, z, r}, 3, indices, visible);
+  return check(numVisible == 2 && visible[0] == 11 && visible[1] == 12,
+      "an occluder hides the sphere behind it");
+}
+
+template <typename Fn>
+double nanosecondsPerSphere(size_t count, int passes, const Fn& fn) {
+  fn();  // warm up
+  auto start = Clock::now();
+  for (int pass = 0; pass < passes; ++pass) {
+    fn();
+  }
+  std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+  return elapsed.count() / (double(count) * passes);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                : size_t(1) << 20;
+  std::mt19937 random(11);
+
+  bool ok = checkFrustum(random);
+
+  const Frustum frustum = extractFrustum(
+      Math::makePerspective(kFov, kAspect, kNear, kFar) *
+      Math::makeYRotate(0.2f));
+  bool simd = true;
+  for (size_t n : {0, 1, 3, 15, 16, 17, 100003}) {
+    simd = checkSimd(frustum, randomSpheres(n, random), 7) && simd;
+  }
+  ok = check(simd, "SIMD sphere culling matches the scalar path") && ok;
+  ok = checkOcclusion() && ok;
+
+  const Spheres         spheres = randomSpheres(count, random);
+  std::vector<uint32_t> visible(count);
+  size_t                numVisible = 0;
+  const double          scalarNs   = nanosecondsPerSphere(count, 10, [&] {
+    numVisible = cullSpheresScalar(
+        frustum, spheres.bounds(), count, 0, visible.data());
+  });
+  const double          simdNs     = nanosecondsPerSphere(count, 10, [&] {
+    numVisible = cullSpheres(
+        frustum, spheres.bounds(), count, 0, visible.data());
+  });
+
+  const size_t lanes = cullLanes();
+  std::printf("\nculler %-6s  %zu spheres, %zu per iteration, %zu visible\n",
+      lanes == 16  ? "avx512"
+      : lanes == 8 ? "avx2"
+      : lanes == 4 ? "sse4"
+                   : "scalar",
+      count, lanes, numVisible);
+  std::printf("  scalar  %7.2f ns/sphere\n", scalarNs);
+  std::printf("  SIMD    %7.2f ns/sphere  (%.2fx)\n", simdNs,
+      scalarNs / simdNs);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.hpp"
+#include "GlbLoader.hpp"
+
+namespace {
+
+using shader_types::VertexData;
+
+void appendU32(std::string* pOut, uint32_t value) {
+  pOut->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Writes a GLB holding `json` and `bin`. The JSON is padded so that the
+// binary chunk starts 16-byte aligned, as VertexData views require.
+bool writeGlb(const char* path, std::string json, const std::string& bin) {
+  while ((20 + json.size() + 8) % 16 != 0) json += ' ';
+  std::string header;
+  appendU32(&header, 0x46546C67);
+  appendU32(&header, 2);
+  appendU32(&header, uint32_t(12 + 8 + json.size() + 8 + bin.size()));
+  appendU32(&header, uint32_t(json.size()));
+  appendU32(&header, 0x4E4F534A);
+  std::string binHeader;
+  appendU32(&binHeader, uint32_t(bin.size()));
+  appendU32(&binHeader, 0x004E4942);
+
+  FILE* pFile = std::fopen(path, "wb");
+  if (!pFile) return false;
+  const std::string* parts[] = {&header, &json, &binHeader, &bin};
+  for (const std::string* pPart : parts) {
+    std::fwrite(pPart->data(), 1, pPart->size(), pFile);
+  }
+  return std::fclose(pFile) == 0;
+}
+
+template <typename T>
+void appendArray(std::string* pOut, const T* pData, size_t count) {
+  pOut->append(reinterpret_cast<const char*>(pData), count * sizeof(T));
+}
+
+// Writes `mesh` as a one-primitive GLB with u32 indices, wound the glTF
+// way so that loading restores the mesh's own winding. `interleaved`
+// stores the vertices exactly as VertexData; otherwise positions and
+// normals are packed in separate buffer views, as most exporters do.
+bool writeMeshGlb(const char* path, const Mesh& mesh, bool interleaved) {
+  const std::vector<VertexData> vertices = mesh.getVertices();
+  std::vector<uint32_t>         indices  = mesh.getIndices();
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    std::swap(indices[i + 1], indices[i + 2]);
+  }
+  const size_t n = vertices.size();
+
+  std::string bin;
+  char        views[512];
+  if (interleaved) {
+    appendArray(&bin, vertices.data(), n);
+    std::snprintf(views, sizeof(views),
+        "{\"buffer\":0,\"byteLength\":%zu,\"byteStride\":32},"
+        "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}",
+        bin.size(), bin.size(), indices.size() * 4);
+  } else {
+    std::vector<float> packed(3 * n);
+    for (size_t i = 0; i < n; ++i) {
+      std::memcpy(&packed[3 * i], &vertices[i].position, 12);
+    }
+    appendArray(&bin, packed.data(), packed.size());
+    for (size_t i = 0; i < n; ++i) {
+      std::memcpy(&packed[3 * i], &vertices[i].normal, 12);
+    }
+    appendArray(&bin, packed.data(), packed.size());
+    std::snprintf(views, sizeof(views),
+        "{\"buffer\":0,\"byteLength\":%zu},"
+        "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+        "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}",
+        12 * n, 12 * n, 12 * n, 24 * n, indices.size() * 4);
+  }
+  appendArray(&bin, indices.data(), indices.size());
+
+  char accessors[512];
+  std::snprintf(accessors, sizeof(accessors),
+      "{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,"
+      "\"type\":\"VEC3\"},"
+      "{\"bufferView\":%d,\"byteOffset\":%d,\"componentType\":5126,"
+      "\"count\":%zu,\"type\":\"VEC3\"},"
+      "{\"bufferView\":%d,\"componentType\":5125,\"count\":%zu,"
+      "\"type\":\"SCALAR\"}",
+      n, interleaved ? 0 : 1, interleaved ? 16 : 0, n, interleaved ? 1 : 2,
+      indices.size());
+  const std::string json =
+      std::string("{\"asset\":{\"version\":\"2.0\"},") +
+      "\"buffers\":[{\"byteLength\":" + std::to_string(bin.size()) + "}]," +
+      "\"bufferViews\":[" + views + "],\"accessors\":[" + accessors + "]," +
+      "\"meshes\":[{\"name\":\"sphere\",\"primitives\":[{\"attributes\":" +
+      "{\"POSITION\":0,\"NORMAL\":1},\"indices\":2}]}]}";
+  return writeGlb(path, json, bin);
+}
+
+bool sameVertices(const Mesh& a, const Mesh& b) {
+  const std::vector<VertexData> va = a.getVertices();
+  const std::vector<VertexData> vb = b.getVertices();
+  if (va.size() != vb.size() || a.getIndices() != b.getIndices()) {
+    return false;
+  }
+  for (size_t i = 0; i < va.size(); ++i) {
+    if (std::memcmp(&va[i].position, &vb[i].position, 12) != 0 ||
+        std::memcmp(&va[i].normal, &vb[i].normal, 12) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool load(const std::string& path, JobSystem& jobSystem,
+    std::vector<std::unique_ptr<GlbMesh>>* pMeshes,
+    std::string* pError = nullptr) {
+  pMeshes->clear();
+  return GlbMesh::load(path.c_str(), jobSystem, pMeshes, pError);
+}
+
+bool checkLoader(const std::string& path, JobSystem& jobSystem) {
+  bool                                  ok = true;
+  std::vector<std::unique_ptr<GlbMesh>> meshes;
+  const SphereMesh                      sphere(kSphereRadius, 32, 32);
+
+  // Both layouts give back the sphere exactly; only the interleaved one
+  // is used in place.
+  for (bool interleaved : {true, false}) {
+    const bool loaded = writeMeshGlb(path.c_str(), sphere, interleaved) &&
+                        load(path, jobSystem, &meshes) && meshes.size() == 1;
+    ok = check(loaded && meshes[0]->isMapped() == interleaved &&
+                   meshes[0]->name() == "sphere" &&
+                   sameVertices(*meshes[0], sphere),
+             interleaved ? "interleaved sphere is mapped and exact"
+                         : "separate sphere is converted and exact") &&
+         ok;
+  }
+
+  // A non-indexed triangle without normals, counter-clockwise in glTF,
+  // gets a flat normal facing +z, and a u8-indexed copy of it in a second
+  // primitive loads the same. Points are skipped.
+  const float triangle[9] = {0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f};
+  std::string bin(reinterpret_cast<const char*>(triangle), sizeof(triangle));
+  bin += std::string("\0\1\2\0", 4);
+  const std::string views =
+      "\"bufferViews\":[{\"buffer\":0,\"byteLength\":36},"
+      "{\"buffer\":0,\"byteOffset\":36,\"byteLength\":3}],";
+  const std::string accessors =
+      "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":3,"
+      "\"type\":\"VEC3\"},{\"bufferView\":1,\"componentType\":5121,"
+      "\"count\":3,\"type\":\"SCALAR\"}],";
+  const std::string buffers = "\"buffers\":[{\"byteLength\":40}],";
+  // Escapes in skipped strings must parse too.
+  const std::string asset =
+      "\"asset\":{\"version\":\"2.0\","
+      "\"generator\":\"\\u00e9\\ud83d\\ude00 \\\"quoted\\\"\"},";
+  writeGlb(path.c_str(),
+      "{" + asset + buffers + views + accessors +
+          "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0}},"
+          "{\"attributes\":{\"POSITION\":0},\"indices\":1},"
+          "{\"attributes\":{\"POSITION\":0},\"mode\":0}]}]}",
+      bin);
+  ok = check(load(path, jobSystem, &meshes) && meshes.size() == 2 &&
+                 meshes[0]->name() == "mesh0/0" &&
+                 meshes[0]->getIndices() == std::vector<uint32_t>{0, 1, 2} &&
+                 meshes[0]->getVertices()[1].position.y == 1.f &&
+                 meshes[0]->getVertices()[0].normal.z == 1.f &&
+                 sameVertices(*meshes[0], *meshes[1]),
+           "flat normals, u8 indices, skipped points") &&
+       ok;
+
+  // Errors name the problem.
+  std::string error;
+  bin[38] = 3;
+  writeGlb(path.c_str(),
+      "{" + buffers + views + accessors +
+          "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},"
+          "\"indices\":1}]}]}",
+      bin);
+  ok = check(!load(path, jobSystem, &meshes, &error) &&
+                 error == path + ": mesh0: vertex index out of range",
+           "out-of-range index is reported") &&
+       ok;
+  writeGlb(path.c_str(),
+      "{" + buffers + views +
+          "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,"
+          "\"count\":4,\"type\":\"VEC3\"}],"
+          "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0}}]}]}",
+      bin);
+  ok = check(!load(path, jobSystem, &meshes, &error) &&
+                 error == path + ": accessor 0 exceeds its buffer view",
+           "accessor overrunning its view is reported") &&
+       ok;
+  // Strides glTF forbids; the second would also wrap the accessor's
+  // length past 2^64 if it were multiplied out.
+  bool rejected = true;
+  for (const char* pStride : {"14", "4503599627370496"}) {
+    writeGlb(path.c_str(),
+        "{" + buffers +
+            "\"bufferViews\":[{\"buffer\":0,\"byteLength\":36,"
+            "\"byteStride\":" + pStride + "}],"
+            "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,"
+            "\"count\":4097,\"type\":\"VEC3\"}],"
+            "\"meshes\":[{\"primitives\":[{\"attributes\":"
+            "{\"POSITION\":0}}]}]}",
+        bin);
+    rejected = !load(path, jobSystem, &meshes, &error) &&
+               error == path + ": buffer view 0 has an invalid byte stride" &&
+               rejected;
+  }
+  ok = check(rejected, "invalid byte strides are reported") && ok;
+  writeGlb(path.c_str(), "{\"meshes\":[{]}", "");
+  ok = check(!load(path, jobSystem, &meshes, &error) &&
+                 error == path + ": invalid JSON at byte 12",
+           "malformed JSON is reported") &&
+       ok;
+  std::remove(path.c_str());
+  return ok;
+}
+
+double milliseconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  unsigned int megabytes  = 128;
+  unsigned int numThreads = std::thread::hardware_concurrency();
+  if (argc > 3 || (argc >= 2 && (megabytes = std::atoi(argv[1])) == 0) ||
+      (argc == 3 && (numThreads = std::atoi(argv[2])) == 0)) {
+    std::printf("usage: %s [megabytes] [threads]\n", argv[0]);
+    return 1;
+  }
+  JobSystem jobSystem(numThreads);
+
+  const std::string path = createTempFile("glb_bench", ".glb");
+  bool ok = checkLoader(path, jobSystem);
+
+  // The interleaved layout takes 32 bytes per vertex and 24 of indices.
+  const auto stacks = unsigned(std::sqrt(megabytes * 1e6 / 56.0));
+  const SphereMesh sphere(kSphereRadius, stacks, stacks);
+  std::vector<VertexData> upload(sphere.vertexCount());
+  std::printf("\n%u threads, %u^2 sphere, best of 3, page cache warm\n",
+      jobSystem.numThreads(), stacks);
+  std::printf("%-12s %8s %10s %10s %12s %10s\n", "layout", "MB", "vertices",
+      "load ms", "+upload ms", "MB/s");
+  for (bool interleaved : {true, false}) {
+    if (!writeMeshGlb(path.c_str(), sphere, interleaved)) {
+      std::printf("cannot write %s\n", path.c_str());
+      return 1;
+    }
+    FILE* pFile = std::fopen(path.c_str(), "rb");
+    std::fseek(pFile, 0, SEEK_END);
+    const double megabytesRead = std::ftell(pFile) / 1e6;
+    std::fclose(pFile);
+
+    // Loading alone leaves mapped vertices untouched, so the copy into a
+    // stand-in for a GPU buffer is timed as well.
+    double bestLoad = 1e30, bestTotal = 1e30;
+    bool   mapped   = false;
+    for (int run = 0; run < 3; ++run) {
+      std::vector<std::unique_ptr<GlbMesh>> meshes;
+      std::string                           error;
+      const auto start = std::chrono::steady_clock::now();
+      if (!GlbMesh::load(path.c_str(), jobSystem, &meshes, &error)) {
+        std::printf("%s\n", error.c_str());
+        return 1;
+      }
+      bestLoad = std::min(bestLoad, milliseconds(start));
+      meshes[0]->writeVertices(upload.data());
+      bestTotal = std::min(bestTotal, milliseconds(start));
+      mapped    = meshes[0]->isMapped();
+      ok        = ok && meshes[0]->vertexCount() == sphere.vertexCount();
+    }
+    std::remove(path.c_str());
+    ok = ok && mapped == interleaved;
+    std::printf("%-12s %8.1f %10zu %10.1f %12.1f %10.1f\n",
+        interleaved ? "interleaved" : "separate", megabytesRead,
+        sphere.vertexCount(), bestLoad, bestTotal,
+        megabytesRead / bestTotal * 1e3);
+  }
+  return ok ? 0 : 1;
+}
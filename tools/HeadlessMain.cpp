@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "SoftwareRenderer.hpp"
+
+namespace {
+
+void printUsage(const char* argv0) {
+  std::printf(
+      "usage: %s [--width N] [--height N] [--frames N] [--threads N] "
+      "[--grid RxCxD]... [--no-cull] [--no-occlusion] [--quantized-vertices] "
+      "[--compact-instances] [--no-meshlet-cull] [--mesh-cache DIR] "
+      "[--out frame.ppm]\n"
+      "Repeating --grid resizes the instance grid at runtime: the frames are "
+      "split evenly across the listed grids. --mesh-cache reads generated "
+      "meshes from, or writes them to, mesh files in DIR.\n",
+      argv0);
+}
+
+bool writePpm(const char* path, const Framebuffer& fb) {
+  FILE* pFile = std::fopen(path, "wb");
+  if (!pFile) {
+    return false;
+  }
+  std::fprintf(pFile, "P6\n%u %u\n255\n", fb.width, fb.height);
+  for (uint32_t bgra : fb.color) {
+    const unsigned char rgb[3] = {static_cast<unsigned char>(bgra >> 16),
+        static_cast<unsigned char>(bgra >> 8), static_cast<unsigned char>(bgra)};
+    std::fwrite(rgb, 1, sizeof(rgb), pFile);
+  }
+  std::fclose(pFile);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  uint32_t       width          = 1024;
+  uint32_t       height         = 1024;
+  unsigned int   frames         = 60;
+  unsigned int   numThreads     = std::thread::hardware_concurrency();
+  const char*    outPath        = nullptr;
+  bool           cull           = true;
+  bool           occlusion      = true;
+  bool           meshletCull    = true;
+  VertexFormat   vertexFormat   = VertexFormat::Float;
+  InstanceFormat instanceFormat = InstanceFormat::Full;
+
+  std::vector<InstanceGrid> grids;
+
+  for (int i = 1; i < argc; ++i) {
+    const bool hasValue = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--width") && hasValue) {
+      width = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--height") && hasValue) {
+      height = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--frames") && hasValue) {
+      frames = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--threads") && hasValue) {
+      numThreads = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--grid") && hasValue) {
+      InstanceGrid grid;
+      if (!parseInstanceGrid(argv[++i], &grid)) {
+        printUsage(argv[0]);
+        return 1;
+      }
+      grids.push_back(grid);
+    } else if (!std::strcmp(argv[i], "--no-cull")) {
+      cull = false;
+    } else if (!std::strcmp(argv[i], "--no-occlusion")) {
+      occlusion = false;
+    } else if (!std::strcmp(argv[i], "--no-meshlet-cull")) {
+      meshletCull = false;
+    } else if (!std::strcmp(argv[i], "--quantized-vertices")) {
+      vertexFormat = VertexFormat::Quantized;
+    } else if (!std::strcmp(argv[i], "--compact-instances")) {
+      instanceFormat = InstanceFormat::Compact;
+    } else if (!std::strcmp(argv[i], "--mesh-cache") && hasValue) {
+      MeshRegistry::shared().setCacheDirectory(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--out") && hasValue) {
+      outPath = argv[++i];
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (grids.empty()) {
+    grids.push_back(kDefaultInstanceGrid);
+  }
+  if (width == 0 || height == 0 || frames < grids.size()) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  SoftwareRenderer renderer(width, height, numThreads, grids.front(),
+      vertexFormat, instanceFormat);
+  renderer.setFrustumCulling(cull);
+  renderer.setOcclusionCulling(occlusion);
+  renderer.setMeshletCulling(meshletCull);
+
+  // The scene and the rasterizer share one chain unless the rasterizer
+  // draws quantized vertices.
+  const MeshRegistryStats registry = MeshRegistry::shared().stats();
+  std::printf(
+      "mesh registry: %zu meshes, %zu built, %zu shared, %zu from cache\n",
+      MeshRegistry::shared().numMeshes(), registry.builds, registry.hits,
+      registry.cacheLoads);
+
+  for (size_t stage = 0; stage < grids.size(); ++stage) {
+    const InstanceGrid& grid        = grids[stage];
+    const unsigned int  stageFrames = frames / grids.size() +
+                                     (stage < frames % grids.size() ? 1 : 0);
+    renderer.setInstanceGrid(grid);
+
+    uint64_t     visible     = 0;
+    uint64_t     culled      = 0;
+    uint64_t     occluded    = 0;
+    double       occlusionMs = 0.0;
+    LodStats     lods        = {};
+    MeshletStats meshlets    = {};
+    auto         start       = std::chrono::steady_clock::now();
+    for (unsigned int frame = 0; frame < stageFrames; ++frame) {
+      renderer.draw();
+      const CullStats& stats = renderer.cullStats();
+      visible += stats.visible;
+      culled += stats.culled;
+      occluded += stats.occluded;
+      occlusionMs += stats.occlusionMs;
+      for (size_t lod = 0; lod < kNumSphereLods; ++lod) {
+        lods.instances[lod] += renderer.lodStats().instances[lod];
+        lods.triangles[lod] += renderer.lodStats().triangles[lod];
+      }
+      meshlets.triangles += renderer.meshletStats().triangles;
+      meshlets.backFacing += renderer.meshletStats().backFacing;
+      meshlets.outsideFrustum += renderer.meshletStats().outsideFrustum;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() -
+                                            start;
+
+    std::printf("%ux%u, %u threads, %ux%ux%u grid (%u instances): %u frames "
+                "in %.3f s (%.2f ms/frame, %.1f fps)\n",
+        width, height, renderer.numThreads(), grid.rows, grid.columns,
+        grid.depth, renderer.numInstances(), stageFrames, elapsed.count(),
+        1000.0 * elapsed.count() / stageFrames, stageFrames / elapsed.count());
+    std::printf("  culling per frame: %.1f visible, %.1f outside frustum, "
+                "%.1f occluded (%.1f%%, %.3f ms)\n",
+        double(visible) / stageFrames, double(culled) / stageFrames,
+        double(occluded) / stageFrames,
+        100.0 * occluded / std::max<uint64_t>(visible + occluded, 1),
+        occlusionMs / stageFrames);
+    std::printf("  instance records: %.1f KB per frame (%zu bytes each)\n",
+        double(visible) * instanceSize(instanceFormat) / stageFrames / 1024.0,
+        instanceSize(instanceFormat));
+    for (size_t lod = 0; lod < kNumSphereLods; ++lod) {
+      std::printf("  LOD %zu (%2u stacks): %10.1f instances, %12.1f triangles "
+                  "per frame\n",
+          lod, kSphereLodStacks[lod], double(lods.instances[lod]) / stageFrames,
+          double(lods.triangles[lod]) / stageFrames);
+    }
+    const double submitted = double(std::max<uint64_t>(meshlets.triangles, 1));
+    std::printf("  meshlet culling: %.1f%% of triangles rejected (%.1f%% "
+                "back-facing, %.1f%% outside frustum)\n",
+        100.0 * (meshlets.backFacing + meshlets.outsideFrustum) / submitted,
+        100.0 * meshlets.backFacing / submitted,
+        100.0 * meshlets.outsideFrustum / submitted);
+  }
+
+  if (outPath && !writePpm(outPath, renderer.framebuffer())) {
+    std::printf("Failed to write %s\n", outPath);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "InstanceTransforms.hpp"
+
+// Compares the batched SoA instance-transform kernel against the AoS
+// float4x4 product chain it replaces, then the full and compact instance
+// layouts: the cost of writing a frame's records and of copying them, which
+// stands in for the upload. Built per backend by `make bench`.
+
+namespace {
+
+template <typename Fn>
+double nanosecondsPerInstance(size_t count, int passes, const Fn& fn) {
+  fn();  // warm up
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; ++pass) {
+    fn();
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (double(count) * passes);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const size_t count  = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                 : size_t(1) << 20;
+  const int    passes = 10;
+
+  std::vector<float> x(count), y(count), z(count);
+  std::vector<float> yAngle(count), zAngle(count), scale(count, 0.2f);
+  for (size_t i = 0; i < count; ++i) {
+    x[i]      = float(i % 100) * 0.4f - 20.f;
+    y[i]      = float(i / 100 % 100) * 0.4f - 20.f;
+    z[i]      = float(i / 10000) * 0.4f - 10.f;
+    yAngle[i] = 3.f * cosf(float(i % 100));
+    zAngle[i] = 3.f * sinf(float(i / 100 % 100));
+  }
+  const InstanceTransformParams params = {x.data(), y.data(), z.data(),
+      yAngle.data(), zAngle.data(), scale.data()};
+  const Math::float4x4 parent = Math::makeTranslate({0.f, 0.f, -10.f}) *
+                                Math::makeYRotate(-0.7f) *
+                                Math::makeXRotate(0.35f) *
+                                Math::makeTranslate({0.f, 0.f, 10.f});
+
+  std::vector<shader_types::InstanceData> reference(count);
+  std::vector<shader_types::InstanceData> batched(count);
+
+  double scalarNs = nanosecondsPerInstance(count, passes, [&] {
+    computeInstanceTransformsScalar(parent, params, count, reference.data());
+  });
+  double batchedNs = nanosecondsPerInstance(count, passes, [&] {
+    computeInstanceTransforms(parent, params, count, batched.data());
+  });
+
+  float maxError = 0.f;
+  for (size_t i = 0; i < count; ++i) {
+    for (int c = 0; c < 4; ++c) {
+      Math::float4 d = reference[i].instanceTransform.columns[c] -
+                       batched[i].instanceTransform.columns[c];
+      maxError = std::max({maxError, fabsf(d.x), fabsf(d.y), fabsf(d.z),
+          fabsf(d.w)});
+    }
+  }
+
+  const size_t lanes = instanceTransformLanes();
+  std::printf("kernel %-6s  %zu instances, %zu per iteration\n",
+      lanes == 16 ? "avx512" : lanes == 8 ? "avx2" : "scalar", count, lanes);
+  std::printf("  scalar AoS   %7.2f ns/instance\n", scalarNs);
+  std::printf("  batched SoA  %7.2f ns/instance  (%.2fx, max abs error %g)\n",
+      batchedNs, scalarNs / batchedNs, maxError);
+
+  // Layouts. Colors are written alongside the transforms, as Scene does.
+  std::vector<Math::float4> colors(count);
+  std::vector<uint32_t>     packedColors(count);
+  for (size_t i = 0; i < count; ++i) {
+    const float t   = float(i) / float(count);
+    colors[i]       = {t, 1.f - t, sinf(6.2831853f * t), 1.f};
+    packedColors[i] = packUnorm4x8(colors[i]);
+  }
+  std::vector<shader_types::CompactInstanceData> compact(count);
+  std::vector<unsigned char> uploaded(count * sizeof(batched[0]));
+
+  const double writeNs[2] = {
+      nanosecondsPerInstance(count, passes, [&] {
+        computeInstanceTransforms(parent, params, count, batched.data());
+        for (size_t i = 0; i < count; ++i) {
+          batched[i].instanceColor = colors[i];
+        }
+      }),
+      nanosecondsPerInstance(count, passes, [&] {
+        computeInstanceTransforms(parent, params, count, compact.data());
+        for (size_t i = 0; i < count; ++i) {
+          compact[i].color = packedColors[i];
+        }
+      })};
+  const double uploadNs[2] = {
+      nanosecondsPerInstance(count, passes, [&] {
+        std::memcpy(
+            uploaded.data(), batched.data(), count * sizeof(batched[0]));
+      }),
+      nanosecondsPerInstance(count, passes, [&] {
+        std::memcpy(
+            uploaded.data(), compact.data(), count * sizeof(compact[0]));
+      })};
+
+  float maxCompactError = 0.f;
+  float maxColorError   = 0.f;
+  for (size_t i = 0; i < count; ++i) {
+    const Math::float4x4 m = instanceTransform(compact[i]);
+    for (int c = 0; c < 4; ++c) {
+      Math::float4 d = batched[i].instanceTransform.columns[c] - m.columns[c];
+      maxCompactError = std::max({maxCompactError, fabsf(d.x), fabsf(d.y),
+          fabsf(d.z), fabsf(d.w)});
+    }
+    const Math::float4 color = unpackUnorm4x8(compact[i].color);
+    const float clamped = std::min(std::max(colors[i].z, 0.f), 1.f);
+    maxColorError = std::max({maxColorError, fabsf(color.x - colors[i].x),
+        fabsf(color.y - colors[i].y), fabsf(color.z - clamped)});
+  }
+
+  const char*  names[2] = {"full", "compact"};
+  const size_t bytes[2] = {
+      sizeof(shader_types::InstanceData),
+      sizeof(shader_types::CompactInstanceData)};
+  std::printf("layouts, %zu instances per frame\n", count);
+  std::printf("  %-8s %6s %10s %12s %13s %10s\n", "format", "B/inst",
+      "MB/frame", "write ns/i", "upload ns/i", "GB/s");
+  for (int f = 0; f < 2; ++f) {
+    std::printf("  %-8s %6zu %10.1f %12.2f %13.2f %10.2f\n", names[f],
+        bytes[f], double(count) * bytes[f] / 1e6, writeNs[f], uploadNs[f],
+        bytes[f] / uploadNs[f]);
+  }
+  std::printf("  compact max abs error: transform %g, color %g\n",
+      maxCompactError, maxColorError);
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "Math.hpp"
+
+// Microbenchmarks for the Math backends. The Makefile's `bench` target
+// builds this file once per backend (scalar, sse4, avx2) so the numbers can
+// be compared side by side.
+
+namespace {
+
+template <typename Fn>
+double nanosecondsPerOp(size_t ops, const Fn& fn) {
+  fn();  // warm up
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(ops);
+}
+
+float checksum(const Math::float4x4& m) {
+  float sum = 0.f;
+  for (const Math::float4& c : m.columns) {
+    sum += c.x + c.y + c.z + c.w;
+  }
+  return sum;
+}
+
+}  // namespace
+
+int main() {
+  using Math::float4;
+  using Math::float4x4;
+
+  constexpr size_t kMatrices   = 1024;
+  constexpr size_t kIterations = 2000;
+  constexpr size_t kVectors    = 1 << 20;
+  constexpr size_t kPasses     = 20;
+
+  std::vector<float4x4> matrices(kMatrices);
+  for (size_t i = 0; i < kMatrices; ++i) {
+    matrices[i] = Math::makeYRotate(0.001f * i) *
+                  Math::makeTranslate({float(i), 1.f, -2.f});
+  }
+
+  std::vector<float4> vectors(kVectors);
+  for (size_t i = 0; i < kVectors; ++i) {
+    vectors[i] = {float(i & 255), float(i >> 8 & 255), 1.f, 1.f};
+  }
+  std::vector<float4> transformed(kVectors);
+
+  volatile float sink = 0.f;
+
+  double multiply = nanosecondsPerOp(kMatrices * kIterations, [&] {
+    float4x4 acc = Math::makeIdentity();
+    for (size_t it = 0; it < kIterations; ++it) {
+      for (const float4x4& m : matrices) {
+        acc = m * acc;
+      }
+      acc.columns[3] = {0.f, 0.f, 0.f, 1.f};
+    }
+    sink = sink + checksum(acc);
+  });
+
+  double rotation = nanosecondsPerOp(kMatrices * kIterations, [&] {
+    float sum = 0.f;
+    for (size_t it = 0; it < kIterations; ++it) {
+      for (size_t i = 0; i < kMatrices; ++i) {
+        const float angle = 0.0001f * float(it * kMatrices + i);
+        sum += checksum(Math::makeXRotate(angle) * Math::makeYRotate(angle) *
+                        Math::makeZRotate(angle));
+      }
+    }
+    sink = sink + sum;
+  });
+
+  double transform = nanosecondsPerOp(kVectors * kPasses, [&] {
+    for (size_t pass = 0; pass < kPasses; ++pass) {
+      Math::transform(matrices[pass], vectors.data(), transformed.data(),
+          kVectors);
+    }
+    sink = sink + transformed[kVectors / 2].x;
+  });
+
+  std::printf("backend %-6s  mat4 multiply %6.2f ns  "
+              "xyz rotation build %6.2f ns  transform %5.2f ns/vec4 "
+              "(%.2f Gvec/s)\n",
+      Math::kBackendName, multiply, rotation, transform, 1.0 / transform);
+  return 0;
+}
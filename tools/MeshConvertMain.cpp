@@ -0,0 +1,158 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GlbLoader.hpp"
+#include "JobSystem.hpp"
+#include "Mesh.hpp"
+#include "MeshFile.hpp"
+#include "ObjLoader.hpp"
+#include "PlyReader.hpp"
+
+namespace {
+
+void printUsage(const char* argv0) {
+  std::printf(
+      "usage: %s [--quantized] [--lods N] [--threads N] input output.rmesh\n"
+      "input is an .obj, .glb or binary .ply file, or \"sphere\" for the "
+      "built-in sphere chain that --mesh-cache stores. Loaded meshes get "
+      "N - 1 simplified levels (default 4 levels); the primitives of a .glb "
+      "file are merged into one mesh.\n",
+      argv0);
+}
+
+bool endsWith(const std::string& text, const char* pSuffix) {
+  const size_t length = std::strlen(pSuffix);
+  return text.size() >= length &&
+         text.compare(text.size() - length, length, pSuffix) == 0;
+}
+
+// The mesh in `path`, or nullptr after printing why it cannot be loaded.
+std::unique_ptr<Mesh> loadMesh(const std::string& path, JobSystem& jobSystem) {
+  std::string error;
+  if (endsWith(path, ".obj")) {
+    std::unique_ptr<ObjMesh> mesh = ObjMesh::load(
+        path.c_str(), jobSystem, &error);
+    if (!mesh) std::printf("%s\n", error.c_str());
+    return mesh;
+  }
+  if (endsWith(path, ".glb")) {
+    std::vector<std::unique_ptr<GlbMesh>> primitives;
+    if (!GlbMesh::load(path.c_str(), jobSystem, &primitives, &error)) {
+      std::printf("%s\n", error.c_str());
+      return nullptr;
+    }
+    std::vector<shader_types::VertexData> vertices;
+    std::vector<uint32_t>                 indices;
+    for (const std::unique_ptr<GlbMesh>& primitive : primitives) {
+      const size_t firstVertex = vertices.size();
+      const size_t firstIndex  = indices.size();
+      vertices.resize(firstVertex + primitive->vertexCount());
+      indices.resize(firstIndex + primitive->indexCount());
+      primitive->writeVertices(vertices.data() + firstVertex);
+      primitive->writeIndices(indices.data() + firstIndex);
+      for (size_t i = firstIndex; i < indices.size(); ++i) {
+        indices[i] += uint32_t(firstVertex);
+      }
+    }
+    return std::make_unique<ObjMesh>(std::move(vertices), std::move(indices));
+  }
+  if (endsWith(path, ".ply")) {
+    std::vector<shader_types::VertexData> vertices;
+    std::vector<uint32_t>                 indices;
+    PlyConsumer                           consumer;
+    consumer.vertices = [&](size_t, const shader_types::VertexData* pVertices,
+                            size_t count) {
+      vertices.insert(vertices.end(), pVertices, pVertices + count);
+      return true;
+    };
+    consumer.triangles = [&](const uint32_t* pIndices, size_t count) {
+      indices.insert(indices.end(), pIndices, pIndices + count);
+      return true;
+    };
+    if (!streamPly(path.c_str(), consumer, &error)) {
+      std::printf("%s\n", error.c_str());
+      return nullptr;
+    }
+    return std::make_unique<ObjMesh>(std::move(vertices), std::move(indices));
+  }
+  std::printf(
+      "%s: unknown file type, expected .obj, .glb or .ply\n", path.c_str());
+  return nullptr;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  VertexFormat             vertexFormat = VertexFormat::Float;
+  unsigned int             numLods      = 4;
+  unsigned int             numThreads   = std::thread::hardware_concurrency();
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    const bool hasValue = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--quantized")) {
+      vertexFormat = VertexFormat::Quantized;
+    } else if (!std::strcmp(argv[i], "--lods") && hasValue) {
+      numLods = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--threads") && hasValue) {
+      numThreads = std::atoi(argv[++i]);
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.size() != 2 || numLods == 0 || numThreads == 0) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  const auto   start = std::chrono::steady_clock::now();
+  MeshLodChain chain;
+  if (paths[0] == "sphere") {
+    chain = createSphereLodChain(vertexFormat);
+  } else {
+    JobSystem                   jobSystem(numThreads);
+    const std::unique_ptr<Mesh> mesh = loadMesh(paths[0], jobSystem);
+    if (!mesh) return 1;
+    if (mesh->indexCount() == 0) {
+      std::printf("%s: no triangles\n", paths[0].c_str());
+      return 1;
+    }
+    const std::vector<std::unique_ptr<Mesh>> lods = createSimplifiedLods(
+        *mesh, numLods, jobSystem);
+    if (lods.size() < numLods) {
+      std::printf("%s: simplification stops after %zu of %u levels\n",
+          paths[0].c_str(), lods.size(), numLods);
+    }
+    chain = createMeshLodChain(lods, vertexFormat);
+  }
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::string error;
+  if (!writeMeshFile(paths[1].c_str(), chain, &error)) {
+    std::printf("%s\n", error.c_str());
+    return 1;
+  }
+  MeshFile file;
+  if (!file.open(paths[1].c_str(), &error)) {
+    std::printf("%s\n", error.c_str());
+    return 1;
+  }
+  std::printf("%s: %zu LODs, %zu vertices, %zu indices, %zu meshlets in "
+              "%.1f ms\n",
+      paths[1].c_str(), file.numLods(), file.numVertices(),
+      file.indexDataSize() / indexSize(file.indexType()), file.numMeshlets(),
+      elapsed.count());
+  for (size_t l = 0; l < file.numLods(); ++l) {
+    const MeshLodBounds& bounds = file.lodBounds()[l];
+    std::printf("  LOD %zu: %u triangles, bounds (%g %g %g) - (%g %g %g)\n",
+        l, file.lods()[l].numIndices / 3, bounds.min.x, bounds.min.y,
+        bounds.min.z, bounds.max.x, bounds.max.y, bounds.max.z);
+  }
+  return 0;
+}
@@ -0,0 +1,245 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.hpp"
+#include "Mesh.hpp"
+#include "MeshFile.hpp"
+#include "MeshRegistry.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// Drops the file's pages from the page cache where the OS allows it, so
+// that the next open reads from storage like a cold start.
+void evictFromPageCache(const char* path) {
+#ifdef POSIX_FADV_DONTNEED
+  const int fd = ::open(path, O_RDONLY);
+  if (fd < 0) return;
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+#else
+  (void)path;
+#endif
+}
+
+// Sphere LOD chain from `stacks` down, a quarter of the triangles per
+// level, in the layout createSphereLodChain() produces.
+MeshLodChain createLargeSphereLodChain(
+    unsigned int stacks, VertexFormat vertexFormat) {
+  std::vector<std::unique_ptr<Mesh>> meshes;
+  for (; meshes.size() < 4 && stacks >= 4; stacks /= 2) {
+    meshes.push_back(std::make_unique<OptimizedMesh>(
+        SphereMesh(kSphereRadius, stacks, stacks)));
+  }
+  return createMeshLodChain(meshes, vertexFormat);
+}
+
+// Every vertex of every level lies inside the level's bounds, which touch
+// the sphere.
+bool boundsMatch(const MeshFile& file, const MeshLodChain& chain) {
+  for (size_t l = 0; l < file.numLods(); ++l) {
+    const MeshLodBounds& bounds = file.lodBounds()[l];
+    if (bounds.max.x < kSphereRadius * 0.99f ||
+        bounds.min.y > -kSphereRadius * 0.99f) {
+      return false;
+    }
+    const MeshLod& lod = chain.lods[l];
+    for (uint32_t v = lod.firstVertex; v < lod.firstVertex + lod.numVertices;
+         ++v) {
+      const Math::float3 p =
+          chain.vertexFormat == VertexFormat::Float
+              ? chain.vertices[v].position
+              : dequantizePosition(
+                    chain.quantizedVertices[v], chain.quantizations[l]);
+      if (p.x < bounds.min.x || p.y < bounds.min.y || p.z < bounds.min.z ||
+          p.x > bounds.max.x || p.y > bounds.max.y || p.z > bounds.max.z) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Generation against writing once and mapping thereafter, for one chain.
+bool compare(const char* name, const std::function<MeshLodChain()>& generate,
+    const std::string& path) {
+  Clock::time_point  start      = Clock::now();
+  const MeshLodChain generated  = generate();
+  const double       generateMs = millisecondsSince(start);
+
+  start = Clock::now();
+  std::string  error;
+  bool         ok      = writeMeshFile(path.c_str(), generated, &error);
+  const double writeMs = millisecondsSince(start);
+  if (!ok) {
+    std::printf("%s\n", error.c_str());
+    return false;
+  }
+
+  evictFromPageCache(path.c_str());
+  start = Clock::now();
+  MeshFile file;
+  ok = file.open(path.c_str(), &error);
+  const double openMs = millisecondsSince(start);
+  if (!ok) {
+    std::printf("%s\n", error.c_str());
+    return false;
+  }
+  // Copying into buffers faults every page in, as a first upload would.
+  std::vector<unsigned char> buffers(
+      file.vertexDataSize() + file.indexDataSize());
+  start = Clock::now();
+  std::memcpy(buffers.data(), file.vertexData(), file.vertexDataSize());
+  std::memcpy(buffers.data() + file.vertexDataSize(), file.indexData(),
+      file.indexDataSize());
+  const double uploadMs = millisecondsSince(start);
+
+  start                      = Clock::now();
+  const MeshLodChain loaded  = file.toChain();
+  const double       chainMs = millisecondsSince(start);
+
+  std::printf("%-20s %10.2f %10.2f %10.3f %10.2f %10.2f %10.1f\n", name,
+      generateMs, writeMs, openMs, uploadMs, chainMs, buffers.size() / 1e6);
+  return MeshKey::content(loaded) == MeshKey::content(generated) &&
+         loaded.meshlets.size() == generated.meshlets.size() &&
+         std::memcmp(loaded.meshletBounds.data(),
+             generated.meshletBounds.data(),
+             generated.meshletBounds.size() * sizeof(MeshletBounds)) == 0 &&
+         boundsMatch(file, loaded);
+}
+
+// Overwrites `size` bytes at `offset` in the file.
+void patch(const std::string& path, size_t offset, const void* pBytes,
+    size_t size) {
+  FILE* pFile = std::fopen(path.c_str(), "r+b");
+  std::fseek(pFile, long(offset), SEEK_SET);
+  std::fwrite(pBytes, 1, size, pFile);
+  std::fclose(pFile);
+}
+
+// Where the file's section of `type` starts.
+uint64_t sectionOffset(const std::string& path, MeshFileSectionType type) {
+  MeshFileHeader  header   = {};
+  MeshFileSection section  = {};
+  uint64_t        offset   = 0;
+  FILE*           pFile    = std::fopen(path.c_str(), "rb");
+  bool            readable = std::fread(&header, sizeof(header), 1, pFile);
+  for (uint32_t i = 0; readable && i < header.numSections; ++i) {
+    readable = std::fread(&section, sizeof(section), 1, pFile);
+    if (readable && section.type == uint32_t(type)) offset = section.offset;
+  }
+  std::fclose(pFile);
+  return offset;
+}
+
+bool checkErrors(const std::string& path) {
+  const MeshLodChain chain = createSphereLodChain();
+  bool               ok    = true;
+  auto               expect = [&](const char* what, const char* message) {
+    MeshFile    file;
+    std::string error;
+    ok = check(!file.open(path.c_str(), &error) && error == path + message,
+             what) &&
+         ok;
+    writeMeshFile(path.c_str(), chain);
+  };
+
+  writeMeshFile(path.c_str(), chain);
+  patch(path, 0, "XMESH", 5);
+  expect("bad magic is rejected", ": not a mesh file");
+  const uint32_t version = kMeshFileVersion + 1;
+  patch(path, offsetof(MeshFileHeader, version), &version, sizeof(version));
+  expect("other versions are rejected", ": unsupported mesh file version");
+  truncate(path.c_str(), off_t(kMeshFileAlignment + 100));
+  expect("truncated file is rejected", ": truncated mesh file");
+  const uint64_t misaligned = kMeshFileAlignment + 4;
+  patch(path, sizeof(MeshFileHeader) + offsetof(MeshFileSection, offset),
+      &misaligned, sizeof(misaligned));
+  expect("misaligned section is rejected", ": malformed section table");
+  const uint32_t numVertices = 1u << 30;
+  patch(path,
+      sectionOffset(path, MeshFileSectionType::Lods) +
+          offsetof(MeshLod, numVertices),
+      &numVertices, sizeof(numVertices));
+  expect("out-of-range LOD is rejected", ": LOD out of range");
+  // The first meshlet now starts at its LOD's last triangle.
+  const uint32_t lastTriangle = chain.lods[0].numIndices / 3 - 1;
+  patch(path,
+      sectionOffset(path, MeshFileSectionType::Meshlets) +
+          offsetof(Meshlet, firstTriangle),
+      &lastTriangle, sizeof(lastTriangle));
+  expect("out-of-range meshlet is rejected", ": meshlet out of range");
+  return ok;
+}
+
+bool checkIntern() {
+  MeshRegistry       registry;
+  const MeshLodChain chain = createSphereLodChain();
+  MeshLodChain       copy  = chain;
+  MeshLodChain       moved = chain;
+  moved.vertices[0].position.x += 1.f;
+  const MeshHandle first  = registry.intern(MeshLodChain(chain));
+  const MeshHandle second = registry.intern(std::move(copy));
+  const MeshHandle other  = registry.intern(std::move(moved));
+  return check(
+      first == second && first != other, "intern shares only equal chains");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  unsigned int stacks = 1024;
+  if (argc > 2 || (argc == 2 && (stacks = std::atoi(argv[1])) < 4)) {
+    std::printf("usage: %s [sphere-stacks]\n", argv[0]);
+    return 1;
+  }
+  const std::string path = createTempFile("mesh_file_bench", ".rmesh");
+  bool ok = checkErrors(path);
+  ok = checkIntern() && ok;
+
+  std::printf("\n%-20s %10s %10s %10s %10s %10s %10s\n", "chain",
+      "generate", "write", "open", "upload", "toChain", "MB");
+  const std::string large = "sphere " + std::to_string(stacks) + " lods";
+  const struct {
+    std::string                   name;
+    std::function<MeshLodChain()> generate;
+  } chains[] = {
+      {"sphere lods", [] { return createSphereLodChain(); }},
+      {"quantized",
+          [] { return createSphereLodChain(VertexFormat::Quantized); }},
+      {large,
+          [&] {
+            return createLargeSphereLodChain(stacks, VertexFormat::Float);
+          }},
+      {"quantized",
+          [&] {
+            return createLargeSphereLodChain(stacks, VertexFormat::Quantized);
+          }},
+  };
+  bool equal = true;
+  for (const auto& chain : chains) {
+    equal = compare(chain.name.c_str(), chain.generate, path) && equal;
+  }
+  ok = check(equal, "mapped chains equal the generated ones") && ok;
+  std::printf("(milliseconds; open is from a dropped page cache where the OS "
+              "allows it)\n");
+  std::remove(path.c_str());
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "MeshOptimizer.hpp"
+
+namespace {
+
+struct NamedMesh {
+  std::string           name;
+  std::unique_ptr<Mesh> mesh;
+};
+
+struct MeshData {
+  std::vector<uint32_t> indices;
+  size_t                numVertices;
+  size_t                bufferBytes;  // vertex + index buffer at auto width
+};
+
+MeshData meshData(const Mesh& mesh) {
+  MeshData data;
+  data.indices     = mesh.getIndices();
+  data.numVertices = mesh.vertexCount();
+  data.bufferBytes = mesh.vertexCount() * sizeof(shader_types::VertexData) +
+                     mesh.indexCount() * indexSize(mesh.indexType());
+  return data;
+}
+
+void report(const NamedMesh& entry, uint32_t cacheSize) {
+  auto                start = std::chrono::steady_clock::now();
+  const OptimizedMesh optimizedMesh(*entry.mesh);
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  const MeshData before = meshData(*entry.mesh);
+  const MeshData after  = meshData(optimizedMesh);
+
+  const VertexCacheStats cacheBefore = analyzeVertexCache(
+      before.indices.data(), before.indices.size(), before.numVertices,
+      cacheSize);
+  const VertexCacheStats cacheAfter = analyzeVertexCache(after.indices.data(),
+      after.indices.size(), after.numVertices, cacheSize);
+  const VertexFetchStats fetchBefore = analyzeVertexFetch(
+      before.indices.data(), before.indices.size(), before.numVertices,
+      sizeof(shader_types::VertexData));
+  const VertexFetchStats fetchAfter = analyzeVertexFetch(after.indices.data(),
+      after.indices.size(), after.numVertices,
+      sizeof(shader_types::VertexData));
+
+  std::printf("%-16s %8zu -> %-8zu %8zu -> %-8zu %8.2f\n", entry.name.c_str(),
+      before.indices.size() / 3, after.indices.size() / 3, before.numVertices,
+      after.numVertices, elapsed.count());
+  std::printf("%-16s ACMR %5.3f -> %5.3f, ATVR %5.3f -> %5.3f, overfetch "
+              "%5.3f -> %5.3f\n",
+      "", cacheBefore.acmr, cacheAfter.acmr, cacheBefore.atvr,
+      cacheAfter.atvr, fetchBefore.overfetch, fetchAfter.overfetch);
+  std::printf("%-16s buffers %zu -> %zu bytes (%zu saved), fetched %zu -> "
+              "%zu bytes\n",
+      "", before.bufferBytes, after.bufferBytes,
+      before.bufferBytes - after.bufferBytes, fetchBefore.bytesFetched,
+      fetchAfter.bytesFetched);
+
+  // Cone angles are measured on the optimized mesh's own meshlets.
+  const std::vector<Meshlet> meshlets = optimizedMesh.getMeshlets();
+  const std::vector<shader_types::VertexData> vertices =
+      optimizedMesh.getVertices();
+  const VertexStream position = {
+      &vertices.data()->position.x, sizeof(shader_types::VertexData), 3};
+  size_t meshletVertices = 0;
+  double coneDegrees     = 0.0;
+  for (const Meshlet& meshlet : meshlets) {
+    const MeshletBounds bounds = computeMeshletBounds(
+        after.indices.data(), meshlet, position);
+    meshletVertices += meshlet.numVertices;
+    coneDegrees += asin(std::min(bounds.coneCutoff, 1.f)) * 180.0 / M_PI;
+  }
+  std::printf("%-16s %zu meshlets, %.1f vertices, %.1f triangles, %.1f deg "
+              "cone on average\n",
+      "", meshlets.size(), double(meshletVertices) / meshlets.size(),
+      double(after.indices.size() / 3) / meshlets.size(),
+      coneDegrees / meshlets.size());
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  uint32_t cacheSize = kVertexCacheSize;
+  if (argc > 2 || (argc == 2 && (cacheSize = std::atoi(argv[1])) == 0)) {
+    std::printf("usage: %s [cache-size]\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<NamedMesh> meshes;
+  for (unsigned int stacks : kSphereLodStacks) {
+    meshes.push_back({"sphere " + std::to_string(stacks) + "x" +
+                          std::to_string(stacks),
+        std::make_unique<SphereMesh>(kSphereRadius, stacks, stacks)});
+  }
+  meshes.push_back({"sphere 256x256",
+      std::make_unique<SphereMesh>(kSphereRadius, 256, 256)});
+  meshes.push_back({"sphere 1024x1024",
+      std::make_unique<SphereMesh>(kSphereRadius, 1024, 1024)});
+  meshes.push_back({"cube", createMesh(MeshType::Cube)});
+  meshes.push_back({"icosphere", createMesh(MeshType::Icosphere)});
+  meshes.push_back({"cube-sphere", createMesh(MeshType::CubeSphere)});
+
+  std::printf("%u-entry FIFO vertex cache, %zu-byte fetch lines\n", cacheSize,
+      kFetchLineSize);
+  std::printf("%-16s %-20s %-20s %8s\n", "mesh", "triangles", "vertices",
+      "opt ms");
+  for (const NamedMesh& entry : meshes) {
+    report(entry, cacheSize);
+  }
+  return 0;
+}
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.hpp"
+#include "MappedFile.hpp"
+#include "ObjLoader.hpp"
+
+namespace {
+
+using shader_types::VertexData;
+
+bool parse(const std::string& text, JobSystem& jobSystem,
+    std::vector<VertexData>* pVertices, std::vector<uint32_t>* pIndices,
+    std::string* pError = nullptr) {
+  return parseObj(text.data(), text.size(), jobSystem, pVertices, pIndices,
+      pError);
+}
+
+bool samePosition(const Math::float3& a, const Math::float3& b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// Small hand-written files covering the syntax the loader accepts.
+bool checkSyntax(JobSystem& jobSystem) {
+  bool                    ok = true;
+  std::vector<VertexData> vertices;
+  std::vector<uint32_t>   indices;
+
+  // Number formats, compared with strtof.
+  const char* numbers[] = {"1e-3", "-.5", "+2.", "3E+2", "0.1",
+      "123456789012345678901234", "-0.000000123456789", "1.17549435e-38",
+      "3.40282347e+38", "0.30000001192092896"};
+  std::string text;
+  for (const char* number : numbers) {
+    text += std::string("v ") + number + " 0 0\n";
+  }
+  text += "f 1 2 3\n";
+  bool numbersOk = parse(text, jobSystem, &vertices, &indices) &&
+                   vertices.size() == std::size(numbers);
+  for (size_t i = 0; numbersOk && i < std::size(numbers); ++i) {
+    numbersOk = vertices[i].position.x == std::strtof(numbers[i], nullptr);
+  }
+  ok = check(numbersOk, "numbers match strtof") && ok;
+
+  // A quad with relative indices, texture coordinates and CRLF endings
+  // fans into two reversed triangles over shared normals.
+  text =
+      "# quad\r\nv 0 0 0\r\nv 1 0 0\r\nv 1 1 0\r\nv 0 1 0\r\nvt 0 0\r\n"
+      "vn 0 0 1\r\ng quad\r\nf -4/1/-1 -3/1/-1 -2/1/-1 -1/1/-1\r\n";
+  const Math::float3 fan[6] = {{0.f, 0.f, 0.f}, {1.f, 1.f, 0.f},
+      {1.f, 0.f, 0.f}, {0.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {1.f, 1.f, 0.f}};
+  bool quadOk = parse(text, jobSystem, &vertices, &indices) &&
+                vertices.size() == 4 && indices.size() == 6;
+  for (size_t i = 0; quadOk && i < 6; ++i) {
+    quadOk = samePosition(vertices[indices[i]].position, fan[i]) &&
+             vertices[indices[i]].normal.z == 1.f;
+  }
+  ok = check(quadOk, "quad, relative indices, CRLF") && ok;
+
+  // Without normals, the face normal points along cross(c - a, b - a) of
+  // the stored triangle, i.e. the OBJ face's front.
+  text = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+  ok = check(parse(text, jobSystem, &vertices, &indices) &&
+                 vertices.size() == 3 && vertices[0].normal.z == 1.f,
+           "generated normals face the front") &&
+       ok;
+
+  // Corners sharing a position but not a normal stay separate vertices.
+  text =
+      "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 0 0 1\nvn 0 0 1\nvn 0 1 0\n"
+      "f 1//1 2//1 3//1\nf 1//2 4//2 2//2\n";
+  ok = check(parse(text, jobSystem, &vertices, &indices) &&
+                 vertices.size() == 6 && indices[3] != indices[0],
+           "split vertices at normal seams") &&
+       ok;
+
+  // Matching indices but fewer normals than positions: the unused
+  // position has no normal to pair with, so vertices are deduplicated.
+  text =
+      "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 5 5 5\nvn 0 0 1\nvn 0 0 1\nvn 0 0 1\n"
+      "f 1//1 2//2 3//3\n";
+  ok = check(parse(text, jobSystem, &vertices, &indices) &&
+                 vertices.size() == 3 && vertices[2].normal.z == 1.f,
+           "unused position past the last normal") &&
+       ok;
+
+  // Positions alone load as points with zero normals.
+  text = "v 0 0 0\nv 1 0 0\nv 0 1 0\n";
+  ok = check(parse(text, jobSystem, &vertices, &indices) &&
+                 vertices.size() == 3 && indices.empty() &&
+                 vertices[1].normal.x == 0.f && vertices[1].normal.z == 0.f,
+           "positions without faces") &&
+       ok;
+
+  std::string error;
+  text = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n";
+  ok = check(!parse(text, jobSystem, &vertices, &indices, &error) &&
+                 error == "line 4: bad face position index",
+           "out-of-range index reports its line") &&
+       ok;
+  text = "v 0 0 0\nv 1 zero 0\n";
+  ok = check(!parse(text, jobSystem, &vertices, &indices, &error) &&
+                 error == "line 2: malformed vertex position",
+           "malformed number reports its line") &&
+       ok;
+  return ok;
+}
+
+// Writes a UV sphere as OBJ, faces wound the OBJ way so that loading
+// restores SphereMesh's winding. With `sharedIndices`, corners read
+// "v//v"; otherwise normals are listed in reverse and every face is a
+// quad, which takes the general deduplicating path.
+bool writeSphereObj(const char* path, unsigned int stacks, bool sharedIndices) {
+  const SphereMesh              sphere(kSphereRadius, stacks, stacks);
+  const std::vector<VertexData> vertices = sphere.getVertices();
+  const size_t                  n        = vertices.size();
+
+  FILE* pFile = std::fopen(path, "wb");
+  if (!pFile) return false;
+  std::string buffer;
+  char        line[128];
+  auto        flush = [&](bool force) {
+    if (force || buffer.size() > (1 << 20)) {
+      std::fwrite(buffer.data(), 1, buffer.size(), pFile);
+      buffer.clear();
+    }
+  };
+  for (const VertexData& v : vertices) {
+    std::snprintf(line, sizeof(line), "v %.9g %.9g %.9g\n", v.position.x,
+        v.position.y, v.position.z);
+    buffer += line;
+    flush(false);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    const VertexData& v = vertices[sharedIndices ? i : n - 1 - i];
+    std::snprintf(line, sizeof(line), "vn %.9g %.9g %.9g\n", v.normal.x,
+        v.normal.y, v.normal.z);
+    buffer += line;
+    flush(false);
+  }
+  const uint32_t row = stacks + 1;
+  for (uint32_t i = 0; i < stacks; ++i) {
+    for (uint32_t j = 0; j < stacks; ++j) {
+      const uint32_t a = i * row + j + 1, b = a + row, c = b + 1, d = a + 1;
+      if (sharedIndices) {
+        std::snprintf(line, sizeof(line),
+            "f %u//%u %u//%u %u//%u\nf %u//%u %u//%u %u//%u\n", a, a, d, d, b,
+            b, b, b, d, d, c, c);
+      } else {
+        auto nn = [&](uint32_t v) { return uint32_t(n) + 1 - v; };
+        std::snprintf(line, sizeof(line), "f %u//%u %u//%u %u//%u %u//%u\n", a,
+            nn(a), d, nn(d), c, nn(c), b, nn(b));
+      }
+      buffer += line;
+      flush(false);
+    }
+  }
+  flush(true);
+  return std::fclose(pFile) == 0;
+}
+
+// Loading the shared-index sphere gives back SphereMesh exactly: %.9g
+// round-trips floats, and vertices follow the file's positions.
+bool checkRoundTrip(const char* path, JobSystem& jobSystem) {
+  const unsigned int stacks = 64;
+  if (!writeSphereObj(path, stacks, true)) return false;
+  const auto mesh = ObjMesh::load(path, jobSystem);
+  std::remove(path);
+
+  const SphereMesh              sphere(kSphereRadius, stacks, stacks);
+  const std::vector<VertexData> expected = sphere.getVertices();
+  bool ok = mesh && mesh->getIndices() == sphere.getIndices() &&
+            mesh->vertexCount() == expected.size();
+  const std::vector<VertexData> loaded = ok ? mesh->getVertices()
+                                            : std::vector<VertexData>();
+  for (size_t i = 0; ok && i < expected.size(); ++i) {
+    ok = samePosition(loaded[i].position, expected[i].position) &&
+         samePosition(loaded[i].normal, expected[i].normal);
+  }
+  return check(ok, "sphere round trip is exact");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  unsigned int megabytes  = 128;
+  unsigned int numThreads = std::thread::hardware_concurrency();
+  if (argc > 3 || (argc >= 2 && (megabytes = std::atoi(argv[1])) == 0) ||
+      (argc == 3 && (numThreads = std::atoi(argv[2])) == 0)) {
+    std::printf("usage: %s [megabytes-per-file] [threads]\n", argv[0]);
+    return 1;
+  }
+  JobSystem jobSystem(numThreads);
+
+  const std::string path = createTempFile("obj_bench", ".obj");
+  bool ok = checkSyntax(jobSystem);
+  ok      = checkRoundTrip(path.c_str(), jobSystem) && ok;
+
+  // About 170 bytes per sphere vertex with triangles, 130 with quads.
+  std::printf("\n%u threads, best of 3, page cache warm\n",
+      jobSystem.numThreads());
+  std::printf("%-22s %8s %12s %12s %10s %10s\n", "faces", "MB", "triangles",
+      "vertices", "ms", "MB/s");
+  for (bool sharedIndices : {true, false}) {
+    const double bytesPerVertex = sharedIndices ? 170.0 : 130.0;
+    const auto   stacks = unsigned(std::sqrt(megabytes * 1e6 / bytesPerVertex));
+    if (!writeSphereObj(path.c_str(), stacks, sharedIndices)) {
+      std::printf("cannot write %s\n", path.c_str());
+      return 1;
+    }
+
+    std::unique_ptr<ObjMesh> mesh;
+    double                   best = 1e30;
+    for (int run = 0; run < 3; ++run) {
+      mesh.reset();
+      auto        start = std::chrono::steady_clock::now();
+      std::string error;
+      mesh = ObjMesh::load(path.c_str(), jobSystem, &error);
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      if (!mesh) {
+        std::printf("%s\n", error.c_str());
+        return 1;
+      }
+      best = std::min(best, elapsed.count());
+    }
+
+    MappedFile file;
+    file.open(path.c_str());
+    const double megabytesRead = file.size() / 1e6;
+    std::remove(path.c_str());
+
+    // Either way, the sphere's own vertex count comes back.
+    const size_t expected = size_t(stacks + 1) * (stacks + 1);
+    ok = ok && mesh->vertexCount() == expected &&
+         mesh->indexCount() == size_t(stacks) * stacks * 6;
+    std::printf("%-22s %8.1f %12zu %12zu %10.1f %10.1f\n",
+        sharedIndices ? "triangles, v//v" : "quads, separate vn",
+        megabytesRead, mesh->indexCount() / 3, mesh->vertexCount(), best,
+        megabytesRead / best * 1e3);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.hpp"
+#include "Mesh.hpp"
+#include "PlyReader.hpp"
+
+namespace {
+
+using shader_types::VertexData;
+
+// Peak resident set size of this process so far.
+double peakRssMegabytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1e6;  // bytes
+#else
+  return usage.ru_maxrss / 1e3;  // kilobytes
+#endif
+}
+
+template <typename T>
+void put(FILE* pFile, const T& value) {
+  std::fwrite(&value, sizeof(value), 1, pFile);
+}
+
+// Everything streamPly() delivered, for small files.
+struct Collected {
+  PlyInfo                 info = {};
+  std::vector<VertexData> vertices;
+  std::vector<uint32_t>   indices;
+  bool                    inOrder = true;
+
+  PlyConsumer consumer() {
+    PlyConsumer consumer;
+    consumer.begin = [this](const PlyInfo& plyInfo) {
+      info = plyInfo;
+      return true;
+    };
+    consumer.vertices = [this](size_t first, const VertexData* pVertices,
+                            size_t count) {
+      inOrder = inOrder && first == vertices.size();
+      vertices.insert(vertices.end(), pVertices, pVertices + count);
+      return true;
+    };
+    consumer.triangles = [this](const uint32_t* pIndices, size_t count) {
+      inOrder = inOrder && count % 3 == 0;
+      indices.insert(indices.end(), pIndices, pIndices + count);
+      return true;
+    };
+    return consumer;
+  }
+};
+
+// Writes SphereMesh as PLY, faces wound the PLY way so that reading
+// restores its winding. Extra properties around the ones the reader uses
+// have to be skipped.
+bool writeSpherePly(const char* path, const SphereMesh& sphere) {
+  const std::vector<VertexData> vertices = sphere.getVertices();
+  const std::vector<uint32_t>   indices  = sphere.getIndices();
+  FILE*                         pFile    = std::fopen(path, "wb");
+  if (!pFile) return false;
+  std::fprintf(pFile,
+      "ply\nformat binary_little_endian 1.0\ncomment sphere\n"
+      "element vertex %zu\nproperty uchar red\nproperty float x\n"
+      "property float y\nproperty float z\nproperty float nx\n"
+      "property float ny\nproperty float nz\nproperty ushort quality\n"
+      "element face %zu\nproperty list uchar int vertex_indices\n"
+      "property uint flags\nend_header\n",
+      vertices.size(), indices.size() / 3);
+  for (const VertexData& v : vertices) {
+    put(pFile, uint8_t(255));
+    for (float value : {v.position.x, v.position.y, v.position.z, v.normal.x,
+             v.normal.y, v.normal.z}) {
+      put(pFile, value);
+    }
+    put(pFile, uint16_t(7));
+  }
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    put(pFile, uint8_t(3));
+    put(pFile, int32_t(indices[i]));
+    put(pFile, int32_t(indices[i + 2]));
+    put(pFile, int32_t(indices[i + 1]));
+    put(pFile, uint32_t(0));
+  }
+  return std::fclose(pFile) == 0;
+}
+
+bool writeFile(const char* path, const std::string& header,
+    const std::string& body) {
+  FILE* pFile = std::fopen(path, "wb");
+  if (!pFile) return false;
+  std::fwrite(header.data(), 1, header.size(), pFile);
+  std::fwrite(body.data(), 1, body.size(), pFile);
+  return std::fclose(pFile) == 0;
+}
+
+template <typename T>
+void append(std::string* pOut, const T& value) {
+  pOut->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool checkReader(const std::string& path) {
+  bool ok = true;
+
+  // Spans several read windows, so records straddle window ends.
+  const SphereMesh sphere(kSphereRadius, 128, 128);
+  Collected        sphereOut;
+  bool             read = writeSpherePly(path.c_str(), sphere) &&
+                          streamPly(path.c_str(), sphereOut.consumer());
+  const std::vector<VertexData> expected = sphere.getVertices();
+  read = read && sphereOut.inOrder && sphereOut.info.hasNormals &&
+         sphereOut.info.numFaces == sphere.indexCount() / 3 &&
+         sphereOut.indices == sphere.getIndices() &&
+         sphereOut.vertices.size() == expected.size();
+  for (size_t i = 0; read && i < expected.size(); ++i) {
+    read = std::memcmp(&sphereOut.vertices[i].position,
+               &expected[i].position, 12) == 0 &&
+           std::memcmp(&sphereOut.vertices[i].normal, &expected[i].normal,
+               12) == 0;
+  }
+  ok = check(read, "sphere round trip is exact") && ok;
+
+  // Double positions without normals, a CRLF header and a quad with
+  // unsigned short indices.
+  const std::string quadHeader =
+      "ply\r\nformat binary_little_endian 1.0\r\nelement vertex 4\r\n"
+      "property double x\r\nproperty double y\r\nproperty double z\r\n"
+      "element face 1\r\nproperty list uchar ushort vertex_index\r\n"
+      "end_header\r\n";
+  std::string quad;
+  for (double xyz : {0., 0., 0., 1., 0., 0., 1., 1., 0., 0., 1., 0.}) {
+    append(&quad, xyz);
+  }
+  append(&quad, uint8_t(4));
+  for (uint16_t index : {0, 1, 2, 3}) append(&quad, index);
+  Collected quadOut;
+  ok = check(writeFile(path.c_str(), quadHeader, quad) &&
+                 streamPly(path.c_str(), quadOut.consumer()) &&
+                 !quadOut.info.hasNormals && quadOut.vertices.size() == 4 &&
+                 quadOut.vertices[2].position.y == 1.f &&
+                 quadOut.vertices[2].normal.z == 0.f &&
+                 quadOut.indices == std::vector<uint32_t>{0, 2, 1, 0, 3, 2},
+           "doubles, CRLF header, fanned quad") &&
+       ok;
+
+  // Errors name the problem.
+  std::string error;
+  Collected   ignored;
+  writeFile(path.c_str(),
+      "ply\nformat ascii 1.0\nelement vertex 0\nend_header\n", "");
+  ok = check(!streamPly(path.c_str(), ignored.consumer(), &error) &&
+                 error == path +
+                              ": unsupported format ascii, only "
+                              "binary_little_endian is read",
+           "ASCII files are rejected") &&
+       ok;
+  std::string badIndex = quad;
+  badIndex[badIndex.size() - 2] = 4;
+  writeFile(path.c_str(), quadHeader, badIndex);
+  ok = check(!streamPly(path.c_str(), ignored.consumer(), &error) &&
+                 error == path + ": face 0: vertex index out of range",
+           "out-of-range index is reported") &&
+       ok;
+  writeFile(path.c_str(), quadHeader, quad.substr(0, 40));
+  ok = check(!streamPly(path.c_str(), ignored.consumer(), &error) &&
+                 error == path + ": truncated vertex 1",
+           "truncated file is reported") &&
+       ok;
+  std::remove(path.c_str());
+  return ok;
+}
+
+// Writes a `stacks` x `stacks` UV sphere a row at a time, so that files
+// far larger than memory can be made.
+bool writeLargeSpherePly(const char* path, unsigned int stacks) {
+  FILE* pFile = std::fopen(path, "wb");
+  if (!pFile) return false;
+  const size_t row = size_t(stacks) + 1;
+  std::fprintf(pFile,
+      "ply\nformat binary_little_endian 1.0\nelement vertex %zu\n"
+      "property float x\nproperty float y\nproperty float z\n"
+      "property float nx\nproperty float ny\nproperty float nz\n"
+      "element face %zu\nproperty list uchar uint vertex_indices\n"
+      "end_header\n",
+      row * row, size_t(stacks) * stacks * 2);
+  std::vector<float> rowData(6 * row);
+  for (unsigned int i = 0; i <= stacks; ++i) {
+    const float phi = float(M_PI) * float(i) / float(stacks);
+    for (unsigned int j = 0; j <= stacks; ++j) {
+      const float theta = 2.f * float(M_PI) * float(j) / float(stacks);
+      const float n[3]  = {std::sin(phi) * std::cos(theta), std::cos(phi),
+          std::sin(phi) * std::sin(theta)};
+      for (int k = 0; k < 3; ++k) {
+        rowData[6 * j + k]     = kSphereRadius * n[k];
+        rowData[6 * j + 3 + k] = n[k];
+      }
+    }
+    std::fwrite(rowData.data(), sizeof(float), rowData.size(), pFile);
+  }
+  std::vector<char> faceRow;
+  for (unsigned int i = 0; i < stacks; ++i) {
+    faceRow.clear();
+    for (unsigned int j = 0; j < stacks; ++j) {
+      const uint32_t a = uint32_t(i * row + j), b = uint32_t(a + row);
+      const uint32_t triangles[2][3] = {{a, a + 1, b}, {b, a + 1, b + 1}};
+      for (const auto& triangle : triangles) {
+        const char* pBytes = reinterpret_cast<const char*>(triangle);
+        faceRow.push_back(3);
+        faceRow.insert(faceRow.end(), pBytes, pBytes + sizeof(triangle));
+      }
+    }
+    std::fwrite(faceRow.data(), 1, faceRow.size(), pFile);
+  }
+  return std::fclose(pFile) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  unsigned int megabytes = 512;
+  if (argc > 2 || (argc == 2 && (megabytes = std::atoi(argv[1])) == 0)) {
+    std::printf("usage: %s [megabytes]\n", argv[0]);
+    return 1;
+  }
+  const std::string path = createTempFile("ply_bench", ".ply");
+  bool ok = checkReader(path);
+
+  // 24 bytes per vertex and 26 for its two triangles.
+  const auto stacks = unsigned(std::sqrt(megabytes * 1e6 / 50.0));
+  if (!writeLargeSpherePly(path.c_str(), stacks)) {
+    std::printf("cannot write %s\n", path.c_str());
+    return 1;
+  }
+  FILE* pFile = std::fopen(path.c_str(), "rb");
+  std::fseek(pFile, 0, SEEK_END);
+  const double fileMegabytes = std::ftell(pFile) / 1e6;
+  std::fclose(pFile);
+
+  // Touch every vertex and index, as an uploader would.
+  size_t      numVertices = 0, numIndices = 0;
+  uint32_t    maxIndex    = 0;
+  double      radiusError = 0.0;
+  PlyConsumer consumer;
+  consumer.vertices = [&](size_t, const VertexData* pVertices, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      radiusError = std::max(radiusError,
+          double(std::fabs(Math::length(pVertices[i].position) -
+                           kSphereRadius)));
+    }
+    numVertices += count;
+    return true;
+  };
+  consumer.triangles = [&](const uint32_t* pIndices, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      maxIndex = std::max(maxIndex, pIndices[i]);
+    }
+    numIndices += count;
+    return true;
+  };
+
+  const double rssBefore = peakRssMegabytes();
+  const auto   start     = std::chrono::steady_clock::now();
+  std::string  error;
+  const bool   streamed  = streamPly(path.c_str(), consumer, &error);
+  const double seconds   = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start)
+                             .count();
+  const double rssAfter = peakRssMegabytes();
+  std::remove(path.c_str());
+  if (!streamed) {
+    std::printf("%s\n", error.c_str());
+    return 1;
+  }
+
+  const size_t row = size_t(stacks) + 1;
+  ok = check(numVertices == row * row &&
+                 numIndices == size_t(stacks) * stacks * 6 &&
+                 maxIndex == row * row - 1 && radiusError < 1e-5,
+           "large sphere streams completely") &&
+       ok;
+  // The window and one chunk of each kind, plus allocator slack.
+  ok = check(rssAfter - rssBefore < 32.0, "peak RSS stays bounded") && ok;
+  std::printf("\n%.1f MB, %zu vertices, %zu triangles in %.2f s: %.0f MB/s\n",
+      fileMegabytes, numVertices, numIndices / 3, seconds,
+      fileMegabytes / seconds);
+  std::printf("peak RSS %.1f MB before reading, %.1f MB after\n", rssBefore,
+      rssAfter);
+  return ok ? 0 : 1;
+}
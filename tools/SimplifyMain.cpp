@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "ObjLoader.hpp"
+
+namespace {
+
+// Largest distance from the sphere of radius kSphereRadius over the
+// vertices, edge midpoints and centroids of a mesh's triangles. Flat
+// triangles sag inward the most around their centroids.
+float sphereDeviation(const Mesh& mesh) {
+  const std::vector<shader_types::VertexData> vertices = mesh.getVertices();
+  const std::vector<uint32_t>                 indices  = mesh.getIndices();
+
+  float deviation = 0.f;
+  auto  sample    = [&](const Math::float3& p) {
+    deviation = std::max(
+        deviation, fabsf(Math::length(p) - kSphereRadius));
+  };
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    const Math::float3& a = vertices[indices[i + 0]].position;
+    const Math::float3& b = vertices[indices[i + 1]].position;
+    const Math::float3& c = vertices[indices[i + 2]].position;
+    sample(a);
+    sample((a + b) * 0.5f);
+    sample((b + c) * 0.5f);
+    sample((c + a) * 0.5f);
+    sample((a + b + c) * (1.f / 3.f));
+  }
+  return deviation;
+}
+
+// `mesh` with three vertices of its own per triangle, all with the face
+// normal, so that every position is shared by several vertices.
+ObjMesh flatShaded(const Mesh& mesh) {
+  const std::vector<shader_types::VertexData> vertices = mesh.getVertices();
+  const std::vector<uint32_t>                 indices  = mesh.getIndices();
+
+  std::vector<shader_types::VertexData> flat(indices.size());
+  std::vector<uint32_t>                 flatIndices(indices.size());
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    const Math::float3 normal = Math::normalize(Math::cross(
+        vertices[indices[i + 1]].position - vertices[indices[i]].position,
+        vertices[indices[i + 2]].position - vertices[indices[i]].position));
+    for (size_t k = i; k < i + 3; ++k) {
+      flat[k]        = vertices[indices[k]];
+      flat[k].normal = normal;
+      flatIndices[k] = uint32_t(k);
+    }
+  }
+  return ObjMesh(std::move(flat), std::move(flatIndices));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  unsigned int stacks     = 1024;
+  unsigned int numThreads = std::thread::hardware_concurrency();
+  if (argc > 3 || (argc >= 2 && (stacks = std::atoi(argv[1])) == 0) ||
+      (argc == 3 && (numThreads = std::atoi(argv[2])) == 0)) {
+    std::printf("usage: %s [sphere-stacks] [threads]\n", argv[0]);
+    return 1;
+  }
+
+  JobSystem        jobSystem(numThreads);
+  const SphereMesh sphere(kSphereRadius, stacks, stacks);
+  std::printf("sphere %ux%u, %zu triangles, %u threads\n", stacks, stacks,
+      sphere.indexCount() / 3, jobSystem.numThreads());
+  std::printf("%-8s %10s %10s %10s %12s %12s %16s\n", "target", "triangles",
+      "vertices", "ms", "error", "deviation", "analytic dev.");
+
+  // Each level is simplified from the full sphere and compared with the
+  // analytic sphere of about the same triangle count (2 * stacks^2).
+  for (unsigned int divisor : {4u, 16u, 64u, 256u, 1024u}) {
+    const size_t target = sphere.indexCount() / 3 / divisor;
+    auto         start  = std::chrono::steady_clock::now();
+    const SimplifiedMesh simplified(sphere, target, HUGE_VALF, jobSystem);
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    const unsigned int analyticStacks = std::max(
+        2u, unsigned(std::lround(std::sqrt(double(target) / 2.0))));
+    std::printf("1/%-6u %10zu %10zu %10.1f %12.3g %12.3g %16.3g\n", divisor,
+        simplified.indexCount() / 3, simplified.vertexCount(),
+        elapsed.count(), simplified.error(), sphereDeviation(simplified),
+        sphereDeviation(
+            SphereMesh(kSphereRadius, analyticStacks, analyticStacks)));
+  }
+
+  // An error bound stops collapsing early instead of hitting the target.
+  const float          maxError = 1e-4f;
+  const SimplifiedMesh bounded(sphere, 0, maxError, jobSystem);
+  std::printf("error <= %g: %zu triangles, error %.3g\n", maxError,
+      bounded.indexCount() / 3, bounded.error());
+
+  // Hard edges are attribute seams. Seam points slide only along seams,
+  // so a flat-shaded mesh, all seams, still simplifies; the cube's corners
+  // cannot slide without cutting it, which an error bound stops.
+  const SphereMesh                         coarse(kSphereRadius, 64, 64);
+  const ObjMesh                            flat = flatShaded(coarse);
+  const std::vector<std::unique_ptr<Mesh>> lods = createSimplifiedLods(
+      flat, 4, jobSystem);
+  std::printf("flat-shaded sphere 64x64 LODs:");
+  for (const std::unique_ptr<Mesh>& lod : lods) {
+    std::printf(" %zu", lod->indexCount() / 3);
+  }
+  const auto           cube = createMesh(MeshType::Cube);
+  const SimplifiedMesh simplifiedCube(*cube, 2, 0.01f, jobSystem);
+  std::printf("\ncube: %zu -> %zu triangles\n", cube->indexCount() / 3,
+      simplifiedCube.indexCount() / 3);
+  return 0;
+}
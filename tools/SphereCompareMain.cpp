@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "Mesh.hpp"
+
+namespace {
+
+struct MeshCheck {
+  double error;       // largest distance from the sphere
+  bool   outward;     // every triangle faces along cross(c - a, b - a)
+  bool   watertight;  // after welding, every edge has one opposite twin
+};
+
+MeshCheck checkSphere(const Mesh& mesh, float radius) {
+  std::vector<shader_types::VertexData> vertices;
+  std::vector<uint32_t>                 indices;
+  weldMesh(mesh, &vertices, &indices);
+
+  // Directed edges packed as (from << 32) | to.
+  MeshCheck             check = {0.0, true, true};
+  std::vector<uint64_t> edges;
+  edges.reserve(indices.size());
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    const Math::float3& a = vertices[indices[i + 0]].position;
+    const Math::float3& b = vertices[indices[i + 1]].position;
+    const Math::float3& c = vertices[indices[i + 2]].position;
+    check.error   = std::max(
+        check.error, inscribedTriangleError(a, b, c, radius));
+    check.outward = check.outward &&
+                    Math::dot(Math::cross(c - a, b - a), a + b + c) > 0.f;
+    for (int k = 0; k < 3; ++k) {
+      edges.push_back(uint64_t(indices[i + k]) << 32 |
+                      indices[i + (k + 1) % 3]);
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  check.watertight =
+      std::adjacent_find(edges.begin(), edges.end()) == edges.end();
+  for (size_t i = 0; i < edges.size() && check.watertight; ++i) {
+    const uint64_t twin = edges[i] << 32 | edges[i] >> 32;
+    check.watertight    = std::binary_search(edges.begin(), edges.end(), twin);
+  }
+  return check;
+}
+
+// UV spheres come with as many slices as stacks, as the renderer uses
+// them, and with twice as many, which keeps their equatorial quads square
+// and is the best case for them.
+double uvSphereError(float radius, unsigned int stacks, unsigned int slices) {
+  const SphereMesh sphere(radius, stacks, slices);
+  const std::vector<shader_types::VertexData> vertices = sphere.getVertices();
+  const std::vector<uint32_t>                 indices  = sphere.getIndices();
+  double                                      error    = 0.0;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    error = std::max(error,
+        inscribedTriangleError(vertices[indices[i + 0]].position,
+            vertices[indices[i + 1]].position,
+            vertices[indices[i + 2]].position, radius));
+  }
+  return error;
+}
+
+struct Row {
+  const char*           name;
+  std::unique_ptr<Mesh> mesh;
+  float                 predicted;  // the error the mesh was built for
+};
+
+}  // namespace
+
+int main() {
+  const float radius = kSphereRadius;
+  struct Target {
+    const char*        label;
+    TessellationTarget target;
+  };
+  const Target targets[] = {
+      {"1e-2 r", {1e-2f * radius}},
+      {"1e-3 r", {1e-3f * radius}},
+      {"1e-4 r", {1e-4f * radius}},
+      {"1e-5 r", {1e-5f * radius}},
+      {"0.5px@100px", TessellationTarget::screenSpace(radius, 100.f, 0.5f)},
+  };
+
+  bool ok = true;
+  std::printf("sphere radius %g; \"uv 1:n\" has n slices per stack\n",
+      radius);
+  std::printf("%-12s %-10s %10s %10s %12s %12s  %s\n", "target", "mesh",
+      "triangles", "vertices", "error", "tri/icos.", "checks");
+  for (const Target& t : targets) {
+    const float maxError = t.target.maxError;
+    auto        uvStacks = [&](unsigned int slicesPerStack) {
+      return tessellationLevelForError(maxError, 4096, [&](unsigned int n) {
+        return uvSphereError(radius, n, slicesPerStack * n);
+      });
+    };
+    const unsigned int square = uvStacks(1);
+    const unsigned int wide   = uvStacks(2);
+
+    Row rows[4];
+    rows[0] = {"icosphere", std::make_unique<IcosphereMesh>(radius, t.target),
+        0.f};
+    rows[1] = {"cube", std::make_unique<CubeSphereMesh>(radius, t.target),
+        0.f};
+    rows[2] = {"uv 1:1", std::make_unique<SphereMesh>(radius, square, square),
+        float(uvSphereError(radius, square, square))};
+    rows[3] = {"uv 1:2", std::make_unique<SphereMesh>(radius, wide, 2 * wide),
+        float(uvSphereError(radius, wide, 2 * wide))};
+    rows[0].predicted = static_cast<IcosphereMesh&>(*rows[0].mesh).maxError();
+    rows[1].predicted = static_cast<CubeSphereMesh&>(*rows[1].mesh).maxError();
+
+    const double icosphereTriangles = double(rows[0].mesh->indexCount() / 3);
+    for (const Row& row : rows) {
+      const MeshCheck check = checkSphere(*row.mesh, radius);
+      // Welding moves nothing, so the measured error matches the
+      // prediction up to float rounding of the positions.
+      const bool pass = check.outward && check.watertight &&
+                        check.error <= maxError * 1.001 + 1e-7 &&
+                        std::fabs(check.error - row.predicted) <=
+                            1e-3 * maxError + 1e-7;
+      ok = ok && pass;
+      std::printf("%-12s %-10s %10zu %10zu %12.3g %12.2f  %s\n", t.label,
+          row.name, row.mesh->indexCount() / 3, row.mesh->vertexCount(),
+          check.error, double(row.mesh->indexCount() / 3) / icosphereTriangles,
+          pass ? "ok" : "FAIL");
+    }
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "VertexQuantization.hpp"
+
+namespace {
+
+using shader_types::QuantizedVertexData;
+using shader_types::VertexData;
+using shader_types::VertexQuantization;
+
+struct ErrorStats {
+  float maxPositionError;  // in units of the per-axis bound
+  float maxNormalError;    // radians
+};
+
+ErrorStats measureErrors(const std::vector<VertexData>& vertices) {
+  const VertexQuantization quantization = computeVertexQuantization(
+      vertices.data(), vertices.size());
+  std::vector<QuantizedVertexData> quantized(vertices.size());
+  quantizeVertices(
+      quantized.data(), vertices.data(), vertices.size(), quantization);
+
+  // Half a step per axis, plus float rounding relative to the magnitudes
+  // involved.
+  const Math::float3& o     = quantization.offset;
+  const Math::float3& s     = quantization.scale;
+  const float         slack = 1e-6f * (fabsf(o.x) + fabsf(o.y) + fabsf(o.z) +
+                                   65535.f * (s.x + s.y + s.z));
+  const float         bound[3] = {
+      0.5f * s.x + slack, 0.5f * s.y + slack, 0.5f * s.z + slack};
+
+  ErrorStats stats = {0.f, 0.f};
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    const Math::float3  p     = dequantizePosition(quantized[i], quantization);
+    const Math::float3& exact = vertices[i].position;
+    const float error[3] = {fabsf(p.x - exact.x), fabsf(p.y - exact.y),
+        fabsf(p.z - exact.z)};
+    for (int axis = 0; axis < 3; ++axis) {
+      stats.maxPositionError = std::max(
+          stats.maxPositionError, error[axis] / bound[axis]);
+    }
+
+    // atan2 keeps precision for tiny angles, where acos(dot) does not.
+    const Math::float3 n      = decodeOctahedral(quantized[i].normal);
+    const Math::float3 normal = Math::normalize(vertices[i].normal);
+    const float        angle  = atan2f(
+        Math::length(Math::cross(n, normal)), Math::dot(n, normal));
+    stats.maxNormalError = std::max(stats.maxNormalError, angle);
+  }
+  return stats;
+}
+
+std::vector<VertexData> randomNormals(size_t count) {
+  std::mt19937                    rng(1234);
+  std::normal_distribution<float> gauss;
+  std::vector<VertexData>         vertices(count);
+  for (VertexData& v : vertices) {
+    Math::float3 n;
+    do {
+      n = {gauss(rng), gauss(rng), gauss(rng)};
+    } while (Math::length(n) < 1e-3f);
+    v.position = {0.f, 0.f, 0.f};
+    v.normal   = Math::normalize(n);
+  }
+  return vertices;
+}
+
+// Fetch only: touch every attribute, so the time is mostly memory traffic.
+float fetchFloat(const std::vector<VertexData>& vertices) {
+  float sum = 0.f;
+  for (const VertexData& v : vertices) {
+    sum += v.position.x + v.position.y + v.position.z + v.normal.x +
+           v.normal.y + v.normal.z;
+  }
+  return sum;
+}
+
+float fetchQuantized(const std::vector<QuantizedVertexData>& vertices) {
+  uint32_t sum = 0;
+  for (const QuantizedVertexData& v : vertices) {
+    sum += v.position[0] + v.position[1] + v.position[2] +
+           uint16_t(v.normal[0]) + uint16_t(v.normal[1]);
+  }
+  return float(sum);
+}
+
+// A vertex stage stand-in: fetch, decode and transform every vertex. The
+// checksum keeps the work alive.
+float transformFloat(const std::vector<VertexData>& vertices,
+    const Math::float4x4& m) {
+  float sum = 0.f;
+  for (const VertexData& v : vertices) {
+    const Math::float4 clip = m * Math::float4{
+        v.position.x, v.position.y, v.position.z, 1.f};
+    sum += clip.x + clip.w + v.normal.x;
+  }
+  return sum;
+}
+
+float transformQuantized(const std::vector<QuantizedVertexData>& vertices,
+    const VertexQuantization& quantization, const Math::float4x4& m) {
+  float sum = 0.f;
+  for (const QuantizedVertexData& v : vertices) {
+    const Math::float3 p    = dequantizePosition(v, quantization);
+    const Math::float4 clip = m * Math::float4{p.x, p.y, p.z, 1.f};
+    sum += clip.x + clip.w + decodeOctahedral(v.normal).x;
+  }
+  return sum;
+}
+
+// SphereMesh's vertices the way it used to make them, with five trig
+// calls and three divides per vertex.
+void writeSphereTrig(VertexData* pVertices, float radius, unsigned int stacks,
+    unsigned int slices) {
+  for (unsigned int i = 0; i <= stacks; ++i) {
+    float V   = static_cast<float>(i) / static_cast<float>(stacks);
+    float phi = V * M_PI;
+    for (unsigned int j = 0; j <= slices; ++j) {
+      float U     = static_cast<float>(j) / static_cast<float>(slices);
+      float theta = U * (M_PI * 2);
+
+      float x = radius * sinf(phi) * cosf(theta);
+      float y = radius * cosf(phi);
+      float z = radius * sinf(phi) * sinf(theta);
+
+      *pVertices++ = {{x, y, z}, {x / radius, y / radius, z / radius}};
+    }
+  }
+}
+
+template <typename Fn>
+double bestMs(int runs, Fn&& fn) {
+  double best = 1e30;
+  for (int run = 0; run < runs; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  unsigned int stacks = 2047;
+  if (argc > 2 || (argc == 2 && (stacks = std::atoi(argv[1])) == 0)) {
+    std::printf("usage: %s [sphere-stacks]\n", argv[0]);
+    return 1;
+  }
+
+  // Error bounds.
+  std::vector<std::pair<std::string, std::vector<VertexData>>> meshes;
+  const auto lods = createSphereLods();
+  for (size_t lod = 0; lod < lods.size(); ++lod) {
+    meshes.push_back({"sphere LOD " + std::to_string(lod),
+        lods[lod]->getVertices()});
+  }
+  meshes.push_back({"sphere 256x256",
+      SphereMesh(kSphereRadius, 256, 256).getVertices()});
+  meshes.push_back({"cube", createMesh(MeshType::Cube)->getVertices()});
+  meshes.push_back({"random normals", randomNormals(1 << 20)});
+
+  bool ok = true;
+  std::printf("%-16s %22s %22s\n", "mesh", "position error/bound",
+      "normal error (rad)");
+  for (const auto& [name, vertices] : meshes) {
+    const ErrorStats stats = measureErrors(vertices);
+    const bool       pass  = stats.maxPositionError <= 1.f &&
+                      stats.maxNormalError <= kMaxNormalError;
+    ok = ok && pass;
+    std::printf("%-16s %22.3f %22.3g  %s\n", name.c_str(),
+        stats.maxPositionError, stats.maxNormalError, pass ? "ok" : "FAIL");
+  }
+  std::printf("normal error bound: %.3g rad\n", kMaxNormalError);
+  int16_t zero[2] = {-1, -1};
+  encodeOctahedral({0.f, 0.f, 0.f}, zero);
+  const bool zeroPass = zero[0] == 0 && zero[1] == 0;
+  ok                  = ok && zeroPass;
+  std::printf("zero normal encodes as +Z  %s\n\n", zeroPass ? "ok" : "FAIL");
+
+  // Bandwidth.
+  const SphereMesh              sphere(kSphereRadius, stacks, stacks);
+  const std::vector<VertexData> vertices = sphere.getVertices();
+  const VertexQuantization      quantization = computeVertexQuantization(
+      vertices.data(), vertices.size());
+  std::vector<QuantizedVertexData> quantized(vertices.size());
+  quantizeVertices(
+      quantized.data(), vertices.data(), vertices.size(), quantization);
+
+  const Math::float4x4 m = Math::makePerspective(1.f, 1.f, 0.03f, 500.f) *
+                           Math::makeTranslate({0.f, 0.f, -2.f});
+  volatile float sink = 0.f;
+  const double   fetchMs[2] = {
+      bestMs(5, [&] { sink = sink + fetchFloat(vertices); }),
+      bestMs(5, [&] { sink = sink + fetchQuantized(quantized); })};
+  const double transformMs[2] = {
+      bestMs(5, [&] { sink = sink + transformFloat(vertices, m); }),
+      bestMs(5, [&] {
+        sink = sink + transformQuantized(quantized, quantization, m);
+      })};
+
+  const char*  names[2]      = {"float", "quantized"};
+  const size_t bytesPerVertex[2] = {
+      sizeof(VertexData), sizeof(QuantizedVertexData)};
+  std::printf("%zu vertices, best of 5\n", vertices.size());
+  std::printf("%-10s %10s %10s %12s %10s %14s\n", "format", "B/vertex", "MB",
+      "fetch ms", "GB/s", "transform ms");
+  for (int f = 0; f < 2; ++f) {
+    const double bytes = double(vertices.size()) * bytesPerVertex[f];
+    std::printf("%-10s %10zu %10.1f %12.2f %10.2f %14.2f\n", names[f],
+        bytesPerVertex[f], bytes / 1e6, fetchMs[f], bytes / fetchMs[f] / 1e6,
+        transformMs[f]);
+  }
+
+  // Generation of a stress-test sphere, against writing the same bytes.
+  const unsigned int      generateStacks = 4096;
+  const SphereMesh        big(kSphereRadius, generateStacks, generateStacks);
+  std::vector<VertexData> generated(big.vertexCount());
+  std::vector<VertexData> reference(big.vertexCount());
+  JobSystem               jobSystem(std::thread::hardware_concurrency());
+  const double            generateMs[4] = {
+      bestMs(3,
+          [&] {
+            writeSphereTrig(reference.data(), kSphereRadius, generateStacks,
+                generateStacks);
+          }),
+      bestMs(3, [&] { big.writeVertices(generated.data()); }),
+      bestMs(3, [&] { big.writeVertices(generated.data(), jobSystem); }),
+      bestMs(3, [&] {
+        jobSystem.parallelFor(generated.size(), 1 << 16,
+            [&](size_t begin, size_t end) {
+              std::fill(generated.begin() + begin, generated.begin() + end,
+                  VertexData{});
+            });
+      })};
+  big.writeVertices(generated.data(), jobSystem);
+
+  // Positions come out bit-identical; normals no longer go through a
+  // divide, so they may differ in the last bit.
+  float maxNormalDelta = 0.f;
+  bool  samePositions  = true;
+  for (size_t i = 0; i < generated.size(); ++i) {
+    const Math::float3& p = generated[i].position;
+    const Math::float3& q = reference[i].position;
+    samePositions = samePositions && p.x == q.x && p.y == q.y && p.z == q.z;
+    maxNormalDelta = std::max(maxNormalDelta,
+        Math::length(generated[i].normal - reference[i].normal));
+  }
+  const bool generatePass = samePositions && maxNormalDelta <= 1e-6f;
+  ok                      = ok && generatePass;
+
+  const char*  generateNames[4] = {
+      "trig per vertex", "trig tables", "tables, parallel", "fill"};
+  const double generateBytes = double(generated.size()) * sizeof(VertexData);
+  std::printf("\nsphere %ux%u generation, %zu vertices, %u threads, best "
+              "of 3\n",
+      generateStacks, generateStacks, generated.size(),
+      jobSystem.numThreads());
+  std::printf("%-18s %10s %10s\n", "method", "ms", "GB/s");
+  for (int m = 0; m < 4; ++m) {
+    std::printf("%-18s %10.1f %10.2f\n", generateNames[m], generateMs[m],
+        generateBytes / generateMs[m] / 1e6);
+  }
+  std::printf("positions %s, normal difference %.3g  %s\n",
+      samePositions ? "identical" : "differ", maxNormalDelta,
+      generatePass ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}